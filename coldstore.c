@@ -0,0 +1,559 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "coldstore.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define COLDSTORE_WARM_SLOTS (COLDSTORE_BLOCK_ENTRIES * 2)     // Power of two
+#define COLDSTORE_MAX_ENTRY_BYTES 72    // Worst case of one encoded entry
+#define COLDSTORE_MERGE_RATIO 2         // Merge a block into the next older one up to this size ratio
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+static uint32_t hash_bytes(uint32_t h, const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 16777619u;  // FNV-1a
+    }
+    return h;
+}
+
+static uint32_t hash_entry_key(const ColdEntry* e) {
+    uint32_t h = hash_bytes(2166136261u, &e->path_id, sizeof(e->path_id));
+    h = hash_bytes(h, &e->protocol, 1);
+    h = hash_bytes(h, &e->ip_version, 1);
+    h = hash_bytes(h, &e->remote_port, sizeof(e->remote_port));
+    return hash_bytes(h, e->remote_addr, 16);
+}
+
+// Block order: path, protocol, IP version, address (byte order), port
+static int compare_entry_keys(const ColdEntry* a, const ColdEntry* b) {
+    if (a->path_id != b->path_id) return (a->path_id < b->path_id) ? -1 : 1;
+    if (a->protocol != b->protocol) return (a->protocol < b->protocol) ? -1 : 1;
+    if (a->ip_version != b->ip_version) return (a->ip_version < b->ip_version) ? -1 : 1;
+    int c = memcmp(a->remote_addr, b->remote_addr, 16);
+    if (c != 0) return c;
+    if (a->remote_port != b->remote_port) return (a->remote_port < b->remote_port) ? -1 : 1;
+    return 0;
+}
+
+static int qsort_entries(const void* a, const void* b) {
+    return compare_entry_keys((const ColdEntry*)a, (const ColdEntry*)b);
+}
+
+static void merge_entry(ColdEntry* into, const ColdEntry* from) {
+    into->count += from->count;
+    if (from->first_seen < into->first_seen) into->first_seen = from->first_seen;
+    if (from->last_seen > into->last_seen) into->last_seen = from->last_seen;
+    into->total_duration += from->total_duration;
+}
+
+// ============================================================================
+// Interned Paths
+// ============================================================================
+
+static int grow_path_slots(ColdStore* store) {
+    int slot_count = store->path_slot_count ? store->path_slot_count * 2 : 256;
+    int* slots = (int*)malloc((size_t)slot_count * sizeof(int));
+    if (!slots) {
+        return -1;
+    }
+    for (int i = 0; i < slot_count; i++) {
+        slots[i] = -1;
+    }
+    for (int id = 0; id < store->path_count; id++) {
+        const char* path = store->paths[id];
+        uint32_t slot = hash_bytes(2166136261u, path, strlen(path)) & (uint32_t)(slot_count - 1);
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & (uint32_t)(slot_count - 1);
+        }
+        slots[slot] = id;
+    }
+
+    free(store->path_slots);
+    store->path_slots = slots;
+    store->path_slot_count = slot_count;
+    return 0;
+}
+
+// Id of `path`, interning it on first use. -1 when out of memory
+static int intern_path(ColdStore* store, const char* path) {
+    if ((store->path_count + 1) * 2 > store->path_slot_count && grow_path_slots(store) != 0) {
+        return -1;
+    }
+
+    size_t length = strlen(path);
+    uint32_t mask = (uint32_t)(store->path_slot_count - 1);
+    uint32_t slot = hash_bytes(2166136261u, path, length) & mask;
+    while (store->path_slots[slot] >= 0) {
+        int id = store->path_slots[slot];
+        if (strcmp(store->paths[id], path) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (store->path_count == store->path_capacity) {
+        int capacity = store->path_capacity ? store->path_capacity * 2 : 64;
+        char** paths = (char**)realloc(store->paths, (size_t)capacity * sizeof(char*));
+        if (!paths) {
+            return -1;
+        }
+        store->paths = paths;
+        store->path_capacity = capacity;
+    }
+
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, path, length + 1);
+
+    int id = store->path_count++;
+    store->paths[id] = copy;
+    store->path_slots[slot] = id;
+    store->path_bytes += length + 1 + sizeof(char*) + 2 * sizeof(int);
+    return id;
+}
+
+static int find_path(const ColdStore* store, const char* path) {
+    if (store->path_slot_count == 0) {
+        return -1;
+    }
+
+    uint32_t mask = (uint32_t)(store->path_slot_count - 1);
+    uint32_t slot = hash_bytes(2166136261u, path, strlen(path)) & mask;
+    while (store->path_slots[slot] >= 0) {
+        int id = store->path_slots[slot];
+        if (strcmp(store->paths[id], path) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Block Encoding
+// ============================================================================
+
+static uint8_t* put_varint(uint8_t* p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, uint64_t* value) {
+    uint64_t result = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        result |= (uint64_t)(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    *value = result | ((uint64_t)*p++ << shift);
+    return p;
+}
+
+static uint32_t ipv4_value(const uint8_t* addr) {
+    return ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) | ((uint32_t)addr[2] << 8) | addr[3];
+}
+
+// Running state shared by the encoder and the decoder
+typedef struct {
+    uint32_t path_id;
+    uint32_t ipv4;
+    uint8_t ipv6[16];
+} CodecState;
+
+static uint8_t* encode_entry(uint8_t* p, CodecState* state, const ColdEntry* e, uint64_t base_time) {
+    p = put_varint(p, e->path_id - state->path_id);
+    state->path_id = e->path_id;
+    *p++ = (uint8_t)(e->protocol | (e->ip_version << 1));
+
+    if (e->ip_version == 0) {
+        // Sorted by address within a path, so the step is usually small
+        uint32_t value = ipv4_value(e->remote_addr);
+        int64_t delta = (int64_t)value - (int64_t)state->ipv4;
+        p = put_varint(p, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));  // Zigzag
+        state->ipv4 = value;
+    } else {
+        int shared = 0;
+        while (shared < 16 && e->remote_addr[shared] == state->ipv6[shared]) {
+            shared++;
+        }
+        *p++ = (uint8_t)shared;
+        memcpy(p, e->remote_addr + shared, 16 - shared);
+        p += 16 - shared;
+        memcpy(state->ipv6, e->remote_addr, 16);
+    }
+
+    p = put_varint(p, e->remote_port);
+    p = put_varint(p, e->count);
+    p = put_varint(p, e->first_seen - base_time);
+    p = put_varint(p, e->last_seen - e->first_seen);
+    return put_varint(p, e->total_duration);
+}
+
+static const uint8_t* decode_entry(const uint8_t* p, CodecState* state, ColdEntry* e, uint64_t base_time) {
+    uint64_t value;
+    p = get_varint(p, &value);
+    state->path_id += (uint32_t)value;
+    e->path_id = state->path_id;
+    e->protocol = *p & 1;
+    e->ip_version = (*p++ >> 1) & 1;
+
+    memset(e->remote_addr, 0, 16);
+    if (e->ip_version == 0) {
+        p = get_varint(p, &value);
+        int64_t delta = (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+        state->ipv4 = (uint32_t)((int64_t)state->ipv4 + delta);
+        e->remote_addr[0] = (uint8_t)(state->ipv4 >> 24);
+        e->remote_addr[1] = (uint8_t)(state->ipv4 >> 16);
+        e->remote_addr[2] = (uint8_t)(state->ipv4 >> 8);
+        e->remote_addr[3] = (uint8_t)state->ipv4;
+    } else {
+        int shared = *p++;
+        memcpy(state->ipv6 + shared, p, 16 - shared);
+        p += 16 - shared;
+        memcpy(e->remote_addr, state->ipv6, 16);
+    }
+
+    p = get_varint(p, &value);
+    e->remote_port = (uint16_t)value;
+    p = get_varint(p, &value);
+    e->count = (uint32_t)value;
+    p = get_varint(p, &value);
+    e->first_seen = base_time + value;
+    p = get_varint(p, &value);
+    e->last_seen = e->first_seen + value;
+    p = get_varint(p, &e->total_duration);
+    return p;
+}
+
+// Encode sorted entries into a new block. Returns 0 or -1
+static int encode_block(const ColdEntry* entries, int count, ColdBlock* block) {
+    memset(block, 0, sizeof(ColdBlock));
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t base_time = entries[0].first_seen;
+    uint64_t connections = 0;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].first_seen < base_time) base_time = entries[i].first_seen;
+        connections += entries[i].count;
+    }
+
+    uint8_t* buffer = (uint8_t*)malloc((size_t)count * COLDSTORE_MAX_ENTRY_BYTES);
+    if (!buffer) {
+        return -1;
+    }
+
+    CodecState state = {0};
+    uint8_t* p = buffer;
+    for (int i = 0; i < count; i++) {
+        p = encode_entry(p, &state, &entries[i], base_time);
+    }
+
+    size_t size = (size_t)(p - buffer);
+    uint8_t* data = (uint8_t*)realloc(buffer, size);
+    block->data = data ? data : buffer;
+    block->size = size;
+    block->entries = count;
+    block->connections = connections;
+    block->base_time = base_time;
+    return 0;
+}
+
+// Decode a whole block into `out` (block->entries entries)
+static void decode_block(const ColdBlock* block, ColdEntry* out) {
+    CodecState state = {0};
+    const uint8_t* p = block->data;
+    for (int i = 0; i < block->entries; i++) {
+        p = decode_entry(p, &state, &out[i], block->base_time);
+    }
+}
+
+// ============================================================================
+// Blocks
+// ============================================================================
+
+static void drop_oldest_block(ColdStore* store) {
+    ColdBlock* oldest = &store->blocks[0];
+    store->dropped_connections += oldest->connections;
+    store->block_bytes -= oldest->size;
+    free(oldest->data);
+    memmove(&store->blocks[0], &store->blocks[1], (size_t)(store->block_count - 1) * sizeof(ColdBlock));
+    store->block_count--;
+}
+
+// Merge the two newest blocks into one, adding up shared keys
+static int merge_newest_blocks(ColdStore* store) {
+    ColdBlock* older = &store->blocks[store->block_count - 2];
+    ColdBlock* newer = &store->blocks[store->block_count - 1];
+
+    ColdEntry* a = (ColdEntry*)malloc((size_t)(older->entries + newer->entries) * sizeof(ColdEntry));
+    ColdEntry* merged = (ColdEntry*)malloc((size_t)(older->entries + newer->entries) * sizeof(ColdEntry));
+    if (!a || !merged) {
+        free(a);
+        free(merged);
+        return -1;
+    }
+    ColdEntry* b = a + older->entries;
+    decode_block(older, a);
+    decode_block(newer, b);
+
+    int i = 0, j = 0, count = 0;
+    while (i < older->entries || j < newer->entries) {
+        int c = (i == older->entries) ? 1 : (j == newer->entries) ? -1 : compare_entry_keys(&a[i], &b[j]);
+        if (c < 0) {
+            merged[count++] = a[i++];
+        } else if (c > 0) {
+            merged[count++] = b[j++];
+        } else {
+            merged[count] = a[i++];
+            merge_entry(&merged[count++], &b[j++]);
+        }
+    }
+
+    ColdBlock block;
+    int result = encode_block(merged, count, &block);
+    free(a);
+    free(merged);
+    if (result != 0) {
+        return -1;
+    }
+
+    store->block_bytes -= older->size + newer->size;
+    free(older->data);
+    free(newer->data);
+    *older = block;
+    store->block_bytes += block.size;
+    store->block_count--;
+    return 0;
+}
+
+// Turn the warm table into a block. Returns 0 or -1 (warm table kept)
+static int seal_warm(ColdStore* store) {
+    if (store->warm_count == 0) {
+        return 0;
+    }
+
+    if (store->block_count == store->block_capacity) {
+        int capacity = store->block_capacity ? store->block_capacity * 2 : 16;
+        ColdBlock* blocks = (ColdBlock*)realloc(store->blocks, (size_t)capacity * sizeof(ColdBlock));
+        if (!blocks) {
+            return -1;
+        }
+        store->blocks = blocks;
+        store->block_capacity = capacity;
+    }
+
+    qsort(store->warm, (size_t)store->warm_count, sizeof(ColdEntry), qsort_entries);
+    ColdBlock block;
+    if (encode_block(store->warm, store->warm_count, &block) != 0) {
+        return -1;
+    }
+    store->blocks[store->block_count++] = block;
+    store->block_bytes += block.size;
+
+    store->warm_count = 0;
+    for (int i = 0; i < COLDSTORE_WARM_SLOTS; i++) {
+        store->warm_slots[i] = -1;
+    }
+
+    // Size-tiered: a key ends up in O(log n) blocks, each entry is re-encoded O(log n) times
+    while (store->block_count >= 2 &&
+           store->blocks[store->block_count - 2].entries <=
+               COLDSTORE_MERGE_RATIO * store->blocks[store->block_count - 1].entries) {
+        if (merge_newest_blocks(store) != 0) {
+            break;
+        }
+    }
+
+    while (store->block_count > 1 && store->block_bytes + store->path_bytes > store->max_bytes) {
+        drop_oldest_block(store);
+    }
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int coldstore_init(ColdStore* store, size_t max_bytes) {
+    memset(store, 0, sizeof(ColdStore));
+    store->max_bytes = max_bytes ? max_bytes : COLDSTORE_DEFAULT_MAX_BYTES;
+
+    store->warm = (ColdEntry*)malloc(COLDSTORE_BLOCK_ENTRIES * sizeof(ColdEntry));
+    store->warm_slots = (int*)malloc(COLDSTORE_WARM_SLOTS * sizeof(int));
+    if (!store->warm || !store->warm_slots || grow_path_slots(store) != 0) {
+        coldstore_free(store);
+        return -1;
+    }
+    for (int i = 0; i < COLDSTORE_WARM_SLOTS; i++) {
+        store->warm_slots[i] = -1;
+    }
+    return 0;
+}
+
+void coldstore_free(ColdStore* store) {
+    for (int i = 0; i < store->path_count; i++) {
+        free(store->paths[i]);
+    }
+    for (int i = 0; i < store->block_count; i++) {
+        free(store->blocks[i].data);
+    }
+    free(store->paths);
+    free(store->path_slots);
+    free(store->warm);
+    free(store->warm_slots);
+    free(store->blocks);
+    memset(store, 0, sizeof(ColdStore));
+}
+
+int coldstore_add(ColdStore* store, const ColdSummary* summary) {
+    if (!store->warm) {
+        return -1;
+    }
+
+    int path_id = intern_path(store, summary->process_path ? summary->process_path : "");
+    if (path_id < 0) {
+        return -1;
+    }
+
+    ColdEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.path_id = (uint32_t)path_id;
+    entry.protocol = summary->protocol & 1;
+    entry.ip_version = summary->ip_version & 1;
+    entry.remote_port = summary->remote_port;
+    memcpy(entry.remote_addr, summary->remote_addr, entry.ip_version ? 16 : 4);
+    entry.count = summary->count;
+    entry.first_seen = summary->first_seen;
+    entry.last_seen = (summary->last_seen > summary->first_seen) ? summary->last_seen : summary->first_seen;
+    entry.total_duration = summary->total_duration;
+
+    uint32_t slot = hash_entry_key(&entry) & (COLDSTORE_WARM_SLOTS - 1);
+    while (store->warm_slots[slot] >= 0) {
+        ColdEntry* existing = &store->warm[store->warm_slots[slot]];
+        if (compare_entry_keys(existing, &entry) == 0) {
+            merge_entry(existing, &entry);
+            return 0;
+        }
+        slot = (slot + 1) & (COLDSTORE_WARM_SLOTS - 1);
+    }
+
+    store->warm[store->warm_count] = entry;
+    store->warm_slots[slot] = store->warm_count++;
+
+    if (store->warm_count == COLDSTORE_BLOCK_ENTRIES) {
+        return seal_warm(store);
+    }
+    return 0;
+}
+
+int coldstore_query(const ColdStore* store, const char* process_path, ColdSummary** summaries, int* count) {
+    *summaries = NULL;
+    *count = 0;
+
+    int path_id = -1;
+    if (process_path) {
+        path_id = find_path(store, process_path);
+        if (path_id < 0) {
+            return 0;
+        }
+    }
+
+    int largest = 0;
+    size_t total = (size_t)store->warm_count;
+    for (int b = 0; b < store->block_count; b++) {
+        total += (size_t)store->blocks[b].entries;
+        if (store->blocks[b].entries > largest) largest = store->blocks[b].entries;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    ColdEntry* matches = (ColdEntry*)malloc(total * sizeof(ColdEntry));
+    ColdEntry* decoded = (ColdEntry*)malloc((size_t)(largest > 0 ? largest : 1) * sizeof(ColdEntry));
+    if (!matches || !decoded) {
+        free(matches);
+        free(decoded);
+        return -1;
+    }
+
+    int found = 0;
+    for (int b = 0; b < store->block_count; b++) {
+        decode_block(&store->blocks[b], decoded);
+        for (int i = 0; i < store->blocks[b].entries; i++) {
+            if (path_id < 0 || decoded[i].path_id == (uint32_t)path_id) {
+                matches[found++] = decoded[i];
+            }
+        }
+    }
+    for (int i = 0; i < store->warm_count; i++) {
+        if (path_id < 0 || store->warm[i].path_id == (uint32_t)path_id) {
+            matches[found++] = store->warm[i];
+        }
+    }
+    free(decoded);
+
+    // One summary per key across blocks
+    qsort(matches, (size_t)found, sizeof(ColdEntry), qsort_entries);
+    int unique = 0;
+    for (int i = 0; i < found; i++) {
+        if (unique > 0 && compare_entry_keys(&matches[unique - 1], &matches[i]) == 0) {
+            merge_entry(&matches[unique - 1], &matches[i]);
+        } else {
+            matches[unique++] = matches[i];
+        }
+    }
+
+    ColdSummary* out = (unique > 0) ? (ColdSummary*)malloc((size_t)unique * sizeof(ColdSummary)) : NULL;
+    if (unique > 0 && !out) {
+        free(matches);
+        return -1;
+    }
+    for (int i = 0; i < unique; i++) {
+        const ColdEntry* e = &matches[i];
+        out[i].process_path = store->paths[e->path_id];
+        out[i].protocol = e->protocol;
+        out[i].ip_version = e->ip_version;
+        out[i].remote_port = e->remote_port;
+        memcpy(out[i].remote_addr, e->remote_addr, 16);
+        out[i].count = e->count;
+        out[i].first_seen = e->first_seen;
+        out[i].last_seen = e->last_seen;
+        out[i].total_duration = e->total_duration;
+    }
+    free(matches);
+
+    *summaries = out;
+    *count = unique;
+    return 0;
+}
+
+void coldstore_get_stats(const ColdStore* store, ColdStoreStats* stats) {
+    memset(stats, 0, sizeof(ColdStoreStats));
+    stats->summaries = store->warm_count;
+    stats->blocks = store->block_count;
+    for (int b = 0; b < store->block_count; b++) {
+        stats->summaries += store->blocks[b].entries;
+        stats->connections += store->blocks[b].connections;
+    }
+    for (int i = 0; i < store->warm_count; i++) {
+        stats->connections += store->warm[i].count;
+    }
+    stats->dropped_connections = store->dropped_connections;
+    stats->bytes = store->block_bytes + store->path_bytes +
+                   (store->warm ? COLDSTORE_BLOCK_ENTRIES * sizeof(ColdEntry) + COLDSTORE_WARM_SLOTS * sizeof(int) : 0);
+}
@@ -0,0 +1,108 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_COLDSTORE_H
+#define PEEK_COLDSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cold tier of the connection history. Connections leaving the seen store
+// are folded into one summary per (process image, remote endpoint, protocol):
+// connection count, first and last seen, total duration.
+//
+// Summaries collect in a small warm hash table; every COLDSTORE_BLOCK_ENTRIES
+// distinct keys it is sealed into an immutable block, sorted by key and
+// delta-encoded: LEB128 varints for ids, ports, counts and times (relative to
+// the block's earliest time), IPv4 addresses as the difference to the previous
+// one, IPv6 addresses as the length of the prefix shared with the previous one
+// plus the remaining bytes. A summary takes 10-30 bytes against ~900 for a
+// NetworkConnection, before several connections share one summary.
+//
+// Blocks are merged size-tiered (a key then appears once per block) and the
+// oldest block is dropped when the tier exceeds its byte budget. Process
+// paths are interned once. Portable (no Windows dependencies), like
+// connstore.c; not thread-safe, the owner serializes calls.
+
+#define COLDSTORE_BLOCK_ENTRIES 1024                // Warm summaries per sealed block
+#define COLDSTORE_DEFAULT_MAX_BYTES (16 * 1024 * 1024)
+
+typedef struct {
+    const char* process_path;       // Interned: valid until coldstore_free
+    uint8_t protocol;               // Protocol / IPVersion values from network.h
+    uint8_t ip_version;
+    uint16_t remote_port;
+    uint8_t remote_addr[16];        // IPv4 in the first 4 bytes (network order)
+    uint32_t count;                 // Connections folded into this summary
+    uint64_t first_seen;            // Milliseconds since 1601 (FILETIME / 10000)
+    uint64_t last_seen;
+    uint64_t total_duration;        // Sum of last_seen - first_seen, milliseconds
+} ColdSummary;
+
+typedef struct {
+    int summaries;                  // Distinct keys summed over blocks and the warm table
+    int blocks;
+    uint64_t connections;           // Connections folded in (and still held)
+    uint64_t dropped_connections;   // Lost with blocks dropped over the budget
+    size_t bytes;                   // Blocks + interned paths + warm table
+} ColdStoreStats;
+
+// Internal types, declared here so a ColdStore can live in static storage
+typedef struct {
+    uint32_t path_id;
+    uint8_t protocol;
+    uint8_t ip_version;
+    uint16_t remote_port;
+    uint8_t remote_addr[16];
+    uint32_t count;
+    uint64_t first_seen;
+    uint64_t last_seen;
+    uint64_t total_duration;
+} ColdEntry;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    int entries;
+    uint64_t connections;
+    uint64_t base_time;             // Earliest first_seen in the block
+} ColdBlock;
+
+typedef struct {
+    char** paths;                   // Interned process paths, by id
+    int path_count;
+    int path_capacity;
+    int* path_slots;                // Open addressing over path ids, -1 = empty
+    int path_slot_count;            // Power of two, at most half full
+    size_t path_bytes;
+
+    ColdEntry* warm;                // COLDSTORE_BLOCK_ENTRIES entries
+    int* warm_slots;                // Open addressing over warm indices, -1 = empty
+    int warm_count;
+
+    ColdBlock* blocks;              // Oldest first
+    int block_count;
+    int block_capacity;
+    size_t block_bytes;
+
+    size_t max_bytes;
+    uint64_t dropped_connections;
+} ColdStore;
+
+// max_bytes = 0 uses COLDSTORE_DEFAULT_MAX_BYTES. Returns 0 or -1
+int coldstore_init(ColdStore* store, size_t max_bytes);
+
+void coldstore_free(ColdStore* store);
+
+// Fold a summary in (count 1 for a single connection; process_path is
+// copied). Returns 0 or -1 when out of memory
+int coldstore_add(ColdStore* store, const ColdSummary* summary);
+
+// Every summary of `process_path` (NULL = all), one per key with the blocks
+// merged, sorted by key. *summaries is malloc'd (free it, NULL when *count is 0)
+int coldstore_query(const ColdStore* store, const char* process_path, ColdSummary** summaries, int* count);
+
+void coldstore_get_stats(const ColdStore* store, ColdStoreStats* stats);
+
+#endif
@@ -0,0 +1,441 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "connstore.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CONNSTORE_HAVE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC/Clang compile each kernel for its own target only, so the rest of the
+// binary keeps running on CPUs without the extension
+#if defined(CONNSTORE_HAVE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CONNSTORE_TARGET_SSE2 __attribute__((target("sse2")))
+#define CONNSTORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CONNSTORE_TARGET_SSE2
+#define CONNSTORE_TARGET_AVX2
+#endif
+
+#define CONNSTORE_ALIGN 64
+#define CONNSTORE_BLOCK 64              // Rows per mask word
+
+// Every predicate reduced to a mask/compare that is always evaluated: a field
+// left open gets a zero mask (or a full range) and matches every row
+typedef struct {
+    uint8_t protocol_mask;
+    uint8_t protocol_value;
+    uint8_t direction_mask;
+    uint8_t direction_value;
+    uint8_t trust_mask;
+    uint8_t trust_value;
+    uint8_t flags_mask;
+    uint8_t flags_value;
+    uint16_t local_port_min;
+    uint16_t local_port_span;           // max - min: in range when (port - min) <= span
+    uint16_t remote_port_min;
+    uint16_t remote_port_span;
+    uint32_t remote_net;
+    uint32_t remote_netmask;
+} PreparedFilter;
+
+typedef void (*FilterBlocksFn)(const ConnectionColumns* cols, const PreparedFilter* f, int blocks, uint64_t* mask);
+
+// ============================================================================
+// Storage
+// ============================================================================
+
+static size_t aligned_size(size_t size) {
+    return (size + CONNSTORE_ALIGN - 1) & ~(size_t)(CONNSTORE_ALIGN - 1);
+}
+
+int connstore_init(ConnectionColumns* cols, int capacity) {
+    memset(cols, 0, sizeof(ConnectionColumns));
+    if (capacity <= 0) {
+        return -1;
+    }
+
+    // Whole blocks, zero-filled: kernels read past `count` up to the block end
+    capacity = (capacity + CONNSTORE_BLOCK - 1) / CONNSTORE_BLOCK * CONNSTORE_BLOCK;
+    size_t bytes8 = aligned_size((size_t)capacity);
+    size_t bytes16 = aligned_size((size_t)capacity * sizeof(uint16_t));
+    size_t bytes32 = aligned_size((size_t)capacity * sizeof(uint32_t));
+    size_t bytes128 = aligned_size((size_t)capacity * 16);
+
+    cols->memory = calloc(1, bytes8 * 4 + bytes16 * 2 + bytes32 * 2 + bytes128 * 2 + CONNSTORE_ALIGN);
+    if (!cols->memory) {
+        return -1;
+    }
+
+    uint8_t* p = (uint8_t*)(((uintptr_t)cols->memory + CONNSTORE_ALIGN - 1) & ~(uintptr_t)(CONNSTORE_ALIGN - 1));
+    cols->protocol = p;                     p += bytes8;
+    cols->direction = p;                    p += bytes8;
+    cols->trust = p;                        p += bytes8;
+    cols->flags = p;                        p += bytes8;
+    cols->local_port = (uint16_t*)p;        p += bytes16;
+    cols->remote_port = (uint16_t*)p;       p += bytes16;
+    cols->local_addr = (uint32_t*)p;        p += bytes32;
+    cols->remote_addr = (uint32_t*)p;       p += bytes32;
+    cols->local_addr_v6 = (uint8_t(*)[16])p;    p += bytes128;
+    cols->remote_addr_v6 = (uint8_t(*)[16])p;
+
+    cols->capacity = capacity;
+    return 0;
+}
+
+void connstore_free(ConnectionColumns* cols) {
+    free(cols->memory);
+    memset(cols, 0, sizeof(ConnectionColumns));
+}
+
+static void store_row(ConnectionColumns* cols, int i, const ConnectionRow* row) {
+    cols->protocol[i] = row->protocol;
+    cols->direction[i] = row->direction;
+    cols->trust[i] = row->trust;
+    cols->flags[i] = row->flags;
+    cols->local_port[i] = row->local_port;
+    cols->remote_port[i] = row->remote_port;
+    cols->local_addr[i] = row->local_addr;
+    cols->remote_addr[i] = row->remote_addr;
+    memcpy(cols->local_addr_v6[i], row->local_addr_v6, 16);
+    memcpy(cols->remote_addr_v6[i], row->remote_addr_v6, 16);
+}
+
+int connstore_append(ConnectionColumns* cols, const ConnectionRow* row) {
+    if (cols->count >= cols->capacity) {
+        return -1;
+    }
+
+    int i = cols->count;
+    store_row(cols, i, row);
+    cols->count = i + 1;
+    return i;
+}
+
+void connstore_set_row(ConnectionColumns* cols, int index, const ConnectionRow* row) {
+    if (index >= 0 && index < cols->count) {
+        store_row(cols, index, row);
+    }
+}
+
+void connstore_set_trust(ConnectionColumns* cols, int index, uint8_t trust) {
+    if (index >= 0 && index < cols->count) {
+        cols->trust[index] = trust;
+    }
+}
+
+void connstore_set_flags(ConnectionColumns* cols, int index, uint8_t flags) {
+    if (index >= 0 && index < cols->count) {
+        cols->flags[index] = flags;
+    }
+}
+
+void connstore_filter_reset(ConnectionFilter* filter) {
+    memset(filter, 0, sizeof(ConnectionFilter));
+    filter->protocol = -1;
+    filter->direction = -1;
+    filter->trust = -1;
+    filter->local_port_max = 0xFFFF;
+    filter->remote_port_max = 0xFFFF;
+}
+
+static void prepare_filter(const ConnectionFilter* filter, PreparedFilter* f) {
+    f->protocol_mask = (filter->protocol < 0) ? 0 : 0xFF;
+    f->protocol_value = (uint8_t)filter->protocol & f->protocol_mask;
+    f->direction_mask = (filter->direction < 0) ? 0 : 0xFF;
+    f->direction_value = (uint8_t)filter->direction & f->direction_mask;
+    f->trust_mask = (filter->trust < 0) ? 0 : 0xFF;
+    f->trust_value = (uint8_t)filter->trust & f->trust_mask;
+    f->flags_mask = filter->flags_mask;
+    f->flags_value = filter->flags_value & filter->flags_mask;
+
+    f->local_port_min = filter->local_port_min;
+    f->local_port_span = (uint16_t)(filter->local_port_max - filter->local_port_min);
+    f->remote_port_min = filter->remote_port_min;
+    f->remote_port_span = (uint16_t)(filter->remote_port_max - filter->remote_port_min);
+    f->remote_netmask = filter->remote_netmask;
+    f->remote_net = filter->remote_net & filter->remote_netmask;
+
+    // An IPv4 prefix only selects IPv4 rows
+    int impossible = filter->local_port_max < filter->local_port_min ||
+                     filter->remote_port_max < filter->remote_port_min;
+    if (filter->remote_netmask != 0) {
+        impossible |= (f->flags_value & CONNSTORE_FLAG_IPV6) != 0;
+        f->flags_mask |= CONNSTORE_FLAG_IPV6;
+    }
+
+    // No row has every flag bit set
+    if (impossible) {
+        f->flags_mask = 0xFF;
+        f->flags_value = 0xFF;
+    }
+}
+
+static int prepared_matches(const PreparedFilter* f, uint8_t protocol, uint8_t direction, uint8_t trust,
+                            uint8_t flags, uint16_t local_port, uint16_t remote_port, uint32_t remote_addr) {
+    return ((protocol & f->protocol_mask) == f->protocol_value) &
+           ((direction & f->direction_mask) == f->direction_value) &
+           ((trust & f->trust_mask) == f->trust_value) &
+           ((flags & f->flags_mask) == f->flags_value) &
+           ((uint16_t)(local_port - f->local_port_min) <= f->local_port_span) &
+           ((uint16_t)(remote_port - f->remote_port_min) <= f->remote_port_span) &
+           ((remote_addr & f->remote_netmask) == f->remote_net);
+}
+
+int connstore_matches(const ConnectionFilter* filter, const ConnectionRow* row) {
+    PreparedFilter f;
+    prepare_filter(filter, &f);
+    return prepared_matches(&f, row->protocol, row->direction, row->trust, row->flags,
+                            row->local_port, row->remote_port, row->remote_addr);
+}
+
+// ============================================================================
+// Scalar kernel
+// ============================================================================
+
+static void filter_blocks_scalar(const ConnectionColumns* c, const PreparedFilter* f, int blocks, uint64_t* mask) {
+    for (int b = 0; b < blocks; b++) {
+        uint64_t bits = 0;
+        int base = b * CONNSTORE_BLOCK;
+        for (int i = 0; i < CONNSTORE_BLOCK; i++) {
+            int r = base + i;
+            uint64_t match = (uint64_t)prepared_matches(f, c->protocol[r], c->direction[r], c->trust[r], c->flags[r],
+                                                        c->local_port[r], c->remote_port[r], c->remote_addr[r]);
+            bits |= match << i;
+        }
+        mask[b] = bits;
+    }
+}
+
+#ifdef CONNSTORE_HAVE_X86
+
+// ============================================================================
+// SSE2 kernel: 16 rows per step
+// ============================================================================
+
+CONNSTORE_TARGET_SSE2
+static void filter_blocks_sse2(const ConnectionColumns* c, const PreparedFilter* f, int blocks, uint64_t* mask) {
+    const __m128i protocol_mask = _mm_set1_epi8((char)f->protocol_mask);
+    const __m128i protocol_value = _mm_set1_epi8((char)f->protocol_value);
+    const __m128i direction_mask = _mm_set1_epi8((char)f->direction_mask);
+    const __m128i direction_value = _mm_set1_epi8((char)f->direction_value);
+    const __m128i trust_mask = _mm_set1_epi8((char)f->trust_mask);
+    const __m128i trust_value = _mm_set1_epi8((char)f->trust_value);
+    const __m128i flags_mask = _mm_set1_epi8((char)f->flags_mask);
+    const __m128i flags_value = _mm_set1_epi8((char)f->flags_value);
+    const __m128i local_min = _mm_set1_epi16((short)f->local_port_min);
+    const __m128i local_span = _mm_set1_epi16((short)f->local_port_span);
+    const __m128i remote_min = _mm_set1_epi16((short)f->remote_port_min);
+    const __m128i remote_span = _mm_set1_epi16((short)f->remote_port_span);
+    const __m128i netmask = _mm_set1_epi32((int)f->remote_netmask);
+    const __m128i net = _mm_set1_epi32((int)f->remote_net);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int b = 0; b < blocks; b++) {
+        uint64_t bits = 0;
+        for (int step = 0; step < CONNSTORE_BLOCK; step += 16) {
+            int r = b * CONNSTORE_BLOCK + step;
+
+            __m128i ok = _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128((const __m128i*)(c->protocol + r)), protocol_mask), protocol_value);
+            ok = _mm_and_si128(ok, _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128((const __m128i*)(c->direction + r)), direction_mask), direction_value));
+            ok = _mm_and_si128(ok, _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128((const __m128i*)(c->trust + r)), trust_mask), trust_value));
+            ok = _mm_and_si128(ok, _mm_cmpeq_epi8(_mm_and_si128(_mm_load_si128((const __m128i*)(c->flags + r)), flags_mask), flags_value));
+
+            // Unsigned range test: (port - min) saturating-minus span is zero
+            __m128i ports[2];
+            for (int half = 0; half < 2; half++) {
+                __m128i local = _mm_load_si128((const __m128i*)(c->local_port + r + half * 8));
+                __m128i remote = _mm_load_si128((const __m128i*)(c->remote_port + r + half * 8));
+                __m128i local_ok = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(local, local_min), local_span), zero);
+                __m128i remote_ok = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_sub_epi16(remote, remote_min), remote_span), zero);
+                ports[half] = _mm_and_si128(local_ok, remote_ok);
+            }
+            ok = _mm_and_si128(ok, _mm_packs_epi16(ports[0], ports[1]));
+
+            __m128i addr[4];
+            for (int quarter = 0; quarter < 4; quarter++) {
+                __m128i remote = _mm_load_si128((const __m128i*)(c->remote_addr + r + quarter * 4));
+                addr[quarter] = _mm_cmpeq_epi32(_mm_and_si128(remote, netmask), net);
+            }
+            ok = _mm_and_si128(ok, _mm_packs_epi16(_mm_packs_epi32(addr[0], addr[1]), _mm_packs_epi32(addr[2], addr[3])));
+
+            bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(ok) << step;
+        }
+        mask[b] = bits;
+    }
+}
+
+// ============================================================================
+// AVX2 kernel: 32 rows per step
+// ============================================================================
+
+CONNSTORE_TARGET_AVX2
+static void filter_blocks_avx2(const ConnectionColumns* c, const PreparedFilter* f, int blocks, uint64_t* mask) {
+    const __m256i protocol_mask = _mm256_set1_epi8((char)f->protocol_mask);
+    const __m256i protocol_value = _mm256_set1_epi8((char)f->protocol_value);
+    const __m256i direction_mask = _mm256_set1_epi8((char)f->direction_mask);
+    const __m256i direction_value = _mm256_set1_epi8((char)f->direction_value);
+    const __m256i trust_mask = _mm256_set1_epi8((char)f->trust_mask);
+    const __m256i trust_value = _mm256_set1_epi8((char)f->trust_value);
+    const __m256i flags_mask = _mm256_set1_epi8((char)f->flags_mask);
+    const __m256i flags_value = _mm256_set1_epi8((char)f->flags_value);
+    const __m256i local_min = _mm256_set1_epi16((short)f->local_port_min);
+    const __m256i local_span = _mm256_set1_epi16((short)f->local_port_span);
+    const __m256i remote_min = _mm256_set1_epi16((short)f->remote_port_min);
+    const __m256i remote_span = _mm256_set1_epi16((short)f->remote_port_span);
+    const __m256i netmask = _mm256_set1_epi32((int)f->remote_netmask);
+    const __m256i net = _mm256_set1_epi32((int)f->remote_net);
+    const __m256i zero = _mm256_setzero_si256();
+    // The packs work per 128-bit lane: these put the rows back in order
+    const __m256i dword_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    for (int b = 0; b < blocks; b++) {
+        uint64_t bits = 0;
+        for (int step = 0; step < CONNSTORE_BLOCK; step += 32) {
+            int r = b * CONNSTORE_BLOCK + step;
+
+            __m256i ok = _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_load_si256((const __m256i*)(c->protocol + r)), protocol_mask), protocol_value);
+            ok = _mm256_and_si256(ok, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_load_si256((const __m256i*)(c->direction + r)), direction_mask), direction_value));
+            ok = _mm256_and_si256(ok, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_load_si256((const __m256i*)(c->trust + r)), trust_mask), trust_value));
+            ok = _mm256_and_si256(ok, _mm256_cmpeq_epi8(_mm256_and_si256(_mm256_load_si256((const __m256i*)(c->flags + r)), flags_mask), flags_value));
+
+            __m256i ports[2];
+            for (int half = 0; half < 2; half++) {
+                __m256i local = _mm256_load_si256((const __m256i*)(c->local_port + r + half * 16));
+                __m256i remote = _mm256_load_si256((const __m256i*)(c->remote_port + r + half * 16));
+                __m256i local_ok = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_sub_epi16(local, local_min), local_span), zero);
+                __m256i remote_ok = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_sub_epi16(remote, remote_min), remote_span), zero);
+                ports[half] = _mm256_and_si256(local_ok, remote_ok);
+            }
+            ok = _mm256_and_si256(ok, _mm256_permute4x64_epi64(_mm256_packs_epi16(ports[0], ports[1]), 0xD8));
+
+            __m256i addr[4];
+            for (int quarter = 0; quarter < 4; quarter++) {
+                __m256i remote = _mm256_load_si256((const __m256i*)(c->remote_addr + r + quarter * 8));
+                addr[quarter] = _mm256_cmpeq_epi32(_mm256_and_si256(remote, netmask), net);
+            }
+            __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(addr[0], addr[1]), _mm256_packs_epi32(addr[2], addr[3]));
+            ok = _mm256_and_si256(ok, _mm256_permutevar8x32_epi32(packed, dword_order));
+
+            bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ok) << step;
+        }
+        mask[b] = bits;
+    }
+}
+
+static void cpu_features(int* sse2, int* avx2) {
+    unsigned int leaf1[4] = {0};
+    unsigned int leaf7[4] = {0};
+    unsigned int max_leaf;
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    max_leaf = (unsigned int)regs[0];
+    __cpuid(regs, 1);
+    memcpy(leaf1, regs, sizeof(leaf1));
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        memcpy(leaf7, regs, sizeof(leaf7));
+    }
+#else
+    max_leaf = __get_cpuid_max(0, NULL);
+    __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    }
+#endif
+    *sse2 = (leaf1[3] >> 26) & 1;
+
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+    *avx2 = 0;
+    int osxsave = (leaf1[2] >> 27) & 1;
+    int avx = (leaf1[2] >> 28) & 1;
+    if (osxsave && avx && ((leaf7[1] >> 5) & 1)) {
+#if defined(_MSC_VER)
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned int lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        unsigned long long xcr0 = ((unsigned long long)hi << 32) | lo;
+#endif
+        *avx2 = (xcr0 & 0x6) == 0x6;
+    }
+}
+
+#endif // CONNSTORE_HAVE_X86
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+// Written by connstore_select_implementation only, before filtering threads start
+static FilterBlocksFn blocks_fn = filter_blocks_scalar;
+static const char* blocks_name = "scalar";
+
+const char* connstore_select_implementation(const char* name) {
+    FilterBlocksFn fn = filter_blocks_scalar;
+    const char* best = "scalar";
+#ifdef CONNSTORE_HAVE_X86
+    int sse2, avx2;
+    cpu_features(&sse2, &avx2);
+    if (avx2 && (!name || strcmp(name, "avx2") == 0)) {
+        fn = filter_blocks_avx2;
+        best = "avx2";
+    } else if (sse2 && (!name || strcmp(name, "sse2") == 0)) {
+        fn = filter_blocks_sse2;
+        best = "sse2";
+    }
+#endif
+    if (name && strcmp(name, best) != 0) {
+        return NULL;  // Not available on this CPU
+    }
+    blocks_name = best;
+    blocks_fn = fn;
+    return best;
+}
+
+const char* connstore_get_implementation(void) {
+    return blocks_name;
+}
+
+static int popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+int connstore_filter(const ConnectionColumns* cols, int count, const ConnectionFilter* filter, uint64_t* mask) {
+    if (count > cols->count) {
+        count = cols->count;
+    }
+    if (count <= 0) {
+        return 0;
+    }
+
+    PreparedFilter f;
+    prepare_filter(filter, &f);
+
+    int words = CONNSTORE_MASK_WORDS(count);
+    blocks_fn(cols, &f, words, mask);
+
+    // Rows past `count` in the last block are padding
+    if (count % CONNSTORE_BLOCK) {
+        mask[words - 1] &= (1ULL << (count % CONNSTORE_BLOCK)) - 1;
+    }
+
+    int matches = 0;
+    for (int w = 0; w < words; w++) {
+        matches += popcount64(mask[w]);
+    }
+    return matches;
+}
@@ -0,0 +1,109 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_CONNSTORE_H
+#define PEEK_CONNSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Column (struct-of-arrays) copy of the fields the list filters on, kept next
+// to the seen connections: one 64-byte aligned array per field instead of a
+// ~900-byte NetworkConnection per row. Filters run over whole columns with
+// AVX2 or SSE2 kernels (runtime dispatch, scalar fallback) and produce a
+// selection bitmask. Portable (no Windows dependencies), like sha256.c.
+//
+// Fixed capacity: rows never move, so a worker can update one row's trust
+// byte while another thread filters. A row can be overwritten in place when
+// its owner recycles the index.
+
+#define CONNSTORE_FLAG_LOCALHOST 0x01
+#define CONNSTORE_FLAG_IPV6 0x02
+#define CONNSTORE_FLAG_THREAT_FEED 0x04
+#define CONNSTORE_FLAG_CLOSED 0x08         // No longer listed by the OS
+#define CONNSTORE_FLAG_FREE 0x10           // Unused row (owner recycled it)
+
+// Words needed for a selection mask over `rows` rows
+#define CONNSTORE_MASK_WORDS(rows) (((rows) + 63) / 64)
+
+// One row as stored in the columns. Ports are in host order, IPv4 addresses
+// as stored by the IP Helper API (network order)
+typedef struct {
+    uint8_t protocol;
+    uint8_t direction;
+    uint8_t trust;
+    uint8_t flags;
+    uint16_t local_port;
+    uint16_t remote_port;
+    uint32_t local_addr;
+    uint32_t remote_addr;
+    uint8_t local_addr_v6[16];
+    uint8_t remote_addr_v6[16];
+} ConnectionRow;
+
+typedef struct {
+    uint8_t* protocol;
+    uint8_t* direction;
+    uint8_t* trust;
+    uint8_t* flags;
+    uint16_t* local_port;
+    uint16_t* remote_port;
+    uint32_t* local_addr;
+    uint32_t* remote_addr;
+    uint8_t (*local_addr_v6)[16];
+    uint8_t (*remote_addr_v6)[16];
+    int count;
+    int capacity;                       // Multiple of 64: kernels read whole blocks
+    void* memory;
+} ConnectionColumns;
+
+// A field set to -1 (or a full 0..65535 range / zero mask) matches everything
+typedef struct {
+    int protocol;
+    int direction;
+    int trust;
+    uint8_t flags_mask;                 // Row matches when (flags & mask) == value
+    uint8_t flags_value;
+    uint16_t local_port_min;
+    uint16_t local_port_max;
+    uint16_t remote_port_min;
+    uint16_t remote_port_max;
+    uint32_t remote_net;                // IPv4 rows: (remote_addr & netmask) == net
+    uint32_t remote_netmask;            // 0 = any (IPv6 rows never match a non-zero mask)
+} ConnectionFilter;
+
+int connstore_init(ConnectionColumns* cols, int capacity);
+
+void connstore_free(ConnectionColumns* cols);
+
+// Returns the row index, or -1 when full
+int connstore_append(ConnectionColumns* cols, const ConnectionRow* row);
+
+// Overwrite an existing row
+void connstore_set_row(ConnectionColumns* cols, int index, const ConnectionRow* row);
+
+void connstore_set_trust(ConnectionColumns* cols, int index, uint8_t trust);
+
+void connstore_set_flags(ConnectionColumns* cols, int index, uint8_t flags);
+
+// Everything matches
+void connstore_filter_reset(ConnectionFilter* filter);
+
+// Single row (scalar)
+int connstore_matches(const ConnectionFilter* filter, const ConnectionRow* row);
+
+// Bit i of mask[i / 64] is set when row i of [0, count) matches. `mask` holds
+// CONNSTORE_MASK_WORDS(count) words. Returns the number of matching rows
+int connstore_filter(const ConnectionColumns* cols, int count, const ConnectionFilter* filter, uint64_t* mask);
+
+// Pick the filter kernel: the named one ("avx2", "sse2" or "scalar"), or the
+// best this CPU has when `name` is NULL. Call before any thread filters (the
+// scalar kernel runs until then); tests call it again to compare the
+// kernels. Returns the kernel name, NULL when the CPU lacks the named one
+const char* connstore_select_implementation(const char* name);
+
+// Name of the selected kernel
+const char* connstore_get_implementation(void);
+
+#endif
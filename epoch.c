@@ -0,0 +1,160 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "epoch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EPOCH_COLLECT_THRESHOLD 64      // Retired blocks before a retire tries to free some
+
+// Starts at 1: a reader slot holding 0 is free
+static volatile LONG64 epoch_global = 1;
+static volatile LONG64 epoch_readers[EPOCH_READER_SLOTS];   // Epoch a reader announced, 0 = free
+static volatile LONG epoch_reader_hint = 0;                 // Spreads readers over the slots
+
+// Retired memory, oldest first (epochs never decrease). Writers only
+typedef struct {
+    void* memory;
+    LONG64 epoch;
+} RetiredMemory;
+
+static RetiredMemory* retired = NULL;
+static int retired_count = 0;
+static int retired_capacity = 0;
+static CRITICAL_SECTION retired_cs;
+static BOOL epoch_initialized = FALSE;
+
+int epoch_init(void) {
+    if (epoch_initialized) {
+        return 0;
+    }
+
+    InitializeCriticalSection(&retired_cs);
+    for (int i = 0; i < EPOCH_READER_SLOTS; i++) {
+        epoch_readers[i] = 0;
+    }
+    epoch_initialized = TRUE;
+    return 0;
+}
+
+void epoch_cleanup(void) {
+    if (!epoch_initialized) {
+        return;
+    }
+
+    for (int i = 0; i < retired_count; i++) {
+        free(retired[i].memory);
+    }
+    free(retired);
+    retired = NULL;
+    retired_count = 0;
+    retired_capacity = 0;
+
+    DeleteCriticalSection(&retired_cs);
+    epoch_initialized = FALSE;
+}
+
+int epoch_enter(void) {
+    int start = (int)InterlockedIncrement(&epoch_reader_hint);
+    for (int i = 0;; i++) {
+        int slot = (start + i) & (EPOCH_READER_SLOTS - 1);
+
+        // A stale epoch is harmless: it only holds the global epoch back until
+        // this section ends (the interlocked claim orders the reads that follow)
+        if (epoch_readers[slot] == 0 &&
+            InterlockedCompareExchange64(&epoch_readers[slot], epoch_global, 0) == 0) {
+            return slot;
+        }
+        if ((i & (EPOCH_READER_SLOTS - 1)) == EPOCH_READER_SLOTS - 1) {
+            YieldProcessor();
+        }
+    }
+}
+
+void epoch_exit(int slot) {
+    InterlockedExchange64(&epoch_readers[slot], 0);
+}
+
+LONG64 epoch_stamp(void) {
+    return epoch_global;
+}
+
+// Move the global epoch forward if every active reader has observed it
+static LONG64 try_advance(void) {
+    LONG64 epoch = epoch_global;
+    for (int i = 0; i < EPOCH_READER_SLOTS; i++) {
+        LONG64 reader = epoch_readers[i];
+        if (reader != 0 && reader != epoch) {
+            return epoch;
+        }
+    }
+
+    InterlockedCompareExchange64(&epoch_global, epoch + 1, epoch);
+    return epoch_global;
+}
+
+BOOL epoch_reclaimable(LONG64 stamp) {
+    // Without readers in the way both steps happen right here
+    for (int attempt = 0; attempt < 2 && epoch_global < stamp + 2; attempt++) {
+        try_advance();
+    }
+    return epoch_global >= stamp + 2;
+}
+
+void epoch_synchronize(void) {
+    LONG64 stamp = epoch_global;
+    while (!epoch_reclaimable(stamp)) {
+        SwitchToThread();
+    }
+}
+
+void epoch_retire(void* memory) {
+    if (!memory) {
+        return;
+    }
+
+    BOOL collect = FALSE;
+    EnterCriticalSection(&retired_cs);
+    if (retired_count == retired_capacity) {
+        int capacity = retired_capacity ? retired_capacity * 2 : 256;
+        RetiredMemory* grown = (RetiredMemory*)realloc(retired, (size_t)capacity * sizeof(RetiredMemory));
+        if (!grown) {
+            // Cannot defer: wait out the readers instead
+            LeaveCriticalSection(&retired_cs);
+            epoch_synchronize();
+            free(memory);
+            return;
+        }
+        retired = grown;
+        retired_capacity = capacity;
+    }
+
+    retired[retired_count].memory = memory;
+    retired[retired_count].epoch = epoch_global;
+    retired_count++;
+    collect = (retired_count >= EPOCH_COLLECT_THRESHOLD);
+    LeaveCriticalSection(&retired_cs);
+
+    if (collect) {
+        epoch_collect();
+    }
+}
+
+void epoch_collect(void) {
+    // Two steps make everything retired so far reclaimable when no reader is active
+    try_advance();
+    try_advance();
+
+    EnterCriticalSection(&retired_cs);
+    int freed = 0;
+    while (freed < retired_count && epoch_global >= retired[freed].epoch + 2) {
+        free(retired[freed].memory);
+        freed++;
+    }
+    if (freed > 0) {
+        retired_count -= freed;
+        memmove(retired, retired + freed, (size_t)retired_count * sizeof(RetiredMemory));
+    }
+    LeaveCriticalSection(&retired_cs);
+}
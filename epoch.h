@@ -0,0 +1,50 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_EPOCH_H
+#define PEEK_EPOCH_H
+
+#include <windows.h>
+
+// Epoch-based reclamation for lock-free readers. A reader brackets its
+// accesses with epoch_enter / epoch_exit (one interlocked operation each,
+// never waits on a writer). A writer unpublishes an object (pointer swap, slot
+// state change), then retires it: the memory is freed, or the slot reused,
+// once every reader that could still see it has left its section.
+//
+// The global epoch only advances when every active reader has observed the
+// current one, so anything retired at epoch E is unreachable once the global
+// epoch reaches E + 2. Reader sections must stay short and must not nest.
+
+#define EPOCH_READER_SLOTS 128          // Concurrent readers (pool threads + GUI + exporters)
+
+int epoch_init(void);
+
+// Frees everything still retired; no reader may be active
+void epoch_cleanup(void);
+
+// Start a read section. Returns the reader slot to hand to epoch_exit
+int epoch_enter(void);
+
+void epoch_exit(int slot);
+
+// Current epoch, to stamp something unpublished by its owner (for instance a
+// recycled array slot) and test it later with epoch_reclaimable
+LONG64 epoch_stamp(void);
+
+// TRUE once no reader can still see what was unpublished at `stamp` (tries to
+// advance the epoch)
+BOOL epoch_reclaimable(LONG64 stamp);
+
+// Wait until everything unpublished so far is reclaimable. Writers only,
+// never from inside a read section
+void epoch_synchronize(void);
+
+// free() `memory` once no reader can reach it. Any thread, outside a read section
+void epoch_retire(void* memory);
+
+// Free the retired memory that became unreachable
+void epoch_collect(void);
+
+#endif
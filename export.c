@@ -0,0 +1,909 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "export.h"
+#include "coldstore.h"
+#include "logger.h"
+#include "network.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define EXPORT_DICT_SLOTS (EXPORT_CHUNK_ROWS * 2)   // Open addressing, power of two
+#define EXPORT_UTF8_SIZE (MAX_PATH * 3 + 1)
+
+typedef struct {
+    HANDLE file;
+    char* data;
+    size_t used;
+    BOOL failed;
+} ExportWriter;
+
+typedef struct {
+    const char* name;
+    ExportColumnType type;
+    size_t offset;                      // Field in NetworkConnection
+} ExportColumn;
+
+// Enum / BOOL fields are stored as U8 and ports as U16; the timestamp column
+// is milliseconds since 1970 in local wall-clock time (as captured)
+static const ExportColumn columns[] = {
+    {"timestamp_ms", EXPORT_COLUMN_I64, offsetof(NetworkConnection, timestamp)},
+    {"protocol", EXPORT_COLUMN_U8, offsetof(NetworkConnection, protocol)},
+    {"ip_version", EXPORT_COLUMN_U8, offsetof(NetworkConnection, ip_version)},
+    {"direction", EXPORT_COLUMN_U8, offsetof(NetworkConnection, direction)},
+    {"is_localhost", EXPORT_COLUMN_U8, offsetof(NetworkConnection, is_localhost)},
+    {"local_addr", EXPORT_COLUMN_U32, offsetof(NetworkConnection, local_addr)},
+    {"local_port", EXPORT_COLUMN_U16, offsetof(NetworkConnection, local_port)},
+    {"remote_addr", EXPORT_COLUMN_U32, offsetof(NetworkConnection, remote_addr)},
+    {"remote_port", EXPORT_COLUMN_U16, offsetof(NetworkConnection, remote_port)},
+    {"local_addr_v6", EXPORT_COLUMN_BYTES16, offsetof(NetworkConnection, local_addr_v6)},
+    {"remote_addr_v6", EXPORT_COLUMN_BYTES16, offsetof(NetworkConnection, remote_addr_v6)},
+    {"state", EXPORT_COLUMN_U32, offsetof(NetworkConnection, state)},
+    {"pid", EXPORT_COLUMN_U32, offsetof(NetworkConnection, pid)},
+    {"process_name", EXPORT_COLUMN_STRING, offsetof(NetworkConnection, process_name)},
+    {"process_path", EXPORT_COLUMN_STRING, offsetof(NetworkConnection, process_path)},
+    {"sha256", EXPORT_COLUMN_STRING, offsetof(NetworkConnection, sha256_hash)},
+    {"trust", EXPORT_COLUMN_U8, offsetof(NetworkConnection, trust_status)},
+    {"country", EXPORT_COLUMN_STRING, offsetof(NetworkConnection, geo.country)},
+    {"asn", EXPORT_COLUMN_U32, offsetof(NetworkConnection, geo.asn)},
+    {"threat_feed_match", EXPORT_COLUMN_U8, offsetof(NetworkConnection, threat_intel_hit)},
+};
+
+#define EXPORT_COLUMN_COUNT ((int)(sizeof(columns) / sizeof(columns[0])))
+
+// Schema of the history groups (cold tier summaries), written in this order
+// by write_history_group. Times as in the timestamp column
+typedef struct {
+    const char* name;
+    ExportColumnType type;
+} HistoryColumn;
+
+static const HistoryColumn history_columns[] = {
+    {"process_path", EXPORT_COLUMN_STRING},
+    {"protocol", EXPORT_COLUMN_U8},
+    {"ip_version", EXPORT_COLUMN_U8},
+    {"remote_addr", EXPORT_COLUMN_BYTES16},
+    {"remote_port", EXPORT_COLUMN_U16},
+    {"connections", EXPORT_COLUMN_U32},
+    {"first_seen_ms", EXPORT_COLUMN_I64},
+    {"last_seen_ms", EXPORT_COLUMN_I64},
+    {"total_duration_ms", EXPORT_COLUMN_I64},
+};
+
+#define EXPORT_HISTORY_COLUMN_COUNT ((int)(sizeof(history_columns) / sizeof(history_columns[0])))
+
+static const char* trust_names[] = {
+    "unknown", "microsoft_signed", "verified_signed", "manual_trusted", "unsigned",
+    "invalid", "manual_threat", "error", "blocklisted"
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// Allocated on the first export and kept: one export runs at a time
+static char* output_buffer = NULL;
+static NetworkConnection* chunk_rows = NULL;
+static const char** dict_texts = NULL;  // Per row string of the column being written
+static int* dict_slots = NULL;          // Row of the first occurrence + 1, 0 = empty
+static uint32_t* dict_indices = NULL;     // Per row dictionary index
+static int* dict_entries = NULL;        // Dictionary index -> row of the first occurrence
+
+static volatile LONG64 progress_done = 0;
+static volatile LONG64 progress_total = 0;
+
+// Background export
+typedef struct {
+    char path[MAX_PATH];
+    ExportFormat format;
+    HWND hwnd;
+    UINT message;
+} ExportJob;
+
+static ExportJob job;
+static HANDLE export_thread = NULL;
+static volatile LONG export_running = 0;
+static volatile LONG export_cancel_flag = 0;
+
+static BOOL ensure_buffers(void) {
+    if (!output_buffer) {
+        output_buffer = (char*)VirtualAlloc(NULL, EXPORT_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    }
+    if (!chunk_rows) {
+        chunk_rows = (NetworkConnection*)malloc(EXPORT_CHUNK_ROWS * sizeof(NetworkConnection));
+    }
+    if (!dict_texts) {
+        dict_texts = (const char**)malloc(EXPORT_CHUNK_ROWS * sizeof(const char*));
+    }
+    if (!dict_slots) {
+        dict_slots = (int*)malloc(EXPORT_DICT_SLOTS * sizeof(int));
+    }
+    if (!dict_indices) {
+        dict_indices = (uint32_t*)malloc(EXPORT_CHUNK_ROWS * sizeof(uint32_t));
+    }
+    if (!dict_entries) {
+        dict_entries = (int*)malloc(EXPORT_CHUNK_ROWS * sizeof(int));
+    }
+    return output_buffer && chunk_rows && dict_texts && dict_slots && dict_indices && dict_entries;
+}
+
+static void release_buffers(void) {
+    if (output_buffer) {
+        VirtualFree(output_buffer, 0, MEM_RELEASE);
+        output_buffer = NULL;
+    }
+    free(chunk_rows);
+    chunk_rows = NULL;
+    free(dict_texts);
+    dict_texts = NULL;
+    free(dict_slots);
+    dict_slots = NULL;
+    free(dict_indices);
+    dict_indices = NULL;
+    free(dict_entries);
+    dict_entries = NULL;
+}
+
+// ============================================================================
+// Output buffer
+// ============================================================================
+
+static void writer_flush(ExportWriter* w) {
+    size_t offset = 0;
+    while (!w->failed && offset < w->used) {
+        DWORD written = 0;
+        if (!WriteFile(w->file, w->data + offset, (DWORD)(w->used - offset), &written, NULL) || written == 0) {
+            w->failed = TRUE;
+        }
+        offset += written;
+    }
+    w->used = 0;
+}
+
+// Pointer to at least `len` free bytes; hand the end back with writer_commit
+static char* writer_reserve(ExportWriter* w, size_t len) {
+    if (w->used + len > EXPORT_BUFFER_SIZE) {
+        writer_flush(w);
+    }
+    return w->data + w->used;
+}
+
+static void writer_commit(ExportWriter* w, const char* end) {
+    w->used = (size_t)(end - w->data);
+}
+
+static void writer_put(ExportWriter* w, const void* bytes, size_t len) {
+    char* p = writer_reserve(w, len);
+    memcpy(p, bytes, len);
+    writer_commit(w, p + len);
+}
+
+// ============================================================================
+// Text formatting (no printf: this runs once per field of every row)
+// ============================================================================
+
+static char* put_text(char* p, const char* text) {
+    size_t len = strlen(text);
+    memcpy(p, text, len);
+    return p + len;
+}
+
+static char* put_uint(char* p, ULONGLONG value) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+static char* put_2digits(char* p, unsigned value) {
+    p[0] = (char)('0' + value / 10 % 10);
+    p[1] = (char)('0' + value % 10);
+    return p + 2;
+}
+
+// Same notation as network_format_ip / network_format_ipv6
+static char* put_ipv4(char* p, DWORD addr) {
+    const unsigned char* bytes = (const unsigned char*)&addr;
+    for (int i = 0; i < 4; i++) {
+        if (i) *p++ = '.';
+        p = put_uint(p, bytes[i]);
+    }
+    return p;
+}
+
+static char* put_ipv6(char* p, const BYTE* addr) {
+    for (int i = 0; i < 16; i++) {
+        if (i && !(i & 1)) *p++ = ':';
+        *p++ = hex_digits[addr[i] >> 4];
+        *p++ = hex_digits[addr[i] & 0xF];
+    }
+    return p;
+}
+
+static char* put_address(char* p, const NetworkConnection* conn, BOOL local) {
+    if (conn->ip_version == IP_V4) {
+        return put_ipv4(p, local ? conn->local_addr : conn->remote_addr);
+    }
+    return put_ipv6(p, local ? conn->local_addr_v6 : conn->remote_addr_v6);
+}
+
+// YYYY-MM-DD HH:MM:SS.mmm (local time, as captured)
+static char* put_timestamp(char* p, const SYSTEMTIME* st) {
+    p = put_2digits(p, st->wYear / 100);
+    p = put_2digits(p, st->wYear % 100);
+    *p++ = '-';
+    p = put_2digits(p, st->wMonth);
+    *p++ = '-';
+    p = put_2digits(p, st->wDay);
+    *p++ = ' ';
+    p = put_2digits(p, st->wHour);
+    *p++ = ':';
+    p = put_2digits(p, st->wMinute);
+    *p++ = ':';
+    p = put_2digits(p, st->wSecond);
+    *p++ = '.';
+    *p++ = (char)('0' + st->wMilliseconds / 100 % 10);
+    return put_2digits(p, st->wMilliseconds % 100);
+}
+
+// Cold tier times (UTC milliseconds since 1601) as local wall-clock time,
+// like the captured timestamps
+static void history_time(uint64_t ms, SYSTEMTIME* st) {
+    ULARGE_INTEGER value;
+    value.QuadPart = ms * 10000;
+    FILETIME utc = {value.LowPart, value.HighPart};
+    FILETIME local;
+    if (!FileTimeToLocalFileTime(&utc, &local) || !FileTimeToSystemTime(&local, st)) {
+        memset(st, 0, sizeof(*st));
+    }
+}
+
+static char* put_history_address(char* p, const ColdSummary* summary) {
+    if (summary->ip_version == IP_V4) {
+        DWORD addr;
+        memcpy(&addr, summary->remote_addr, sizeof(addr));
+        return put_ipv4(p, addr);
+    }
+    return put_ipv6(p, summary->remote_addr);
+}
+
+static const char* direction_name(ConnectionDirection direction) {
+    switch (direction) {
+        case CONN_OUTBOUND: return "outbound";
+        case CONN_INBOUND: return "inbound";
+        default: return "unknown";
+    }
+}
+
+static const char* trust_name(TrustStatus status) {
+    if ((int)status < 0 || (int)status >= (int)(sizeof(trust_names) / sizeof(trust_names[0]))) {
+        return "unknown";
+    }
+    return trust_names[status];
+}
+
+// Names and paths come from the ANSI APIs: re-encode as UTF-8 unless plain ASCII
+static const char* utf8_text(const char* text, char* scratch, int scratch_size) {
+    const unsigned char* c = (const unsigned char*)text;
+    while (*c && *c < 0x80) {
+        c++;
+    }
+    if (!*c) {
+        return text;
+    }
+
+    wchar_t wide[MAX_PATH + 1];
+    if (MultiByteToWideChar(CP_ACP, 0, text, -1, wide, MAX_PATH + 1) <= 0 ||
+        WideCharToMultiByte(CP_UTF8, 0, wide, -1, scratch, scratch_size, NULL, NULL) <= 0) {
+        return text;
+    }
+    return scratch;
+}
+
+static char* put_csv_field(char* p, const char* text) {
+    char scratch[EXPORT_UTF8_SIZE];
+    text = utf8_text(text, scratch, sizeof(scratch));
+
+    if (!strpbrk(text, ",\"\r\n")) {
+        return put_text(p, text);
+    }
+
+    *p++ = '"';
+    for (; *text; text++) {
+        if (*text == '"') {
+            *p++ = '"';
+        }
+        *p++ = *text;
+    }
+    *p++ = '"';
+    return p;
+}
+
+static char* put_json_string(char* p, const char* text) {
+    char scratch[EXPORT_UTF8_SIZE];
+    text = utf8_text(text, scratch, sizeof(scratch));
+
+    *p++ = '"';
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)*c;
+        } else if (*c < 0x20) {
+            memcpy(p, "\\u00", 4);
+            p += 4;
+            *p++ = hex_digits[*c >> 4];
+            *p++ = hex_digits[*c & 0xF];
+        } else {
+            *p++ = (char)*c;
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+// ============================================================================
+// CSV / JSON rows
+// ============================================================================
+
+static const char csv_header[] =
+    "\xEF\xBB\xBF"
+    "timestamp,protocol,ip_version,direction,local_address,local_port,remote_address,remote_port,"
+    "state,pid,process_name,process_path,sha256,trust,country,asn,threat_feed_match\r\n";
+
+static char* format_csv_row(char* p, const NetworkConnection* conn) {
+    p = put_timestamp(p, &conn->timestamp);
+    *p++ = ',';
+    p = put_text(p, conn->protocol == PROTO_TCP ? "TCP" : "UDP");
+    *p++ = ',';
+    *p++ = conn->ip_version == IP_V4 ? '4' : '6';
+    *p++ = ',';
+    p = put_text(p, direction_name(conn->direction));
+    *p++ = ',';
+    p = put_address(p, conn, TRUE);
+    *p++ = ',';
+    p = put_uint(p, conn->local_port);
+    *p++ = ',';
+    p = put_address(p, conn, FALSE);
+    *p++ = ',';
+    p = put_uint(p, conn->remote_port);
+    *p++ = ',';
+    p = put_uint(p, conn->state);
+    *p++ = ',';
+    p = put_uint(p, conn->pid);
+    *p++ = ',';
+    p = put_csv_field(p, conn->process_name);
+    *p++ = ',';
+    p = put_csv_field(p, conn->process_path);
+    *p++ = ',';
+    p = put_csv_field(p, conn->sha256_hash);
+    *p++ = ',';
+    p = put_text(p, trust_name(conn->trust_status));
+    *p++ = ',';
+    p = put_csv_field(p, conn->geo.country);
+    *p++ = ',';
+    p = put_uint(p, conn->geo.asn);
+    *p++ = ',';
+    *p++ = conn->threat_intel_hit ? '1' : '0';
+    *p++ = '\r';
+    *p++ = '\n';
+    return p;
+}
+
+static char* format_json_row(char* p, const NetworkConnection* conn) {
+    p = put_text(p, "{\"timestamp\":\"");
+    p = put_timestamp(p, &conn->timestamp);
+    p = put_text(p, conn->protocol == PROTO_TCP ? "\",\"protocol\":\"TCP\"" : "\",\"protocol\":\"UDP\"");
+    p = put_text(p, conn->ip_version == IP_V4 ? ",\"ip_version\":4" : ",\"ip_version\":6");
+    p = put_text(p, ",\"direction\":\"");
+    p = put_text(p, direction_name(conn->direction));
+    p = put_text(p, "\",\"local_address\":\"");
+    p = put_address(p, conn, TRUE);
+    p = put_text(p, "\",\"local_port\":");
+    p = put_uint(p, conn->local_port);
+    p = put_text(p, ",\"remote_address\":\"");
+    p = put_address(p, conn, FALSE);
+    p = put_text(p, "\",\"remote_port\":");
+    p = put_uint(p, conn->remote_port);
+    p = put_text(p, ",\"state\":");
+    p = put_uint(p, conn->state);
+    p = put_text(p, ",\"pid\":");
+    p = put_uint(p, conn->pid);
+    p = put_text(p, ",\"process_name\":");
+    p = put_json_string(p, conn->process_name);
+    p = put_text(p, ",\"process_path\":");
+    p = put_json_string(p, conn->process_path);
+    p = put_text(p, ",\"sha256\":");
+    p = put_json_string(p, conn->sha256_hash);
+    p = put_text(p, ",\"trust\":\"");
+    p = put_text(p, trust_name(conn->trust_status));
+    p = put_text(p, "\",\"country\":");
+    p = put_json_string(p, conn->geo.country);
+    p = put_text(p, ",\"asn\":");
+    p = put_uint(p, conn->geo.asn);
+    p = put_text(p, conn->threat_intel_hit ? ",\"threat_feed_match\":true}" : ",\"threat_feed_match\":false}");
+    return p;
+}
+
+static void write_text_rows(ExportWriter* w, ExportFormat format, const NetworkConnection* rows,
+                            int count, LONG64 first_row) {
+    for (int i = 0; i < count; i++) {
+        char* p = writer_reserve(w, EXPORT_MAX_ROW_TEXT);
+        if (format == EXPORT_FORMAT_CSV) {
+            p = format_csv_row(p, &rows[i]);
+        } else {
+            p = put_text(p, (first_row + i == 0) ? "\n" : ",\n");
+            p = format_json_row(p, &rows[i]);
+        }
+        writer_commit(w, p);
+    }
+}
+
+// Summary section: one row per (process image, remote endpoint, protocol)
+// that left the seen store for the cold tier
+static const char csv_history_header[] =
+    "\r\nprocess_path,protocol,ip_version,remote_address,remote_port,connections,"
+    "first_seen,last_seen,total_duration_ms\r\n";
+
+static char* format_csv_history_row(char* p, const ColdSummary* summary) {
+    SYSTEMTIME first, last;
+    history_time(summary->first_seen, &first);
+    history_time(summary->last_seen, &last);
+
+    p = put_csv_field(p, summary->process_path);
+    *p++ = ',';
+    p = put_text(p, summary->protocol == PROTO_TCP ? "TCP" : "UDP");
+    *p++ = ',';
+    *p++ = summary->ip_version == IP_V4 ? '4' : '6';
+    *p++ = ',';
+    p = put_history_address(p, summary);
+    *p++ = ',';
+    p = put_uint(p, summary->remote_port);
+    *p++ = ',';
+    p = put_uint(p, summary->count);
+    *p++ = ',';
+    p = put_timestamp(p, &first);
+    *p++ = ',';
+    p = put_timestamp(p, &last);
+    *p++ = ',';
+    p = put_uint(p, summary->total_duration);
+    *p++ = '\r';
+    *p++ = '\n';
+    return p;
+}
+
+static char* format_json_history_row(char* p, const ColdSummary* summary) {
+    SYSTEMTIME first, last;
+    history_time(summary->first_seen, &first);
+    history_time(summary->last_seen, &last);
+
+    p = put_text(p, "{\"process_path\":");
+    p = put_json_string(p, summary->process_path);
+    p = put_text(p, summary->protocol == PROTO_TCP ? ",\"protocol\":\"TCP\"" : ",\"protocol\":\"UDP\"");
+    p = put_text(p, summary->ip_version == IP_V4 ? ",\"ip_version\":4" : ",\"ip_version\":6");
+    p = put_text(p, ",\"remote_address\":\"");
+    p = put_history_address(p, summary);
+    p = put_text(p, "\",\"remote_port\":");
+    p = put_uint(p, summary->remote_port);
+    p = put_text(p, ",\"connections\":");
+    p = put_uint(p, summary->count);
+    p = put_text(p, ",\"first_seen\":\"");
+    p = put_timestamp(p, &first);
+    p = put_text(p, "\",\"last_seen\":\"");
+    p = put_timestamp(p, &last);
+    p = put_text(p, "\",\"total_duration_ms\":");
+    p = put_uint(p, summary->total_duration);
+    *p++ = '}';
+    return p;
+}
+
+static void write_text_history(ExportWriter* w, ExportFormat format, const ColdSummary* summaries,
+                               int count, LONG64 first_row) {
+    for (int i = 0; i < count; i++) {
+        char* p = writer_reserve(w, EXPORT_MAX_ROW_TEXT);
+        if (format == EXPORT_FORMAT_CSV) {
+            p = format_csv_history_row(p, &summaries[i]);
+        } else {
+            p = put_text(p, (first_row + i == 0) ? "\n" : ",\n");
+            p = format_json_history_row(p, &summaries[i]);
+        }
+        writer_commit(w, p);
+    }
+}
+
+// ============================================================================
+// Columnar
+// ============================================================================
+
+// Days-from-civil: no calendar API call per row
+static LONG64 systemtime_to_ms(const SYSTEMTIME* st) {
+    int year = st->wYear - (st->wMonth <= 2);
+    unsigned month = st->wMonth;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = (unsigned)(year - era * 400);
+    unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + st->wDay - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    LONG64 days = (LONG64)era * 146097 + (LONG64)day_of_era - 719468;
+    return ((days * 24 + st->wHour) * 60 + st->wMinute) * 60000LL + st->wSecond * 1000LL + st->wMilliseconds;
+}
+
+static void write_column_descriptor(ExportWriter* w, const char* name, ExportColumnType column_type) {
+    BYTE type = (BYTE)column_type;
+    BYTE len = (BYTE)strlen(name);
+    writer_put(w, &type, 1);
+    writer_put(w, &len, 1);
+    writer_put(w, name, len);
+}
+
+static void write_columnar_header(ExportWriter* w) {
+    uint32_t count = EXPORT_COLUMN_COUNT;
+    writer_put(w, "PEEKCOL1", 8);
+    writer_put(w, &count, sizeof(count));
+    for (int i = 0; i < EXPORT_COLUMN_COUNT; i++) {
+        write_column_descriptor(w, columns[i].name, columns[i].type);
+    }
+
+    count = EXPORT_HISTORY_COLUMN_COUNT;
+    writer_put(w, &count, sizeof(count));
+    for (int i = 0; i < EXPORT_HISTORY_COLUMN_COUNT; i++) {
+        write_column_descriptor(w, history_columns[i].name, history_columns[i].type);
+    }
+}
+
+static uint32_t hash_string(const char* text) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    }
+    return hash;
+}
+
+// Dictionary-encode dict_texts[0..count)
+static void write_string_column(ExportWriter* w, int count) {
+    memset(dict_slots, 0, EXPORT_DICT_SLOTS * sizeof(int));
+    uint32_t dict_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        const char* text = dict_texts[i];
+        uint32_t slot = hash_string(text) & (EXPORT_DICT_SLOTS - 1);
+        for (;;) {
+            int row = dict_slots[slot] - 1;
+            if (row < 0) {
+                dict_slots[slot] = i + 1;
+                dict_entries[dict_count] = i;
+                dict_indices[i] = dict_count++;
+                break;
+            }
+            if (strcmp(dict_texts[row], text) == 0) {
+                dict_indices[i] = dict_indices[row];
+                break;
+            }
+            slot = (slot + 1) & (EXPORT_DICT_SLOTS - 1);
+        }
+    }
+
+    writer_put(w, &dict_count, sizeof(dict_count));
+    for (uint32_t e = 0; e < dict_count; e++) {
+        char scratch[EXPORT_UTF8_SIZE];
+        const char* text = utf8_text(dict_texts[dict_entries[e]], scratch, sizeof(scratch));
+        uint16_t len = (uint16_t)strlen(text);
+        writer_put(w, &len, sizeof(len));
+        writer_put(w, text, len);
+    }
+    writer_put(w, dict_indices, count * sizeof(uint32_t));
+}
+
+// x86/x64 are little-endian, so values are copied as they sit in memory
+static void write_columnar_group(ExportWriter* w, const NetworkConnection* rows, int count) {
+    uint32_t group_rows = (uint32_t)count;
+    writer_put(w, &group_rows, sizeof(group_rows));
+
+    for (int c = 0; c < EXPORT_COLUMN_COUNT; c++) {
+        size_t offset = columns[c].offset;
+        char* p;
+
+        switch (columns[c].type) {
+            case EXPORT_COLUMN_U8:
+                p = writer_reserve(w, count);
+                for (int i = 0; i < count; i++) {
+                    *p++ = (char)*(const int*)((const char*)&rows[i] + offset);
+                }
+                writer_commit(w, p);
+                break;
+
+            case EXPORT_COLUMN_U16:
+                p = writer_reserve(w, count * sizeof(uint16_t));
+                for (int i = 0; i < count; i++) {
+                    uint16_t value = (uint16_t)*(const DWORD*)((const char*)&rows[i] + offset);
+                    memcpy(p, &value, sizeof(value));
+                    p += sizeof(value);
+                }
+                writer_commit(w, p);
+                break;
+
+            case EXPORT_COLUMN_U32:
+                p = writer_reserve(w, count * sizeof(DWORD));
+                for (int i = 0; i < count; i++) {
+                    memcpy(p, (const char*)&rows[i] + offset, sizeof(DWORD));
+                    p += sizeof(DWORD);
+                }
+                writer_commit(w, p);
+                break;
+
+            case EXPORT_COLUMN_I64:
+                p = writer_reserve(w, count * sizeof(LONG64));
+                for (int i = 0; i < count; i++) {
+                    LONG64 value = systemtime_to_ms((const SYSTEMTIME*)((const char*)&rows[i] + offset));
+                    memcpy(p, &value, sizeof(value));
+                    p += sizeof(value);
+                }
+                writer_commit(w, p);
+                break;
+
+            case EXPORT_COLUMN_BYTES16:
+                p = writer_reserve(w, count * 16);
+                for (int i = 0; i < count; i++) {
+                    memcpy(p, (const char*)&rows[i] + offset, 16);
+                    p += 16;
+                }
+                writer_commit(w, p);
+                break;
+
+            case EXPORT_COLUMN_STRING:
+                for (int i = 0; i < count; i++) {
+                    dict_texts[i] = (const char*)&rows[i] + offset;
+                }
+                write_string_column(w, count);
+                break;
+        }
+    }
+}
+
+static void put_history_i64(ExportWriter* w, LONG64 value) {
+    writer_put(w, &value, sizeof(value));
+}
+
+// One history group: the marker, then the columns of history_columns in order
+static void write_history_group(ExportWriter* w, const ColdSummary* summaries, int count) {
+    uint32_t header[2] = {EXPORT_HISTORY_GROUP, (uint32_t)count};
+    writer_put(w, header, sizeof(header));
+
+    for (int i = 0; i < count; i++) {
+        dict_texts[i] = summaries[i].process_path;
+    }
+    write_string_column(w, count);
+
+    for (int i = 0; i < count; i++) {
+        writer_put(w, &summaries[i].protocol, 1);
+    }
+    for (int i = 0; i < count; i++) {
+        writer_put(w, &summaries[i].ip_version, 1);
+    }
+    for (int i = 0; i < count; i++) {
+        writer_put(w, summaries[i].remote_addr, 16);
+    }
+    for (int i = 0; i < count; i++) {
+        writer_put(w, &summaries[i].remote_port, sizeof(uint16_t));
+    }
+    for (int i = 0; i < count; i++) {
+        writer_put(w, &summaries[i].count, sizeof(uint32_t));
+    }
+    for (int i = 0; i < count; i++) {
+        SYSTEMTIME st;
+        history_time(summaries[i].first_seen, &st);
+        put_history_i64(w, systemtime_to_ms(&st));
+    }
+    for (int i = 0; i < count; i++) {
+        SYSTEMTIME st;
+        history_time(summaries[i].last_seen, &st);
+        put_history_i64(w, systemtime_to_ms(&st));
+    }
+    for (int i = 0; i < count; i++) {
+        put_history_i64(w, (LONG64)summaries[i].total_duration);
+    }
+}
+
+// ============================================================================
+// Export
+// ============================================================================
+
+ExportState export_write(const char* path, ExportFormat format, volatile LONG* cancel) {
+    if (!path || !ensure_buffers()) {
+        return EXPORT_FAILED;
+    }
+
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Unable to create export file %s (error %lu)", path, GetLastError());
+        return EXPORT_FAILED;
+    }
+
+    ExportWriter w = {file, output_buffer, 0, FALSE};
+    ExportState result = EXPORT_DONE;
+
+    // The store as of now: at most this many rows, entries expiring meanwhile are skipped
+    LONG64 total = network_get_seen_count();
+    progress_total = total;
+    progress_done = 0;
+
+    if (format == EXPORT_FORMAT_CSV) {
+        writer_put(&w, csv_header, sizeof(csv_header) - 1);
+    } else if (format == EXPORT_FORMAT_JSON) {
+        writer_put(&w, "{\"connections\":[", 16);
+    } else {
+        write_columnar_header(&w);
+    }
+
+    LONG64 done = 0;
+    int cursor = 0;
+    while (done < total && !w.failed) {
+        if (cancel && *cancel) {
+            result = EXPORT_CANCELLED;
+            break;
+        }
+
+        int wanted = (total - done < EXPORT_CHUNK_ROWS) ? (int)(total - done) : EXPORT_CHUNK_ROWS;
+        int count = network_copy_seen_range(&cursor, chunk_rows, wanted);
+        if (count == 0) {
+            break;
+        }
+
+        if (format == EXPORT_FORMAT_COLUMNAR) {
+            write_columnar_group(&w, chunk_rows, count);
+        } else {
+            write_text_rows(&w, format, chunk_rows, count, done);
+        }
+
+        done += count;
+        progress_done = done;
+    }
+
+    // Then the connections that left the seen store, as cold tier summaries.
+    // Queried after the seen rows were copied: a row compacted meanwhile
+    // appears in both parts rather than in neither
+    ColdSummary* history = NULL;
+    int history_count = 0;
+    if (result == EXPORT_DONE && network_query_history(NULL, &history, &history_count) != 0) {
+        LOG_WARNING("Connection history unavailable: exporting the seen store only");
+    }
+    progress_total = done + history_count;
+
+    if (result == EXPORT_DONE && !w.failed) {
+        if (format == EXPORT_FORMAT_CSV) {
+            writer_put(&w, csv_history_header, sizeof(csv_history_header) - 1);
+        } else if (format == EXPORT_FORMAT_JSON) {
+            writer_put(&w, "\n],\"history\":[", 14);
+        }
+    }
+
+    int history_done = 0;
+    while (result == EXPORT_DONE && history_done < history_count && !w.failed) {
+        if (cancel && *cancel) {
+            result = EXPORT_CANCELLED;
+            break;
+        }
+
+        int count = history_count - history_done;
+        if (count > EXPORT_CHUNK_ROWS) {
+            count = EXPORT_CHUNK_ROWS;
+        }
+        if (format == EXPORT_FORMAT_COLUMNAR) {
+            write_history_group(&w, history + history_done, count);
+        } else {
+            write_text_history(&w, format, history + history_done, count, history_done);
+        }
+
+        history_done += count;
+        progress_done = done + history_done;
+    }
+    free(history);
+
+    if (result == EXPORT_DONE) {
+        if (format == EXPORT_FORMAT_JSON) {
+            writer_put(&w, "\n]}\n", 4);
+        } else if (format == EXPORT_FORMAT_COLUMNAR) {
+            uint32_t end = 0;
+            uint64_t rows[2] = {(uint64_t)done, (uint64_t)history_done};
+            writer_put(&w, &end, sizeof(end));
+            writer_put(&w, rows, sizeof(rows));
+        }
+        writer_flush(&w);
+    }
+
+    CloseHandle(file);
+
+    if (w.failed) {
+        LOG_ERROR("Export to %s failed while writing", path);
+        result = EXPORT_FAILED;
+    }
+    if (result != EXPORT_DONE) {
+        DeleteFileA(path);
+    }
+    return result;
+}
+
+static DWORD WINAPI ExportThread(LPVOID param) {
+    (void)param;
+
+    ULONGLONG started = GetTickCount64();
+    ExportState result = export_write(job.path, job.format, &export_cancel_flag);
+
+    if (result == EXPORT_DONE) {
+        LOG_SUCCESS("Exported %lld row(s) to %s in %llu ms",
+                    progress_done, job.path, GetTickCount64() - started);
+    } else if (result == EXPORT_CANCELLED) {
+        LOG_INFO("Export cancelled");
+    }
+
+    // A new export may reuse `job` as soon as export_running drops
+    HWND hwnd = job.hwnd;
+    UINT message = job.message;
+    InterlockedExchange(&export_running, 0);
+    if (hwnd) {
+        PostMessage(hwnd, message, (WPARAM)result, 0);
+    }
+    return 0;
+}
+
+int export_start(const char* path, ExportFormat format, HWND hwnd, UINT message) {
+    if (!path || InterlockedCompareExchange(&export_running, 1, 0) != 0) {
+        return -1;
+    }
+
+    // The previous thread has finished (export_running was 0)
+    if (export_thread) {
+        WaitForSingleObject(export_thread, INFINITE);
+        CloseHandle(export_thread);
+        export_thread = NULL;
+    }
+
+    strncpy(job.path, path, MAX_PATH - 1);
+    job.path[MAX_PATH - 1] = '\0';
+    job.format = format;
+    job.hwnd = hwnd;
+    job.message = message;
+    export_cancel_flag = 0;
+    progress_done = 0;
+    progress_total = network_get_seen_count();
+
+    export_thread = CreateThread(NULL, 0, ExportThread, NULL, 0, NULL);
+    if (!export_thread) {
+        LOG_ERROR("Unable to start the export thread");
+        InterlockedExchange(&export_running, 0);
+        return -1;
+    }
+
+    LOG_INFO("Exporting %lld connection(s) to %s", progress_total, job.path);
+    return 0;
+}
+
+void export_cancel(void) {
+    InterlockedExchange(&export_cancel_flag, 1);
+}
+
+BOOL export_is_running(void) {
+    return export_running != 0;
+}
+
+void export_get_progress(LONG64* done, LONG64* total) {
+    if (done) *done = progress_done;
+    if (total) *total = progress_total;
+}
+
+void export_cleanup(void) {
+    if (export_thread) {
+        export_cancel();
+        WaitForSingleObject(export_thread, INFINITE);
+        CloseHandle(export_thread);
+        export_thread = NULL;
+    }
+    release_buffers();
+}
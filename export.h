@@ -0,0 +1,84 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_EXPORT_H
+#define PEEK_EXPORT_H
+
+#include <windows.h>
+
+#define EXPORT_CHUNK_ROWS 2048                  // Rows copied out of the store per lock hold
+#define EXPORT_BUFFER_SIZE (4 * 1024 * 1024)    // Output buffer, allocated once and reused
+#define EXPORT_MAX_ROW_TEXT 8192                // Worst case for one CSV/JSON row
+#define EXPORT_HISTORY_GROUP 0xFFFFFFFFu        // Columnar marker of a history group
+
+// Streaming export of the whole connection history: the rows of the seen
+// store, then one summary per (process image, remote endpoint, protocol) for
+// the connections that already expired or were evicted into the cold tier
+// (coldstore.h). Rows are copied out of the store a chunk at a time and
+// formatted straight into one large buffer (hand-rolled integer / address /
+// timestamp formatting, no printf), which is written with WriteFile whenever
+// it fills up.
+//
+// Formats:
+//   CSV       UTF-8 with BOM, header row, RFC 4180 quoting. The summaries
+//             follow after an empty line, with their own header row
+//   JSON      {"connections": [...], "history": [...]}, one object per line
+//   Columnar  "PEEKCOL1" binary for analytics tools:
+//               header   "PEEKCOL1", u32 column count, then per column
+//                        u8 type, u8 name length, name; then the history
+//                        schema the same way (u32 count, descriptors)
+//               groups   u32 row count, then every column in schema order:
+//                          U8/U16/U32/I64   row count little-endian values
+//                          BYTES16          row count x 16 bytes
+//                          STRING           u32 dictionary size, entries as
+//                                           u16 length + bytes, then row count
+//                                           u32 dictionary indices
+//               history  u32 EXPORT_HISTORY_GROUP, u32 row count, then every
+//                        column of the history schema, encoded as above
+//               trailer  u32 0, u64 total rows, u64 total history rows
+//             Dictionaries are per group (EXPORT_CHUNK_ROWS rows)
+
+typedef enum {
+    EXPORT_FORMAT_CSV,
+    EXPORT_FORMAT_JSON,
+    EXPORT_FORMAT_COLUMNAR
+} ExportFormat;
+
+typedef enum {
+    EXPORT_IDLE,
+    EXPORT_RUNNING,
+    EXPORT_DONE,
+    EXPORT_FAILED,
+    EXPORT_CANCELLED
+} ExportState;
+
+// Column types of the columnar format
+typedef enum {
+    EXPORT_COLUMN_U8 = 1,
+    EXPORT_COLUMN_U16,
+    EXPORT_COLUMN_U32,
+    EXPORT_COLUMN_I64,
+    EXPORT_COLUMN_BYTES16,
+    EXPORT_COLUMN_STRING
+} ExportColumnType;
+
+// Export on the calling thread. `cancel` (may be NULL) is polled between
+// chunks. Returns EXPORT_DONE, EXPORT_FAILED or EXPORT_CANCELLED
+ExportState export_write(const char* path, ExportFormat format, volatile LONG* cancel);
+
+// Export on a background thread. When it ends, `message` is posted to `hwnd`
+// with the final ExportState in wParam. Returns -1 if one is already running
+int export_start(const char* path, ExportFormat format, HWND hwnd, UINT message);
+
+void export_cancel(void);
+
+BOOL export_is_running(void);
+
+// Rows written so far / rows to write for the running (or last) export
+void export_get_progress(LONG64* done, LONG64* total);
+
+// Cancel and wait for a running export, then release the buffers
+void export_cleanup(void);
+
+#endif
@@ -0,0 +1,388 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "geoip.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <shlobj.h>
+
+// ============================================================================
+// Database format (sorted-range, little-endian)
+// ============================================================================
+//
+// [GeoDbHeader][GeoRangeV4 * v4_count][GeoRangeV6 * v6_count]
+//
+// IPv4 ranges hold host-order addresses, IPv6 ranges hold network-order bytes.
+// Both tables are sorted by range start and must not overlap, so a lookup is a
+// single binary search over the mapped view.
+
+#define GEOIP_MAGIC 0x4F454750  // "PGEO"
+#define GEOIP_VERSION 1
+#define GEOIP_CACHE_BUCKETS 8192  // Power of two, 2x cache size
+
+typedef struct {
+    DWORD magic;
+    DWORD version;
+    DWORD v4_count;
+    DWORD v6_count;
+    DWORD v4_offset;
+    DWORD v6_offset;
+} GeoDbHeader;
+
+typedef struct {
+    DWORD start;
+    DWORD end;
+    DWORD asn;
+    char country[2];
+    WORD reserved;
+} GeoRangeV4;
+
+typedef struct {
+    BYTE start[16];
+    BYTE end[16];
+    DWORD asn;
+    char country[2];
+    WORD reserved;
+} GeoRangeV6;
+
+static HANDLE db_file = INVALID_HANDLE_VALUE;
+static HANDLE db_mapping = NULL;
+static const BYTE* db_view = NULL;
+static const GeoRangeV4* ranges_v4 = NULL;
+static const GeoRangeV6* ranges_v6 = NULL;
+static DWORD ranges_v4_count = 0;
+static DWORD ranges_v6_count = 0;
+
+// ============================================================================
+// LRU cache keyed by address
+// ============================================================================
+
+typedef struct {
+    BYTE key[17];     // [0] = IP version (4 or 6), [1..16] = address bytes
+    GeoInfo info;
+    BOOL found;
+    int prev;         // LRU list (head = most recently used)
+    int next;
+    int hash_next;    // Bucket chain
+} GeoCacheEntry;
+
+static GeoCacheEntry geo_cache[GEOIP_CACHE_SIZE];
+static int geo_buckets[GEOIP_CACHE_BUCKETS];
+static int geo_cache_count = 0;
+static int lru_head = -1;
+static int lru_tail = -1;
+
+static CRITICAL_SECTION geoip_cs;
+static BOOL geoip_initialized = FALSE;
+
+static DWORD hash_key(const BYTE* key) {
+    // FNV-1a
+    DWORD hash = 2166136261u;
+    for (int i = 0; i < 17; i++) {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    return hash & (GEOIP_CACHE_BUCKETS - 1);
+}
+
+static void lru_unlink(int idx) {
+    GeoCacheEntry* e = &geo_cache[idx];
+    if (e->prev >= 0) geo_cache[e->prev].next = e->next; else lru_head = e->next;
+    if (e->next >= 0) geo_cache[e->next].prev = e->prev; else lru_tail = e->prev;
+    e->prev = e->next = -1;
+}
+
+static void lru_push_front(int idx) {
+    GeoCacheEntry* e = &geo_cache[idx];
+    e->prev = -1;
+    e->next = lru_head;
+    if (lru_head >= 0) geo_cache[lru_head].prev = idx;
+    lru_head = idx;
+    if (lru_tail < 0) lru_tail = idx;
+}
+
+static void bucket_remove(int idx) {
+    DWORD bucket = hash_key(geo_cache[idx].key);
+    int* link = &geo_buckets[bucket];
+    while (*link >= 0) {
+        if (*link == idx) {
+            *link = geo_cache[idx].hash_next;
+            return;
+        }
+        link = &geo_cache[*link].hash_next;
+    }
+}
+
+// Must be called with geoip_cs held
+static int cache_find(const BYTE* key) {
+    for (int i = geo_buckets[hash_key(key)]; i >= 0; i = geo_cache[i].hash_next) {
+        if (memcmp(geo_cache[i].key, key, sizeof(geo_cache[i].key)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Must be called with geoip_cs held
+static void cache_insert(const BYTE* key, const GeoInfo* info, BOOL found) {
+    int idx;
+    if (geo_cache_count < GEOIP_CACHE_SIZE) {
+        idx = geo_cache_count++;
+    } else {
+        // Recycle the least recently used entry
+        idx = lru_tail;
+        lru_unlink(idx);
+        bucket_remove(idx);
+    }
+
+    GeoCacheEntry* e = &geo_cache[idx];
+    memcpy(e->key, key, sizeof(e->key));
+    e->info = *info;
+    e->found = found;
+
+    DWORD bucket = hash_key(key);
+    e->hash_next = geo_buckets[bucket];
+    geo_buckets[bucket] = idx;
+    lru_push_front(idx);
+}
+
+// ============================================================================
+// Range search
+// ============================================================================
+
+static const GeoRangeV4* find_range_v4(DWORD ip) {
+    DWORD lo = 0, hi = ranges_v4_count;
+    while (lo < hi) {
+        DWORD mid = lo + (hi - lo) / 2;
+        if (ranges_v4[mid].start <= ip) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // lo is the first range starting after ip
+    if (lo == 0 || ip > ranges_v4[lo - 1].end) {
+        return NULL;
+    }
+    return &ranges_v4[lo - 1];
+}
+
+static const GeoRangeV6* find_range_v6(const BYTE* ip) {
+    DWORD lo = 0, hi = ranges_v6_count;
+    while (lo < hi) {
+        DWORD mid = lo + (hi - lo) / 2;
+        if (memcmp(ranges_v6[mid].start, ip, 16) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0 || memcmp(ip, ranges_v6[lo - 1].end, 16) > 0) {
+        return NULL;
+    }
+    return &ranges_v6[lo - 1];
+}
+
+static void fill_info(GeoInfo* info, const char* country, DWORD asn) {
+    info->country[0] = country[0];
+    info->country[1] = country[1];
+    info->country[2] = '\0';
+    info->asn = asn;
+}
+
+// Shared lookup path: cache first, then the mapped ranges
+static BOOL geoip_lookup(const BYTE* key, GeoInfo* info) {
+    memset(info, 0, sizeof(GeoInfo));
+
+    if (!geoip_initialized || db_view == NULL) {
+        return FALSE;
+    }
+
+    EnterCriticalSection(&geoip_cs);
+
+    int idx = cache_find(key);
+    if (idx >= 0) {
+        lru_unlink(idx);
+        lru_push_front(idx);
+        *info = geo_cache[idx].info;
+        BOOL found = geo_cache[idx].found;
+        LeaveCriticalSection(&geoip_cs);
+        return found;
+    }
+
+    BOOL found = FALSE;
+    if (key[0] == 4) {
+        DWORD ip = ((DWORD)key[1] << 24) | ((DWORD)key[2] << 16) | ((DWORD)key[3] << 8) | key[4];
+        const GeoRangeV4* range = find_range_v4(ip);
+        if (range) {
+            fill_info(info, range->country, range->asn);
+            found = TRUE;
+        }
+    } else {
+        const GeoRangeV6* range = find_range_v6(&key[1]);
+        if (range) {
+            fill_info(info, range->country, range->asn);
+            found = TRUE;
+        }
+    }
+
+    // Negative results are memoized too so unknown endpoints stay free
+    cache_insert(key, info, found);
+
+    LeaveCriticalSection(&geoip_cs);
+    return found;
+}
+
+BOOL geoip_lookup_ipv4(DWORD addr, GeoInfo* info) {
+    BYTE key[17] = {0};
+    key[0] = 4;
+    memcpy(&key[1], &addr, 4);  // Already in network byte order
+    return geoip_lookup(key, info);
+}
+
+BOOL geoip_lookup_ipv6(const BYTE* addr, GeoInfo* info) {
+    BYTE key[17];
+    key[0] = 6;
+    memcpy(&key[1], addr, 16);
+    return geoip_lookup(key, info);
+}
+
+void geoip_format(const GeoInfo* info, char* buffer, size_t size) {
+    if (!info || (info->country[0] == '\0' && info->asn == 0)) {
+        snprintf(buffer, size, "-");
+    } else if (info->asn == 0) {
+        snprintf(buffer, size, "%s", info->country);
+    } else if (info->country[0] == '\0') {
+        snprintf(buffer, size, "AS%lu", info->asn);
+    } else {
+        snprintf(buffer, size, "%s AS%lu", info->country, info->asn);
+    }
+}
+
+// ============================================================================
+// Database lifecycle
+// ============================================================================
+
+static void close_database(void) {
+    if (db_view) {
+        UnmapViewOfFile(db_view);
+        db_view = NULL;
+    }
+    if (db_mapping) {
+        CloseHandle(db_mapping);
+        db_mapping = NULL;
+    }
+    if (db_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(db_file);
+        db_file = INVALID_HANDLE_VALUE;
+    }
+    ranges_v4 = NULL;
+    ranges_v6 = NULL;
+    ranges_v4_count = 0;
+    ranges_v6_count = 0;
+}
+
+static BOOL open_database(const char* path) {
+    db_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (db_file == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(db_file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(GeoDbHeader) ||
+        file_size.QuadPart > 0x7FFFFFFF) {
+        LOG_ERROR("GeoIP database has an invalid size");
+        close_database();
+        return FALSE;
+    }
+
+    db_mapping = CreateFileMappingA(db_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!db_mapping) {
+        LOG_ERROR("Failed to map GeoIP database: %lu", GetLastError());
+        close_database();
+        return FALSE;
+    }
+
+    db_view = (const BYTE*)MapViewOfFile(db_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!db_view) {
+        LOG_ERROR("Failed to map GeoIP database view: %lu", GetLastError());
+        close_database();
+        return FALSE;
+    }
+
+    const GeoDbHeader* header = (const GeoDbHeader*)db_view;
+    ULONGLONG size = (ULONGLONG)file_size.QuadPart;
+    ULONGLONG v4_end = (ULONGLONG)header->v4_offset + (ULONGLONG)header->v4_count * sizeof(GeoRangeV4);
+    ULONGLONG v6_end = (ULONGLONG)header->v6_offset + (ULONGLONG)header->v6_count * sizeof(GeoRangeV6);
+
+    if (header->magic != GEOIP_MAGIC || header->version != GEOIP_VERSION ||
+        (header->v4_offset % 4) != 0 || (header->v6_offset % 4) != 0 ||
+        v4_end > size || v6_end > size) {
+        LOG_ERROR("Invalid GeoIP database (bad header)");
+        close_database();
+        return FALSE;
+    }
+
+    ranges_v4 = (const GeoRangeV4*)(db_view + header->v4_offset);
+    ranges_v6 = (const GeoRangeV6*)(db_view + header->v6_offset);
+    ranges_v4_count = header->v4_count;
+    ranges_v6_count = header->v6_count;
+
+    // Fault every page in now so lookups never wait on disk I/O
+    volatile BYTE sink = 0;
+    for (ULONGLONG offset = 0; offset < size; offset += 4096) {
+        sink ^= db_view[offset];
+    }
+    (void)sink;
+
+    return TRUE;
+}
+
+int geoip_init(void) {
+    if (geoip_initialized) {
+        return 0;
+    }
+
+    InitializeCriticalSection(&geoip_cs);
+    for (int i = 0; i < GEOIP_CACHE_BUCKETS; i++) {
+        geo_buckets[i] = -1;
+    }
+    geo_cache_count = 0;
+    lru_head = lru_tail = -1;
+    geoip_initialized = TRUE;
+
+    char appdata[MAX_PATH];
+    char path[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(path, MAX_PATH, "%s\\Peek\\geoip.dat", appdata);
+    } else {
+        strcpy(path, "geoip.dat");
+    }
+
+    if (!open_database(path)) {
+        LOG_INFO("No GeoIP database found - Country/ASN lookup disabled");
+        return 0;
+    }
+
+    LOG_SUCCESS("GeoIP database loaded (%lu IPv4 / %lu IPv6 ranges)",
+                ranges_v4_count, ranges_v6_count);
+    return 0;
+}
+
+void geoip_cleanup(void) {
+    if (!geoip_initialized) {
+        return;
+    }
+
+    EnterCriticalSection(&geoip_cs);
+    close_database();
+    geo_cache_count = 0;
+    lru_head = lru_tail = -1;
+    LeaveCriticalSection(&geoip_cs);
+
+    DeleteCriticalSection(&geoip_cs);
+    geoip_initialized = FALSE;
+}
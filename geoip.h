@@ -0,0 +1,33 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_GEOIP_H
+#define PEEK_GEOIP_H
+
+#include <windows.h>
+
+#define GEOIP_COUNTRY_LENGTH 3   // ISO 3166-1 alpha-2 code + null terminator
+#define GEOIP_CACHE_SIZE 4096    // Max memoized addresses (LRU)
+
+typedef struct {
+    char country[GEOIP_COUNTRY_LENGTH];  // Empty string when unknown
+    DWORD asn;                           // 0 when unknown
+} GeoInfo;
+
+// Open the local GeoIP database (%APPDATA%\Peek\geoip.dat) via memory mapping.
+// A missing database is not an error: lookups simply return FALSE.
+int geoip_init(void);
+
+void geoip_cleanup(void);
+
+// Offline lookups - never touch the disk or the network once initialized.
+// Results are memoized in a bounded LRU keyed by address.
+BOOL geoip_lookup_ipv4(DWORD addr, GeoInfo* info);
+
+BOOL geoip_lookup_ipv6(const BYTE* addr, GeoInfo* info);
+
+// Format as "CC ASnnnn", "CC", "ASnnnn" or "-"
+void geoip_format(const GeoInfo* info, char* buffer, size_t size);
+
+#endif
@@ -4,8 +4,13 @@
 
 #include "gui.h"
 #include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "export.h"
 #include "resource.h"
+#include "resolver.h"
 #include <stdio.h>
+#include <commdlg.h>
 
 #define CLASS_NAME L"PeekWindowClass"
 #define WINDOW_TITLE L"PEEK - Network Monitor"
@@ -18,6 +23,7 @@
 #define ID_TIMER 1006
 #define ID_TIMER_FLASH 1007
 #define ID_TIMER_SECURITY 1013
+#define ID_TIMER_PERF 1016
 #define ID_RADIO_ALL 1008
 #define ID_RADIO_OUTBOUND 1009
 #define ID_RADIO_INBOUND 1010
@@ -26,9 +32,29 @@
 #define ID_COMBO_TRUST 1015
 #define ID_LEGEND_GROUP 1014
 
+#define WM_APP_HOSTNAMES_READY (WM_USER + 2)
+#define WM_APP_SECURITY_READY (WM_USER + 3)
+#define WM_APP_EXPORT_DONE (WM_USER + 4)
+
 #define FLASH_DURATION_MS 1500
 #define LEGEND_HEIGHT 50
 #define MAX_HIGHLIGHTED_ITEMS 100
+#define PERF_REFRESH_MS 1000
+
+// Status bar parts: the first four are the connection counters, the rest the
+// self-performance panel
+enum {
+    STATUS_PART_STATE,
+    STATUS_PART_NEW,
+    STATUS_PART_ACTIVE,
+    STATUS_PART_TOTAL,
+    STATUS_PART_POLL,
+    STATUS_PART_QUEUE,
+    STATUS_PART_CACHE,
+    STATUS_PART_PROCESS,
+    STATUS_PART_DROPPED,
+    STATUS_PART_COUNT
+};
 
 typedef struct {
     int item_index;
@@ -41,6 +67,9 @@ typedef struct {
     DWORD remote_addr;
     DWORD remote_port;
     DWORD local_port;
+    IPVersion ip_version;
+    BYTE remote_addr_v6[16];
+    BOOL resolvable;         // Has a remote endpoint worth a reverse DNS lookup
 } ConnectionKey;
 
 #define MAX_LISTVIEW_ITEMS 2000
@@ -74,9 +103,8 @@ static int g_trust_filter = -1; // Default to show all trust levels
 static HighlightedItem g_highlighted_items[MAX_HIGHLIGHTED_ITEMS];
 static int g_highlighted_count = 0;
 
-// Security info loading progress
-static HANDLE g_security_thread = NULL;
-static BOOL g_security_loading = FALSE;
+// Last metrics sample, refreshed by ID_TIMER_PERF; paints only read it
+static MetricsSummary g_perf_summary;
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 void CreateControls(HWND hwnd);
@@ -87,24 +115,14 @@ void UpdateHighlights(void);
 COLORREF GetHighlightColor(int item_index, BOOL* is_highlighted);
 void RefreshListViewWithFilter(void);
 void UpdateTrustColumnForConnection(DWORD pid, DWORD remote_addr, DWORD remote_port, DWORD local_port);
-
-// Security loading thread
-static DWORD WINAPI LoadSecurityInfoThread(LPVOID lpParam) {
-    (void)lpParam;
-
-    // Compute security info for all seen connections in parallel
-    // This updates the seen_connections array directly (thread-safe)
-    network_compute_security_for_all_seen();
-
-    g_security_loading = FALSE;
-
-    // Trigger full UI refresh after all security info is loaded
-    if (g_hwndListView) {
-        PostMessage(g_hwndMain, WM_USER + 1, 0, 0); // Custom message to refresh
-    }
-
-    return 0;
-}
+void UpdateHostnameColumn(void);
+void PrioritizeVisibleRows(void);
+void ApplySecurityUpdates(void);
+void ToggleTrace(void);
+void UpdatePerformancePanel(void);
+void ShowPerformanceDetails(void);
+void ToggleExport(void);
+void ShowProcessHistory(const NetworkConnection* conn);
 
 int gui_init(HINSTANCE hInstance) {
     g_hInstance = hInstance;
@@ -169,6 +187,12 @@ HWND gui_create_window(HINSTANCE hInstance) {
 
     CreateControls(g_hwndMain);
 
+    // Reverse DNS answers arrive on resolver threads and are marshalled here
+    resolver_set_notify_window(g_hwndMain, WM_APP_HOSTNAMES_READY);
+
+    // Same for trust results computed by the security queue
+    network_set_security_notify_window(g_hwndMain, WM_APP_SECURITY_READY);
+
     ShowWindow(g_hwndMain, SW_SHOW);
     UpdateWindow(g_hwndMain);
 
@@ -328,6 +352,7 @@ void CreateControls(HWND hwnd) {
     SendMessageW(g_hwndComboTrust, CB_ADDSTRING, 0, (LPARAM)L"Manually Threat");
     SendMessageW(g_hwndComboTrust, CB_ADDSTRING, 0, (LPARAM)L"Error");
     SendMessageW(g_hwndComboTrust, CB_ADDSTRING, 0, (LPARAM)L"Unknown");
+    SendMessageW(g_hwndComboTrust, CB_ADDSTRING, 0, (LPARAM)L"Blocklisted");
 
     // Set default to "All"
     SendMessageW(g_hwndComboTrust, CB_SETCURSEL, 0, 0);
@@ -405,6 +430,15 @@ void CreateControls(HWND hwnd) {
         legendItemX + spacingX * 2 + colorBoxSize + 5, legendItemY + spacingY, 120, 20,
         hwnd, NULL, g_hInstance, NULL);
 
+    // Purple - Threat feed match (fourth column, first row)
+    CreateWindowW(L"STATIC", L"", WS_CHILD | WS_VISIBLE,
+        legendItemX + spacingX * 3, legendItemY + 2, colorBoxSize, colorBoxSize,
+        hwnd, (HMENU)1407, g_hInstance, NULL);
+    SetWindowLongPtrW(GetDlgItem(hwnd, 1407), GWLP_USERDATA, (LONG_PTR)RGB(220, 180, 255));
+    CreateWindowW(L"STATIC", L"Blocklisted", WS_CHILD | WS_VISIBLE,
+        legendItemX + spacingX * 3 + colorBoxSize + 5, legendItemY, 120, 20,
+        hwnd, NULL, g_hInstance, NULL);
+
     // listY accounts for: btnMargin + btnHeight (toolbar) + legendY offset + legend height (70) + spacing
     int listY = btnMargin + btnHeight + btnMargin + 70;
     g_hwndListView = CreateWindowEx(
@@ -435,9 +469,13 @@ void CreateControls(HWND hwnd) {
         NULL
     );
 
-    int statusParts[] = {200, 400, 600, -1};
-    SendMessage(g_hwndStatusBar, SB_SETPARTS, 4, (LPARAM)statusParts);
-    SendMessage(g_hwndStatusBar, SB_SETTEXT, 0, (LPARAM)L"Ready");
+    int statusParts[STATUS_PART_COUNT] = {110, 220, 330, 440, 640, 800, 920, 1090, -1};
+    SendMessage(g_hwndStatusBar, SB_SETPARTS, STATUS_PART_COUNT, (LPARAM)statusParts);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_STATE, (LPARAM)L"Ready");
+
+    // Independent of monitoring: the panel also shows Peek idling
+    SetTimer(hwnd, ID_TIMER_PERF, PERF_REFRESH_MS, NULL);
+    UpdatePerformancePanel();
 }
 
 void InitializeListView(void) {
@@ -509,30 +547,38 @@ void InitializeListView(void) {
     lvc.cx = 60;
     lvc.fmt = LVCFMT_CENTER;
     ListView_InsertColumn(g_hwndListView, 10, &lvc);
-}
 
-void gui_add_connection(const NetworkConnection* conn) {
-    if (!g_hwndListView || !conn) return;
+    // Country/ASN column (offline GeoIP)
+    lvc.pszText = L"Geo";
+    lvc.cx = 110;
+    lvc.fmt = LVCFMT_LEFT;
+    ListView_InsertColumn(g_hwndListView, 11, &lvc);
 
-    // Apply direction filter
-    if (g_filter != CONN_UNKNOWN && conn->direction != g_filter) {
-        return; // Skip this connection based on direction filter
-    }
+    // Hostname column (reverse DNS, filled asynchronously)
+    lvc.pszText = L"Host";
+    lvc.cx = 220;
+    lvc.fmt = LVCFMT_LEFT;
+    ListView_InsertColumn(g_hwndListView, 12, &lvc);
+}
 
-    // Apply localhost filter
-    if (!g_show_localhost && conn->is_localhost) {
-        return; // Skip localhost connections if filter is disabled
+// Direction, localhost, protocol and trust filters as one column predicate
+static void build_row_filter(ConnectionFilter* filter) {
+    connstore_filter_reset(filter);
+    if (g_filter != CONN_UNKNOWN) {
+        filter->direction = g_filter;
     }
-
-    // Apply protocol filter
-    if (g_protocol_filter != -1 && conn->protocol != g_protocol_filter) {
-        return; // Skip this connection based on protocol filter
+    if (!g_show_localhost) {
+        filter->flags_mask = CONNSTORE_FLAG_LOCALHOST;
+        filter->flags_value = 0;
     }
+    filter->protocol = g_protocol_filter;
+    filter->trust = g_trust_filter;
+}
 
-    // Apply trust level filter
-    if (g_trust_filter != -1 && conn->trust_status != g_trust_filter) {
-        return; // Skip this connection based on trust level filter
-    }
+// Caller has applied the filters. `is_new`: a new connection, not a list rebuild
+// (only its hostname lookup counts in the reverse DNS hit rate)
+static void insert_connection_row(const NetworkConnection* conn, BOOL is_new) {
+    if (!g_hwndListView || !conn) return;
 
     // Prepare connection data
     char remote_ip[64];
@@ -568,6 +614,12 @@ void gui_add_connection(const NetworkConnection* conn) {
     wchar_t pid_str[16];
     swprintf(pid_str, 16, L"%lu", conn->pid);
 
+    // Country/ASN was resolved once at enumeration time
+    char geo[32];
+    wchar_t w_geo[32];
+    geoip_format(&conn->geo, geo, sizeof(geo));
+    MultiByteToWideChar(CP_ACP, 0, geo, -1, w_geo, 32);
+
     wchar_t direction_str[4];
     if (conn->direction == CONN_OUTBOUND) {
         wcscpy(direction_str, L"OUT");
@@ -605,6 +657,9 @@ void gui_add_connection(const NetworkConnection* conn) {
         case TRUST_ERROR:
             wcscpy(trust_str, L"!");   // Exclamation for error
             break;
+        case TRUST_BLOCKLISTED:
+            wcscpy(trust_str, L"⛔");   // No-entry for threat feed match
+            break;
         case TRUST_UNKNOWN:
         default:
             wcscpy(trust_str, L"?");   // Question for unknown
@@ -673,9 +728,31 @@ void gui_add_connection(const NetworkConnection* conn) {
         g_connection_keys[key_index].remote_addr = conn->remote_addr;
         g_connection_keys[key_index].remote_port = conn->remote_port;
         g_connection_keys[key_index].local_port = conn->local_port;
+        g_connection_keys[key_index].ip_version = conn->ip_version;
+        memcpy(g_connection_keys[key_index].remote_addr_v6, conn->remote_addr_v6, 16);
+        g_connection_keys[key_index].resolvable = (conn->protocol == PROTO_TCP && !conn->is_localhost);
         g_connection_keys_count++;
     }
 
+    // Reverse DNS never blocks: cached names show immediately, others arrive later
+    wchar_t w_hostname[RESOLVER_MAX_HOSTNAME] = L"";
+    if (key_index < MAX_LISTVIEW_ITEMS && g_connection_keys[key_index].resolvable) {
+        char hostname[RESOLVER_MAX_HOSTNAME];
+        BOOL known;
+        if (is_new) {
+            known = (conn->ip_version == IP_V4)
+                ? resolver_lookup_ipv4(conn->remote_addr, hostname, sizeof(hostname))
+                : resolver_lookup_ipv6(conn->remote_addr_v6, hostname, sizeof(hostname));
+        } else {
+            known = (conn->ip_version == IP_V4)
+                ? resolver_recheck_ipv4(conn->remote_addr, hostname, sizeof(hostname))
+                : resolver_recheck_ipv6(conn->remote_addr_v6, hostname, sizeof(hostname));
+        }
+        if (known) {
+            MultiByteToWideChar(CP_ACP, 0, hostname, -1, w_hostname, RESOLVER_MAX_HOSTNAME);
+        }
+    }
+
     LVITEM lvi = {0};
     lvi.mask = LVIF_TEXT | LVIF_PARAM;
     lvi.iItem = item_count; // Insert at end
@@ -694,6 +771,8 @@ void gui_add_connection(const NetworkConnection* conn) {
     ListView_SetItemText(g_hwndListView, index, 8, trust_str);
     ListView_SetItemText(g_hwndListView, index, 9, pid_str);
     ListView_SetItemText(g_hwndListView, index, 10, L"1");
+    ListView_SetItemText(g_hwndListView, index, 11, w_geo);
+    ListView_SetItemText(g_hwndListView, index, 12, w_hostname);
 
     // Trigger highlight effect for new connection
     AddHighlightedItem(index);
@@ -702,22 +781,191 @@ void gui_add_connection(const NetworkConnection* conn) {
     ListView_EnsureVisible(g_hwndListView, index, FALSE);
 }
 
+void gui_add_connection(const NetworkConnection* conn) {
+    TRACE_BEGIN("ui add row");
+    LONG64 start = metrics_now();
+
+    ConnectionFilter filter;
+    ConnectionRow row;
+    build_row_filter(&filter);
+    network_connection_row(conn, &row);
+    if (connstore_matches(&filter, &row)) {
+        insert_connection_row(conn, TRUE);
+    }
+    metrics_observe_since(METRIC_HIST_GUI_ADD, start);
+    TRACE_END("ui add row");
+}
+
 void gui_update_stats(const NetworkStats* stats) {
     if (!g_hwndStatusBar || !stats) return;
 
     wchar_t status_text[256];
 
     swprintf(status_text, 256, L"Monitoring");
-    SendMessage(g_hwndStatusBar, SB_SETTEXT, 0, (LPARAM)status_text);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_STATE, (LPARAM)status_text);
 
     swprintf(status_text, 256, L"New: %d", stats->new_connections);
-    SendMessage(g_hwndStatusBar, SB_SETTEXT, 1, (LPARAM)status_text);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_NEW, (LPARAM)status_text);
 
     swprintf(status_text, 256, L"Active: %d", stats->active_connections);
-    SendMessage(g_hwndStatusBar, SB_SETTEXT, 2, (LPARAM)status_text);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_ACTIVE, (LPARAM)status_text);
 
     swprintf(status_text, 256, L"Total: %d", stats->total_connections);
-    SendMessage(g_hwndStatusBar, SB_SETTEXT, 3, (LPARAM)status_text);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_TOTAL, (LPARAM)status_text);
+}
+
+// Once per PERF_REFRESH_MS: sample the metrics registry and rewrite the panel
+void UpdatePerformancePanel(void) {
+    if (!g_hwndStatusBar) return;
+
+    // The poll only publishes the queue depth while monitoring
+    metrics_gauge_set(METRIC_GAUGE_SECURITY_QUEUE, network_get_security_queue_length());
+    metrics_sample(&g_perf_summary);
+    const MetricsSummary* m = &g_perf_summary;
+
+    wchar_t status_text[256];
+
+    const MetricsStage* poll = &m->stages[METRIC_HIST_POLL];
+    if (poll->count > 0) {
+        swprintf(status_text, 256, L"Poll: %.1f ms (p99 %.1f)", poll->last_ms, poll->p99_ms);
+    } else {
+        swprintf(status_text, 256, L"Poll: -");
+    }
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_POLL, (LPARAM)status_text);
+
+    swprintf(status_text, 256, L"Queue: %lld (%.0f/s)", m->security_queue, m->security_per_second);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_QUEUE, (LPARAM)status_text);
+
+    if (m->security_cache_hit_rate >= 0.0) {
+        swprintf(status_text, 256, L"Cache: %.0f%%", m->security_cache_hit_rate * 100.0);
+    } else {
+        swprintf(status_text, 256, L"Cache: -");
+    }
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_CACHE, (LPARAM)status_text);
+
+    swprintf(status_text, 256, L"CPU: %.1f%%  Mem: %.1f MB", m->cpu_percent,
+             m->working_set / (1024.0 * 1024.0));
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_PROCESS, (LPARAM)status_text);
+
+    swprintf(status_text, 256, L"Dropped: %lld", m->log_dropped + m->security_rejected);
+    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_DROPPED, (LPARAM)status_text);
+}
+
+static int append_stage(wchar_t* text, int size, int used, const wchar_t* label, MetricHistogram id) {
+    const MetricsStage* stage = &g_perf_summary.stages[id];
+    if (used >= size) return used;
+    if (stage->count == 0) {
+        return used + swprintf(text + used, size - used, L"  %-18ls -\n", label);
+    }
+    return used + swprintf(text + used, size - used,
+                           L"  %-18ls last %.2f ms   p50 %.2f ms   p99 %.2f ms   (%lld)\n",
+                           label, stage->last_ms, stage->p50_ms, stage->p99_ms, stage->count);
+}
+
+// Double-click on the status bar: full breakdown of the last sample
+void ShowPerformanceDetails(void) {
+    const MetricsSummary* m = &g_perf_summary;
+    ColdStoreStats history;
+    network_get_history_stats(&history);
+    wchar_t text[2048];
+    int size = (int)(sizeof(text) / sizeof(text[0]));
+    int used = 0;
+
+    used += swprintf(text + used, size - used, L"Stage latencies (histogram buckets, ~12%% precision)\n");
+    used = append_stage(text, size, used, L"Poll", METRIC_HIST_POLL);
+    used = append_stage(text, size, used, L"TCP IPv4 table", METRIC_HIST_TABLE_TCP4);
+    used = append_stage(text, size, used, L"TCP IPv6 table", METRIC_HIST_TABLE_TCP6);
+    used = append_stage(text, size, used, L"UDP IPv4 table", METRIC_HIST_TABLE_UDP4);
+    used = append_stage(text, size, used, L"UDP IPv6 table", METRIC_HIST_TABLE_UDP6);
+    used = append_stage(text, size, used, L"Diff", METRIC_HIST_DIFF);
+    used = append_stage(text, size, used, L"Process snapshot", METRIC_HIST_PROCESS_SNAPSHOT);
+    used = append_stage(text, size, used, L"Process name", METRIC_HIST_PROCESS_NAME);
+    used = append_stage(text, size, used, L"SHA-256", METRIC_HIST_SHA256);
+    used = append_stage(text, size, used, L"Signature check", METRIC_HIST_VERIFY_SIGNATURE);
+    used = append_stage(text, size, used, L"List insert", METRIC_HIST_GUI_ADD);
+    used = append_stage(text, size, used, L"Visible row trust", METRIC_HIST_VISIBLE_TRUST);
+
+    if (used < size) {
+        used += swprintf(text + used, size - used,
+                         L"\nSecurity queue: %lld pending, %.1f analyses/s, %lld rejected (queue full)\n"
+                         L"Security cache hit rate: %.0f%%\n"
+                         L"Reverse DNS cache hit rate: %.0f%%\n"
+                         L"Connections: %lld active, %lld tracked\n"
+                         L"History: %d summaries of %llu closed connections, %.1f KB\n"
+                         L"\nPeek process: %.1f%% CPU, %.1f MB working set (peak %.1f MB)\n"
+                         L"Log messages dropped: %lld",
+                         m->security_queue, m->security_per_second, m->security_rejected,
+                         m->security_cache_hit_rate >= 0.0 ? m->security_cache_hit_rate * 100.0 : 0.0,
+                         m->resolver_hit_rate >= 0.0 ? m->resolver_hit_rate * 100.0 : 0.0,
+                         m->active_connections, m->seen_connections,
+                         history.summaries, (unsigned long long)history.connections, history.bytes / 1024.0,
+                         m->cpu_percent, m->working_set / (1024.0 * 1024.0),
+                         m->peak_working_set / (1024.0 * 1024.0), m->log_dropped);
+    }
+
+    MessageBoxW(g_hwndMain, text, L"PEEK - Performance", MB_OK | MB_ICONINFORMATION);
+}
+
+static int compare_history_count(const void* a, const void* b) {
+    const ColdSummary* x = (const ColdSummary*)a;
+    const ColdSummary* y = (const ColdSummary*)b;
+    return (x->count < y->count) ? 1 : (x->count > y->count) ? -1 : 0;
+}
+
+// Context menu: the compacted history of the row's executable, busiest endpoints first
+void ShowProcessHistory(const NetworkConnection* conn) {
+    const char* process_path = conn->process_path[0] ? conn->process_path : conn->process_name;
+    ColdSummary* summaries = NULL;
+    int count = 0;
+    if (network_query_history(process_path, &summaries, &count) != 0) {
+        MessageBoxW(g_hwndMain, L"Unable to read the connection history.", L"PEEK - History", MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    wchar_t text[4096];
+    int size = (int)(sizeof(text) / sizeof(text[0]));
+    int used = swprintf(text, size, L"%hs (PID %lu, parent %lu, session %lu)\n\n",
+                        conn->process_name, conn->pid, conn->parent_pid, conn->session_id);
+    if (count == 0) {
+        used += swprintf(text + used, size - used,
+                         L"No closed connection has been compacted yet (entries stay in the list for the retention window).");
+    } else {
+        used += swprintf(text + used, size - used, L"%d endpoint(s), busiest first:\n\n", count);
+    }
+
+    qsort(summaries, (size_t)count, sizeof(ColdSummary), compare_history_count);
+    for (int i = 0; i < count && i < 25 && used < size; i++) {
+        const ColdSummary* h = &summaries[i];
+        char address[64];
+        if (h->ip_version == IP_V4) {
+            DWORD addr;
+            memcpy(&addr, h->remote_addr, sizeof(addr));
+            network_format_ip(addr, address, sizeof(address));
+        } else {
+            network_format_ipv6(h->remote_addr, address, sizeof(address));
+        }
+
+        // Milliseconds since 1601 back to a local wall-clock time
+        ULARGE_INTEGER last;
+        last.QuadPart = h->last_seen * 10000;
+        FILETIME utc = {last.LowPart, last.HighPart};
+        FILETIME local;
+        SYSTEMTIME st = {0};
+        FileTimeToLocalFileTime(&utc, &local);
+        FileTimeToSystemTime(&local, &st);
+
+        used += swprintf(text + used, size - used,
+                         L"%ls %hs:%u   %u connection(s), avg %.1f s, last %04u-%02u-%02u %02u:%02u\n",
+                         h->protocol == PROTO_TCP ? L"TCP" : L"UDP", address, h->remote_port, h->count,
+                         h->total_duration / 1000.0 / h->count,
+                         st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute);
+    }
+    if (count > 25 && used < size) {
+        swprintf(text + used, size - used, L"... and %d more", count - 25);
+    }
+    free(summaries);
+
+    MessageBoxW(g_hwndMain, text, L"PEEK - History", MB_OK | MB_ICONINFORMATION);
 }
 
 void gui_clear_list(void) {
@@ -732,27 +980,95 @@ void gui_clear_list(void) {
 void RefreshListViewWithFilter(void) {
     if (!g_hwndListView) return;
 
+    TRACE_BEGIN("ui refresh");
+
     // Clear current list and highlights
     ListView_DeleteAllItems(g_hwndListView);
     g_highlighted_count = 0;
     g_connection_keys_count = 0; // Reset connection keys
 
-    // Get all seen connections and re-add them with the current filter
-    NetworkConnection* all_conns = NULL;
-    int count = 0;
-
-    if (network_get_all_seen_connections(&all_conns, &count) == 0) {
-        for (int i = 0; i < count; i++) {
-            gui_add_connection(&all_conns[i]);
+    // Select matching rows on the seen columns, then insert only those
+    int count = network_get_seen_slots();
+    uint64_t* mask = (count > 0) ? (uint64_t*)malloc(CONNSTORE_MASK_WORDS(count) * sizeof(uint64_t)) : NULL;
+    if (mask) {
+        ConnectionFilter filter;
+        build_row_filter(&filter);
+        int matches = network_filter_seen(&filter, count, mask);
+
+        NetworkConnection conn;
+        for (int word = 0; word < CONNSTORE_MASK_WORDS(count); word++) {
+            for (uint64_t bits = mask[word]; bits; bits &= bits - 1) {
+                int bit = 0;
+                while (!((bits >> bit) & 1)) bit++;
+                if (network_get_seen_connection(word * 64 + bit, &conn)) {
+                    insert_connection_row(&conn, FALSE);
+                }
+            }
         }
-        free(all_conns);
-        LOG_INFO("ListView refreshed with filter (%d connections)", count);
+        free(mask);
+        LOG_INFO("ListView refreshed with filter (%d of %d connections)", matches, network_get_seen_count());
     }
 
     // Update stats
     NetworkStats stats;
     network_get_stats(&stats);
     gui_update_stats(&stats);
+
+    PrioritizeVisibleRows();
+    TRACE_END("ui refresh");
+}
+
+// Move the rows currently on screen to the front of the security queue
+void PrioritizeVisibleRows(void) {
+    if (!g_hwndListView) return;
+
+    int top = ListView_GetTopIndex(g_hwndListView);
+    int per_page = ListView_GetCountPerPage(g_hwndListView) + 1;  // Partially visible last row
+    int item_count = ListView_GetItemCount(g_hwndListView);
+
+    for (int i = top; i < top + per_page && i < item_count; i++) {
+        LVITEM lvi = {0};
+        lvi.mask = LVIF_PARAM;
+        lvi.iItem = i;
+        if (!ListView_GetItem(g_hwndListView, &lvi)) continue;
+
+        int key_index = (int)lvi.lParam;
+        if (key_index < 0 || key_index >= g_connection_keys_count) continue;
+
+        ConnectionKey* key = &g_connection_keys[key_index];
+        NetworkConnection conn;
+        int index = network_find_connection(key->pid, key->remote_addr,
+                                            key->remote_port, key->local_port, &conn);
+        if (index >= 0 && !conn.security_info_loaded) {
+            network_queue_security_info(index, SECURITY_PRIORITY_VISIBLE);
+        }
+    }
+}
+
+// Update the Trust cell of every row whose analysis just finished
+void ApplySecurityUpdates(void) {
+    int indices[256];
+    BOOL overflowed = FALSE;
+    int count;
+    BOOL any = FALSE;
+
+    while ((count = network_drain_security_updates(indices, 256, &overflowed)) > 0) {
+        for (int i = 0; i < count; i++) {
+            NetworkConnection conn;
+            if (network_get_seen_connection(indices[i], &conn)) {
+                UpdateTrustColumnForConnection(conn.pid, conn.remote_addr,
+                                               conn.remote_port, conn.local_port);
+                any = TRUE;
+            }
+        }
+    }
+
+    if (overflowed) {
+        RefreshListViewWithFilter();
+    } else if (any) {
+        // Trust colors are painted in custom draw
+        InvalidateRect(g_hwndListView, NULL, FALSE);
+    }
 }
 
 // Update the trust column text for a specific connection in the ListView
@@ -779,10 +1095,10 @@ void UpdateTrustColumnForConnection(DWORD pid, DWORD remote_addr, DWORD remote_p
                     key->local_port == local_port) {
 
                     // Get the real connection to read its trust status
-                    NetworkConnection* conn = network_find_connection(pid, remote_addr, remote_port, local_port);
-                    if (conn) {
+                    NetworkConnection conn;
+                    if (network_find_connection(pid, remote_addr, remote_port, local_port, &conn) >= 0) {
                         wchar_t trust_str[8];
-                        switch (conn->trust_status) {
+                        switch (conn.trust_status) {
                             case TRUST_MICROSOFT_SIGNED:
                                 wcscpy(trust_str, L"✓✓");  // Double checkmark for Microsoft
                                 break;
@@ -804,6 +1120,9 @@ void UpdateTrustColumnForConnection(DWORD pid, DWORD remote_addr, DWORD remote_p
                             case TRUST_ERROR:
                                 wcscpy(trust_str, L"!");   // Exclamation for error
                                 break;
+                            case TRUST_BLOCKLISTED:
+                                wcscpy(trust_str, L"⛔");   // No-entry for threat feed match
+                                break;
                             case TRUST_UNKNOWN:
                             default:
                                 wcscpy(trust_str, L"?");   // Question for unknown
@@ -820,6 +1139,48 @@ void UpdateTrustColumnForConnection(DWORD pid, DWORD remote_addr, DWORD remote_p
     }
 }
 
+// Fill in hostnames that were resolved since the rows were added
+void UpdateHostnameColumn(void) {
+    if (!g_hwndListView) return;
+
+    // Re-arm first so answers landing during the scan trigger another pass
+    resolver_ack_notify();
+
+    int item_count = ListView_GetItemCount(g_hwndListView);
+    for (int i = 0; i < item_count; i++) {
+        LVITEM lvi = {0};
+        lvi.mask = LVIF_PARAM;
+        lvi.iItem = i;
+        if (!ListView_GetItem(g_hwndListView, &lvi)) {
+            continue;
+        }
+
+        int key_index = (int)lvi.lParam;
+        if (key_index < 0 || key_index >= g_connection_keys_count ||
+            !g_connection_keys[key_index].resolvable) {
+            continue;
+        }
+
+        wchar_t existing[RESOLVER_MAX_HOSTNAME];
+        ListView_GetItemText(g_hwndListView, i, 12, existing, RESOLVER_MAX_HOSTNAME);
+        if (existing[0] != L'\0') {
+            continue;
+        }
+
+        // Already counted when the row was inserted
+        ConnectionKey* key = &g_connection_keys[key_index];
+        char hostname[RESOLVER_MAX_HOSTNAME];
+        BOOL known = (key->ip_version == IP_V4)
+            ? resolver_recheck_ipv4(key->remote_addr, hostname, sizeof(hostname))
+            : resolver_recheck_ipv6(key->remote_addr_v6, hostname, sizeof(hostname));
+        if (known) {
+            wchar_t w_hostname[RESOLVER_MAX_HOSTNAME];
+            MultiByteToWideChar(CP_ACP, 0, hostname, -1, w_hostname, RESOLVER_MAX_HOSTNAME);
+            ListView_SetItemText(g_hwndListView, i, 12, w_hostname);
+        }
+    }
+}
+
 void AddHighlightedItem(int item_index) {
     // Check if already highlighted
     for (int i = 0; i < g_highlighted_count; i++) {
@@ -924,11 +1285,9 @@ void UpdateMonitoringState(BOOL monitoring) {
         SetTimer(g_hwndMain, ID_TIMER, 500, NULL);  // Check every 500ms
         SetTimer(g_hwndMain, ID_TIMER_FLASH, 50, NULL);  // Update highlights every 50ms for smooth fade
 
-        // Launch security info loading in background thread
-        if (!g_security_loading) {
-            g_security_loading = TRUE;
-            g_security_thread = CreateThread(NULL, 0, LoadSecurityInfoThread, NULL, 0, NULL);
-        }
+        // Queue security analysis: on-screen rows first, the rest as backfill
+        PrioritizeVisibleRows();
+        network_queue_security_for_all_seen();
 
         LOG_INFO("Monitoring started");
     } else {
@@ -937,13 +1296,6 @@ void UpdateMonitoringState(BOOL monitoring) {
         KillTimer(g_hwndMain, ID_TIMER);
         KillTimer(g_hwndMain, ID_TIMER_FLASH);
 
-        // Wait for security thread to complete if still running
-        if (g_security_thread) {
-            WaitForSingleObject(g_security_thread, 2000);  // Wait max 2s
-            CloseHandle(g_security_thread);
-            g_security_thread = NULL;
-        }
-
         LOG_INFO("Monitoring stopped");
     }
 }
@@ -1083,6 +1435,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                                 g_trust_filter = TRUST_UNKNOWN;
                                 LOG_INFO("Trust filter: Unknown");
                                 break;
+                            case 9: // Blocklisted
+                                g_trust_filter = TRUST_BLOCKLISTED;
+                                LOG_INFO("Trust filter: Blocklisted");
+                                break;
                         }
                         RefreshListViewWithFilter();
                     }
@@ -1093,33 +1449,32 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
         case WM_TIMER:
             if (wParam == ID_TIMER && g_monitoring) {
+                TRACE_BEGIN("ui poll");
                 NetworkConnection* new_conns = NULL;
                 int count = 0;
 
                 if (network_check_new_connections(&new_conns, &count) == 0) {
-                    BOOL need_refresh = FALSE;
                     for (int i = 0; i < count; i++) {
                         // Add connection to GUI first
                         gui_add_connection(&new_conns[i]);
 
                         // Then find the real connection in seen_connections and compute security info
-                        NetworkConnection* real_conn = network_find_connection(
+                        NetworkConnection real_conn;
+                        int index = network_find_connection(
                             new_conns[i].pid,
                             new_conns[i].remote_addr,
                             new_conns[i].remote_port,
-                            new_conns[i].local_port
+                            new_conns[i].local_port,
+                            &real_conn
                         );
 
-                        if (real_conn && !real_conn->security_info_loaded) {
-                            network_compute_security_info_deferred(real_conn);
-                            // Update the Trust column text and color for this connection
-                            UpdateTrustColumnForConnection(
-                                new_conns[i].pid,
-                                new_conns[i].remote_addr,
-                                new_conns[i].remote_port,
-                                new_conns[i].local_port
-                            );
-                            need_refresh = TRUE;
+                        // Analysed on the worker pool; the Trust cell updates when it completes
+                        if (index >= 0 && !real_conn.security_info_loaded) {
+                            network_queue_security_info(index, SECURITY_PRIORITY_NEW);
+                        }
+
+                        if (!LOG_ENABLED(LOG_SUCCESS)) {
+                            continue;
                         }
 
                         char remote_ip[64], local_ip[64];
@@ -1131,10 +1486,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                             network_format_ipv6(new_conns[i].local_addr_v6, local_ip, sizeof(local_ip));
                         }
 
-                        const char* proto_str = (new_conns[i].protocol == PROTO_TCP) ? "TCP" : "UDP";
-
                         LOG_SUCCESS("NEW CONNECTION [%s]: %s:%lu -> %s:%lu | %s (PID: %lu)",
-                            proto_str,
+                            (new_conns[i].protocol == PROTO_TCP) ? "TCP" : "UDP",
                             remote_ip, new_conns[i].remote_port,
                             local_ip, new_conns[i].local_port,
                             new_conns[i].process_name, new_conns[i].pid);
@@ -1144,23 +1497,43 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                         NetworkStats stats;
                         network_get_stats(&stats);
                         gui_update_stats(&stats);
-                    }
 
-                    // Refresh ListView if security info was computed for new connections
-                    if (need_refresh) {
-                        InvalidateRect(g_hwndListView, NULL, FALSE);
+                        // New rows may have landed on screen
+                        PrioritizeVisibleRows();
                     }
 
                     free(new_conns);
                 }
+                TRACE_END("ui poll");
             } else if (wParam == ID_TIMER_FLASH) {
                 UpdateHighlights();
+            } else if (wParam == ID_TIMER_PERF) {
+                UpdatePerformancePanel();
+
+                if (export_is_running()) {
+                    LONG64 done = 0, total = 0;
+                    export_get_progress(&done, &total);
+                    wchar_t status_text[64];
+                    swprintf(status_text, 64, L"Export %d%%", total > 0 ? (int)(done * 100 / total) : 0);
+                    SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_STATE, (LPARAM)status_text);
+                }
             }
             return 0;
 
         case WM_NOTIFY: {
             LPNMHDR nmhdr = (LPNMHDR)lParam;
 
+            if (nmhdr->hwndFrom == g_hwndStatusBar && nmhdr->code == NM_DBLCLK) {
+                ShowPerformanceDetails();
+                return 0;
+            }
+
+            // Rows scrolled into view jump ahead of the backfill
+            if (nmhdr->hwndFrom == g_hwndListView && nmhdr->code == LVN_ENDSCROLL) {
+                PrioritizeVisibleRows();
+                return 0;
+            }
+
             // Handle right-click context menu for ListView
             if (nmhdr->hwndFrom == g_hwndListView && nmhdr->code == NM_RCLICK) {
                 LPNMITEMACTIVATE pnmia = (LPNMITEMACTIVATE)lParam;
@@ -1174,6 +1547,8 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     AppendMenuW(hMenu, MF_STRING, 2, L"Mark as Threat (Red)");
                     AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
                     AppendMenuW(hMenu, MF_STRING, 3, L"Reset to Auto (Default)");
+                    AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
+                    AppendMenuW(hMenu, MF_STRING, 4, L"Connection History...");
 
                     int cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_RIGHTBUTTON, pt.x, pt.y, 0, hwnd, NULL);
                     DestroyMenu(hMenu);
@@ -1187,10 +1562,13 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                             int key_index = (int)lvi.lParam;
                             if (key_index >= 0 && key_index < g_connection_keys_count) {
                                 ConnectionKey* key = &g_connection_keys[key_index];
-                                NetworkConnection* conn = network_find_connection(
-                                    key->pid, key->remote_addr, key->remote_port, key->local_port);
+                                NetworkConnection conn;
+                                BOOL found = network_find_connection(
+                                    key->pid, key->remote_addr, key->remote_port, key->local_port, &conn) >= 0;
 
-                                if (conn && strlen(conn->process_path) > 0) {
+                                if (found && cmd == 4) {
+                                    ShowProcessHistory(&conn);
+                                } else if (found && strlen(conn.process_path) > 0) {
                                     TrustStatus new_status = TRUST_UNKNOWN;
                                     switch (cmd) {
                                         case 1: // Mark as Trusted
@@ -1204,11 +1582,14 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                                             break;
                                     }
 
-                                    // Apply trust override (saves to file and updates all connections)
-                                    network_apply_trust_override(conn->process_path, new_status);
+                                    // Journals the override and updates only this executable's rows;
+                                    // their cells repaint through WM_APP_SECURITY_READY
+                                    network_apply_trust_override(conn.process_path, new_status);
 
-                                    // Refresh the entire ListView to show changes
-                                    RefreshListViewWithFilter();
+                                    // Rows may enter or leave a trust-level filter
+                                    if (g_trust_filter != -1) {
+                                        RefreshListViewWithFilter();
+                                    }
                                 }
                             }
                         }
@@ -1241,12 +1622,11 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                                 int key_index = (int)lvi.lParam;
                                 if (key_index >= 0 && key_index < g_connection_keys_count) {
                                     ConnectionKey* key = &g_connection_keys[key_index];
-                                    NetworkConnection* conn = network_find_connection(
-                                        key->pid, key->remote_addr, key->remote_port, key->local_port);
-
-                                    if (conn) {
+                                    NetworkConnection conn;
+                                    if (network_find_connection(key->pid, key->remote_addr, key->remote_port,
+                                                                key->local_port, &conn) >= 0) {
                                     // Set background color based on trust status (6-level system)
-                                    switch (conn->trust_status) {
+                                    switch (conn.trust_status) {
                                         case TRUST_MICROSOFT_SIGNED:
                                             // Dark Green - Microsoft/Windows signed (highest trust)
                                             lplvcd->clrTextBk = RGB(144, 238, 144);  // Light green
@@ -1289,6 +1669,12 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                                             lplvcd->clrText = RGB(120, 60, 60);      // Dark gray-red
                                             break;
 
+                                        case TRUST_BLOCKLISTED:
+                                            // Purple - Remote address or binary hash is on a threat feed
+                                            lplvcd->clrTextBk = RGB(220, 180, 255);  // Light purple
+                                            lplvcd->clrText = RGB(90, 0, 140);       // Dark purple
+                                            break;
+
                                         default: // TRUST_UNKNOWN
                                             // Gray - Not yet verified
                                             lplvcd->clrTextBk = RGB(220, 220, 220);  // Light gray
@@ -1316,23 +1702,23 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         }
 
         case WM_CTLCOLORSTATIC: {
-            // Handle coloring of legend color boxes (IDs 1401-1406)
+            // Handle coloring of legend color boxes (IDs 1401-1407)
             HWND hwndControl = (HWND)lParam;
             HDC hdcControl = (HDC)wParam;
 
             int ctrlId = GetDlgCtrlID(hwndControl);
             // Check if this is one of the legend color boxes
-            if (ctrlId >= 1401 && ctrlId <= 1406) {
+            if (ctrlId >= 1401 && ctrlId <= 1407) {
                 // Get the color stored in user data
                 DWORD_PTR userData = GetWindowLongPtrW(hwndControl, GWLP_USERDATA);
                 if (userData != 0) {
                     COLORREF color = (COLORREF)userData;
                     // Create brush with the stored color
-                    static HBRUSH hBrush[6] = {NULL};
-                    static COLORREF lastColor[6] = {0};
+                    static HBRUSH hBrush[7] = {NULL};
+                    static COLORREF lastColor[7] = {0};
 
                     int idx = ctrlId - 1401;
-                    if (idx >= 0 && idx < 6) {
+                    if (idx >= 0 && idx < 7) {
                         // Delete old brush if color changed
                         if (lastColor[idx] != color && hBrush[idx] != NULL) {
                             DeleteObject(hBrush[idx]);
@@ -1359,12 +1745,29 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             return (LRESULT)GetSysColorBrush(COLOR_WINDOW);
         }
 
-        case WM_USER + 1: {
-            // Security info loading completed - refresh the list view
-            if (g_monitoring && g_hwndListView) {
-                RefreshListViewWithFilter();
+        case WM_APP_SECURITY_READY:
+            // Trust results arrived from the security queue - update only those rows
+            if (g_hwndListView) {
+                TRACE_BEGIN("ui security updates");
+                ApplySecurityUpdates();
+                TRACE_END("ui security updates");
             }
             return 0;
+
+        case WM_APP_HOSTNAMES_READY:
+            // Reverse DNS answers arrived - update only the empty Host cells
+            UpdateHostnameColumn();
+            return 0;
+
+        case WM_APP_EXPORT_DONE: {
+            const wchar_t* text = L"Export failed";
+            if (wParam == EXPORT_DONE) {
+                text = L"Exported";
+            } else if (wParam == EXPORT_CANCELLED) {
+                text = L"Export cancelled";
+            }
+            SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_STATE, (LPARAM)text);
+            return 0;
         }
 
         case WM_DESTROY:
@@ -1375,10 +1778,69 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
+// F12: start recording, or stop and write the trace file
+void ToggleTrace(void) {
+    if (!trace_enabled) {
+        trace_start();
+        LOG_INFO("Tracing started (F12 again to write the trace)");
+        return;
+    }
+
+    char path[MAX_PATH];
+    if (trace_stop(path, sizeof(path)) == 0) {
+        LOG_SUCCESS("Trace written to %s", path);
+    } else {
+        LOG_ERROR("Unable to write the trace");
+    }
+}
+
+// Ctrl+S: export the connection history, or cancel the running export
+void ToggleExport(void) {
+    if (export_is_running()) {
+        export_cancel();
+        return;
+    }
+
+    char path[MAX_PATH] = "peek-connections.csv";
+    OPENFILENAMEA ofn = {0};
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = g_hwndMain;
+    ofn.lpstrFilter = "CSV (*.csv)\0*.csv\0JSON (*.json)\0*.json\0Columnar (*.pcol)\0*.pcol\0";
+    ofn.nFilterIndex = 1;
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = MAX_PATH;
+    ofn.lpstrDefExt = "csv";
+    ofn.Flags = OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+
+    if (!GetSaveFileNameA(&ofn)) {
+        return;
+    }
+
+    ExportFormat format = EXPORT_FORMAT_CSV;
+    if (ofn.nFilterIndex == 2) {
+        format = EXPORT_FORMAT_JSON;
+    } else if (ofn.nFilterIndex == 3) {
+        format = EXPORT_FORMAT_COLUMNAR;
+    }
+
+    if (export_start(path, format, g_hwndMain, WM_APP_EXPORT_DONE) == 0) {
+        SendMessage(g_hwndStatusBar, SB_SETTEXT, STATUS_PART_STATE, (LPARAM)L"Export 0%");
+    }
+}
+
 int gui_run(void) {
     MSG msg = {0};
 
     while (GetMessage(&msg, NULL, 0, 0)) {
+        // Checked here so it works whichever control has the focus
+        if (msg.message == WM_KEYDOWN && msg.wParam == VK_F12) {
+            ToggleTrace();
+            continue;
+        }
+        if (msg.message == WM_KEYDOWN && msg.wParam == 'S' && (GetKeyState(VK_CONTROL) & 0x8000)) {
+            ToggleExport();
+            continue;
+        }
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
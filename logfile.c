@@ -0,0 +1,205 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "logfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shlobj.h>
+
+#define LOGFILE_RETRY_MS 5000    // Back-off after a segment could not be created
+
+// No LOG_* calls in here: the logger is the only caller
+
+static char log_dir[MAX_PATH] = {0};
+static char segment_path[MAX_PATH] = {0};
+static HANDLE segment_file = INVALID_HANDLE_VALUE;
+static HANDLE segment_mapping = NULL;
+static char* segment_view = NULL;
+static size_t segment_used = 0;
+static ULONGLONG segment_opened_tick = 0;
+static ULONGLONG segment_retry_tick = 0;
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp((const char*)a, (const char*)b);
+}
+
+// Names sort chronologically: delete the oldest segments beyond the limit
+static void prune_segments(void) {
+    char pattern[MAX_PATH];
+    snprintf(pattern, sizeof(pattern), "%s\\peek-*.log", log_dir);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE find = FindFirstFileA(pattern, &fd);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    int capacity = LOGFILE_MAX_SEGMENTS * 2;
+    int count = 0;
+    char (*names)[MAX_PATH] = malloc((size_t)capacity * MAX_PATH);
+    if (!names) {
+        FindClose(find);
+        return;
+    }
+
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        if (count == capacity) {
+            char (*grown)[MAX_PATH] = realloc(names, (size_t)capacity * 2 * MAX_PATH);
+            if (!grown) {
+                break;
+            }
+            names = grown;
+            capacity *= 2;
+        }
+        strncpy(names[count], fd.cFileName, MAX_PATH - 1);
+        names[count][MAX_PATH - 1] = '\0';
+        count++;
+    } while (FindNextFileA(find, &fd));
+    FindClose(find);
+
+    qsort(names, (size_t)count, MAX_PATH, compare_names);
+
+    const char* current = strrchr(segment_path, '\\');
+    current = current ? current + 1 : segment_path;
+
+    for (int i = 0; i < count - LOGFILE_MAX_SEGMENTS; i++) {
+        if (strcmp(names[i], current) == 0) {
+            continue;
+        }
+        char path[MAX_PATH];
+        snprintf(path, sizeof(path), "%s\\%s", log_dir, names[i]);
+        DeleteFileA(path);
+    }
+
+    free(names);
+}
+
+static void close_segment(void) {
+    if (segment_view) {
+        UnmapViewOfFile(segment_view);
+        segment_view = NULL;
+    }
+    if (segment_mapping) {
+        CloseHandle(segment_mapping);
+        segment_mapping = NULL;
+    }
+    if (segment_file != INVALID_HANDLE_VALUE) {
+        // Drop the unused pre-sized tail
+        LARGE_INTEGER size;
+        size.QuadPart = (LONGLONG)segment_used;
+        if (SetFilePointerEx(segment_file, size, NULL, FILE_BEGIN)) {
+            SetEndOfFile(segment_file);
+        }
+        CloseHandle(segment_file);
+        segment_file = INVALID_HANDLE_VALUE;
+    }
+    segment_used = 0;
+    segment_path[0] = '\0';
+}
+
+static int open_segment(void) {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+
+    // Same second as an existing segment (fast rotation, quick restart): bump the suffix
+    HANDLE file = INVALID_HANDLE_VALUE;
+    for (int suffix = 0; suffix < 1000 && file == INVALID_HANDLE_VALUE; suffix++) {
+        snprintf(segment_path, MAX_PATH, "%s\\peek-%04u%02u%02u-%02u%02u%02u-%03d.log",
+                 log_dir, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, suffix);
+        file = CreateFileA(segment_path, GENERIC_READ | GENERIC_WRITE,
+                           FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_NEW,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE && GetLastError() != ERROR_FILE_EXISTS) {
+            break;
+        }
+    }
+    if (file == INVALID_HANDLE_VALUE) {
+        segment_path[0] = '\0';
+        return -1;
+    }
+
+    // Mapping a larger size than the file extends it: the whole segment is reserved now
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, LOGFILE_SEGMENT_SIZE, NULL);
+    char* view = mapping ? (char*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, LOGFILE_SEGMENT_SIZE) : NULL;
+    if (!view) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        DeleteFileA(segment_path);
+        segment_path[0] = '\0';
+        return -1;
+    }
+
+    segment_file = file;
+    segment_mapping = mapping;
+    segment_view = view;
+    segment_used = 0;
+    segment_opened_tick = GetTickCount64();
+
+    prune_segments();
+    return 0;
+}
+
+int logfile_open(void) {
+    char appdata[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(log_dir, MAX_PATH, "%s\\Peek", appdata);
+        CreateDirectoryA(log_dir, NULL);
+        snprintf(log_dir, MAX_PATH, "%s\\Peek\\logs", appdata);
+    } else {
+        // Fallback to current directory
+        strcpy(log_dir, "logs");
+    }
+    CreateDirectoryA(log_dir, NULL);
+
+    if (open_segment() != 0) {
+        log_dir[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+char* logfile_reserve(size_t len) {
+    if (!log_dir[0] || len > LOGFILE_SEGMENT_SIZE) {
+        return NULL;
+    }
+
+    ULONGLONG now = GetTickCount64();
+    if (segment_view &&
+        segment_used + len <= LOGFILE_SEGMENT_SIZE &&
+        now - segment_opened_tick < (ULONGLONG)LOGFILE_ROTATE_MINUTES * 60 * 1000) {
+        return segment_view + segment_used;
+    }
+
+    if (!segment_view && now < segment_retry_tick) {
+        return NULL;
+    }
+
+    close_segment();
+    if (open_segment() != 0) {
+        segment_retry_tick = now + LOGFILE_RETRY_MS;
+        return NULL;
+    }
+    return segment_view + segment_used;
+}
+
+void logfile_commit(size_t len) {
+    if (segment_view && segment_used + len <= LOGFILE_SEGMENT_SIZE) {
+        segment_used += len;
+    }
+}
+
+void logfile_close(void) {
+    close_segment();
+    log_dir[0] = '\0';
+}
+
+const char* logfile_get_path(void) {
+    return segment_path;
+}
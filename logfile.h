@@ -0,0 +1,36 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_LOGFILE_H
+#define PEEK_LOGFILE_H
+
+#include <windows.h>
+
+#define LOGFILE_SEGMENT_SIZE (16 * 1024 * 1024)   // Pre-sized and mapped up front
+#define LOGFILE_ROTATE_MINUTES 60                 // A segment is closed after this long even if not full
+#define LOGFILE_MAX_SEGMENTS 48                   // Oldest segments beyond this are deleted
+
+// Log file sink: %APPDATA%\Peek\logs\peek-YYYYMMDD-HHMMSS-NNN.log.
+// Lines are formatted straight into a memory-mapped segment; the OS writes the
+// pages back, so nothing here ever waits on the disk. Segments are trimmed to
+// their used length when closed.
+//
+// Not thread safe: the logger calls these from one writer at a time.
+
+// Create the log directory and open the first segment. Returns 0 on success
+int logfile_open(void);
+
+// Room for at least `len` bytes in the current segment (rotating first if the
+// segment is full or too old). NULL if the sink is closed or rotation failed
+char* logfile_reserve(size_t len);
+
+// Mark `len` bytes written at the last reserved pointer as used
+void logfile_commit(size_t len);
+
+void logfile_close(void);
+
+// Path of the segment being written (empty when closed)
+const char* logfile_get_path(void);
+
+#endif
@@ -3,7 +3,10 @@
 */
 
 #include "logger.h"
+#include "logfile.h"
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define ANSI_RESET   "\033[0m"
 #define ANSI_BOLD    "\033[1m"
@@ -14,67 +17,402 @@
 #define ANSI_RED     "\033[91m"
 #define ANSI_CYAN    "\033[96m"
 
-static HANDLE console_handle = NULL;
-
-void logger_init(void) {
-    AllocConsole();
+#define LOGGER_RING_MASK (LOGGER_RING_CAPACITY - 1)
+#define LOGGER_BATCH_SIZE (64 * 1024)
+#define LOGGER_LINE_SIZE (LOGGER_MESSAGE_SIZE + 64)
 
-    console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+// Bounded multi-producer ring (sequence per slot, Vyukov style). A producer
+// claims a slot with one CAS on enqueue_pos, formats into it, then publishes
+// it by advancing the slot's sequence. Only the flusher dequeues.
+typedef struct {
+    volatile LONG64 sequence;
+    ULONGLONG timestamp;          // FILETIME (UTC), converted by the flusher
+    DWORD thread_id;
+    LogLevel level;
+    char message[LOGGER_MESSAGE_SIZE];
+} LogRecord;
 
-    DWORD mode = 0;
-    GetConsoleMode(console_handle, &mode);
-    mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-    SetConsoleMode(console_handle, mode);
+static HANDLE console_handle = NULL;
+static DWORD logger_sinks = LOGGER_SINK_CONSOLE;
 
-    freopen("CONOUT$", "w", stdout);
-    freopen("CONOUT$", "w", stderr);
-}
+static LogRecord* ring = NULL;
+static volatile LONG64 enqueue_pos = 0;
+static LONG64 dequeue_pos = 0;                 // Flusher only
+static volatile LONG dropped_count = 0;
+static volatile LONG dropped_reported = 0;     // Flusher only
+static volatile LONG logger_running = 0;
+static volatile LONG producers_in_flight = 0;  // Between the running check and the publish
 
-void logger_log(const LogLevel level, const char* format, ...) {
+volatile LONG logger_runtime_level = LOG_DEBUG;
 
-    const time_t now = time(NULL);
-    const struct tm* t = localtime(&now);
-    char timestamp[32];
-    sprintf(timestamp, "%02d:%02d:%02d", t->tm_hour, t->tm_min, t->tm_sec);
+static HANDLE flusher_thread = NULL;
+static HANDLE flusher_wake_event = NULL;
+static HANDLE flusher_stop_event = NULL;
 
-    const char* prefix;
-    const char* color;
+// Serializes sink output between the flusher and the synchronous path
+// (before init / after shutdown)
+static CRITICAL_SECTION output_cs;
+static volatile LONG output_cs_ready = 0;
 
+static void level_style(LogLevel level, const char** prefix, const char** color) {
     switch (level) {
         case LOG_DEBUG:
-            prefix = "DEBUG";
-            color = ANSI_GRAY;
+            *prefix = "DEBUG";
+            *color = ANSI_GRAY;
             break;
         case LOG_INFO:
-            prefix = "INFO ";
-            color = ANSI_BLUE;
+            *prefix = "INFO ";
+            *color = ANSI_BLUE;
             break;
         case LOG_SUCCESS:
-            prefix = "OK   ";
-            color = ANSI_GREEN;
+            *prefix = "OK   ";
+            *color = ANSI_GREEN;
             break;
         case LOG_WARNING:
-            prefix = "WARN ";
-            color = ANSI_YELLOW;
+            *prefix = "WARN ";
+            *color = ANSI_YELLOW;
             break;
         case LOG_ERROR:
-            prefix = "ERROR";
-            color = ANSI_RED;
+            *prefix = "ERROR";
+            *color = ANSI_RED;
             break;
         default:
-            prefix = "LOG  ";
-            color = ANSI_RESET;
+            *prefix = "LOG  ";
+            *color = ANSI_RESET;
+    }
+}
+
+static int clamp_written(int written, size_t out_size) {
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < out_size ? written : (int)out_size - 1;
+}
+
+// Console line: colored, time of day only
+static int format_console_line(char* out, size_t out_size, LogLevel level, const SYSTEMTIME* st, const char* message) {
+    const char* prefix;
+    const char* color;
+    level_style(level, &prefix, &color);
+
+    int written = snprintf(out, out_size, "%s[%02d:%02d:%02d]%s %s[%s]%s %s\n",
+                           ANSI_GRAY, st->wHour, st->wMinute, st->wSecond, ANSI_RESET,
+                           color, prefix, ANSI_RESET, message);
+    return clamp_written(written, out_size);
+}
+
+// File line: full date with milliseconds, level and thread, no escape codes
+static int format_file_line(char* out, size_t out_size, LogLevel level, const SYSTEMTIME* st, DWORD thread_id, const char* message) {
+    const char* prefix;
+    const char* color;
+    level_style(level, &prefix, &color);
+
+    int written = snprintf(out, out_size, "%04d-%02d-%02d %02d:%02d:%02d.%03d %s [%5lu] %s\n",
+                           st->wYear, st->wMonth, st->wDay, st->wHour, st->wMinute, st->wSecond,
+                           st->wMilliseconds, prefix, (unsigned long)thread_id, message);
+    return clamp_written(written, out_size);
+}
+
+static ULONGLONG current_timestamp(void) {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return ((ULONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
+static void write_console(const char* data, size_t len) {
+    if (len > 0) {
+        fwrite(data, 1, len, stdout);
+        fflush(stdout);
+    }
+}
+
+// Send one record to every sink: the console line is appended to `batch`
+// (written by the caller), the file line goes straight into the mapped segment
+static void emit_record(char* batch, size_t batch_size, size_t* used, LogLevel level,
+                        ULONGLONG timestamp, DWORD thread_id, const char* message) {
+    FILETIME utc, local;
+    SYSTEMTIME st;
+    utc.dwLowDateTime = (DWORD)timestamp;
+    utc.dwHighDateTime = (DWORD)(timestamp >> 32);
+    FileTimeToLocalFileTime(&utc, &local);
+    FileTimeToSystemTime(&local, &st);
+
+    if (logger_sinks & LOGGER_SINK_CONSOLE) {
+        *used += format_console_line(batch + *used, batch_size - *used, level, &st, message);
+    }
+    if (logger_sinks & LOGGER_SINK_FILE) {
+        char* out = logfile_reserve(LOGGER_LINE_SIZE);
+        if (out) {
+            logfile_commit(format_file_line(out, LOGGER_LINE_SIZE, level, &st, thread_id, message));
+        }
+    }
+}
+
+static void ensure_output_cs(void) {
+    if (InterlockedCompareExchange(&output_cs_ready, 1, 0) == 0) {
+        InitializeCriticalSection(&output_cs);
+        InterlockedExchange(&output_cs_ready, 2);
+    }
+    while (output_cs_ready != 2) {
+        YieldProcessor();
+    }
+}
+
+// Move every published record into one buffer and write it in one go
+static void drain_ring(char* batch) {
+    size_t used = 0;
+
+    EnterCriticalSection(&output_cs);
+    for (;;) {
+        LogRecord* slot = &ring[dequeue_pos & LOGGER_RING_MASK];
+        if (slot->sequence != dequeue_pos + 1) {
+            break;  // Empty, or the producer is still formatting this slot
+        }
+        MemoryBarrier();
+
+        if (used + LOGGER_LINE_SIZE > LOGGER_BATCH_SIZE) {
+            write_console(batch, used);
+            used = 0;
+        }
+        emit_record(batch, LOGGER_BATCH_SIZE, &used, slot->level, slot->timestamp, slot->thread_id, slot->message);
+
+        // Hand the slot back to producers one lap ahead
+        InterlockedExchange64(&slot->sequence, dequeue_pos + LOGGER_RING_CAPACITY);
+        dequeue_pos++;
+    }
+
+    LONG dropped = dropped_count;
+    if (dropped != dropped_reported) {
+        char note[96];
+        snprintf(note, sizeof(note), "Logger ring full: %ld message(s) dropped", (long)(dropped - dropped_reported));
+        emit_record(batch, LOGGER_BATCH_SIZE, &used, LOG_WARNING, current_timestamp(), GetCurrentThreadId(), note);
+        dropped_reported = dropped;
+    }
+
+    write_console(batch, used);
+    LeaveCriticalSection(&output_cs);
+}
+
+static DWORD WINAPI LoggerFlusherThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    char* batch = (char*)malloc(LOGGER_BATCH_SIZE);
+    if (!batch) {
+        return 0;
+    }
+
+    HANDLE events[2] = {flusher_stop_event, flusher_wake_event};
+    BOOL stopping = FALSE;
+    while (!stopping) {
+        stopping = (WaitForMultipleObjects(2, events, FALSE, LOGGER_FLUSH_MS) == WAIT_OBJECT_0);
+        drain_ring(batch);
+    }
+
+    free(batch);
+    return 0;
+}
+
+static void log_synchronously(LogLevel level, const char* message) {
+    ensure_output_cs();
+
+    char line[LOGGER_LINE_SIZE];
+    size_t used = 0;
+    EnterCriticalSection(&output_cs);
+    emit_record(line, sizeof(line), &used, level, current_timestamp(), GetCurrentThreadId(), message);
+    write_console(line, used);
+    LeaveCriticalSection(&output_cs);
+}
+
+static void open_console(void) {
+    AllocConsole();
+
+    console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    DWORD mode = 0;
+    GetConsoleMode(console_handle, &mode);
+    mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+    SetConsoleMode(console_handle, mode);
+
+    freopen("CONOUT$", "w", stdout);
+    freopen("CONOUT$", "w", stderr);
+}
+
+void logger_init(void) {
+    ensure_output_cs();
+
+    char value[16];
+    DWORD len = GetEnvironmentVariableA("PEEK_LOG_LEVEL", value, sizeof(value));
+    if (len > 0 && len < sizeof(value)) {
+        if (lstrcmpiA(value, "debug") == 0) {
+            logger_set_level(LOG_DEBUG);
+        } else if (lstrcmpiA(value, "info") == 0) {
+            logger_set_level(LOG_INFO);
+        } else if (lstrcmpiA(value, "warning") == 0) {
+            logger_set_level(LOG_WARNING);
+        } else if (lstrcmpiA(value, "error") == 0) {
+            logger_set_level(LOG_ERROR);
+        }
     }
 
-    printf("%s[%s]%s %s[%s]%s ",
-           ANSI_GRAY, timestamp, ANSI_RESET,
-           color, prefix, ANSI_RESET);
+    DWORD sinks = LOGGER_SINK_CONSOLE | LOGGER_SINK_FILE;
+    len = GetEnvironmentVariableA("PEEK_LOG_SINK", value, sizeof(value));
+    if (len > 0 && len < sizeof(value)) {
+        if (lstrcmpiA(value, "console") == 0) {
+            sinks = LOGGER_SINK_CONSOLE;
+        } else if (lstrcmpiA(value, "file") == 0) {
+            sinks = LOGGER_SINK_FILE;
+        }
+    }
 
+    BOOL file_failed = FALSE;
+    if ((sinks & LOGGER_SINK_FILE) && logfile_open() != 0) {
+        // Never end up with no output at all
+        sinks = (sinks & ~LOGGER_SINK_FILE) | LOGGER_SINK_CONSOLE;
+        file_failed = TRUE;
+    }
+    if (sinks & LOGGER_SINK_CONSOLE) {
+        open_console();
+    }
+    logger_sinks = sinks;
+
+    if (file_failed) {
+        LOG_WARNING("Log file unavailable, logging to the console only");
+    } else if (sinks & LOGGER_SINK_FILE) {
+        LOG_INFO("Logging to %s", logfile_get_path());
+    }
+
+    ring = (LogRecord*)VirtualAlloc(NULL, LOGGER_RING_CAPACITY * sizeof(LogRecord),
+                                    MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    flusher_wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    flusher_stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!ring || !flusher_wake_event || !flusher_stop_event) {
+        return;  // Stays synchronous
+    }
+
+    for (LONG64 i = 0; i < LOGGER_RING_CAPACITY; i++) {
+        ring[i].sequence = i;
+    }
+    enqueue_pos = 0;
+    dequeue_pos = 0;
+
+    flusher_thread = CreateThread(NULL, 0, LoggerFlusherThread, NULL, 0, NULL);
+    if (flusher_thread) {
+        InterlockedExchange(&logger_running, 1);
+    }
+}
+
+void logger_shutdown(void) {
+    if (InterlockedExchange(&logger_running, 0) != 0) {
+        // New calls now go synchronous; wait for those that already passed
+        // the running check to publish their record
+        while (producers_in_flight != 0) {
+            SwitchToThread();
+        }
+
+        // The flusher drains once more after seeing the stop event
+        SetEvent(flusher_stop_event);
+        WaitForSingleObject(flusher_thread, INFINITE);
+        CloseHandle(flusher_thread);
+        CloseHandle(flusher_wake_event);
+        CloseHandle(flusher_stop_event);
+        flusher_thread = NULL;
+        flusher_wake_event = NULL;
+        flusher_stop_event = NULL;
+    }
+
+    // Trim and close the file segment; later synchronous calls only reach the console
+    ensure_output_cs();
+    EnterCriticalSection(&output_cs);
+    if (logger_sinks & LOGGER_SINK_FILE) {
+        logfile_close();
+        logger_sinks &= ~LOGGER_SINK_FILE;
+    }
+    LeaveCriticalSection(&output_cs);
+}
+
+void logger_log(const LogLevel level, const char* format, ...) {
     va_list args;
+
+    // Counted before the check so logger_shutdown cannot miss this call
+    // (both sides use interlocked operations, full barriers)
+    InterlockedIncrement(&producers_in_flight);
+    if (!logger_running) {
+        InterlockedDecrement(&producers_in_flight);
+        char message[LOGGER_MESSAGE_SIZE];
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        log_synchronously(level, message);
+        return;
+    }
+
+    // Claim a slot
+    LogRecord* slot;
+    LONG64 pos = enqueue_pos;
+    for (;;) {
+        slot = &ring[pos & LOGGER_RING_MASK];
+        LONG64 diff = slot->sequence - pos;
+        if (diff == 0) {
+            LONG64 seen = InterlockedCompareExchange64(&enqueue_pos, pos + 1, pos);
+            if (seen == pos) {
+                break;
+            }
+            pos = seen;
+        } else if (diff < 0) {
+            // Full: drop the newest record rather than block the caller
+            InterlockedIncrement(&dropped_count);
+            InterlockedDecrement(&producers_in_flight);
+            return;
+        } else {
+            pos = enqueue_pos;
+        }
+    }
+
+    slot->timestamp = current_timestamp();
+    slot->thread_id = GetCurrentThreadId();
+    slot->level = level;
     va_start(args, format);
-    vprintf(format, args);
+    vsnprintf(slot->message, LOGGER_MESSAGE_SIZE, format, args);
     va_end(args);
 
-    printf("\n");
-    fflush(stdout);
-}
\ No newline at end of file
+    // Publish (the interlocked write is a full barrier)
+    InterlockedExchange64(&slot->sequence, pos + 1);
+
+    // Errors and a filling ring get written now rather than on the next tick
+    if (level == LOG_ERROR || (pos - dequeue_pos) > LOGGER_RING_CAPACITY / 2) {
+        SetEvent(flusher_wake_event);
+    }
+    InterlockedDecrement(&producers_in_flight);
+}
+
+LONG logger_get_dropped_count(void) {
+    return dropped_count;
+}
+
+void logger_set_level(LogLevel level) {
+    InterlockedExchange(&logger_runtime_level, (LONG)level);
+}
+
+BOOL logger_rate_allow(LogRateLimit* limit, DWORD burst, DWORD interval_ms, LONG* suppressed) {
+    LONG64 now = (LONG64)GetTickCount64();
+    LONG64 tolerance = (LONG64)burst * interval_ms;
+
+    // GCRA: each message pushes the arrival time one interval ahead; a site
+    // may run at most `burst` intervals ahead of the clock
+    LONG64 tat = limit->next_allowed;
+    for (;;) {
+        LONG64 base = (tat > now) ? tat : now;
+        if (base - now >= tolerance) {
+            InterlockedIncrement(&limit->suppressed);
+            return FALSE;
+        }
+        LONG64 seen = InterlockedCompareExchange64(&limit->next_allowed, base + interval_ms, tat);
+        if (seen == tat) {
+            break;
+        }
+        tat = seen;
+    }
+
+    *suppressed = limit->suppressed ? InterlockedExchange(&limit->suppressed, 0) : 0;
+    return TRUE;
+}
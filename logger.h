@@ -17,14 +17,115 @@ typedef enum {
     LOG_ERROR
 } LogLevel;
 
+#define LOGGER_RING_CAPACITY 4096     // Records in flight (power of two)
+#define LOGGER_MESSAGE_SIZE 512       // Longer messages are truncated
+#define LOGGER_FLUSH_MS 20            // Flusher wake-up interval when idle
+
+#define LOGGER_SINK_CONSOLE 0x1
+#define LOGGER_SINK_FILE    0x2       // Rotating mapped segments, see logfile.h
+
+// Open the sinks (env PEEK_LOG_SINK = console|file|both, default both) and
+// start the background flusher. Falls back to the console if the file cannot be created.
 void logger_init(void);
 
+// Drain every queued record, stop the flusher and close the log file.
+// Later calls log synchronously to the console.
+void logger_shutdown(void);
+
+// Formats into a lock-free ring slot on the calling thread; never blocks on I/O.
+// When the ring is full the record is dropped and counted.
 void logger_log(LogLevel level, const char* format, ...);
 
-#define LOG_DEBUG(...)   logger_log(LOG_DEBUG, __VA_ARGS__)
-#define LOG_INFO(...)    logger_log(LOG_INFO, __VA_ARGS__)
-#define LOG_SUCCESS(...) logger_log(LOG_SUCCESS, __VA_ARGS__)
-#define LOG_WARNING(...) logger_log(LOG_WARNING, __VA_ARGS__)
-#define LOG_ERROR(...)   logger_log(LOG_ERROR, __VA_ARGS__)
+// Records dropped because the ring was full (since start)
+LONG logger_get_dropped_count(void);
+
+// ============================================================================
+// Levels & rate limiting
+// ============================================================================
+//
+// PEEK_LOG_MIN_LEVEL removes lower levels at compile time (arguments are not
+// even evaluated). Defaults to INFO when NDEBUG is set (Release), DEBUG otherwise.
+// Above that, the runtime level (logger_set_level / env PEEK_LOG_LEVEL =
+// debug|info|warning|error) is checked before any formatting.
+//
+// Every call site has its own token bucket (GCRA, one CAS): a burst of
+// LOGGER_RATE_BURST, then one message per LOGGER_RATE_INTERVAL_MS. The next
+// message that passes reports how many were suppressed at that site.
+// LOG_LIMITED sets a tighter budget for known repeaters.
+
+#define PEEK_LOG_LEVEL_DEBUG   0
+#define PEEK_LOG_LEVEL_INFO    1
+#define PEEK_LOG_LEVEL_SUCCESS 2
+#define PEEK_LOG_LEVEL_WARNING 3
+#define PEEK_LOG_LEVEL_ERROR   4
+
+#ifndef PEEK_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define PEEK_LOG_MIN_LEVEL PEEK_LOG_LEVEL_INFO
+#else
+#define PEEK_LOG_MIN_LEVEL PEEK_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOGGER_RATE_BURST 50
+#define LOGGER_RATE_INTERVAL_MS 100
+
+typedef struct {
+    volatile LONG64 next_allowed;   // Theoretical arrival time (ms, GetTickCount64)
+    volatile LONG suppressed;
+} LogRateLimit;
+
+extern volatile LONG logger_runtime_level;
+
+void logger_set_level(LogLevel level);
+
+// TRUE if this call site may log now; `suppressed` receives (and resets) the
+// number of messages dropped at this site since the last one that passed
+BOOL logger_rate_allow(LogRateLimit* limit, DWORD burst, DWORD interval_ms, LONG* suppressed);
+
+// Guard for call sites that do extra work (formatting addresses...) just to log
+#define LOG_ENABLED(level) ((int)(level) >= PEEK_LOG_MIN_LEVEL && (LONG)(level) >= logger_runtime_level)
+
+#define LOGGER_EMIT(level, burst, interval_ms, ...) do { \
+    if (LOG_ENABLED(level)) { \
+        static LogRateLimit log_site_limit_; \
+        LONG log_site_suppressed_; \
+        if (logger_rate_allow(&log_site_limit_, (burst), (interval_ms), &log_site_suppressed_)) { \
+            if (log_site_suppressed_ > 0) { \
+                logger_log((level), "(%ld message(s) suppressed at %s:%d)", \
+                           (long)log_site_suppressed_, __FILE__, __LINE__); \
+            } \
+            logger_log((level), __VA_ARGS__); \
+        } \
+    } \
+} while (0)
+
+#define LOG_LIMITED(level, burst, interval_ms, ...) LOGGER_EMIT(level, burst, interval_ms, __VA_ARGS__)
+
+#if PEEK_LOG_MIN_LEVEL <= PEEK_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)   LOGGER_EMIT(LOG_DEBUG, LOGGER_RATE_BURST, LOGGER_RATE_INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)   ((void)0)
+#endif
+
+#if PEEK_LOG_MIN_LEVEL <= PEEK_LOG_LEVEL_INFO
+#define LOG_INFO(...)    LOGGER_EMIT(LOG_INFO, LOGGER_RATE_BURST, LOGGER_RATE_INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOG_INFO(...)    ((void)0)
+#endif
+
+#if PEEK_LOG_MIN_LEVEL <= PEEK_LOG_LEVEL_SUCCESS
+#define LOG_SUCCESS(...) LOGGER_EMIT(LOG_SUCCESS, LOGGER_RATE_BURST, LOGGER_RATE_INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOG_SUCCESS(...) ((void)0)
+#endif
+
+#if PEEK_LOG_MIN_LEVEL <= PEEK_LOG_LEVEL_WARNING
+#define LOG_WARNING(...) LOGGER_EMIT(LOG_WARNING, LOGGER_RATE_BURST, LOGGER_RATE_INTERVAL_MS, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#define LOG_ERROR(...)   LOGGER_EMIT(LOG_ERROR, LOGGER_RATE_BURST, LOGGER_RATE_INTERVAL_MS, __VA_ARGS__)
 
-#endif
\ No newline at end of file
+#endif
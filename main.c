@@ -5,6 +5,9 @@
 #include "network.h"
 #include "gui.h"
 #include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "export.h"
 #include <windows.h>
 
 // Check if the application is running with administrator privileges
@@ -50,6 +53,12 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         LOG_SUCCESS("Running with administrator privileges");
     }
 
+    // Stage timings and counters (exported only when PEEK_METRICS_* is set)
+    metrics_init();
+
+    // Span tracer (off unless PEEK_TRACE=1 or F12)
+    trace_init();
+
     if (network_init() != 0) {
         LOG_ERROR("Failed to initialize network module");
         MessageBox(NULL, L"Failed to initialize network module", L"Error", MB_ICONERROR);
@@ -74,8 +83,12 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     int result = gui_run();
 
     LOG_INFO("Shutting down...");
+    export_cleanup();  // Reads the connection store
     network_cleanup();
+    trace_cleanup();
+    metrics_cleanup();
     LOG_SUCCESS("Application closed");
+    logger_shutdown();
 
     return result;
 }
\ No newline at end of file
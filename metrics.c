@@ -0,0 +1,560 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "metrics.h"
+#include "logger.h"
+#include <winsock2.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define METRICS_FIRST_EXPORT_POW2 10    // Exported bucket bounds: 2^10 ns (~1 us) ..
+#define METRICS_LAST_EXPORT_POW2 34     // .. 2^34 ns (~17 s)
+
+// One cache line per counter/gauge: worker threads bump different metrics
+// without bouncing each other's lines
+typedef struct {
+    volatile LONG64 value;
+    char padding[64 - sizeof(LONG64)];
+} MetricSlot;
+
+// Log-linear buckets (HDR style): values below 8 ns are exact, above that each
+// power of two is split into METRICS_HISTOGRAM_SUB_BUCKETS linear steps
+typedef struct {
+    volatile LONG64 sum_ns;
+    volatile LONG last_us;      // Most recent value (32-bit: a plain store is atomic)
+    char padding[64 - sizeof(LONG64) - sizeof(LONG)];
+    volatile LONG64 buckets[METRICS_HISTOGRAM_BUCKETS];
+} HistogramData;
+
+typedef struct {
+    const char* name;
+    const char* labels;     // Prometheus label set without braces, or NULL
+    const char* help;
+} MetricInfo;
+
+static const MetricInfo counter_info[METRIC_COUNTER_COUNT] = {
+    {"peek_new_connections_total", NULL, "Connections seen for the first time"},
+    {"peek_security_cache_lookups_total", "result=\"hit\"", "Hash/trust cache lookups"},
+    {"peek_security_cache_lookups_total", "result=\"miss\"", "Hash/trust cache lookups"},
+    {"peek_resolver_lookups_total", "result=\"hit\"", "Reverse DNS cache lookups"},
+    {"peek_resolver_lookups_total", "result=\"miss\"", "Reverse DNS cache lookups"},
+    {"peek_security_analyses_total", NULL, "Hash/signature analyses completed"},
+    {"peek_security_rejected_total", NULL, "Connections not queued because the security queue was full"},
+    {"peek_seen_removed_total", "reason=\"expired\"", "Closed connections removed from the seen table"},
+    {"peek_seen_removed_total", "reason=\"evicted\"", "Closed connections removed from the seen table"},
+};
+
+static const MetricInfo gauge_info[METRIC_GAUGE_COUNT] = {
+    {"peek_active_connections", NULL, "Connections in the last poll"},
+    {"peek_seen_connections", NULL, "Live rows in the seen-connection table"},
+    {"peek_closed_connections", NULL, "Closed connections waiting for expiry in the seen table"},
+    {"peek_history_bytes", NULL, "Memory held by the compacted connection history"},
+    {"peek_security_queue_length", NULL, "Connections waiting for hash/signature analysis"},
+};
+
+static const MetricInfo histogram_info[METRIC_HIST_COUNT] = {
+    {"peek_poll_duration_seconds", NULL, "One connection poll including the diff"},
+    {"peek_table_fetch_duration_seconds", "table=\"tcp4\"", "One connection table fetch and conversion"},
+    {"peek_table_fetch_duration_seconds", "table=\"tcp6\"", "One connection table fetch and conversion"},
+    {"peek_table_fetch_duration_seconds", "table=\"udp4\"", "One connection table fetch and conversion"},
+    {"peek_table_fetch_duration_seconds", "table=\"udp6\"", "One connection table fetch and conversion"},
+    {"peek_diff_duration_seconds", NULL, "Matching a poll against the seen table"},
+    {"peek_process_snapshot_duration_seconds", NULL, "One process table snapshot"},
+    {"peek_process_name_duration_seconds", NULL, "network_get_process_name"},
+    {"peek_sha256_duration_seconds", NULL, "network_calculate_sha256"},
+    {"peek_verify_signature_duration_seconds", NULL, "network_verify_signature"},
+    {"peek_gui_add_duration_seconds", NULL, "gui_add_connection"},
+    {"peek_time_to_trust_seconds", "priority=\"visible\"", "From a row queued or bumped to visible priority until its trust result is published"},
+};
+
+static MetricSlot counters[METRIC_COUNTER_COUNT];
+static MetricSlot gauges[METRIC_GAUGE_COUNT];
+static HistogramData histograms[METRIC_HIST_COUNT];
+
+static double ns_per_tick = 0.0;
+
+// Exporters
+static char export_path[MAX_PATH] = {0};
+static HANDLE export_thread = NULL;
+static HANDLE export_stop_event = NULL;
+static SOCKET listen_socket = INVALID_SOCKET;
+static HANDLE http_thread = NULL;
+static volatile LONG http_running = 0;
+
+static int highest_bit(ULONGLONG value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+static int bucket_index(ULONGLONG ns) {
+    if (ns < METRICS_HISTOGRAM_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    int bit = highest_bit(ns);  // >= 3
+    int index = (bit - 2) * METRICS_HISTOGRAM_SUB_BUCKETS + (int)((ns >> (bit - 3)) & (METRICS_HISTOGRAM_SUB_BUCKETS - 1));
+    return index < METRICS_HISTOGRAM_BUCKETS ? index : METRICS_HISTOGRAM_BUCKETS - 1;
+}
+
+// Largest value that lands in bucket `index`
+static LONG64 bucket_upper_ns(int index) {
+    if (index < METRICS_HISTOGRAM_SUB_BUCKETS) {
+        return index;
+    }
+    int bit = index / METRICS_HISTOGRAM_SUB_BUCKETS + 2;
+    int sub = index % METRICS_HISTOGRAM_SUB_BUCKETS;
+    LONG64 low = (LONG64)(METRICS_HISTOGRAM_SUB_BUCKETS + sub) << (bit - 3);
+    return low + ((LONG64)1 << (bit - 3)) - 1;
+}
+
+void metrics_counter_add(MetricCounter id, LONG64 delta) {
+    InterlockedExchangeAdd64(&counters[id].value, delta);
+}
+
+void metrics_gauge_set(MetricGauge id, LONG64 value) {
+    InterlockedExchange64(&gauges[id].value, value);
+}
+
+LONG64 metrics_now(void) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+void metrics_observe_ns(MetricHistogram id, LONG64 nanoseconds) {
+    if (nanoseconds < 0) {
+        nanoseconds = 0;
+    }
+    HistogramData* h = &histograms[id];
+    InterlockedIncrement64(&h->buckets[bucket_index((ULONGLONG)nanoseconds)]);
+    InterlockedExchangeAdd64(&h->sum_ns, nanoseconds);
+    h->last_us = (nanoseconds / 1000 < MAXLONG) ? (LONG)(nanoseconds / 1000) : MAXLONG;
+}
+
+void metrics_observe_since(MetricHistogram id, LONG64 start) {
+    if (ns_per_tick == 0.0) {
+        // Same value from every thread: the race is harmless
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        ns_per_tick = 1e9 / (double)frequency.QuadPart;
+    }
+    metrics_observe_ns(id, (LONG64)((double)(metrics_now() - start) * ns_per_tick));
+}
+
+LONG64 metrics_counter_get(MetricCounter id) {
+    return counters[id].value;
+}
+
+LONG64 metrics_histogram_count(MetricHistogram id) {
+    LONG64 total = 0;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        total += histograms[id].buckets[i];
+    }
+    return total;
+}
+
+LONG64 metrics_histogram_percentile_ns(MetricHistogram id, double q) {
+    LONG64 total = metrics_histogram_count(id);
+    if (total == 0) {
+        return 0;
+    }
+
+    LONG64 rank = (LONG64)(q * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    LONG64 seen = 0;
+    for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+        seen += histograms[id].buckets[i];
+        if (seen >= rank) {
+            return bucket_upper_ns(i);
+        }
+    }
+    return bucket_upper_ns(METRICS_HISTOGRAM_BUCKETS - 1);
+}
+
+static double hit_rate(MetricCounter hit, MetricCounter miss) {
+    LONG64 hits = counters[hit].value;
+    LONG64 total = hits + counters[miss].value;
+    return total > 0 ? (double)hits / (double)total : -1.0;
+}
+
+static ULONGLONG filetime_to_u64(const FILETIME* ft) {
+    return ((ULONGLONG)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+void metrics_sample(MetricsSummary* out) {
+    static LONG64 previous_tick = 0;
+    static LONG64 previous_completed = 0;
+    static ULONGLONG previous_cpu = 0;
+
+    memset(out, 0, sizeof(MetricsSummary));
+
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        MetricsStage* stage = &out->stages[i];
+        stage->count = metrics_histogram_count((MetricHistogram)i);
+        stage->last_ms = histograms[i].last_us / 1000.0;
+        stage->p50_ms = metrics_histogram_percentile_ns((MetricHistogram)i, 0.50) / 1e6;
+        stage->p99_ms = metrics_histogram_percentile_ns((MetricHistogram)i, 0.99) / 1e6;
+    }
+
+    out->active_connections = gauges[METRIC_GAUGE_ACTIVE_CONNECTIONS].value;
+    out->seen_connections = gauges[METRIC_GAUGE_SEEN_CONNECTIONS].value;
+    out->security_queue = gauges[METRIC_GAUGE_SECURITY_QUEUE].value;
+    out->security_cache_hit_rate = hit_rate(METRIC_COUNTER_SECURITY_CACHE_HIT, METRIC_COUNTER_SECURITY_CACHE_MISS);
+    out->resolver_hit_rate = hit_rate(METRIC_COUNTER_RESOLVER_HIT, METRIC_COUNTER_RESOLVER_MISS);
+    out->log_dropped = logger_get_dropped_count();
+    out->security_rejected = counters[METRIC_COUNTER_SECURITY_REJECTED].value;
+
+    // Rates over the interval since the previous sample
+    LONG64 now = metrics_now();
+    LONG64 completed = counters[METRIC_COUNTER_SECURITY_COMPLETED].value;
+    FILETIME created, exited, kernel, user;
+    ULONGLONG cpu = 0;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        cpu = filetime_to_u64(&kernel) + filetime_to_u64(&user);  // 100 ns units
+    }
+
+    if (previous_tick != 0 && now > previous_tick && ns_per_tick > 0.0) {
+        double seconds = (double)(now - previous_tick) * ns_per_tick / 1e9;
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        out->security_per_second = (double)(completed - previous_completed) / seconds;
+        out->cpu_percent = ((double)(cpu - previous_cpu) / 1e7) / (seconds * si.dwNumberOfProcessors) * 100.0;
+    }
+    previous_tick = now;
+    previous_completed = completed;
+    previous_cpu = cpu;
+
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        out->working_set = pmc.WorkingSetSize;
+        out->peak_working_set = pmc.PeakWorkingSetSize;
+    }
+}
+
+// ============================================================================
+// Prometheus text format
+// ============================================================================
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t used;
+    BOOL overflow;
+} TextBuffer;
+
+static void text_append(TextBuffer* out, const char* format, ...) {
+    if (out->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(out->data + out->used, out->size - out->used, format, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= out->size - out->used) {
+        out->overflow = TRUE;
+        return;
+    }
+    out->used += (size_t)written;
+}
+
+// HELP/TYPE once per family (labelled variants are adjacent in the tables)
+static void append_family_header(TextBuffer* out, const MetricInfo* info, const MetricInfo* previous, const char* type) {
+    if (previous && strcmp(previous->name, info->name) == 0) {
+        return;
+    }
+    text_append(out, "# HELP %s %s\n# TYPE %s %s\n", info->name, info->help, info->name, type);
+}
+
+static void append_sample(TextBuffer* out, const char* name, const char* suffix, const char* labels,
+                          const char* extra_label, const char* value) {
+    text_append(out, "%s%s", name, suffix);
+    if (labels || extra_label) {
+        text_append(out, "{%s%s%s}", labels ? labels : "",
+                    (labels && extra_label) ? "," : "", extra_label ? extra_label : "");
+    }
+    text_append(out, " %s\n", value);
+}
+
+static void append_histogram(TextBuffer* out, MetricHistogram id) {
+    const MetricInfo* info = &histogram_info[id];
+    const HistogramData* h = &histograms[id];
+    char label[64];
+    char value[32];
+
+    // Fine buckets below 2^k ns all end under the 2^k bound: exact aggregation
+    LONG64 cumulative = 0;
+    int index = 0;
+    for (int pow2 = METRICS_FIRST_EXPORT_POW2; pow2 <= METRICS_LAST_EXPORT_POW2; pow2++) {
+        int limit = (pow2 - 2) * METRICS_HISTOGRAM_SUB_BUCKETS;
+        for (; index < limit; index++) {
+            cumulative += h->buckets[index];
+        }
+        snprintf(label, sizeof(label), "le=\"%.9g\"", (double)((LONG64)1 << pow2) / 1e9);
+        snprintf(value, sizeof(value), "%lld", (long long)cumulative);
+        append_sample(out, info->name, "_bucket", info->labels, label, value);
+    }
+    for (; index < METRICS_HISTOGRAM_BUCKETS; index++) {
+        cumulative += h->buckets[index];
+    }
+
+    snprintf(value, sizeof(value), "%lld", (long long)cumulative);
+    append_sample(out, info->name, "_bucket", info->labels, "le=\"+Inf\"", value);
+    snprintf(value, sizeof(value), "%.9g", (double)h->sum_ns / 1e9);
+    append_sample(out, info->name, "_sum", info->labels, NULL, value);
+    snprintf(value, sizeof(value), "%lld", (long long)cumulative);
+    append_sample(out, info->name, "_count", info->labels, NULL, value);
+}
+
+int metrics_format_prometheus(char* buffer, size_t size) {
+    TextBuffer out = {buffer, size, 0, FALSE};
+    char value[32];
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        append_family_header(&out, &counter_info[i], i > 0 ? &counter_info[i - 1] : NULL, "counter");
+        snprintf(value, sizeof(value), "%lld", (long long)counters[i].value);
+        append_sample(&out, counter_info[i].name, "", counter_info[i].labels, NULL, value);
+    }
+
+    text_append(&out, "# HELP peek_log_dropped_total Log records dropped because the ring was full\n"
+                      "# TYPE peek_log_dropped_total counter\n"
+                      "peek_log_dropped_total %ld\n", (long)logger_get_dropped_count());
+
+    for (int i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        append_family_header(&out, &gauge_info[i], i > 0 ? &gauge_info[i - 1] : NULL, "gauge");
+        snprintf(value, sizeof(value), "%lld", (long long)gauges[i].value);
+        append_sample(&out, gauge_info[i].name, "", gauge_info[i].labels, NULL, value);
+    }
+
+    for (int i = 0; i < METRIC_HIST_COUNT; i++) {
+        append_family_header(&out, &histogram_info[i], i > 0 ? &histogram_info[i - 1] : NULL, "histogram");
+        append_histogram(&out, (MetricHistogram)i);
+    }
+
+    return out.overflow ? -1 : (int)out.used;
+}
+
+// ============================================================================
+// Exporters
+// ============================================================================
+
+// Write to a temporary file and swap it in, so scrapers never read half a snapshot
+static void write_snapshot_file(char* text) {
+    int len = metrics_format_prometheus(text, METRICS_TEXT_SIZE);
+    if (len < 0) {
+        return;
+    }
+
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", export_path);
+
+    HANDLE hFile = CreateFileA(temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, text, (DWORD)len, &written, NULL) && written == (DWORD)len;
+    CloseHandle(hFile);
+
+    if (!ok || !MoveFileExA(temp_path, export_path, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(temp_path);
+    }
+}
+
+static DWORD WINAPI MetricsExportThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    char* text = (char*)malloc(METRICS_TEXT_SIZE);
+    if (!text) {
+        return 0;
+    }
+
+    do {
+        write_snapshot_file(text);
+    } while (WaitForSingleObject(export_stop_event, METRICS_EXPORT_INTERVAL_MS) == WAIT_TIMEOUT);
+
+    // Final snapshot on shutdown
+    write_snapshot_file(text);
+    free(text);
+    return 0;
+}
+
+static void send_all(SOCKET client, const char* data, int len) {
+    while (len > 0) {
+        int sent = send(client, data, len, 0);
+        if (sent <= 0) {
+            return;
+        }
+        data += sent;
+        len -= sent;
+    }
+}
+
+// One request per connection, served inline: scrapers poll every few seconds
+static DWORD WINAPI MetricsHttpThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    char* text = (char*)malloc(METRICS_TEXT_SIZE);
+    if (!text) {
+        return 0;
+    }
+
+    char request[1024];
+    char header[256];
+
+    while (http_running) {
+        SOCKET client = accept(listen_socket, NULL, NULL);
+        if (client == INVALID_SOCKET) {
+            if (http_running) {
+                Sleep(100);
+            }
+            continue;
+        }
+
+        // A client that never sends cannot stall the exporter
+        DWORD timeout_ms = 2000;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout_ms, sizeof(timeout_ms));
+
+        int received = recv(client, request, sizeof(request) - 1, 0);
+        if (received > 0) {
+            request[received] = '\0';
+            if (strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0) {
+                int len = metrics_format_prometheus(text, METRICS_TEXT_SIZE);
+                if (len < 0) {
+                    len = 0;
+                }
+                int header_len = snprintf(header, sizeof(header),
+                                          "HTTP/1.0 200 OK\r\n"
+                                          "Content-Type: text/plain; version=0.0.4\r\n"
+                                          "Content-Length: %d\r\n"
+                                          "Connection: close\r\n\r\n", len);
+                send_all(client, header, header_len);
+                send_all(client, text, len);
+            } else {
+                static const char not_found[] =
+                    "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+                send_all(client, not_found, (int)sizeof(not_found) - 1);
+            }
+        }
+
+        shutdown(client, SD_SEND);
+        closesocket(client);
+    }
+
+    free(text);
+    return 0;
+}
+
+static int start_http_exporter(unsigned short port) {
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return -1;
+    }
+
+    listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket == INVALID_SOCKET) {
+        WSACleanup();
+        return -1;
+    }
+
+    // Nobody else may bind the same port while we hold it
+    BOOL exclusive = TRUE;
+    setsockopt(listen_socket, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&exclusive, sizeof(exclusive));
+
+    // Loopback only: metrics are never reachable from the network
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+
+    if (bind(listen_socket, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listen_socket, 4) != 0) {
+        closesocket(listen_socket);
+        listen_socket = INVALID_SOCKET;
+        WSACleanup();
+        return -1;
+    }
+
+    InterlockedExchange(&http_running, 1);
+    http_thread = CreateThread(NULL, 0, MetricsHttpThread, NULL, 0, NULL);
+    if (!http_thread) {
+        InterlockedExchange(&http_running, 0);
+        closesocket(listen_socket);
+        listen_socket = INVALID_SOCKET;
+        WSACleanup();
+        return -1;
+    }
+    return 0;
+}
+
+int metrics_init(void) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    ns_per_tick = 1e9 / (double)frequency.QuadPart;
+
+    DWORD len = GetEnvironmentVariableA("PEEK_METRICS_FILE", export_path, sizeof(export_path));
+    if (len > 0 && len < sizeof(export_path)) {
+        export_stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        export_thread = export_stop_event ? CreateThread(NULL, 0, MetricsExportThread, NULL, 0, NULL) : NULL;
+        if (export_thread) {
+            LOG_INFO("Metrics snapshot: %s (every %d s)", export_path, METRICS_EXPORT_INTERVAL_MS / 1000);
+        } else {
+            LOG_WARNING("Unable to start the metrics file exporter");
+        }
+    } else {
+        export_path[0] = '\0';
+    }
+
+    char port_text[16];
+    len = GetEnvironmentVariableA("PEEK_METRICS_PORT", port_text, sizeof(port_text));
+    if (len > 0 && len < sizeof(port_text)) {
+        int port = atoi(port_text);
+        if (port <= 0 || port > 65535) {
+            LOG_WARNING("Invalid PEEK_METRICS_PORT: %s", port_text);
+        } else if (start_http_exporter((unsigned short)port) == 0) {
+            LOG_INFO("Metrics served on http://127.0.0.1:%d/metrics", port);
+        } else {
+            LOG_WARNING("Unable to serve metrics on port %d", port);
+        }
+    }
+
+    return 0;
+}
+
+void metrics_cleanup(void) {
+    if (export_thread) {
+        SetEvent(export_stop_event);
+        WaitForSingleObject(export_thread, INFINITE);
+        CloseHandle(export_thread);
+        export_thread = NULL;
+    }
+    if (export_stop_event) {
+        CloseHandle(export_stop_event);
+        export_stop_event = NULL;
+    }
+
+    if (http_thread) {
+        // Closing the listener wakes accept()
+        InterlockedExchange(&http_running, 0);
+        closesocket(listen_socket);
+        WaitForSingleObject(http_thread, INFINITE);
+        CloseHandle(http_thread);
+        http_thread = NULL;
+        listen_socket = INVALID_SOCKET;
+        WSACleanup();
+    }
+}
@@ -0,0 +1,116 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_METRICS_H
+#define PEEK_METRICS_H
+
+#include <windows.h>
+
+#define METRICS_HISTOGRAM_SUB_BUCKETS 8       // Per power of two (~12% relative error)
+#define METRICS_HISTOGRAM_BUCKETS 320         // Covers 0 ns .. ~73 minutes
+#define METRICS_EXPORT_INTERVAL_MS 5000       // File snapshot period
+#define METRICS_TEXT_SIZE (128 * 1024)        // Prometheus exposition buffer
+
+// Fixed registry: every metric is an enum slot, so recording is an array index
+// plus one interlocked add (histograms: two). Cheap enough to stay on always.
+//
+// Export (both optional, read at metrics_init):
+//   PEEK_METRICS_FILE=<path>   Prometheus text snapshot rewritten every 5 s
+//   PEEK_METRICS_PORT=<port>   GET /metrics served on 127.0.0.1 only
+
+typedef enum {
+    METRIC_COUNTER_NEW_CONNECTIONS,
+    METRIC_COUNTER_SECURITY_CACHE_HIT,
+    METRIC_COUNTER_SECURITY_CACHE_MISS,
+    METRIC_COUNTER_RESOLVER_HIT,
+    METRIC_COUNTER_RESOLVER_MISS,
+    METRIC_COUNTER_SECURITY_COMPLETED,
+    METRIC_COUNTER_SECURITY_REJECTED,   // Security queue full
+    METRIC_COUNTER_SEEN_EXPIRED,        // Closed connections past the retention window
+    METRIC_COUNTER_SEEN_EVICTED,        // Closed connections dropped early, store full
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_GAUGE_ACTIVE_CONNECTIONS,
+    METRIC_GAUGE_SEEN_CONNECTIONS,
+    METRIC_GAUGE_CLOSED_CONNECTIONS,
+    METRIC_GAUGE_HISTORY_BYTES,
+    METRIC_GAUGE_SECURITY_QUEUE,
+    METRIC_GAUGE_COUNT
+} MetricGauge;
+
+typedef enum {
+    METRIC_HIST_POLL,               // network_check_new_connections end to end
+    METRIC_HIST_TABLE_TCP4,         // One GetExtended*Table pass + row conversion
+    METRIC_HIST_TABLE_TCP6,
+    METRIC_HIST_TABLE_UDP4,
+    METRIC_HIST_TABLE_UDP6,
+    METRIC_HIST_DIFF,               // Matching a poll against the seen table
+    METRIC_HIST_PROCESS_SNAPSHOT,   // One process table pass per poll
+    METRIC_HIST_PROCESS_NAME,       // Per-PID fallback for processes missing from it
+    METRIC_HIST_SHA256,
+    METRIC_HIST_VERIFY_SIGNATURE,
+    METRIC_HIST_GUI_ADD,
+    METRIC_HIST_VISIBLE_TRUST,      // Row queued or bumped to VISIBLE until its trust result is published
+    METRIC_HIST_COUNT
+} MetricHistogram;
+
+// One pipeline stage as shown in the status bar / detail popup
+typedef struct {
+    double last_ms;
+    double p50_ms;
+    double p99_ms;
+    LONG64 count;
+} MetricsStage;
+
+typedef struct {
+    MetricsStage stages[METRIC_HIST_COUNT];
+    LONG64 active_connections;
+    LONG64 seen_connections;
+    LONG64 security_queue;
+    double security_per_second;         // Completed analyses since the previous sample
+    double security_cache_hit_rate;     // 0..1, -1 before the first lookup
+    double resolver_hit_rate;
+    double cpu_percent;                 // Peek's share of the whole machine since the previous sample
+    SIZE_T working_set;
+    SIZE_T peak_working_set;
+    LONG64 log_dropped;
+    LONG64 security_rejected;
+} MetricsSummary;
+
+// Read PEEK_METRICS_FILE / PEEK_METRICS_PORT and start the exporters. Recording
+// works with or without this call.
+int metrics_init(void);
+
+void metrics_cleanup(void);
+
+void metrics_counter_add(MetricCounter id, LONG64 delta);
+
+void metrics_gauge_set(MetricGauge id, LONG64 value);
+
+// Timestamp for metrics_observe_since (QueryPerformanceCounter ticks)
+LONG64 metrics_now(void);
+
+void metrics_observe_ns(MetricHistogram id, LONG64 nanoseconds);
+
+// Record the time elapsed since `start` (from metrics_now)
+void metrics_observe_since(MetricHistogram id, LONG64 start);
+
+LONG64 metrics_counter_get(MetricCounter id);
+
+LONG64 metrics_histogram_count(MetricHistogram id);
+
+// Upper bound of the bucket holding quantile `q` (0..1), in nanoseconds; 0 when empty
+LONG64 metrics_histogram_percentile_ns(MetricHistogram id, double q);
+
+// Summarize every metric plus process CPU / memory. Rates are relative to the
+// previous call, so call it from one place at a steady, low frequency (~1 s)
+void metrics_sample(MetricsSummary* out);
+
+// Prometheus text exposition of every metric. Returns the length, or -1 if
+// `size` is too small
+int metrics_format_prometheus(char* buffer, size_t size);
+
+#endif
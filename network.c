@@ -4,49 +4,189 @@
 
 #include "network.h"
 #include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "resolver.h"
+#include "threatintel.h"
+#include "threadpool.h"
+#include "security_cache.h"
+#include "sha256.h"
+#include "pe.h"
+#include "trust_store.h"
+#include "procsnap.h"
+#include "epoch.h"
 #include <stdio.h>
 #include <string.h>
 #include <psapi.h>
 
+// Readers (GUI, security workers, exporters) take no lock: inside an epoch
+// section they check a slot's state and copy the row. A row's identity fields
+// are written once, before its state is published; what changes later is
+// published separately (security record, lifetime times below), and a freed
+// slot is only reused after an epoch grace period, so a copy is never torn.
 static NetworkConnection seen_connections[MAX_CONNECTIONS];
-static int seen_count = 0;
+static volatile LONG seen_count = 0; // Slots handed out so far (high-water mark), raised after the row is written
+
+// Filterable fields of seen_connections as columns (same indices). Written
+// under seen_connections_cs; trust bytes are updated wherever a seen row's
+// trust_status changes.
+static ConnectionColumns seen_columns;
+
+// Cold tier: summaries of the closed entries freed from the seen store.
+// Guarded by seen_connections_cs
+static ColdStore seen_history;
 static NetworkStats stats = {0};
 static BOOL initialized = FALSE;
 
-// Security info cache to avoid redundant expensive operations
-#define MAX_SECURITY_CACHE 500
+// Critical section guarding the in-flight table below (the cache has its own lock)
+static CRITICAL_SECTION security_inflight_cs;
+static BOOL cs_initialized = FALSE;
+
+// Paths currently being hashed/verified. Guarded by security_inflight_cs.
+#define MAX_SECURITY_INFLIGHT 128
+static char security_inflight[MAX_SECURITY_INFLIGHT][MAX_PATH];
+static int security_inflight_count = 0;
+static CONDITION_VARIABLE security_inflight_cv;
+
+// Mutable parts of a seen row. Security results are an immutable record per
+// row, swapped in with one interlocked pointer exchange (NULL = the fields
+// stored with the row) and freed through epoch_retire; lifetime times are
+// 64-bit interlocked values. seen_connections[i] keeps the values it was
+// added with
 typedef struct {
     char process_path[MAX_PATH];
     char sha256_hash[SHA256_HASH_LENGTH];
     TrustStatus trust_status;
-    BOOL valid;
-} SecurityCacheEntry;
-
-static SecurityCacheEntry security_cache[MAX_SECURITY_CACHE];
-static int security_cache_count = 0;
+    BOOL security_info_loaded;
+} SeenSecurity;
 
-// Critical section for thread-safe cache access
-static CRITICAL_SECTION security_cache_cs;
-static BOOL cs_initialized = FALSE;
+static SeenSecurity* volatile seen_security[MAX_CONNECTIONS];
+static volatile LONG64 seen_last_seen[MAX_CONNECTIONS];
+static volatile LONG64 seen_closed_at[MAX_CONNECTIONS];
 
-// Critical section for thread-safe seen_connections access
+// Writers: the polling thread, plus history and trust override bookkeeping.
+// Readers never take it
 static CRITICAL_SECTION seen_connections_cs;
 static BOOL seen_cs_initialized = FALSE;
 
-// Manual trust overrides - persisted to disk
-#define MAX_TRUST_OVERRIDES 500
+// Prioritized security queue: one FIFO ring per priority level. Bumping an item pushes it again at the
+// more urgent level; the stale copy is skipped when popped (its recorded level
+// no longer matches), so a ring can briefly hold an index twice.
+#define SECURITY_QUEUE_CAPACITY (MAX_CONNECTIONS * 2)
+#define SECURITY_NOT_QUEUED (-1)
+#define SECURITY_IN_PROGRESS (-2)
+
 typedef struct {
-    char process_path[MAX_PATH];
-    TrustStatus override_status;
-    BOOL valid;
-} TrustOverride;
+    int items[SECURITY_QUEUE_CAPACITY];
+    int head;
+    int count;
+} SecurityQueueRing;
+
+static SecurityQueueRing security_queues[SECURITY_PRIORITY_COUNT];
+static int security_queued_level[MAX_CONNECTIONS];
+// Bumped by every manual override of a row: an analysis that started under an
+// older generation read a stale override, so its result is dropped and requeued
+static volatile LONG security_generation[MAX_CONNECTIONS];
+// metrics_now() when the row was queued or bumped to VISIBLE, 0 when nobody is
+// waiting on it (METRIC_HIST_VISIBLE_TRUST)
+static LONG64 security_visible_since[MAX_CONNECTIONS];
+static int security_queue_pending = 0;
+static CRITICAL_SECTION security_queue_cs;
+
+// Completed seen indices waiting for the GUI (guarded by security_queue_cs)
+static int security_done[MAX_CONNECTIONS];
+static int security_done_head = 0;
+static int security_done_count = 0;
+static BOOL security_done_overflow = FALSE;
+
+// Lifetime of the seen slots. A slot is FREE (never handed out, expired or
+// evicted), OPEN (listed by the last poll) or CLOSED (missing since closed_at,
+// waiting in the expiry wheel). Only the polling thread changes slot states,
+// under seen_connections_cs, so a live entry never moves. A freed slot is
+// retired first and becomes reusable once no reader can still be copying it.
+//
+// Intrusive lists keep every update O(1):
+//   seen_open        open slots, most recently listed at the tail: after a
+//                    poll, the ones it did not list form the head run
+//   seen_closed      closed slots in close order (SEEN_EVICT_OLDEST_CLOSED)
+//   seen_closed_lru  closed slots by last use, a close or a lookup from the
+//                    UI counting as a use (SEEN_EVICT_LRU)
+// Open slots are never evicted. Readers cannot touch the lists: a lookup
+// raises the slot's seen_used flag, applied to seen_closed_lru before an
+// eviction picks its victim.
+typedef enum {
+    SEEN_SLOT_FREE,
+    SEEN_SLOT_OPEN,
+    SEEN_SLOT_CLOSED
+} SeenSlotState;
 
-static TrustOverride trust_overrides[MAX_TRUST_OVERRIDES];
-static int trust_overrides_count = 0;
+typedef struct {
+    int head;
+    int tail;
+    int prev[MAX_CONNECTIONS];
+    int next[MAX_CONNECTIONS];
+} SeenList;
+
+static volatile LONG seen_state[MAX_CONNECTIONS];
+static int seen_live_count = 0;
+static int seen_closed_count = 0;
+static int seen_free_slots[MAX_CONNECTIONS];    // Stack of reusable slots
+static int seen_free_count = 0;
+static volatile LONG seen_used[MAX_CONNECTIONS];
+static volatile LONG seen_used_pending = 0;
+
+// Freed slots waiting out their epoch grace period, oldest first
+static int seen_retired_slots[MAX_CONNECTIONS];
+static LONG64 seen_retired_epoch[MAX_CONNECTIONS];
+static int seen_retired_head = 0;
+static int seen_retired_count = 0;
+static ULONGLONG seen_poll_stamp = 0;           // FILETIME of the latest poll (strictly increasing)
+
+static SeenList seen_open;
+static SeenList seen_closed;
+static SeenList seen_closed_lru;
+
+static SeenEvictionPolicy seen_policy = SEEN_EVICT_LRU;
+static DWORD seen_retention_ms = SEEN_RETENTION_DEFAULT_MS;
+
+// Hierarchical timer wheel expiring closed slots. Level 0 has one bucket per
+// tick (SEEN_WHEEL_TICK_MS) for the next 256 ticks; level 1 has one bucket per
+// 256 ticks, cascaded into level 0 as the wheel reaches its block. Deadlines
+// past level 1 park in its farthest bucket and cascade again. Scheduling and
+// cancelling are O(1); a tick touches one bucket plus the slots it expires.
+#define SEEN_WHEEL_BITS 8
+#define SEEN_WHEEL_SIZE (1 << SEEN_WHEEL_BITS)
+#define SEEN_WHEEL_UPPER_SIZE 64
+
+static int seen_wheel_heads[SEEN_WHEEL_SIZE + SEEN_WHEEL_UPPER_SIZE];
+static int seen_wheel_prev[MAX_CONNECTIONS];
+static int seen_wheel_next[MAX_CONNECTIONS];
+static int seen_wheel_bucket[MAX_CONNECTIONS];  // -1 when not scheduled
+static ULONGLONG seen_wheel_deadline[MAX_CONNECTIONS];
+static ULONGLONG seen_wheel_tick = 0;           // Last tick processed
+
+// Seen connections grouped by executable, so an override touches only its own
+// rows. Guarded by seen_connections_cs; a slot is unlinked when it is freed.
+#define PROCESS_IMAGE_BUCKETS 4096
 
-// Secure file path in %APPDATA%
-static char TRUST_OVERRIDES_FILE[MAX_PATH] = {0};
-static BOOL file_path_initialized = FALSE;
+typedef struct {
+    char process_path[MAX_PATH];
+    DWORD path_hash;
+    int first_seen;          // Chain through seen_image_next/prev, newest first
+    int connection_count;
+    int bucket_next;
+} ProcessImage;
+
+static ProcessImage process_images[MAX_CONNECTIONS];
+static int process_image_count = 0;
+static int process_image_buckets[PROCESS_IMAGE_BUCKETS];
+static int seen_image_next[MAX_CONNECTIONS];
+static int seen_image_prev[MAX_CONNECTIONS];
+static int seen_image_owner[MAX_CONNECTIONS];   // Process image of a slot, -1 if none
+
+static HWND security_notify_hwnd = NULL;
+static UINT security_notify_msg = 0;
+static volatile LONG security_notify_posted = 0;
 
 // Cache of listening ports - used to determine connection direction
 typedef struct {
@@ -57,21 +197,681 @@ typedef struct {
 static ListeningPort listening_ports[1000];
 static int listening_ports_count = 0;
 
+static DWORD hash_process_path(const char* path) {
+    DWORD h = 2166136261u;  // FNV-1a
+    while (*path) {
+        h ^= (BYTE)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// seen_connections_cs held
+static int find_process_image(const char* process_path) {
+    DWORD h = hash_process_path(process_path);
+    for (int i = process_image_buckets[h % PROCESS_IMAGE_BUCKETS]; i >= 0; i = process_images[i].bucket_next) {
+        if (process_images[i].path_hash == h && strcmp(process_images[i].process_path, process_path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Link a seen connection to its executable's record (seen_connections_cs held)
+static void index_seen_connection(int index) {
+    const char* process_path = seen_connections[index].process_path;
+    seen_image_next[index] = -1;
+    seen_image_prev[index] = -1;
+    seen_image_owner[index] = -1;
+    if (process_path[0] == '\0') {
+        return;
+    }
+
+    int image = find_process_image(process_path);
+    if (image < 0) {
+        if (process_image_count >= MAX_CONNECTIONS) {
+            return;
+        }
+        image = process_image_count++;
+        ProcessImage* record = &process_images[image];
+        strncpy(record->process_path, process_path, MAX_PATH - 1);
+        record->process_path[MAX_PATH - 1] = '\0';
+        record->path_hash = hash_process_path(process_path);
+        record->first_seen = -1;
+        record->connection_count = 0;
+        record->bucket_next = process_image_buckets[record->path_hash % PROCESS_IMAGE_BUCKETS];
+        process_image_buckets[record->path_hash % PROCESS_IMAGE_BUCKETS] = image;
+    }
+
+    int next = process_images[image].first_seen;
+    seen_image_next[index] = next;
+    if (next >= 0) {
+        seen_image_prev[next] = index;
+    }
+    process_images[image].first_seen = index;
+    process_images[image].connection_count++;
+    seen_image_owner[index] = image;
+}
+
+// Reverse of index_seen_connection (seen_connections_cs held). The image
+// record stays: the executable will likely connect again
+static void unindex_seen_connection(int index) {
+    int image = seen_image_owner[index];
+    if (image < 0) {
+        return;
+    }
+
+    int prev = seen_image_prev[index];
+    int next = seen_image_next[index];
+    if (prev >= 0) {
+        seen_image_next[prev] = next;
+    } else {
+        process_images[image].first_seen = next;
+    }
+    if (next >= 0) {
+        seen_image_prev[next] = prev;
+    }
+    process_images[image].connection_count--;
+    seen_image_owner[index] = -1;
+}
+
+// ============================================================================
+// Seen Row Publishing
+// ============================================================================
+
+// Copy of a live row with its published security record and lifetime times.
+// Inside an epoch section: the record may be replaced (and retired) meanwhile
+static void read_seen_row(int index, NetworkConnection* out) {
+    memcpy(out, &seen_connections[index], sizeof(NetworkConnection));
+    const SeenSecurity* security = seen_security[index];
+    if (security) {
+        memcpy(out->process_path, security->process_path, MAX_PATH);
+        memcpy(out->sha256_hash, security->sha256_hash, SHA256_HASH_LENGTH);
+        out->trust_status = security->trust_status;
+        out->security_info_loaded = security->security_info_loaded;
+    }
+    out->last_seen = (ULONGLONG)seen_last_seen[index];
+    out->closed_at = (ULONGLONG)seen_closed_at[index];
+}
+
+static BOOL seen_security_loaded(int index) {
+    int reader = epoch_enter();
+    const SeenSecurity* security = seen_security[index];
+    BOOL loaded = security ? security->security_info_loaded : seen_connections[index].security_info_loaded;
+    epoch_exit(reader);
+    return loaded;
+}
+
+// Copy the published trust into the column row (inside an epoch section).
+// Re-read until stable, so the last publisher's value sticks
+static void mirror_seen_trust(int index) {
+    for (;;) {
+        const SeenSecurity* latest = seen_security[index];
+        if (!latest) {
+            break;
+        }
+        connstore_set_trust(&seen_columns, index, (uint8_t)latest->trust_status);
+        if (seen_security[index] == latest) {
+            break;
+        }
+    }
+}
+
+// Returns FALSE to leave the current record in place
+typedef BOOL (*SeenSecurityEdit)(SeenSecurity* security, const void* context);
+
+// Publish a new security record for a live row: copy the current one, apply
+// `edit` and swap it in, or start over from the newer record when another
+// writer got there first. Readers see the old or the new record, never a mix
+static void edit_seen_security(int index, SeenSecurityEdit edit, const void* context) {
+    SeenSecurity* record = (SeenSecurity*)malloc(sizeof(SeenSecurity));
+    if (!record) {
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Unable to publish a security result");
+        return;
+    }
+
+    SeenSecurity* current;
+    int reader = epoch_enter();
+    for (;;) {
+        current = seen_security[index];
+        if (current) {
+            memcpy(record, current, sizeof(SeenSecurity));
+        } else {
+            const NetworkConnection* conn = &seen_connections[index];
+            memcpy(record->process_path, conn->process_path, MAX_PATH);
+            memcpy(record->sha256_hash, conn->sha256_hash, SHA256_HASH_LENGTH);
+            record->trust_status = conn->trust_status;
+            record->security_info_loaded = conn->security_info_loaded;
+        }
+        if (!edit(record, context)) {
+            epoch_exit(reader);
+            free(record);
+            return;
+        }
+        if (InterlockedCompareExchangePointer((PVOID volatile*)&seen_security[index], record, current) == current) {
+            break;
+        }
+    }
+
+    mirror_seen_trust(index);
+    epoch_exit(reader);
+
+    epoch_retire(current);
+}
+
+typedef struct {
+    const NetworkConnection* conn;      // Analysed copy of the row
+    int index;
+    LONG generation;                    // security_generation when the analysis started
+} SecurityResult;
+
+// Analysis result. Dropped when an override changed the row meanwhile (the
+// analysis may have applied the old one; the caller requeues it), otherwise
+// an override journaled since it ran still wins
+static BOOL apply_security_result(SeenSecurity* security, const void* context) {
+    const SecurityResult* result = (const SecurityResult*)context;
+    if (security_generation[result->index] != result->generation) {
+        return FALSE;
+    }
+
+    const NetworkConnection* conn = result->conn;
+    memcpy(security->process_path, conn->process_path, MAX_PATH);
+    memcpy(security->sha256_hash, conn->sha256_hash, SHA256_HASH_LENGTH);
+    security->trust_status = conn->trust_status;
+    security->security_info_loaded = conn->security_info_loaded;
+
+    TrustStatus override = trust_store_get(security->process_path);
+    if (override != TRUST_UNKNOWN) {
+        security->trust_status = override;
+    }
+    return TRUE;
+}
+
+// Manual override (context: the TrustStatus). A reset makes the row pending again
+static BOOL apply_trust_override_edit(SeenSecurity* security, const void* context) {
+    TrustStatus status = *(const TrustStatus*)context;
+    security->trust_status = status;
+    if (status == TRUST_UNKNOWN) {
+        security->security_info_loaded = FALSE;
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// Seen Store Lifetime
+// ============================================================================
+
+static void seen_list_init(SeenList* list) {
+    list->head = -1;
+    list->tail = -1;
+}
+
+static void seen_list_push(SeenList* list, int index) {
+    list->prev[index] = list->tail;
+    list->next[index] = -1;
+    if (list->tail >= 0) {
+        list->next[list->tail] = index;
+    } else {
+        list->head = index;
+    }
+    list->tail = index;
+}
+
+static void seen_list_remove(SeenList* list, int index) {
+    int prev = list->prev[index];
+    int next = list->next[index];
+    if (prev >= 0) {
+        list->next[prev] = next;
+    } else {
+        list->head = next;
+    }
+    if (next >= 0) {
+        list->prev[next] = prev;
+    } else {
+        list->tail = prev;
+    }
+}
+
+static ULONGLONG seen_wheel_now(void) {
+    return GetTickCount64() / SEEN_WHEEL_TICK_MS;
+}
+
+// Put a slot in the bucket for `deadline` (seen_connections_cs held). Due
+// times already passed fire on the next tick
+static void seen_wheel_schedule(int index, ULONGLONG deadline) {
+    ULONGLONG next_tick = seen_wheel_tick + 1;
+    ULONGLONG due = (deadline > next_tick) ? deadline : next_tick;
+    int bucket;
+    if (due - next_tick < SEEN_WHEEL_SIZE) {
+        bucket = (int)(due & (SEEN_WHEEL_SIZE - 1));
+    } else {
+        ULONGLONG block = due >> SEEN_WHEEL_BITS;
+        ULONGLONG last_block = (next_tick >> SEEN_WHEEL_BITS) + SEEN_WHEEL_UPPER_SIZE;
+        if (block > last_block) {
+            block = last_block;  // Parked: re-bucketed when this block cascades
+        }
+        bucket = SEEN_WHEEL_SIZE + (int)(block % SEEN_WHEEL_UPPER_SIZE);
+    }
+
+    seen_wheel_deadline[index] = deadline;
+    seen_wheel_bucket[index] = bucket;
+    seen_wheel_prev[index] = -1;
+    seen_wheel_next[index] = seen_wheel_heads[bucket];
+    if (seen_wheel_heads[bucket] >= 0) {
+        seen_wheel_prev[seen_wheel_heads[bucket]] = index;
+    }
+    seen_wheel_heads[bucket] = index;
+}
+
+static void seen_wheel_cancel(int index) {
+    int bucket = seen_wheel_bucket[index];
+    if (bucket < 0) {
+        return;
+    }
+
+    int prev = seen_wheel_prev[index];
+    int next = seen_wheel_next[index];
+    if (prev >= 0) {
+        seen_wheel_next[prev] = next;
+    } else {
+        seen_wheel_heads[bucket] = next;
+    }
+    if (next >= 0) {
+        seen_wheel_prev[next] = prev;
+    }
+    seen_wheel_bucket[index] = -1;
+}
+
+// Rewrite a slot's column row after its state changed (seen_connections_cs held)
+static void sync_seen_row(int index) {
+    NetworkConnection conn;
+    int reader = epoch_enter();
+    read_seen_row(index, &conn);
+    epoch_exit(reader);
+
+    ConnectionRow row;
+    network_connection_row(&conn, &row);
+    if (index == seen_columns.count) {
+        connstore_append(&seen_columns, &row);
+    } else {
+        connstore_set_row(&seen_columns, index, &row);
+    }
+
+    // A worker may have published (and mirrored) a newer trust after the copy
+    // above: the row just written must not keep the older one
+    reader = epoch_enter();
+    mirror_seen_trust(index);
+    epoch_exit(reader);
+}
+
+// Fold a closed entry into the cold tier (seen_connections_cs held)
+static void compact_seen_connection(int index) {
+    NetworkConnection copy;
+    int reader = epoch_enter();
+    read_seen_row(index, &copy);
+    epoch_exit(reader);
+
+    const NetworkConnection* conn = &copy;
+    ColdSummary summary;
+    memset(&summary, 0, sizeof(summary));
+    summary.process_path = conn->process_path[0] ? conn->process_path : conn->process_name;
+    summary.protocol = (uint8_t)conn->protocol;
+    summary.ip_version = (uint8_t)conn->ip_version;
+    summary.remote_port = (uint16_t)conn->remote_port;
+    if (conn->ip_version == IP_V4) {
+        memcpy(summary.remote_addr, &conn->remote_addr, 4);
+    } else {
+        memcpy(summary.remote_addr, conn->remote_addr_v6, 16);
+    }
+    summary.count = 1;
+    summary.first_seen = conn->first_seen / 10000;
+    summary.last_seen = conn->last_seen / 10000;
+    summary.total_duration = summary.last_seen - summary.first_seen;
+
+    if (coldstore_add(&seen_history, &summary) != 0) {
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Unable to compact closed connections into the history");
+    }
+}
+
+// Move a closed slot's summary to the cold tier and retire the slot
+// (seen_connections_cs held): it is reused once no reader can still be
+// copying it. Refuses while a worker is analysing the slot's row; a queued
+// analysis is dropped (its ring copy is skipped when popped)
+static BOOL release_seen_slot(int index) {
+    EnterCriticalSection(&security_queue_cs);
+    int level = security_queued_level[index];
+    if (level == SECURITY_IN_PROGRESS) {
+        LeaveCriticalSection(&security_queue_cs);
+        return FALSE;
+    }
+    if (level != SECURITY_NOT_QUEUED) {
+        security_queue_pending--;
+    }
+    security_queued_level[index] = SECURITY_NOT_QUEUED;
+    security_visible_since[index] = 0;
+    LeaveCriticalSection(&security_queue_cs);
+
+    if (seen_state[index] == SEEN_SLOT_CLOSED) {
+        seen_wheel_cancel(index);
+        seen_list_remove(&seen_closed, index);
+        seen_list_remove(&seen_closed_lru, index);
+        seen_closed_count--;
+    } else {
+        seen_list_remove(&seen_open, index);
+    }
+    unindex_seen_connection(index);
+    compact_seen_connection(index);
+
+    InterlockedExchange(&seen_state[index], SEEN_SLOT_FREE);
+    connstore_set_flags(&seen_columns, index, CONNSTORE_FLAG_FREE);
+    int tail = (seen_retired_head + seen_retired_count) % MAX_CONNECTIONS;
+    seen_retired_slots[tail] = index;
+    seen_retired_epoch[tail] = epoch_stamp();
+    seen_retired_count++;
+    seen_live_count--;
+    return TRUE;
+}
+
+// Hand the retired slots past their grace period back to the free stack
+// (seen_connections_cs held)
+static void recycle_seen_slots(void) {
+    while (seen_retired_count > 0 && epoch_reclaimable(seen_retired_epoch[seen_retired_head])) {
+        seen_free_slots[seen_free_count++] = seen_retired_slots[seen_retired_head];
+        seen_retired_head = (seen_retired_head + 1) % MAX_CONNECTIONS;
+        seen_retired_count--;
+    }
+}
+
+// Move the closed slots looked up since the last eviction to the LRU tail
+// (seen_connections_cs held). Uses between two evictions land in slot order
+static void apply_seen_uses(void) {
+    if (InterlockedExchange(&seen_used_pending, 0) == 0) {
+        return;
+    }
+
+    for (int i = 0; i < seen_count; i++) {
+        if (seen_used[i] && InterlockedExchange(&seen_used[i], 0) && seen_state[i] == SEEN_SLOT_CLOSED) {
+            seen_list_remove(&seen_closed_lru, i);
+            seen_list_push(&seen_closed_lru, i);
+        }
+    }
+}
+
+// Free a closed slot chosen by seen_policy (seen_connections_cs held).
+// Returns FALSE when every closed slot is being analysed, or none exists
+static BOOL evict_seen_slot(void) {
+    apply_seen_uses();
+    SeenList* order = (seen_policy == SEEN_EVICT_OLDEST_CLOSED) ? &seen_closed : &seen_closed_lru;
+    for (int i = order->head; i >= 0; i = order->next[i]) {
+        if (release_seen_slot(i)) {
+            stats.evicted_connections++;
+            metrics_counter_add(METRIC_COUNTER_SEEN_EVICTED, 1);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+// Index of the live slot holding the same socket, or -1
+static int find_seen_connection(const NetworkConnection* conn) {
+    for (int i = 0; i < seen_count; i++) {
+        if (seen_state[i] == SEEN_SLOT_FREE) {
+            continue;
+        }
+
+        // Check protocol and IP version first
+        if (seen_connections[i].protocol != conn->protocol ||
+            seen_connections[i].ip_version != conn->ip_version) {
+            continue;
+        }
+
+        // Check IPv4 addresses
+        if (conn->ip_version == IP_V4) {
+            if (seen_connections[i].local_addr == conn->local_addr &&
+                seen_connections[i].local_port == conn->local_port &&
+                seen_connections[i].remote_addr == conn->remote_addr &&
+                seen_connections[i].remote_port == conn->remote_port &&
+                seen_connections[i].pid == conn->pid) {
+                return i;
+            }
+        }
+        // Check IPv6 addresses
+        else if (conn->ip_version == IP_V6) {
+            if (memcmp(seen_connections[i].local_addr_v6, conn->local_addr_v6, 16) == 0 &&
+                seen_connections[i].local_port == conn->local_port &&
+                memcmp(seen_connections[i].remote_addr_v6, conn->remote_addr_v6, 16) == 0 &&
+                seen_connections[i].remote_port == conn->remote_port &&
+                seen_connections[i].pid == conn->pid) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Store a connection the current poll lists for the first time. Returns its
+// slot, or -1 when the store is full of open (or busy) connections
+static int add_seen_connection(const NetworkConnection* conn) {
+    int index = -1;
+
+    EnterCriticalSection(&seen_connections_cs);
+    recycle_seen_slots();
+    if (seen_free_count == 0 && seen_count == MAX_CONNECTIONS) {
+        if (seen_retired_count == 0) {
+            evict_seen_slot();
+        }
+        if (seen_retired_count > 0) {
+            // Wait out the readers that may still be copying the retired slots
+            epoch_synchronize();
+            recycle_seen_slots();
+        }
+    }
+    if (seen_free_count > 0) {
+        index = seen_free_slots[--seen_free_count];
+    } else if (seen_count < MAX_CONNECTIONS) {
+        index = seen_count;
+    }
+
+    if (index >= 0) {
+        // Nobody can reach the slot: write it in place, then publish its state
+        free(seen_security[index]);
+        seen_security[index] = NULL;
+        seen_used[index] = 0;
+
+        NetworkConnection* entry = &seen_connections[index];
+        memcpy(entry, conn, sizeof(NetworkConnection));
+        entry->first_seen = seen_poll_stamp;
+        entry->last_seen = seen_poll_stamp;
+        entry->closed_at = 0;
+        seen_last_seen[index] = (LONG64)seen_poll_stamp;
+        seen_closed_at[index] = 0;
+
+        InterlockedExchange(&seen_state[index], SEEN_SLOT_OPEN);
+        seen_wheel_bucket[index] = -1;
+        seen_list_push(&seen_open, index);
+        seen_live_count++;
+        index_seen_connection(index);
+        sync_seen_row(index);
+        if (index == seen_count) {
+            InterlockedIncrement(&seen_count);
+        }
+    }
+    LeaveCriticalSection(&seen_connections_cs);
+
+    if (index < 0) {
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Seen store full (%d open connections), new connections are not tracked",
+                    MAX_CONNECTIONS);
+    }
+    return index;
+}
+
+// The current poll listed this slot again
+static void touch_seen_connection(int index) {
+    EnterCriticalSection(&seen_connections_cs);
+    InterlockedExchange64(&seen_last_seen[index], (LONG64)seen_poll_stamp);
+
+    if (seen_state[index] == SEEN_SLOT_CLOSED) {
+        // Same socket listed again (a UDP endpoint rebound, a missed poll)
+        seen_wheel_cancel(index);
+        seen_list_remove(&seen_closed, index);
+        seen_list_remove(&seen_closed_lru, index);
+        seen_closed_count--;
+        InterlockedExchange(&seen_state[index], SEEN_SLOT_OPEN);
+        InterlockedExchange64(&seen_closed_at[index], 0);
+        seen_list_push(&seen_open, index);
+        sync_seen_row(index);
+    } else {
+        seen_list_remove(&seen_open, index);
+        seen_list_push(&seen_open, index);
+    }
+    LeaveCriticalSection(&seen_connections_cs);
+}
+
+// Close the open slots the current poll did not list and schedule their expiry
+static void close_missing_seen_connections(void) {
+    ULONGLONG deadline = seen_wheel_now() + (seen_retention_ms + SEEN_WHEEL_TICK_MS - 1) / SEEN_WHEEL_TICK_MS;
+
+    EnterCriticalSection(&seen_connections_cs);
+    int i = seen_open.head;
+    while (i >= 0 && (ULONGLONG)seen_last_seen[i] != seen_poll_stamp) {
+        int next = seen_open.next[i];
+        seen_list_remove(&seen_open, i);
+
+        InterlockedExchange(&seen_state[i], SEEN_SLOT_CLOSED);
+        InterlockedExchange64(&seen_closed_at[i], (LONG64)seen_poll_stamp);
+        seen_used[i] = 0;  // The close is the latest use
+        seen_list_push(&seen_closed, i);
+        seen_list_push(&seen_closed_lru, i);
+        seen_closed_count++;
+        seen_wheel_schedule(i, deadline);
+        sync_seen_row(i);
+        i = next;
+    }
+    LeaveCriticalSection(&seen_connections_cs);
+}
+
+// Advance the wheel to now, freeing the closed slots whose retention ran out
+static void expire_seen_connections(void) {
+    ULONGLONG now = seen_wheel_now();
+    int expired = 0;
+
+    EnterCriticalSection(&seen_connections_cs);
+    if (seen_closed_count == 0) {
+        seen_wheel_tick = now;  // Nothing scheduled: skip the idle ticks
+    }
+    while (seen_wheel_tick < now) {
+        ULONGLONG tick = seen_wheel_tick + 1;
+
+        // Entering a new level-1 block: spread its bucket over level 0
+        if ((tick & (SEEN_WHEEL_SIZE - 1)) == 0) {
+            int bucket = SEEN_WHEEL_SIZE + (int)((tick >> SEEN_WHEEL_BITS) % SEEN_WHEEL_UPPER_SIZE);
+            int i = seen_wheel_heads[bucket];
+            seen_wheel_heads[bucket] = -1;
+            while (i >= 0) {
+                int next = seen_wheel_next[i];
+                seen_wheel_schedule(i, seen_wheel_deadline[i]);
+                i = next;
+            }
+        }
+
+        int bucket = (int)(tick & (SEEN_WHEEL_SIZE - 1));
+        int i = seen_wheel_heads[bucket];
+        seen_wheel_heads[bucket] = -1;
+        seen_wheel_tick = tick;
+        while (i >= 0) {
+            int next = seen_wheel_next[i];
+            seen_wheel_bucket[i] = -1;
+            if (seen_wheel_deadline[i] > tick) {
+                seen_wheel_schedule(i, seen_wheel_deadline[i]);
+            } else if (release_seen_slot(i)) {
+                expired++;
+            } else {
+                seen_wheel_schedule(i, tick + 1);  // Being analysed: retry next tick
+            }
+            i = next;
+        }
+    }
+    LeaveCriticalSection(&seen_connections_cs);
+
+    if (expired > 0) {
+        stats.expired_connections += expired;
+        metrics_counter_add(METRIC_COUNTER_SEEN_EXPIRED, expired);
+    }
+}
+
+// Poll timestamp, strictly increasing so that last_seen == seen_poll_stamp
+// means "listed by the current poll"
+static ULONGLONG next_poll_stamp(void) {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULONGLONG now = ((ULONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (now > seen_poll_stamp) ? now : seen_poll_stamp + 1;
+}
+
+// PEEK_SEEN_RETENTION (seconds) and PEEK_SEEN_EVICTION ("lru" / "oldest-closed")
+static void load_seen_policy(void) {
+    char value[32];
+    DWORD len = GetEnvironmentVariableA("PEEK_SEEN_RETENTION", value, sizeof(value));
+    if (len > 0 && len < sizeof(value) && atoi(value) > 0) {
+        seen_retention_ms = (DWORD)atoi(value) * 1000;
+    }
+
+    len = GetEnvironmentVariableA("PEEK_SEEN_EVICTION", value, sizeof(value));
+    if (len > 0 && len < sizeof(value)) {
+        if (lstrcmpiA(value, "oldest-closed") == 0) {
+            seen_policy = SEEN_EVICT_OLDEST_CLOSED;
+        } else if (lstrcmpiA(value, "lru") == 0) {
+            seen_policy = SEEN_EVICT_LRU;
+        } else {
+            LOG_WARNING("Unknown PEEK_SEEN_EVICTION '%s' (lru, oldest-closed)", value);
+        }
+    }
+}
+
+void network_set_seen_policy(SeenEvictionPolicy policy, DWORD retention_ms) {
+    if (retention_ms == 0) {
+        retention_ms = SEEN_RETENTION_DEFAULT_MS;
+    }
+
+    EnterCriticalSection(&seen_connections_cs);
+    seen_policy = policy;
+    seen_retention_ms = retention_ms;
+    LeaveCriticalSection(&seen_connections_cs);
+}
+
 int network_init(void) {
     LOG_INFO("Network module initialization...");
 
     // Initialize critical section for thread-safe cache
     if (!cs_initialized) {
-        InitializeCriticalSection(&security_cache_cs);
+        InitializeCriticalSection(&security_inflight_cs);
+        InitializeConditionVariable(&security_inflight_cv);
         cs_initialized = TRUE;
     }
 
     // Initialize critical section for thread-safe seen_connections access
     if (!seen_cs_initialized) {
         InitializeCriticalSection(&seen_connections_cs);
+        InitializeCriticalSection(&security_queue_cs);
+        for (int i = 0; i < MAX_CONNECTIONS; i++) {
+            security_queued_level[i] = SECURITY_NOT_QUEUED;
+            seen_wheel_bucket[i] = -1;
+        }
+        for (int i = 0; i < PROCESS_IMAGE_BUCKETS; i++) {
+            process_image_buckets[i] = -1;
+        }
+        for (int i = 0; i < SEEN_WHEEL_SIZE + SEEN_WHEEL_UPPER_SIZE; i++) {
+            seen_wheel_heads[i] = -1;
+        }
+        seen_list_init(&seen_open);
+        seen_list_init(&seen_closed);
+        seen_list_init(&seen_closed_lru);
         seen_cs_initialized = TRUE;
     }
 
+    // Reclamation for the lock-free seen reads
+    epoch_init();
+
     WSADATA wsaData;
     const int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (result != 0) {
@@ -79,6 +879,45 @@ int network_init(void) {
         return -1;
     }
 
+    // Open the offline GeoIP database before the first enumeration
+    geoip_init();
+
+    // Background reverse DNS pool (bounded concurrency, never blocks callers)
+    resolver_init(RESOLVER_DEFAULT_WORKERS);
+
+    // Threat feeds compile/map in the background; lookups miss until ready
+    threatintel_init();
+
+    // Hash kernel chosen before the cache and the workers hash anything
+    LOG_INFO("SHA-256 kernel: %s", sha256_select_implementation(1));
+
+    // Hash/signature results keyed by path, validated against file identity
+    security_cache_init(0);
+
+    // Persistent workers for hashing / signature checks (one per core)
+    threadpool_init(0);
+
+    if (connstore_init(&seen_columns, MAX_CONNECTIONS) != 0) {
+        LOG_ERROR("Unable to allocate the connection columns");
+        return -1;
+    }
+    LOG_INFO("Connection filter kernel: %s", connstore_select_implementation(NULL));
+
+    if (coldstore_init(&seen_history, 0) != 0) {
+        LOG_ERROR("Unable to allocate the connection history");
+        return -1;
+    }
+
+    if (procsnap_init() != 0) {
+        LOG_WARNING("Process snapshot unavailable, querying processes one by one");
+    }
+
+    load_seen_policy();
+    seen_wheel_tick = seen_wheel_now();
+    seen_poll_stamp = next_poll_stamp();
+    LOG_INFO("Seen store: closed connections kept %lu s, eviction %s", seen_retention_ms / 1000,
+             (seen_policy == SEEN_EVICT_OLDEST_CLOSED) ? "oldest-closed" : "lru");
+
     NetworkConnection* initial_conns = NULL;
     int initial_count = 0;
 
@@ -87,9 +926,10 @@ int network_init(void) {
         stats.active_connections = initial_count;
 
         for (int i = 0; i < initial_count && i < MAX_CONNECTIONS; i++) {
-            memcpy(&seen_connections[i], &initial_conns[i], sizeof(NetworkConnection));
+            network_enrich_geo(&initial_conns[i]);
+            network_check_threat_intel(&initial_conns[i]);
+            add_seen_connection(&initial_conns[i]);
         }
-        seen_count = (initial_count < MAX_CONNECTIONS) ? initial_count : MAX_CONNECTIONS;
 
         free(initial_conns);
         LOG_SUCCESS("Network module initialized (%d existing(s) connection(s))", initial_count);
@@ -97,8 +937,8 @@ int network_init(void) {
         LOG_WARNING("Unable to get initials connections");
     }
 
-    // Load manual trust overrides from file
-    network_load_trust_overrides();
+    // Manual trust overrides (snapshot + journal)
+    trust_store_init();
 
     initialized = TRUE;
     return 0;
@@ -106,18 +946,36 @@ int network_init(void) {
 
 void network_cleanup(void) {
     LOG_INFO("Network module clean-up");
+    threadpool_cleanup();
+    security_cache_cleanup();
+    resolver_cleanup();
     WSACleanup();
+    geoip_cleanup();
+    threatintel_cleanup();
+    trust_store_cleanup();
 
     if (cs_initialized) {
-        DeleteCriticalSection(&security_cache_cs);
+        DeleteCriticalSection(&security_inflight_cs);
         cs_initialized = FALSE;
     }
 
     if (seen_cs_initialized) {
         DeleteCriticalSection(&seen_connections_cs);
+        DeleteCriticalSection(&security_queue_cs);
         seen_cs_initialized = FALSE;
     }
 
+    connstore_free(&seen_columns);
+    coldstore_free(&seen_history);
+    procsnap_cleanup();
+
+    // Workers are stopped: nothing reads the records any more
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        free(seen_security[i]);
+        seen_security[i] = NULL;
+    }
+    epoch_cleanup();
+
     initialized = FALSE;
 }
 
@@ -183,7 +1041,7 @@ void network_format_ipv6(const BYTE* addr, char* buffer, const size_t size) {
         addr[8], addr[9], addr[10], addr[11], addr[12], addr[13], addr[14], addr[15]);
 }
 
-void network_get_process_name(const DWORD pid, char* buffer, const size_t size) {
+static void lookup_process_name(const DWORD pid, char* buffer, const size_t size) {
     // Special case for System Idle Process
     if (pid == 0) {
         strncpy(buffer, "System Idle Process", size - 1);
@@ -249,6 +1107,33 @@ void network_get_process_name(const DWORD pid, char* buffer, const size_t size)
     buffer[size - 1] = '\0';
 }
 
+void network_get_process_name(const DWORD pid, char* buffer, const size_t size) {
+    TRACE_BEGIN("process name");
+    LONG64 start = metrics_now();
+    lookup_process_name(pid, buffer, size);
+    metrics_observe_since(METRIC_HIST_PROCESS_NAME, start);
+    TRACE_END("process name");
+}
+
+// Owner details joined from the poll's process snapshot. Processes missing
+// from it (started since) and the System pseudo-processes go through the
+// per-PID queries
+static void fill_process_info(NetworkConnection* conn) {
+    const ProcessInfo* info = procsnap_find(conn->pid);
+    conn->parent_pid = info ? info->parent_pid : 0;
+    conn->session_id = info ? info->session_id : 0;
+    conn->process_start_time = info ? info->start_time : 0;
+
+    if (!info || !info->name[0] || conn->pid == 0 || conn->pid == 4) {
+        network_get_process_name(conn->pid, conn->process_name, MAX_PROCESS_NAME);
+        network_get_process_path_only(conn->pid, conn->process_path, MAX_PATH);
+        return;
+    }
+
+    snprintf(conn->process_name, MAX_PROCESS_NAME, "%s", info->name);
+    snprintf(conn->process_path, MAX_PATH, "%s", info->path);
+}
+
 static int get_tcp_connections_v4(NetworkConnection** connections, int* count) {
     PMIB_TCPTABLE_OWNER_PID pTcpTable = NULL;
     DWORD dwSize = 0;
@@ -301,8 +1186,7 @@ static int get_tcp_connections_v4(NetworkConnection** connections, int* count) {
                 conn->direction = CONN_OUTBOUND;
             }
 
-            network_get_process_name(conn->pid, conn->process_name, MAX_PROCESS_NAME);
-            network_get_process_path_only(conn->pid, conn->process_path, MAX_PATH);
+            fill_process_info(conn);
             strcpy(conn->sha256_hash, "N/A");
             conn->trust_status = TRUST_UNKNOWN;
             conn->security_info_loaded = FALSE;
@@ -362,8 +1246,7 @@ static int get_tcp_connections_v6(NetworkConnection** connections, int* count) {
 
             conn->direction = CONN_OUTBOUND; // Simplified for IPv6
 
-            network_get_process_name(conn->pid, conn->process_name, MAX_PROCESS_NAME);
-            network_get_process_path_only(conn->pid, conn->process_path, MAX_PATH);
+            fill_process_info(conn);
             strcpy(conn->sha256_hash, "N/A");
             conn->trust_status = TRUST_UNKNOWN;
             conn->security_info_loaded = FALSE;
@@ -422,10 +1305,11 @@ static int get_udp_connections_v4(NetworkConnection** connections, int* count) {
 
         conn->direction = CONN_UNKNOWN; // UDP doesn't have clear direction
 
-        network_get_process_name(conn->pid, conn->process_name, MAX_PROCESS_NAME);
+        fill_process_info(conn);
         network_get_process_security_info(conn->pid, conn->process_path, MAX_PATH,
                                            conn->sha256_hash, SHA256_HASH_LENGTH,
                                            &conn->trust_status);
+        conn->security_info_loaded = TRUE;  // Computed eagerly above
         GetLocalTime(&conn->timestamp);
 
         (*count)++;
@@ -479,10 +1363,11 @@ static int get_udp_connections_v6(NetworkConnection** connections, int* count) {
 
         conn->direction = CONN_UNKNOWN; // UDP doesn't have clear direction
 
-        network_get_process_name(conn->pid, conn->process_name, MAX_PROCESS_NAME);
+        fill_process_info(conn);
         network_get_process_security_info(conn->pid, conn->process_path, MAX_PATH,
                                            conn->sha256_hash, SHA256_HASH_LENGTH,
                                            &conn->trust_status);
+        conn->security_info_loaded = TRUE;  // Computed eagerly above
         GetLocalTime(&conn->timestamp);
 
         (*count)++;
@@ -504,67 +1389,99 @@ int network_get_connections(NetworkConnection** connections, int* count) {
     }
 
     *count = 0;
+    LONG64 start;
+
+    // One pass over the process table; every row below joins on it by PID
+    TRACE_BEGIN("process snapshot");
+    start = metrics_now();
+    if (procsnap_refresh() < 0) {
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Failed to snapshot the process table");
+    }
+    metrics_observe_since(METRIC_HIST_PROCESS_SNAPSHOT, start);
+    TRACE_END("process snapshot");
 
     // Get IPv4 TCP connections
+    TRACE_BEGIN("tcp4 table");
+    start = metrics_now();
     if (get_tcp_connections_v4(connections, count) != 0) {
-        LOG_WARNING("Failed to get IPv4 TCP connections");
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Failed to get IPv4 TCP connections");
     }
+    metrics_observe_since(METRIC_HIST_TABLE_TCP4, start);
+    TRACE_END("tcp4 table");
 
     // Get IPv6 TCP connections
+    TRACE_BEGIN("tcp6 table");
+    start = metrics_now();
     if (get_tcp_connections_v6(connections, count) != 0) {
-        LOG_WARNING("Failed to get IPv6 TCP connections");
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Failed to get IPv6 TCP connections");
     }
+    metrics_observe_since(METRIC_HIST_TABLE_TCP6, start);
+    TRACE_END("tcp6 table");
 
     // Get IPv4 UDP connections
+    TRACE_BEGIN("udp4 table");
+    start = metrics_now();
     if (get_udp_connections_v4(connections, count) != 0) {
-        LOG_WARNING("Failed to get IPv4 UDP connections");
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Failed to get IPv4 UDP connections");
     }
+    metrics_observe_since(METRIC_HIST_TABLE_UDP4, start);
+    TRACE_END("udp4 table");
 
     // Get IPv6 UDP connections
+    TRACE_BEGIN("udp6 table");
+    start = metrics_now();
     if (get_udp_connections_v6(connections, count) != 0) {
-        LOG_WARNING("Failed to get IPv6 UDP connections");
+        LOG_LIMITED(LOG_WARNING, 1, 60000, "Failed to get IPv6 UDP connections");
     }
+    metrics_observe_since(METRIC_HIST_TABLE_UDP6, start);
+    TRACE_END("udp6 table");
 
     return 0;
 }
 
-static BOOL connection_exists(const NetworkConnection* conn) {
-    for (int i = 0; i < seen_count; i++) {
-        // Check protocol and IP version first
-        if (seen_connections[i].protocol != conn->protocol ||
-            seen_connections[i].ip_version != conn->ip_version) {
-            continue;
-        }
+void network_enrich_geo(NetworkConnection* conn) {
+    memset(&conn->geo, 0, sizeof(GeoInfo));
 
-        // Check IPv4 addresses
-        if (conn->ip_version == IP_V4) {
-            if (seen_connections[i].local_addr == conn->local_addr &&
-                seen_connections[i].local_port == conn->local_port &&
-                seen_connections[i].remote_addr == conn->remote_addr &&
-                seen_connections[i].remote_port == conn->remote_port &&
-                seen_connections[i].pid == conn->pid) {
-                return TRUE;
-            }
-        }
-        // Check IPv6 addresses
-        else if (conn->ip_version == IP_V6) {
-            if (memcmp(seen_connections[i].local_addr_v6, conn->local_addr_v6, 16) == 0 &&
-                seen_connections[i].local_port == conn->local_port &&
-                memcmp(seen_connections[i].remote_addr_v6, conn->remote_addr_v6, 16) == 0 &&
-                seen_connections[i].remote_port == conn->remote_port &&
-                seen_connections[i].pid == conn->pid) {
-                return TRUE;
-            }
-        }
+    // UDP sockets and unconnected endpoints have no remote address to locate
+    if (conn->is_localhost || conn->protocol != PROTO_TCP) {
+        return;
+    }
+
+    if (conn->ip_version == IP_V4) {
+        geoip_lookup_ipv4(conn->remote_addr, &conn->geo);
+    } else {
+        geoip_lookup_ipv6(conn->remote_addr_v6, &conn->geo);
+    }
+}
+
+void network_check_threat_intel(NetworkConnection* conn) {
+    conn->threat_intel_hit = FALSE;
+
+    if (conn->is_localhost || conn->protocol != PROTO_TCP) {
+        return;
+    }
+
+    char ip_str[64];
+    if (conn->ip_version == IP_V4) {
+        conn->threat_intel_hit = threatintel_check_ipv4(conn->remote_addr);
+        if (conn->threat_intel_hit) network_format_ip(conn->remote_addr, ip_str, sizeof(ip_str));
+    } else {
+        conn->threat_intel_hit = threatintel_check_ipv6(conn->remote_addr_v6);
+        if (conn->threat_intel_hit) network_format_ipv6(conn->remote_addr_v6, ip_str, sizeof(ip_str));
+    }
+
+    if (conn->threat_intel_hit) {
+        LOG_WARNING("THREAT FEED MATCH: %s contacted blocklisted address %s", conn->process_name, ip_str);
     }
-    return FALSE;
 }
 
-static void add_seen_connection(const NetworkConnection* conn) {
-    if (seen_count < MAX_CONNECTIONS) {
-        memcpy(&seen_connections[seen_count], conn, sizeof(NetworkConnection));
-        seen_count++;
+// Feed matches outrank signature results (a signed binary can still be known-bad).
+// Applied on read rather than cached so a refreshed feed takes effect immediately.
+static TrustStatus apply_threat_intel(const char* sha256_hash, BOOL ip_hit, TrustStatus status) {
+    if (ip_hit || threatintel_check_sha256(sha256_hash)) {
+        return TRUST_BLOCKLISTED;
     }
+    return status;
 }
 
 int network_check_new_connections(NetworkConnection** new_connections, int* count) {
@@ -572,168 +1489,409 @@ int network_check_new_connections(NetworkConnection** new_connections, int* coun
         return -1;
     }
 
+    TRACE_BEGIN("poll");
+    LONG64 poll_start = metrics_now();
     NetworkConnection* current_conns = NULL;
     int current_count = 0;
 
     if (network_get_connections(&current_conns, &current_count) != 0) {
+        TRACE_END("poll");
         return -1;
     }
 
     *new_connections = (NetworkConnection*)malloc(current_count * sizeof(NetworkConnection));
     if (*new_connections == NULL) {
         free(current_conns);
+        TRACE_END("poll");
         return -1;
     }
 
     *count = 0;
+    TRACE_BEGIN("diff");
+    LONG64 diff_start = metrics_now();
 
+    // Touch what the store already has, close what this poll no longer lists,
+    // then store the new ones: they can take the slots expiry just freed
+    seen_poll_stamp = next_poll_stamp();
+    int unseen_count = 0;
     for (int i = 0; i < current_count; i++) {
-        if (!connection_exists(&current_conns[i])) {
-            memcpy(&(*new_connections)[*count], &current_conns[i], sizeof(NetworkConnection));
-            add_seen_connection(&current_conns[i]);
+        int index = find_seen_connection(&current_conns[i]);
+        if (index >= 0) {
+            touch_seen_connection(index);
+            continue;
+        }
+        if (unseen_count != i) {
+            memcpy(&current_conns[unseen_count], &current_conns[i], sizeof(NetworkConnection));
+        }
+        unseen_count++;
+    }
+    close_missing_seen_connections();
+    expire_seen_connections();
+
+    for (int i = 0; i < unseen_count; i++) {
+        network_enrich_geo(&current_conns[i]);
+        network_check_threat_intel(&current_conns[i]);
+        int index = add_seen_connection(&current_conns[i]);
+        if (index >= 0) {
+            // The stored copy carries the lifetime fields
+            int reader = epoch_enter();
+            read_seen_row(index, &(*new_connections)[*count]);
+            epoch_exit(reader);
             (*count)++;
             stats.new_connections++;
         }
     }
 
-    stats.active_connections = current_count;
-    stats.total_connections = seen_count;
+    // Includes geo/threat enrichment of the new rows and the expiry tick
+    metrics_observe_since(METRIC_HIST_DIFF, diff_start);
+    TRACE_END("diff");
+
+    stats.active_connections = current_count;
+    stats.total_connections = seen_live_count;
+    stats.closed_connections = seen_closed_count;
+
+    metrics_counter_add(METRIC_COUNTER_NEW_CONNECTIONS, *count);
+    metrics_gauge_set(METRIC_GAUGE_ACTIVE_CONNECTIONS, current_count);
+    metrics_gauge_set(METRIC_GAUGE_SEEN_CONNECTIONS, seen_live_count);
+    metrics_gauge_set(METRIC_GAUGE_CLOSED_CONNECTIONS, seen_closed_count);
+
+    ColdStoreStats history;
+    network_get_history_stats(&history);
+    metrics_gauge_set(METRIC_GAUGE_HISTORY_BYTES, (LONG64)history.bytes);
+    metrics_gauge_set(METRIC_GAUGE_SECURITY_QUEUE, network_get_security_queue_length());
+
+    // Free the security records replaced since the last poll
+    epoch_collect();
+
+    free(current_conns);
+    metrics_observe_since(METRIC_HIST_POLL, poll_start);
+    TRACE_END("poll");
+    return 0;
+}
+
+void network_get_stats(NetworkStats* out_stats) {
+    if (out_stats) {
+        memcpy(out_stats, &stats, sizeof(NetworkStats));
+    }
+}
+
+int network_get_all_seen_connections(NetworkConnection** connections, int* count) {
+    if (!initialized) {
+        return -1;
+    }
+
+    int slots = seen_count;
+    *connections = (NetworkConnection*)malloc((slots > 0 ? slots : 1) * sizeof(NetworkConnection));
+    if (*connections == NULL) {
+        return -1;
+    }
+
+    int copied = 0;
+    int reader = epoch_enter();
+    for (int i = 0; i < slots; i++) {
+        if (seen_state[i] != SEEN_SLOT_FREE) {
+            read_seen_row(i, &(*connections)[copied++]);
+        }
+    }
+    epoch_exit(reader);
+
+    *count = copied;
+    return 0;
+}
+
+void network_connection_row(const NetworkConnection* conn, ConnectionRow* row) {
+    row->protocol = (uint8_t)conn->protocol;
+    row->direction = (uint8_t)conn->direction;
+    row->trust = (uint8_t)conn->trust_status;
+    row->flags = (conn->is_localhost ? CONNSTORE_FLAG_LOCALHOST : 0) |
+                 (conn->ip_version == IP_V6 ? CONNSTORE_FLAG_IPV6 : 0) |
+                 (conn->threat_intel_hit ? CONNSTORE_FLAG_THREAT_FEED : 0) |
+                 (conn->closed_at != 0 ? CONNSTORE_FLAG_CLOSED : 0);
+    row->local_port = (uint16_t)conn->local_port;
+    row->remote_port = (uint16_t)conn->remote_port;
+    row->local_addr = conn->local_addr;
+    row->remote_addr = conn->remote_addr;
+    memcpy(row->local_addr_v6, conn->local_addr_v6, 16);
+    memcpy(row->remote_addr_v6, conn->remote_addr_v6, 16);
+}
+
+int network_filter_seen(const ConnectionFilter* filter, int count, uint64_t* mask) {
+    if (!initialized || count <= 0) {
+        return 0;
+    }
+
+    // Free slots never match
+    ConnectionFilter live = *filter;
+    live.flags_mask |= CONNSTORE_FLAG_FREE;
+    live.flags_value &= (uint8_t)~CONNSTORE_FLAG_FREE;
+
+    // Columns only hold fixed-size fields; a row being rewritten for a new
+    // entry at worst flips that row's bit for this one call
+    if (count > seen_count) {
+        count = seen_count;
+    }
+    int reader = epoch_enter();
+    int matches = connstore_filter(&seen_columns, count, &live, mask);
+    epoch_exit(reader);
+    return matches;
+}
+
+int network_get_seen_count(void) {
+    return seen_live_count;
+}
 
-    free(current_conns);
-    return 0;
+int network_get_seen_slots(void) {
+    return seen_count;
 }
 
-void network_get_stats(NetworkStats* out_stats) {
-    if (out_stats) {
-        memcpy(out_stats, &stats, sizeof(NetworkStats));
+int network_copy_seen_range(int* cursor, NetworkConnection* out, int max_count) {
+    if (!initialized || !cursor || *cursor < 0 || max_count <= 0) {
+        return 0;
     }
+
+    int copied = 0;
+    int slots = seen_count;
+    int reader = epoch_enter();
+    int i = *cursor;
+    for (; i < slots && copied < max_count; i++) {
+        if (seen_state[i] != SEEN_SLOT_FREE) {
+            read_seen_row(i, &out[copied++]);
+        }
+    }
+    epoch_exit(reader);
+
+    *cursor = i;
+    return copied;
 }
 
-int network_get_all_seen_connections(NetworkConnection** connections, int* count) {
+int network_query_history(const char* process_path, ColdSummary** summaries, int* count) {
+    *summaries = NULL;
+    *count = 0;
     if (!initialized) {
         return -1;
     }
 
-    *connections = (NetworkConnection*)malloc(seen_count * sizeof(NetworkConnection));
-    if (*connections == NULL) {
-        return -1;
-    }
+    EnterCriticalSection(&seen_connections_cs);
+    int result = coldstore_query(&seen_history, process_path, summaries, count);
+    LeaveCriticalSection(&seen_connections_cs);
+    return result;
+}
 
-    for (int i = 0; i < seen_count; i++) {
-        memcpy(&(*connections)[i], &seen_connections[i], sizeof(NetworkConnection));
+void network_get_history_stats(ColdStoreStats* stats) {
+    memset(stats, 0, sizeof(ColdStoreStats));
+    if (!initialized) {
+        return;
     }
 
-    *count = seen_count;
-    return 0;
+    EnterCriticalSection(&seen_connections_cs);
+    coldstore_get_stats(&seen_history, stats);
+    LeaveCriticalSection(&seen_connections_cs);
 }
 
 // ============================================================================
-// Security Cache Functions
+// Single-flight Security Computation
 // ============================================================================
 
-static SecurityCacheEntry* find_in_security_cache(const char* process_path) {
-    SecurityCacheEntry* result = NULL;
+static int find_inflight(const char* process_path) {
+    for (int i = 0; i < security_inflight_count; i++) {
+        if (strcmp(security_inflight[i], process_path) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
 
-    EnterCriticalSection(&security_cache_cs);
-    for (int i = 0; i < security_cache_count; i++) {
-        if (security_cache[i].valid && strcmp(security_cache[i].process_path, process_path) == 0) {
-            result = &security_cache[i];
+// Hash + verify a binary, at most once at a time per path. Concurrent callers
+// for the same path wait for the first one and then read its cached result.
+static void compute_security_single_flight(const char* process_path, char* hash_out, TrustStatus* trust_out) {
+    EnterCriticalSection(&security_inflight_cs);
+    for (;;) {
+        if (security_cache_lookup(process_path, hash_out, SHA256_HASH_LENGTH, trust_out)) {
+            LeaveCriticalSection(&security_inflight_cs);
+            return;
+        }
+        if (find_inflight(process_path) < 0) {
             break;
         }
+        // Another thread owns this path - wait for it to publish
+        SleepConditionVariableCS(&security_inflight_cv, &security_inflight_cs, INFINITE);
     }
-    LeaveCriticalSection(&security_cache_cs);
 
-    return result;
-}
+    // We own the computation (if the table is full, just compute without dedupe)
+    BOOL registered = FALSE;
+    if (security_inflight_count < MAX_SECURITY_INFLIGHT) {
+        strncpy(security_inflight[security_inflight_count], process_path, MAX_PATH - 1);
+        security_inflight[security_inflight_count][MAX_PATH - 1] = '\0';
+        security_inflight_count++;
+        registered = TRUE;
+    }
+    LeaveCriticalSection(&security_inflight_cs);
 
-static void add_to_security_cache(const char* process_path, const char* hash, TrustStatus status) {
-    EnterCriticalSection(&security_cache_cs);
+    // Identity first: if the file is replaced while we hash, the next lookup notices
+    FileIdentity identity;
+    security_cache_get_file_identity(process_path, &identity);
 
-    if (security_cache_count >= MAX_SECURITY_CACHE) {
-        LeaveCriticalSection(&security_cache_cs);
-        return;
+    // Expensive part runs outside the lock
+    if (!network_calculate_sha256(process_path, hash_out, SHA256_HASH_LENGTH)) {
+        strcpy(hash_out, "Error");
     }
+    *trust_out = network_verify_signature(process_path);
 
-    SecurityCacheEntry* entry = &security_cache[security_cache_count];
-    strncpy(entry->process_path, process_path, MAX_PATH - 1);
-    entry->process_path[MAX_PATH - 1] = '\0';
-    strncpy(entry->sha256_hash, hash, SHA256_HASH_LENGTH - 1);
-    entry->sha256_hash[SHA256_HASH_LENGTH - 1] = '\0';
-    entry->trust_status = status;
-    entry->valid = TRUE;
+    security_cache_store(process_path, &identity, hash_out, *trust_out);
 
-    security_cache_count++;
-
-    LeaveCriticalSection(&security_cache_cs);
+    if (registered) {
+        EnterCriticalSection(&security_inflight_cs);
+        int idx = find_inflight(process_path);
+        if (idx >= 0) {
+            security_inflight_count--;
+            if (idx != security_inflight_count) {
+                memcpy(security_inflight[idx], security_inflight[security_inflight_count], MAX_PATH);
+            }
+        }
+        LeaveCriticalSection(&security_inflight_cs);
+        WakeAllConditionVariable(&security_inflight_cv);
+    }
 }
 
 // ============================================================================
 // Security & Integrity Functions
 // ============================================================================
 
+// Hash a file through read-only views of SHA256_MAP_WINDOW bytes; falls back
+// to large aligned reads when the file cannot be mapped (e.g. empty files).
 BOOL network_calculate_sha256(const char* file_path, char* hash_output, size_t hash_size) {
     if (!file_path || !hash_output || hash_size < SHA256_HASH_LENGTH) {
         return FALSE;
     }
 
+    TRACE_BEGIN_DETAIL("sha256", file_path);
+    LONG64 start = metrics_now();
+
     // Open file
     HANDLE hFile = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ,
                                 NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
     if (hFile == INVALID_HANDLE_VALUE) {
+        TRACE_END("sha256");
         return FALSE;
     }
 
     BOOL success = FALSE;
-    HCRYPTPROV hProv = 0;
-    HCRYPTHASH hHash = 0;
-    BYTE hash[32];  // SHA256 = 32 bytes
-    DWORD hashLen = 32;
-    BYTE buffer[8192];
-    DWORD bytesRead = 0;
-
-    // Acquire crypto context
-    if (!CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)) {
+    Sha256Context ctx;
+    BYTE hash[SHA256_DIGEST_SIZE];
+    LARGE_INTEGER file_size;
+
+    sha256_init(&ctx);
+
+    if (!GetFileSizeEx(hFile, &file_size)) {
         goto cleanup;
     }
 
-    // Create hash object
-    if (!CryptCreateHash(hProv, CALG_SHA_256, 0, 0, &hHash)) {
-        goto cleanup;
+    HANDLE hMapping = NULL;
+    if (file_size.QuadPart > 0) {
+        hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
     }
 
-    // Read file and hash
-    while (ReadFile(hFile, buffer, sizeof(buffer), &bytesRead, NULL) && bytesRead > 0) {
-        if (!CryptHashData(hHash, buffer, bytesRead, 0)) {
+    if (hMapping) {
+        ULONGLONG offset = 0;
+        ULONGLONG total = (ULONGLONG)file_size.QuadPart;
+        success = TRUE;
+        while (offset < total) {
+            SIZE_T window = (SIZE_T)((total - offset < SHA256_MAP_WINDOW) ? (total - offset) : SHA256_MAP_WINDOW);
+            const BYTE* view = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ,
+                                                          (DWORD)(offset >> 32), (DWORD)offset, window);
+            if (!view) {
+                success = FALSE;
+                break;
+            }
+            sha256_update(&ctx, view, window);
+            UnmapViewOfFile(view);
+            offset += window;
+        }
+        CloseHandle(hMapping);
+    } else {
+        // Page-aligned buffer keeps reads on the fast (non-buffered copy) path
+        BYTE* buffer = (BYTE*)VirtualAlloc(NULL, SHA256_READ_CHUNK, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        DWORD bytesRead = 0;
+        if (!buffer) {
             goto cleanup;
         }
+        success = TRUE;
+        for (;;) {
+            if (!ReadFile(hFile, buffer, SHA256_READ_CHUNK, &bytesRead, NULL)) {
+                success = FALSE;
+                break;
+            }
+            if (bytesRead == 0) {
+                break;
+            }
+            sha256_update(&ctx, buffer, bytesRead);
+        }
+        VirtualFree(buffer, 0, MEM_RELEASE);
     }
 
-    // Get hash value
-    if (!CryptGetHashParam(hHash, HP_HASHVAL, hash, &hashLen, 0)) {
-        goto cleanup;
-    }
-
-    // Convert to hex string
-    for (DWORD i = 0; i < hashLen; i++) {
-        sprintf(&hash_output[i * 2], "%02x", hash[i]);
+    if (success) {
+        sha256_final(&ctx, hash);
+        sha256_to_hex(hash, hash_output);
     }
-    hash_output[hashLen * 2] = '\0';
-
-    success = TRUE;
 
 cleanup:
-    if (hHash) CryptDestroyHash(hHash);
-    if (hProv) CryptReleaseContext(hProv, 0);
     CloseHandle(hFile);
+    metrics_observe_since(METRIC_HIST_SHA256, start);
+    TRACE_END("sha256");
 
     return success;
 }
 
-TrustStatus network_verify_signature(const char* file_path) {
+// Cheap structural look at the image before WinVerifyTrust: one 4KB header
+// read, plus the certificate table when there is one
+static PeSignatureKind precheck_pe_signature(const char* file_path, char* signer, size_t signer_size) {
+    signer[0] = '\0';
+
+    HANDLE hFile = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return PE_SIGNATURE_NOT_PE;
+    }
+
+    PeHeaderInfo info;
+    info.kind = PE_SIGNATURE_NOT_PE;
+    BYTE header[PE_HEADER_READ_SIZE];
+    DWORD bytes_read = 0;
+    LARGE_INTEGER file_size;
+
+    if (GetFileSizeEx(hFile, &file_size) &&
+        ReadFile(hFile, header, sizeof(header), &bytes_read, NULL)) {
+        pe_parse_headers(header, bytes_read, (uint64_t)file_size.QuadPart, &info);
+    }
+
+    // Signer name from the embedded PKCS#7, so CryptQueryObject can be skipped
+    if (info.kind == PE_SIGNATURE_EMBEDDED && info.cert_size <= PE_MAX_CERT_TABLE) {
+        BYTE* table = (BYTE*)malloc(info.cert_size);
+        LARGE_INTEGER offset;
+        offset.QuadPart = info.cert_offset;
+        if (table && SetFilePointerEx(hFile, offset, NULL, FILE_BEGIN) &&
+            ReadFile(hFile, table, info.cert_size, &bytes_read, NULL) && bytes_read == info.cert_size) {
+            pe_extract_signer(table, info.cert_size, signer, signer_size);
+        }
+        free(table);
+    }
+
+    CloseHandle(hFile);
+    return info.kind;
+}
+
+static TrustStatus verify_file_signature(const char* file_path) {
     if (!file_path || strlen(file_path) == 0) {
         return TRUST_ERROR;
     }
 
+    // The generic verify policy only looks at embedded signatures, so an
+    // empty security directory is TRUST_E_NOSIGNATURE without asking it
+    char signer[PE_MAX_SIGNER];
+    if (precheck_pe_signature(file_path, signer, sizeof(signer)) == PE_SIGNATURE_NONE) {
+        return TRUST_UNSIGNED;
+    }
+
     // Convert to wide string
     WCHAR wFilePath[MAX_PATH];
     MultiByteToWideChar(CP_ACP, 0, file_path, -1, wFilePath, MAX_PATH);
@@ -792,7 +1950,12 @@ TrustStatus network_verify_signature(const char* file_path) {
     }
 
     // If signed, check if it's Microsoft/Windows
-    if (basic_status == TRUST_VERIFIED_SIGNED) {
+    if (basic_status == TRUST_VERIFIED_SIGNED && signer[0] != '\0') {
+        if (strstr(signer, "Microsoft") != NULL || strstr(signer, "Windows") != NULL) {
+            basic_status = TRUST_MICROSOFT_SIGNED;
+        }
+    } else if (basic_status == TRUST_VERIFIED_SIGNED) {
+        // Signer not parsed from the blob (BER, SKI signer, ...): ask CryptoAPI
         // Check signer name
         HCERTSTORE hStore = NULL;
         HCRYPTMSG hMsg = NULL;
@@ -853,6 +2016,15 @@ TrustStatus network_verify_signature(const char* file_path) {
     return basic_status;
 }
 
+TrustStatus network_verify_signature(const char* file_path) {
+    TRACE_BEGIN_DETAIL("verify signature", file_path);
+    LONG64 start = metrics_now();
+    TrustStatus status = verify_file_signature(file_path);
+    metrics_observe_since(METRIC_HIST_VERIFY_SIGNATURE, start);
+    TRACE_END("verify signature");
+    return status;
+}
+
 void network_get_process_security_info(DWORD pid, char* path_buffer, size_t path_size,
                                         char* hash_buffer, size_t hash_size,
                                         TrustStatus* trust_status) {
@@ -889,41 +2061,21 @@ void network_get_process_security_info(DWORD pid, char* path_buffer, size_t path
             path_buffer[path_size - 1] = '\0';
         }
 
-        // Check cache first
-        SecurityCacheEntry* cached = find_in_security_cache(path);
-        if (cached) {
-            // Use cached results
-            if (hash_buffer && hash_size >= SHA256_HASH_LENGTH) {
-                strncpy(hash_buffer, cached->sha256_hash, hash_size - 1);
-                hash_buffer[hash_size - 1] = '\0';
-            }
-            if (trust_status) {
-                *trust_status = cached->trust_status;
-            }
-        } else {
-            // Not in cache - compute and cache
-            char computed_hash[SHA256_HASH_LENGTH];
-            TrustStatus computed_trust = TRUST_UNKNOWN;
-
-            // Calculate SHA256 hash
-            if (network_calculate_sha256(path, computed_hash, SHA256_HASH_LENGTH)) {
-                if (hash_buffer && hash_size >= SHA256_HASH_LENGTH) {
-                    strncpy(hash_buffer, computed_hash, hash_size - 1);
-                    hash_buffer[hash_size - 1] = '\0';
-                }
-            } else {
-                strcpy(computed_hash, "Error");
-                if (hash_buffer) strcpy(hash_buffer, "Error");
-            }
+        // Cached, or computed once even if many sockets of this binary ask at once
+        char computed_hash[SHA256_HASH_LENGTH];
+        TrustStatus computed_trust = TRUST_UNKNOWN;
+        compute_security_single_flight(path, computed_hash, &computed_trust);
 
-            // Verify signature (expensive operation)
-            computed_trust = network_verify_signature(path);
-            if (trust_status) {
-                *trust_status = computed_trust;
-            }
+        if (hash_buffer && hash_size >= SHA256_HASH_LENGTH) {
+            strncpy(hash_buffer, computed_hash, hash_size - 1);
+            hash_buffer[hash_size - 1] = '\0';
+        }
+        if (trust_status) {
+            *trust_status = computed_trust;
+        }
 
-            // Add to cache
-            add_to_security_cache(path, computed_hash, computed_trust);
+        if (trust_status && hash_buffer) {
+            *trust_status = apply_threat_intel(hash_buffer, FALSE, *trust_status);
         }
     }
 
@@ -960,7 +2112,7 @@ void network_get_process_path_only(DWORD pid, char* path_buffer, size_t path_siz
     CloseHandle(hProcess);
 }
 
-void network_compute_security_info_deferred(NetworkConnection* conn) {
+static void compute_security_info_deferred(NetworkConnection* conn) {
     if (!conn || conn->security_info_loaded) {
         return; // Already loaded
     }
@@ -986,53 +2138,76 @@ void network_compute_security_info_deferred(NetworkConnection* conn) {
         return;
     }
 
-    // Check for manual trust override first
-    TrustStatus override = network_get_trust_override(conn->process_path);
+    // Check cache / compute (single-flight per executable path). Overridden
+    // executables too: the hash is still shown, and hashed once per path
+    char computed_hash[SHA256_HASH_LENGTH];
+    TrustStatus computed_trust = TRUST_UNKNOWN;
+    compute_security_single_flight(conn->process_path, computed_hash, &computed_trust);
+
+    strncpy(conn->sha256_hash, computed_hash, SHA256_HASH_LENGTH - 1);
+    conn->sha256_hash[SHA256_HASH_LENGTH - 1] = '\0';
+    conn->trust_status = computed_trust;
+
+    // A manual override keeps the final word over feeds
+    TrustStatus override = trust_store_get(conn->process_path);
+    if (override == TRUST_UNKNOWN) {
+        conn->trust_status = apply_threat_intel(conn->sha256_hash, conn->threat_intel_hit, conn->trust_status);
+    }
+
+    // An override applied while this ran wins over the computed result
+    override = trust_store_get(conn->process_path);
     if (override != TRUST_UNKNOWN) {
-        // Manual override exists - use it
         conn->trust_status = override;
-        // Still compute hash for info
-        if (network_calculate_sha256(conn->process_path, conn->sha256_hash, SHA256_HASH_LENGTH)) {
-            // Hash computed
-        } else {
-            strcpy(conn->sha256_hash, "N/A");
-        }
-        conn->security_info_loaded = TRUE;
-        return;
     }
 
-    // Check cache
-    SecurityCacheEntry* cached = find_in_security_cache(conn->process_path);
-    if (cached) {
-        strncpy(conn->sha256_hash, cached->sha256_hash, SHA256_HASH_LENGTH - 1);
-        conn->sha256_hash[SHA256_HASH_LENGTH - 1] = '\0';
-        conn->trust_status = cached->trust_status;
-    } else {
-        // Compute and cache
-        char computed_hash[SHA256_HASH_LENGTH];
+    conn->security_info_loaded = TRUE;
+    metrics_counter_add(METRIC_COUNTER_SECURITY_COMPLETED, 1);
+}
 
-        if (network_calculate_sha256(conn->process_path, computed_hash, SHA256_HASH_LENGTH)) {
-            strncpy(conn->sha256_hash, computed_hash, SHA256_HASH_LENGTH - 1);
-            conn->sha256_hash[SHA256_HASH_LENGTH - 1] = '\0';
-        } else {
-            strcpy(conn->sha256_hash, "Error");
-            strcpy(computed_hash, "Error");
-        }
+void network_compute_security_info_deferred(NetworkConnection* conn) {
+    compute_security_info_deferred(conn);
+}
 
-        conn->trust_status = network_verify_signature(conn->process_path);
-        add_to_security_cache(conn->process_path, computed_hash, conn->trust_status);
-    }
+// Analyse a copy of a seen row and publish the result (the slot is marked
+// SECURITY_IN_PROGRESS, so it is not freed meanwhile). `generation` is the
+// row's security_generation read before the analysis
+static void analyse_seen_row(int index, LONG generation, const char* trace_name) {
+    NetworkConnection conn;
+    int reader = epoch_enter();
+    read_seen_row(index, &conn);
+    epoch_exit(reader);
+
+    TRACE_BEGIN_DETAIL(trace_name, conn.process_name);
+    compute_security_info_deferred(&conn);
+    SecurityResult result = {&conn, index, generation};
+    edit_seen_security(index, apply_security_result, &result);
+    TRACE_END(trace_name);
+}
 
-    conn->security_info_loaded = TRUE;
+// End of an analysis (security_queue_cs held): the slot leaves
+// SECURITY_IN_PROGRESS. Returns TRUE when an override changed the row since
+// `generation`; its own requeue was refused while the job ran, so the caller
+// queues the row again. `published`: the row got its trust result
+static BOOL finish_seen_analysis_locked(int index, LONG generation, BOOL published) {
+    security_queued_level[index] = SECURITY_NOT_QUEUED;
+    if (security_generation[index] != generation) {
+        return TRUE;  // Result dropped: a waiting visible row keeps its clock
+    }
+    if (published && security_visible_since[index] != 0) {
+        metrics_observe_since(METRIC_HIST_VISIBLE_TRUST, security_visible_since[index]);
+    }
+    security_visible_since[index] = 0;
+    return FALSE;
 }
 
-// Thread worker function for computing security info
-static DWORD WINAPI SecurityWorkerThread(LPVOID lpParam) {
-    NetworkConnection* conn = (NetworkConnection*)lpParam;
+// Pool job: compute security info for one connection in place
+static void SecurityWorkerJob(void* arg) {
+    NetworkConnection* conn = (NetworkConnection*)arg;
     if (conn) {
+        TRACE_BEGIN_DETAIL("security batch job", conn->process_name);
         network_compute_security_info_deferred(conn);
+        TRACE_END("security batch job");
     }
-    return 0;
 }
 
 void network_compute_security_batch_parallel(NetworkConnection* connections, int count) {
@@ -1040,496 +2215,366 @@ void network_compute_security_batch_parallel(NetworkConnection* connections, int
         return;
     }
 
-    #define MAX_CONCURRENT_THREADS 8
-    HANDLE threads[MAX_CONCURRENT_THREADS];
-    int active_threads = 0;
-    int processed = 0;
-
-    while (processed < count) {
-        // Launch threads up to MAX_CONCURRENT_THREADS
-        while (active_threads < MAX_CONCURRENT_THREADS && processed < count) {
-            if (!connections[processed].security_info_loaded) {
-                threads[active_threads] = CreateThread(
-                    NULL,
-                    0,
-                    SecurityWorkerThread,
-                    &connections[processed],
-                    0,
-                    NULL
-                );
-
-                if (threads[active_threads] != NULL) {
-                    active_threads++;
-                }
-            }
-            processed++;
-        }
-
-        // Wait for at least one thread to complete
-        if (active_threads > 0) {
-            WaitForMultipleObjects(active_threads, threads, TRUE, INFINITE);
+    ThreadPoolBatch batch;
+    if (!threadpool_batch_init(&batch)) {
+        return;
+    }
 
-            // Close thread handles
-            for (int i = 0; i < active_threads; i++) {
-                CloseHandle(threads[i]);
+    for (int i = 0; i < count; i++) {
+        if (!connections[i].security_info_loaded) {
+            if (!threadpool_batch_submit(&batch, SecurityWorkerJob, &connections[i])) {
+                // Pool unavailable - fall back to the calling thread
+                network_compute_security_info_deferred(&connections[i]);
             }
-            active_threads = 0;
         }
     }
-}
-
-// Find a connection in seen_connections by matching key fields
-NetworkConnection* network_find_connection(DWORD pid, DWORD remote_addr, DWORD remote_port, DWORD local_port) {
-    if (!initialized) {
-        return NULL;
-    }
 
-    EnterCriticalSection(&seen_connections_cs);
+    // Caller owns the array, so it must outlive every job
+    threadpool_batch_wait(&batch);
+}
 
-    for (int i = 0; i < seen_count; i++) {
-        if (seen_connections[i].pid == pid &&
-            seen_connections[i].remote_addr == remote_addr &&
-            seen_connections[i].remote_port == remote_port &&
-            seen_connections[i].local_port == local_port) {
+// ============================================================================
+// Prioritized Security Queue
+// ============================================================================
 
-            LeaveCriticalSection(&seen_connections_cs);
-            return &seen_connections[i];
-        }
+static BOOL process_has_exited(DWORD pid) {
+    if (pid == 0 || pid == 4) {
+        return FALSE;
     }
 
-    LeaveCriticalSection(&seen_connections_cs);
-    return NULL;
+    HANDLE hProcess = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (!hProcess) {
+        // Access denied means it exists; invalid parameter means it is gone
+        return GetLastError() == ERROR_INVALID_PARAMETER;
+    }
+    BOOL exited = (WaitForSingleObject(hProcess, 0) == WAIT_OBJECT_0);
+    CloseHandle(hProcess);
+    return exited;
 }
 
-// Compute security info for all seen connections in parallel, updating in place
-void network_compute_security_for_all_seen(void) {
-    if (!initialized) {
-        return;
+// Hand a finished row to the GUI (security_queue_cs held)
+static void push_security_done_locked(int index) {
+    if (security_done_count < MAX_CONNECTIONS) {
+        security_done[(security_done_head + security_done_count) % MAX_CONNECTIONS] = index;
+        security_done_count++;
+    } else {
+        security_done_overflow = TRUE;
     }
+}
 
-    #define MAX_CONCURRENT_THREADS 8
-    HANDLE threads[MAX_CONCURRENT_THREADS];
-    int active_threads = 0;
-    int processed = 0;
-
-    EnterCriticalSection(&seen_connections_cs);
-    int total_count = seen_count;
-    LeaveCriticalSection(&seen_connections_cs);
-
-    while (processed < total_count) {
-        // Launch threads up to MAX_CONCURRENT_THREADS
-        while (active_threads < MAX_CONCURRENT_THREADS && processed < total_count) {
-            EnterCriticalSection(&seen_connections_cs);
-            BOOL should_process = (processed < seen_count && !seen_connections[processed].security_info_loaded);
-            NetworkConnection* conn_ptr = &seen_connections[processed];
-            LeaveCriticalSection(&seen_connections_cs);
-
-            if (should_process) {
-                threads[active_threads] = CreateThread(
-                    NULL,
-                    0,
-                    SecurityWorkerThread,
-                    conn_ptr,
-                    0,
-                    NULL
-                );
-
-                if (threads[active_threads] != NULL) {
-                    active_threads++;
-                }
-            }
-            processed++;
-        }
-
-        // Wait for at least one thread to complete
-        if (active_threads > 0) {
-            WaitForMultipleObjects(active_threads, threads, TRUE, INFINITE);
+// One post per drain, however many rows finished meanwhile
+static void notify_security_window(void) {
+    if (security_notify_hwnd && InterlockedExchange(&security_notify_posted, 1) == 0) {
+        PostMessage(security_notify_hwnd, security_notify_msg, 0, 0);
+    }
+}
 
-            // Close thread handles
-            for (int i = 0; i < active_threads; i++) {
-                CloseHandle(threads[i]);
+// Pool job: take the most urgent queued connection and analyse it.
+// Exactly one job is submitted per newly queued item, so the pop never starves.
+static void SecurityQueueJob(void* arg) {
+    (void)arg;
+
+    int index = -1;
+    int level = 0;
+
+    EnterCriticalSection(&security_queue_cs);
+    for (level = 0; level < SECURITY_PRIORITY_COUNT && index < 0; level++) {
+        SecurityQueueRing* ring = &security_queues[level];
+        while (ring->count > 0) {
+            int candidate = ring->items[ring->head];
+            ring->head = (ring->head + 1) % SECURITY_QUEUE_CAPACITY;
+            ring->count--;
+            if (security_queued_level[candidate] == level) {
+                index = candidate;
+                break;
             }
-            active_threads = 0;
         }
     }
-}
-
-// ============================================================================
-// Manual Trust Override Functions - Secured with DPAPI + Atomic Writes
-// ============================================================================
-
-// Initialize secure file path in %APPDATA%\Peek\
+    level--;
+    if (index >= 0) {
+        security_queued_level[index] = SECURITY_IN_PROGRESS;
+        security_queue_pending--;
+    }
+    LeaveCriticalSection(&security_queue_cs);
 
-static void init_secure_file_path(void) {
-    if (file_path_initialized) {
+    if (index < 0) {
         return;
     }
 
-    char appdata[MAX_PATH];
-    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
-        // Create Peek subdirectory
-        snprintf(TRUST_OVERRIDES_FILE, MAX_PATH, "%s\\Peek", appdata);
-        CreateDirectoryA(TRUST_OVERRIDES_FILE, NULL);
-
-        // Full path to trust file
-        snprintf(TRUST_OVERRIDES_FILE, MAX_PATH, "%s\\Peek\\trust_overrides.dat", appdata);
-        file_path_initialized = TRUE;
-        LOG_INFO("Secure file path: %s", TRUST_OVERRIDES_FILE);
-    } else {
-        // Fallback to current directory
-        strcpy(TRUST_OVERRIDES_FILE, "trust_overrides.dat");
-        file_path_initialized = TRUE;
-        LOG_WARNING("Using fallback file path");
+    // The socket's owner is gone: nobody will look at this row's trust any time soon
+    LONG generation = security_generation[index];
+    BOOL cancelled = process_has_exited(seen_connections[index].pid);
+    if (!cancelled) {
+        // Backfill yields disk and CPU to the user (low I/O + memory priority)
+        BOOL background = (level == SECURITY_PRIORITY_BACKFILL) &&
+                          SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+        analyse_seen_row(index, generation, "security job");
+        if (background) {
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
     }
-}
-
-// Encrypt data using DPAPI (user-scoped, tied to Windows account)
-static BOOL dpapi_encrypt(const BYTE* plaintext, DWORD plaintext_len, BYTE** ciphertext, DWORD* ciphertext_len) {
-    DATA_BLOB input;
-    DATA_BLOB output;
 
-    input.pbData = (BYTE*)plaintext;
-    input.cbData = plaintext_len;
-
-    // Encrypt with DPAPI (CRYPTPROTECT_LOCAL_MACHINE for machine scope, 0 for user scope)
-    // Using user scope for better security isolation
-    if (!CryptProtectData(&input, L"PEEK Trust Overrides", NULL, NULL, NULL,
-                          CRYPTPROTECT_UI_FORBIDDEN, &output)) {
-        LOG_ERROR("DPAPI encryption failed: %lu", GetLastError());
-        return FALSE;
+    EnterCriticalSection(&security_queue_cs);
+    BOOL requeue = finish_seen_analysis_locked(index, generation, !cancelled);
+    if (!cancelled) {
+        push_security_done_locked(index);
     }
+    LeaveCriticalSection(&security_queue_cs);
 
-    *ciphertext = output.pbData;
-    *ciphertext_len = output.cbData;
-    return TRUE;
+    if (!cancelled) {
+        notify_security_window();
+    }
+    if (requeue) {
+        network_queue_security_info(index, SECURITY_PRIORITY_VISIBLE);
+    }
 }
 
-// Decrypt data using DPAPI
-static BOOL dpapi_decrypt(const BYTE* ciphertext, DWORD ciphertext_len, BYTE** plaintext, DWORD* plaintext_len) {
-    DATA_BLOB input;
-    DATA_BLOB output;
-    LPWSTR description = NULL;
-
-    input.pbData = (BYTE*)ciphertext;
-    input.cbData = ciphertext_len;
+void network_set_security_notify_window(HWND hwnd, UINT message) {
+    security_notify_msg = message;
+    security_notify_hwnd = hwnd;
+}
 
-    if (!CryptUnprotectData(&input, &description, NULL, NULL, NULL,
-                            CRYPTPROTECT_UI_FORBIDDEN, &output)) {
-        LOG_ERROR("DPAPI decryption failed: %lu", GetLastError());
+BOOL network_queue_security_info(int index, SecurityPriority priority) {
+    if (!initialized || priority < 0 || priority >= SECURITY_PRIORITY_COUNT) {
         return FALSE;
     }
 
-    if (description) {
-        LocalFree(description);
+    if (index < 0 || index >= seen_count || seen_state[index] == SEEN_SLOT_FREE) {
+        return FALSE;
     }
 
-    *plaintext = output.pbData;
-    *plaintext_len = output.cbData;
-    return TRUE;
-}
-
+    BOOL loaded = seen_security_loaded(index);
+    BOOL submit = FALSE;
+    EnterCriticalSection(&security_queue_cs);
+    int current = security_queued_level[index];
 
-// Set restrictive ACLs on trust overrides file (user only)
-static void set_file_acl_user_only(const char* file_path) {
-    // Get current user SID
-    HANDLE hToken = NULL;
-    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &hToken)) {
-        LOG_WARNING("Failed to open process token for ACL: %lu", GetLastError());
-        return;
+    // A visible row starts its time-to-trust clock, even if already queued or running
+    if (!loaded && priority == SECURITY_PRIORITY_VISIBLE && security_visible_since[index] == 0) {
+        security_visible_since[index] = metrics_now();
     }
 
-    DWORD dwSize = 0;
-    GetTokenInformation(hToken, TokenUser, NULL, 0, &dwSize);
-    PTOKEN_USER pTokenUser = (PTOKEN_USER)malloc(dwSize);
-    
-    if (!GetTokenInformation(hToken, TokenUser, pTokenUser, dwSize, &dwSize)) {
-        LOG_WARNING("Failed to get token information: %lu", GetLastError());
-        free(pTokenUser);
-        CloseHandle(hToken);
-        return;
+    if (loaded || current == SECURITY_IN_PROGRESS ||
+        (current != SECURITY_NOT_QUEUED && current <= (int)priority)) {
+        // Done, running, or already queued at least this urgently
+        LeaveCriticalSection(&security_queue_cs);
+        return current != SECURITY_NOT_QUEUED;
     }
 
-    PSID pSID = pTokenUser->User.Sid;
-    CloseHandle(hToken);
-
-    // Create ACL with only user access
-    EXPLICIT_ACCESSA ea[1];
-    ZeroMemory(&ea, sizeof(EXPLICIT_ACCESSA));
-    ea[0].grfAccessPermissions = GENERIC_READ | GENERIC_WRITE;
-    ea[0].grfAccessMode = SET_ACCESS;
-    ea[0].grfInheritance = NO_INHERITANCE;
-    ea[0].Trustee.TrusteeForm = TRUSTEE_IS_SID;
-    ea[0].Trustee.TrusteeType = TRUSTEE_IS_USER;
-    ea[0].Trustee.ptstrName = (LPSTR)pSID;
-
-    PACL pACL = NULL;
-    DWORD dwRes = SetEntriesInAclA(1, ea, NULL, &pACL);
-    
-    if (dwRes != ERROR_SUCCESS) {
-        LOG_WARNING("SetEntriesInAcl failed: %lu", dwRes);
-        free(pTokenUser);
-        return;
+    SecurityQueueRing* ring = &security_queues[priority];
+    if (ring->count == SECURITY_QUEUE_CAPACITY) {
+        if (current == SECURITY_NOT_QUEUED) {
+            security_visible_since[index] = 0;  // Nothing will publish a result
+        }
+        LeaveCriticalSection(&security_queue_cs);
+        metrics_counter_add(METRIC_COUNTER_SECURITY_REJECTED, 1);
+        return FALSE;
     }
-
-    // Apply ACL to file
-    dwRes = SetNamedSecurityInfoA(
-        (LPSTR)file_path,
-        SE_FILE_OBJECT,
-        DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION,
-        NULL,
-        NULL,
-        pACL,
-        NULL
-    );
-
-    if (dwRes != ERROR_SUCCESS) {
-        LOG_WARNING("SetNamedSecurityInfo failed: %lu", dwRes);
-    } else {
-        LOG_SUCCESS("Applied restrictive ACLs to trust file (user only)");
+    ring->items[(ring->head + ring->count) % SECURITY_QUEUE_CAPACITY] = index;
+    ring->count++;
+    security_queued_level[index] = (int)priority;
+    if (current == SECURITY_NOT_QUEUED) {
+        security_queue_pending++;
+        submit = TRUE;
     }
+    LeaveCriticalSection(&security_queue_cs);
 
-    LocalFree(pACL);
-    free(pTokenUser);
-}
-
-void network_load_trust_overrides(void) {
-    init_secure_file_path();
-
-    FILE* f = fopen(TRUST_OVERRIDES_FILE, "rb");
-    if (!f) {
-        LOG_INFO("No trust overrides file found (first run)");
-        return;
+    if (submit && !threadpool_submit(SecurityQueueJob, NULL, NULL, NULL)) {
+        // Pool not running - analyse inline so the row still resolves
+        SecurityQueueJob(NULL);
     }
+    return TRUE;
+}
 
-    // Read entire file
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (file_size < 12) {
-        LOG_ERROR("Trust overrides file too small (corrupted)");
-        fclose(f);
+void network_queue_security_for_all_seen(void) {
+    if (!initialized) {
         return;
     }
 
-    BYTE* file_data = (BYTE*)malloc(file_size);
-    if (fread(file_data, 1, file_size, f) != file_size) {
-        LOG_ERROR("Failed to read trust overrides file");
-        free(file_data);
-        fclose(f);
-        return;
+    // Free slots are refused by network_queue_security_info
+    int total_count = seen_count;
+    for (int i = 0; i < total_count; i++) {
+        network_queue_security_info(i, SECURITY_PRIORITY_BACKFILL);
     }
-    fclose(f);
+}
 
-    // Check magic + version
-    DWORD magic = *(DWORD*)&file_data[0];
-    DWORD version = *(DWORD*)&file_data[4];
-    DWORD count = *(DWORD*)&file_data[8];
+int network_drain_security_updates(int* seen_indices, int max_count, BOOL* overflowed) {
+    // Re-arm before draining so a result finishing now triggers a new post
+    InterlockedExchange(&security_notify_posted, 0);
 
-    if (magic != 0x4B454550) {
-        LOG_ERROR("Invalid trust overrides file (bad magic) - renaming to .corrupt");
-        char corrupt_path[MAX_PATH];
-        snprintf(corrupt_path, MAX_PATH, "%s.corrupt.%lu", TRUST_OVERRIDES_FILE, (unsigned long)GetTickCount());
-        MoveFileA(TRUST_OVERRIDES_FILE, corrupt_path);
-        free(file_data);
-        return;
+    int count = 0;
+    EnterCriticalSection(&security_queue_cs);
+    while (count < max_count && security_done_count > 0) {
+        seen_indices[count++] = security_done[security_done_head];
+        security_done_head = (security_done_head + 1) % MAX_CONNECTIONS;
+        security_done_count--;
     }
-
-    if (count > MAX_TRUST_OVERRIDES) {
-        LOG_ERROR("Invalid count in trust overrides file");
-        free(file_data);
-        return;
+    if (overflowed) {
+        *overflowed = security_done_overflow;
     }
+    security_done_overflow = FALSE;
+    LeaveCriticalSection(&security_queue_cs);
 
-    // DPAPI encrypted data starts at offset 12
-    BYTE* encrypted_blob = &file_data[12];
-    DWORD encrypted_size = file_size - 12;
+    return count;
+}
 
-    // Decrypt with DPAPI
-    BYTE* decrypted_data = NULL;
-    DWORD decrypted_size = 0;
+int network_get_security_queue_length(void) {
+    return security_queue_pending;
+}
 
-    if (!dpapi_decrypt(encrypted_blob, encrypted_size, &decrypted_data, &decrypted_size)) {
-        LOG_ERROR("DPAPI decryption failed - file may be corrupted or tampered");
-        char corrupt_path[MAX_PATH];
-        snprintf(corrupt_path, MAX_PATH, "%s.corrupt.%lu", TRUST_OVERRIDES_FILE, (unsigned long)GetTickCount());
-        MoveFileA(TRUST_OVERRIDES_FILE, corrupt_path);
-        free(file_data);
-        return;
+BOOL network_get_seen_connection(int index, NetworkConnection* out) {
+    if (!initialized || index < 0 || index >= seen_count) {
+        return FALSE;
     }
 
-    // Verify size matches
-    size_t expected_size = count * sizeof(TrustOverride);
-    if (decrypted_size != expected_size) {
-        LOG_ERROR("Decrypted data size mismatch (expected %zu, got %lu)", expected_size, (unsigned long)decrypted_size);
-        LocalFree(decrypted_data);
-        free(file_data);
-        return;
+    int reader = epoch_enter();
+    BOOL live = (seen_state[index] != SEEN_SLOT_FREE);
+    if (live) {
+        read_seen_row(index, out);
     }
-
-    // Load into memory
-    memcpy(trust_overrides, decrypted_data, decrypted_size);
-    trust_overrides_count = count;
-
-    LocalFree(decrypted_data);
-    free(file_data);
-
-    LOG_SUCCESS("Loaded %d trust override(s) (DPAPI verified)", trust_overrides_count);
+    epoch_exit(reader);
+    return live;
 }
 
-void network_save_trust_override(const char* process_path, TrustStatus status) {
-    if (!process_path || strlen(process_path) == 0) {
-        return;
+// Find a connection in seen_connections by matching key fields
+int network_find_connection(DWORD pid, DWORD remote_addr, DWORD remote_port, DWORD local_port, NetworkConnection* out) {
+    if (!initialized) {
+        return -1;
     }
 
-    init_secure_file_path();
+    int found = -1;
+    int slots = seen_count;
+    int reader = epoch_enter();
+    for (int i = 0; i < slots; i++) {
+        LONG state = seen_state[i];
+        if (state != SEEN_SLOT_FREE &&
+            seen_connections[i].pid == pid &&
+            seen_connections[i].remote_addr == remote_addr &&
+            seen_connections[i].remote_port == remote_port &&
+            seen_connections[i].local_port == local_port) {
 
-    // Update or add to in-memory array
-    BOOL found = FALSE;
-    for (int i = 0; i < trust_overrides_count; i++) {
-        if (trust_overrides[i].valid && strcmp(trust_overrides[i].process_path, process_path) == 0) {
-            if (status == TRUST_UNKNOWN) {
-                trust_overrides[i].valid = FALSE;
-            } else {
-                trust_overrides[i].override_status = status;
+            if (out) {
+                read_seen_row(i, out);
             }
-            found = TRUE;
-            break;
-        }
-    }
 
-    if (!found && status != TRUST_UNKNOWN && trust_overrides_count < MAX_TRUST_OVERRIDES) {
-        TrustOverride* override = &trust_overrides[trust_overrides_count];
-        strncpy(override->process_path, process_path, MAX_PATH - 1);
-        override->process_path[MAX_PATH - 1] = '\0';
-        override->override_status = status;
-        override->valid = TRUE;
-        trust_overrides_count++;
-    }
-
-    // Compact array (remove invalid)
-    int write_pos = 0;
-    for (int i = 0; i < trust_overrides_count; i++) {
-        if (trust_overrides[i].valid) {
-            if (write_pos != i) {
-                trust_overrides[write_pos] = trust_overrides[i];
+            // A lookup from the UI counts as a use for LRU eviction
+            if (state == SEEN_SLOT_CLOSED && !seen_used[i]) {
+                InterlockedExchange(&seen_used[i], 1);
+                InterlockedExchange(&seen_used_pending, 1);
             }
-            write_pos++;
+            found = i;
+            break;
         }
     }
-    trust_overrides_count = write_pos;
+    epoch_exit(reader);
+    return found;
+}
 
-    // Prepare data for encryption
-    size_t data_size = trust_overrides_count * sizeof(TrustOverride);
+// Pool job: analyse one seen row claimed by network_compute_security_for_all_seen
+static void SeenSecurityJob(void* arg) {
+    int index = (int)(INT_PTR)arg;
+    LONG generation = security_generation[index];
+    analyse_seen_row(index, generation, "security batch job");
 
-    // Encrypt with DPAPI
-    BYTE* encrypted_blob = NULL;
-    DWORD encrypted_size = 0;
+    EnterCriticalSection(&security_queue_cs);
+    BOOL requeue = finish_seen_analysis_locked(index, generation, TRUE);
+    LeaveCriticalSection(&security_queue_cs);
 
-    if (!dpapi_encrypt((BYTE*)trust_overrides, data_size, &encrypted_blob, &encrypted_size)) {
-        LOG_ERROR("DPAPI encryption failed");
-        return;
+    if (requeue) {
+        network_queue_security_info(index, SECURITY_PRIORITY_VISIBLE);
     }
+}
 
-    // Atomic write: write to temp file first
-    char temp_path[MAX_PATH];
-    snprintf(temp_path, MAX_PATH, "%s.tmp", TRUST_OVERRIDES_FILE);
-
-    FILE* f = fopen(temp_path, "wb");
-    if (!f) {
-        LOG_ERROR("Failed to create temp file for trust overrides");
-        LocalFree(encrypted_blob);
+// Compute security info for all seen connections in parallel, publishing each row's result
+void network_compute_security_for_all_seen(void) {
+    if (!initialized) {
         return;
     }
 
-    // Write: [MAGIC:4][VERSION:4][COUNT:4][DPAPI_ENCRYPTED_DATA]
-    DWORD magic = 0x4B454550;
-    DWORD version = 2; // Version 2 = DPAPI
-    DWORD count = trust_overrides_count;
-
-    fwrite(&magic, sizeof(DWORD), 1, f);
-    fwrite(&version, sizeof(DWORD), 1, f);
-    fwrite(&count, sizeof(DWORD), 1, f);
-    fwrite(encrypted_blob, 1, encrypted_size, f);
-
-    fflush(f);
-    fclose(f);
-
-    LocalFree(encrypted_blob);
+    ThreadPoolBatch batch;
+    if (!threadpool_batch_init(&batch)) {
+        return;
+    }
 
-    // Atomic replace using Windows ReplaceFile
-    if (!ReplaceFileA(TRUST_OVERRIDES_FILE, temp_path, NULL, 
-                      REPLACEFILE_WRITE_THROUGH, NULL, NULL)) {
-        // If target doesn't exist, just rename
-        if (GetLastError() == ERROR_FILE_NOT_FOUND) {
-            if (!MoveFileA(temp_path, TRUST_OVERRIDES_FILE)) {
-                LOG_ERROR("Failed to move temp file: %lu", GetLastError());
-                DeleteFileA(temp_path);
-                return;
+    // Claimed like a queue job, so the slot is not freed while analysed; rows
+    // already queued are left to the queue
+    int total_count = seen_count;
+    for (int i = 0; i < total_count; i++) {
+        BOOL claimed = FALSE;
+        EnterCriticalSection(&seen_connections_cs);
+        if (seen_state[i] != SEEN_SLOT_FREE && !seen_security_loaded(i)) {
+            EnterCriticalSection(&security_queue_cs);
+            if (security_queued_level[i] == SECURITY_NOT_QUEUED) {
+                security_queued_level[i] = SECURITY_IN_PROGRESS;
+                claimed = TRUE;
             }
-        } else {
-            LOG_ERROR("Failed to replace trust overrides file: %lu", GetLastError());
-            DeleteFileA(temp_path);
-            return;
+            LeaveCriticalSection(&security_queue_cs);
         }
-    }
-
-    // Apply restrictive ACLs
-    set_file_acl_user_only(TRUST_OVERRIDES_FILE);
-
-    LOG_SUCCESS("Saved trust override for: %s (DPAPI encrypted, atomic write, ACLs applied)", process_path);
-}
-
-TrustStatus network_get_trust_override(const char* process_path) {
-    if (!process_path || strlen(process_path) == 0) {
-        return TRUST_UNKNOWN;
-    }
+        LeaveCriticalSection(&seen_connections_cs);
 
-    for (int i = 0; i < trust_overrides_count; i++) {
-        if (trust_overrides[i].valid && strcmp(trust_overrides[i].process_path, process_path) == 0) {
-            return trust_overrides[i].override_status;
+        if (claimed && !threadpool_batch_submit(&batch, SeenSecurityJob, (void*)(INT_PTR)i)) {
+            SeenSecurityJob((void*)(INT_PTR)i);
         }
     }
 
-    return TRUST_UNKNOWN;
+    threadpool_batch_wait(&batch);
 }
 
+// ============================================================================
+// Manual Trust Overrides
+// ============================================================================
+
 void network_apply_trust_override(const char* process_path, TrustStatus status) {
     if (!process_path || strlen(process_path) == 0) {
         return;
     }
 
-    // Save to file
-    network_save_trust_override(process_path, status);
+    // Journal the change (one small encrypted append)
+    if (!trust_store_set(process_path, status)) {
+        return;
+    }
+
+    // Update cache first so a reset recomputes instead of reading the old override
+    if (status == TRUST_UNKNOWN) {
+        security_cache_remove(process_path);
+    } else {
+        security_cache_set_trust(process_path, status);
+    }
+
+    // Only this executable's rows: one published record each, no hashing or
+    // WinVerifyTrust here. A reset is recomputed by the pool.
+    int* affected = NULL;
+    int affected_count = 0;
 
-    // Apply to all seen connections with this process path
     EnterCriticalSection(&seen_connections_cs);
-    for (int i = 0; i < seen_count; i++) {
-        if (strcmp(seen_connections[i].process_path, process_path) == 0) {
-            if (status == TRUST_UNKNOWN) {
-                // Reset to auto - recompute
-                seen_connections[i].security_info_loaded = FALSE;
-                network_compute_security_info_deferred(&seen_connections[i]);
-            } else {
-                seen_connections[i].trust_status = status;
-            }
+    int image = find_process_image(process_path);
+    if (image >= 0) {
+        affected = (int*)malloc((size_t)process_images[image].connection_count * sizeof(int));
+    }
+    if (affected) {
+        for (int i = process_images[image].first_seen; i >= 0; i = seen_image_next[i]) {
+            // Before the edit: a running analysis then drops its result and requeues
+            InterlockedIncrement(&security_generation[i]);
+            edit_seen_security(i, apply_trust_override_edit, &status);
+            affected[affected_count++] = i;
         }
     }
     LeaveCriticalSection(&seen_connections_cs);
 
-    // Update cache
-    EnterCriticalSection(&security_cache_cs);
-    for (int i = 0; i < security_cache_count; i++) {
-        if (security_cache[i].valid && strcmp(security_cache[i].process_path, process_path) == 0) {
-            if (status == TRUST_UNKNOWN) {
-                // Remove from cache to force recomputation
-                security_cache[i].valid = FALSE;
-            } else {
-                security_cache[i].trust_status = status;
+    if (affected_count > 0) {
+        EnterCriticalSection(&security_queue_cs);
+        for (int i = 0; i < affected_count; i++) {
+            push_security_done_locked(affected[i]);
+        }
+        LeaveCriticalSection(&security_queue_cs);
+        notify_security_window();
+
+        if (status == TRUST_UNKNOWN) {
+            for (int i = 0; i < affected_count; i++) {
+                network_queue_security_info(affected[i], SECURITY_PRIORITY_VISIBLE);
             }
         }
     }
-    LeaveCriticalSection(&security_cache_cs);
+    free(affected);
 
-    LOG_SUCCESS("Applied trust override to all connections: %s", process_path);
+    LOG_SUCCESS("Applied trust override to %d connection(s): %s", affected_count, process_path);
 }
@@ -15,6 +15,10 @@
 #include <softpub.h>
 #include <shlobj.h>  // For SHGetFolderPath
 #include <aclapi.h>  // For ACL management
+#include "geoip.h"
+#include "trust.h"
+#include "connstore.h"
+#include "coldstore.h"
 
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "ws2_32.lib")
@@ -25,6 +29,10 @@
 #define MAX_CONNECTIONS 2000
 #define MAX_PROCESS_NAME 260
 #define SHA256_HASH_LENGTH 65  // 64 hex chars + null terminator
+#define SHA256_MAP_WINDOW (64 * 1024 * 1024)  // Bytes mapped at a time when hashing (multiple of 64 KB)
+#define SHA256_READ_CHUNK (1024 * 1024)       // Read size when a file cannot be mapped
+#define SEEN_RETENTION_DEFAULT_MS (15 * 60 * 1000)  // How long a closed connection stays in the seen store
+#define SEEN_WHEEL_TICK_MS 1000                     // Expiry resolution of the seen store
 
 typedef enum {
     CONN_OUTBOUND,  // Local initiated connection
@@ -42,16 +50,11 @@ typedef enum {
     IP_V6
 } IPVersion;
 
+// What the seen store drops to make room once all MAX_CONNECTIONS slots are used
 typedef enum {
-    TRUST_UNKNOWN = 0,            // Not yet verified (gray)
-    TRUST_MICROSOFT_SIGNED,       // Signed by Microsoft/Windows (dark green)
-    TRUST_VERIFIED_SIGNED,        // Signed by verified publisher (green)
-    TRUST_MANUAL_TRUSTED,         // Manually marked as trusted (yellow-green)
-    TRUST_UNSIGNED,               // Not signed (orange)
-    TRUST_INVALID,                // Invalid/expired signature (red)
-    TRUST_MANUAL_THREAT,          // Manually marked as threat (dark red)
-    TRUST_ERROR                   // Error during verification (gray-red)
-} TrustStatus;
+    SEEN_EVICT_LRU,             // Least recently listed by a poll, open or closed
+    SEEN_EVICT_OLDEST_CLOSED    // Earliest closed first, LRU when nothing is closed
+} SeenEvictionPolicy;
 
 typedef struct {
     DWORD local_addr;
@@ -61,6 +64,9 @@ typedef struct {
     BYTE local_addr_v6[16];   // IPv6 address
     BYTE remote_addr_v6[16];  // IPv6 address
     DWORD pid;
+    DWORD parent_pid;             // From the process snapshot, 0 when unknown
+    DWORD session_id;
+    ULONGLONG process_start_time; // FILETIME the owning process started, 0 when unknown
     DWORD state;
     ConnectionDirection direction;
     BOOL is_localhost;
@@ -71,7 +77,12 @@ typedef struct {
     char sha256_hash[SHA256_HASH_LENGTH];  // SHA256 hash of binary
     TrustStatus trust_status;     // Digital signature verification status
     BOOL security_info_loaded;    // Whether security info has been computed (for lazy loading)
+    GeoInfo geo;                  // Country/ASN of the remote endpoint (offline lookup)
+    BOOL threat_intel_hit;        // Remote address matched a local threat feed
     SYSTEMTIME timestamp;
+    ULONGLONG first_seen;         // FILETIME (UTC) of the first poll that listed it
+    ULONGLONG last_seen;          // FILETIME of the latest poll that listed it
+    ULONGLONG closed_at;          // FILETIME of the first poll it was missing from, 0 while open
 } NetworkConnection;
 
 typedef struct {
@@ -79,6 +90,9 @@ typedef struct {
     int new_connections;
     int active_connections;
     int initial_connections;
+    int closed_connections;       // In the seen store, waiting for expiry
+    int expired_connections;      // Dropped after the retention window
+    int evicted_connections;      // Dropped early to make room
 } NetworkStats;
 
 int network_init(void);
@@ -99,6 +113,46 @@ void network_get_process_name(DWORD pid, char* buffer, size_t size);
 
 int network_get_all_seen_connections(NetworkConnection** connections, int* count);
 
+// Live entries in the seen store (open and closed)
+int network_get_seen_count(void);
+
+// Seen slots handed out so far: live entries have indices below this. Slots
+// freed by expiry or eviction are reused, so an index names one entry only
+// while it is live
+int network_get_seen_slots(void);
+
+// Copy up to max_count live seen connections, scanning slots from *cursor
+// (start at 0) without locking, for chunked readers. Advances *cursor.
+// Returns the number copied, 0 at the end
+int network_copy_seen_range(int* cursor, NetworkConnection* out, int max_count);
+
+// Retention of closed connections and the eviction policy. Defaults come
+// from PEEK_SEEN_RETENTION (seconds) and PEEK_SEEN_EVICTION ("lru" or
+// "oldest-closed") at init. A new retention applies to later closes
+void network_set_seen_policy(SeenEvictionPolicy policy, DWORD retention_ms);
+
+// Closed connections compacted out of the seen store (expired or evicted),
+// one summary per (process image, remote endpoint, protocol). process_path
+// NULL = all. *summaries is malloc'd; their process_path pointers stay valid
+// until network_cleanup
+int network_query_history(const char* process_path, ColdSummary** summaries, int* count);
+
+void network_get_history_stats(ColdStoreStats* stats);
+
+// The filterable fields of a connection, as stored in the seen columns
+void network_connection_row(const NetworkConnection* conn, ConnectionRow* row);
+
+// Evaluate `filter` over the first `count` seen slots (column kernels, free
+// slots never match).
+// `mask` holds CONNSTORE_MASK_WORDS(count) words. Returns the number of matches
+int network_filter_seen(const ConnectionFilter* filter, int count, uint64_t* mask);
+
+// Attach Country/ASN of the remote endpoint (memoized, no I/O)
+void network_enrich_geo(NetworkConnection* conn);
+
+// Match the remote endpoint against the loaded threat feeds (sets threat_intel_hit)
+void network_check_threat_intel(NetworkConnection* conn);
+
 // Security & Integrity functions
 BOOL network_calculate_sha256(const char* file_path, char* hash_output, size_t hash_size);
 
@@ -111,23 +165,50 @@ void network_get_process_security_info(DWORD pid, char* path_buffer, size_t path
 // Lazy version: only gets path, defers hash/trust computation
 void network_get_process_path_only(DWORD pid, char* path_buffer, size_t path_size);
 
-// Compute security info for an existing connection (can be called later)
+// Compute security info for a caller-owned connection (seen rows go through
+// network_queue_security_info, which publishes the result)
 void network_compute_security_info_deferred(NetworkConnection* conn);
 
 // Batch compute security info for multiple connections in parallel (thread-safe)
 void network_compute_security_batch_parallel(NetworkConnection* connections, int count);
 
-// Compute security info for all seen connections in parallel, updating in place
+// Compute security info for all seen connections in parallel, publishing each row's result
 void network_compute_security_for_all_seen(void);
 
-// Find a connection in seen_connections by PID, remote addr and ports
-// Returns direct pointer to the connection in seen_connections (not a copy)
-NetworkConnection* network_find_connection(DWORD pid, DWORD remote_addr, DWORD remote_port, DWORD local_port);
+// Prioritized, non-blocking security analysis. Lower value = more urgent.
+typedef enum {
+    SECURITY_PRIORITY_VISIBLE = 0,   // Row currently on screen
+    SECURITY_PRIORITY_NEW,           // Connection just appeared
+    SECURITY_PRIORITY_BACKFILL,      // Everything else (background / low-priority I/O)
+    SECURITY_PRIORITY_COUNT
+} SecurityPriority;
+
+// Post `message` to `hwnd` when results are ready (coalesced), then drain them
+void network_set_security_notify_window(HWND hwnd, UINT message);
+
+// Queue (or bump to a more urgent level) the seen connection at `index`. Jobs
+// whose process has exited by the time they run are cancelled. Returns FALSE
+// if not queued.
+BOOL network_queue_security_info(int index, SecurityPriority priority);
+
+// Queue every seen connection that has no security info yet, as backfill
+void network_queue_security_for_all_seen(void);
+
+// Pop up to max_count seen indices whose security info was just computed.
+// Sets *overflowed when updates were dropped (caller should refresh everything).
+int network_drain_security_updates(int* seen_indices, int max_count, BOOL* overflowed);
+
+int network_get_security_queue_length(void);
+
+// Copy of the seen connection at `index` (lock-free). FALSE if out of range or free
+BOOL network_get_seen_connection(int index, NetworkConnection* out);
+
+// Find a connection in seen_connections by PID, remote addr and ports. Copies
+// it to `out` (may be NULL) and returns its seen index, or -1. The copy is a
+// consistent snapshot; the index names the entry only while it is live
+int network_find_connection(DWORD pid, DWORD remote_addr, DWORD remote_port, DWORD local_port, NetworkConnection* out);
 
-// Manual trust override management
-void network_load_trust_overrides(void);
-void network_save_trust_override(const char* process_path, TrustStatus status);
-TrustStatus network_get_trust_override(const char* process_path);
+// Manual trust override management (storage lives in trust_store.c)
 void network_apply_trust_override(const char* process_path, TrustStatus status);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "pe.h"
+#include <string.h>
+
+#define IMAGE_DOS_SIGNATURE 0x5A4D               // "MZ"
+#define IMAGE_NT_SIGNATURE 0x00004550            // "PE\0\0"
+#define IMAGE_NT_OPTIONAL_HDR32_MAGIC 0x10B
+#define IMAGE_NT_OPTIONAL_HDR64_MAGIC 0x20B
+#define IMAGE_DIRECTORY_ENTRY_SECURITY 4
+#define WIN_CERT_TYPE_PKCS_SIGNED_DATA 0x0002
+
+static uint16_t read_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ============================================================================
+// PE headers
+// ============================================================================
+
+PeSignatureKind pe_parse_headers(const uint8_t* data, size_t size, uint64_t file_size, PeHeaderInfo* info) {
+    memset(info, 0, sizeof(PeHeaderInfo));
+    info->kind = PE_SIGNATURE_NOT_PE;
+
+    if (size < 64 || read_le16(data) != IMAGE_DOS_SIGNATURE) {
+        return info->kind;
+    }
+
+    uint32_t nt_offset = read_le32(data + 0x3C);
+    if (nt_offset > size || size - nt_offset < 24 + 2) {
+        return info->kind;
+    }
+    const uint8_t* nt = data + nt_offset;
+    if (read_le32(nt) != IMAGE_NT_SIGNATURE) {
+        return info->kind;
+    }
+
+    info->machine = read_le16(nt + 4);
+    uint16_t optional_size = read_le16(nt + 20);
+    const uint8_t* opt = nt + 24;
+    size_t opt_available = size - nt_offset - 24;
+    if (optional_size > opt_available) {
+        return info->kind;
+    }
+
+    size_t dirs_offset, count_offset;
+    uint16_t magic = read_le16(opt);
+    if (magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        count_offset = 92;
+        dirs_offset = 96;
+    } else if (magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+        count_offset = 108;
+        dirs_offset = 112;
+        info->is_64bit = 1;
+    } else {
+        return info->kind;
+    }
+
+    if (optional_size < count_offset + 4) {
+        return info->kind;
+    }
+    uint32_t dir_count = read_le32(opt + count_offset);
+
+    // No security slot at all: unsigned
+    size_t security_entry = dirs_offset + IMAGE_DIRECTORY_ENTRY_SECURITY * 8;
+    if (dir_count <= IMAGE_DIRECTORY_ENTRY_SECURITY || optional_size < security_entry + 8) {
+        info->kind = PE_SIGNATURE_NONE;
+        return info->kind;
+    }
+
+    // The security directory holds a file offset, not an RVA
+    info->cert_offset = read_le32(opt + security_entry);
+    info->cert_size = read_le32(opt + security_entry + 4);
+
+    if (info->cert_offset == 0 && info->cert_size == 0) {
+        info->kind = PE_SIGNATURE_NONE;
+    } else if (info->cert_offset == 0 || info->cert_size < 8 ||
+               (uint64_t)info->cert_offset + info->cert_size > file_size) {
+        info->kind = PE_SIGNATURE_MALFORMED;
+    } else {
+        info->kind = PE_SIGNATURE_EMBEDDED;
+    }
+    return info->kind;
+}
+
+// ============================================================================
+// Minimal DER walker for PKCS#7 SignedData
+// ============================================================================
+
+typedef struct {
+    uint8_t tag;
+    const uint8_t* start;     // First byte of the tag
+    const uint8_t* content;
+    size_t length;            // Content length
+    size_t total;             // Tag + length + content
+} DerElement;
+
+static int der_next(const uint8_t** cursor, const uint8_t* end, DerElement* out) {
+    const uint8_t* p = *cursor;
+    if (p >= end || end - p < 2) {
+        return 0;
+    }
+
+    out->start = p;
+    out->tag = *p++;
+    if ((out->tag & 0x1F) == 0x1F) {
+        return 0;  // High tag numbers never appear in Authenticode structures
+    }
+
+    size_t length = *p++;
+    if (length & 0x80) {
+        int bytes = (int)(length & 0x7F);
+        // Indefinite lengths (BER) are rejected; the caller falls back to CryptoAPI
+        if (bytes == 0 || bytes > 4 || end - p < bytes) {
+            return 0;
+        }
+        length = 0;
+        while (bytes--) {
+            length = (length << 8) | *p++;
+        }
+    }
+    if ((size_t)(end - p) < length) {
+        return 0;
+    }
+
+    out->content = p;
+    out->length = length;
+    *cursor = p + length;
+    out->total = (size_t)(*cursor - out->start);
+    return 1;
+}
+
+static int der_expect(const uint8_t** cursor, const uint8_t* end, uint8_t tag, DerElement* out) {
+    return der_next(cursor, end, out) && out->tag == tag;
+}
+
+static void copy_der_string(const DerElement* value, char* out, size_t out_size) {
+    size_t n = 0;
+    if (value->tag == 0x1E) {
+        // BMPString (UTF-16BE): keep ASCII, replace the rest
+        for (size_t i = 0; i + 1 < value->length && n + 1 < out_size; i += 2) {
+            out[n++] = (value->content[i] == 0 && value->content[i + 1] >= 0x20 && value->content[i + 1] < 0x7F)
+                       ? (char)value->content[i + 1] : '?';
+        }
+    } else {
+        // UTF8String / PrintableString / IA5String / T61String
+        for (size_t i = 0; i < value->length && n + 1 < out_size; i++) {
+            out[n++] = value->content[i] >= 0x20 ? (char)value->content[i] : '?';
+        }
+    }
+    out[n] = '\0';
+}
+
+// Find an attribute (by the last byte of id-at-*: 3 = CN, 10 = O) in a Name
+static int find_name_attribute(const DerElement* name, uint8_t attribute, char* out, size_t out_size) {
+    static const uint8_t id_at[] = {0x55, 0x04};
+    const uint8_t* cursor = name->content;
+    const uint8_t* end = name->content + name->length;
+    DerElement rdn;
+
+    while (der_expect(&cursor, end, 0x31, &rdn)) {
+        const uint8_t* rdn_cursor = rdn.content;
+        const uint8_t* rdn_end = rdn.content + rdn.length;
+        DerElement atv;
+        while (der_expect(&rdn_cursor, rdn_end, 0x30, &atv)) {
+            const uint8_t* atv_cursor = atv.content;
+            const uint8_t* atv_end = atv.content + atv.length;
+            DerElement oid, value;
+            if (!der_expect(&atv_cursor, atv_end, 0x06, &oid) || !der_next(&atv_cursor, atv_end, &value)) {
+                continue;
+            }
+            if (oid.length == 3 && memcmp(oid.content, id_at, 2) == 0 && oid.content[2] == attribute) {
+                copy_der_string(&value, out, out_size);
+                return out[0] != '\0';
+            }
+        }
+    }
+    return 0;
+}
+
+// Certificate whose (issuer, serial) matches the signer; returns its subject Name
+static int find_signer_subject(const DerElement* certificates, const DerElement* issuer,
+                               const DerElement* serial, DerElement* subject) {
+    const uint8_t* cursor = certificates->content;
+    const uint8_t* end = certificates->content + certificates->length;
+    DerElement cert;
+
+    while (der_next(&cursor, end, &cert)) {
+        if (cert.tag != 0x30) {
+            continue;  // Attribute certificates etc.
+        }
+        const uint8_t* c = cert.content;
+        const uint8_t* c_end = cert.content + cert.length;
+        DerElement tbs;
+        if (!der_expect(&c, c_end, 0x30, &tbs)) {
+            continue;
+        }
+
+        const uint8_t* t = tbs.content;
+        const uint8_t* t_end = tbs.content + tbs.length;
+        DerElement field, cert_serial, algorithm, cert_issuer, validity;
+        if (!der_next(&t, t_end, &field)) {
+            continue;
+        }
+        if (field.tag == 0xA0) {
+            // Explicit version, serial follows
+            if (!der_expect(&t, t_end, 0x02, &cert_serial)) continue;
+        } else if (field.tag == 0x02) {
+            cert_serial = field;
+        } else {
+            continue;
+        }
+        if (!der_expect(&t, t_end, 0x30, &algorithm) ||
+            !der_expect(&t, t_end, 0x30, &cert_issuer) ||
+            !der_expect(&t, t_end, 0x30, &validity) ||
+            !der_expect(&t, t_end, 0x30, subject)) {
+            continue;
+        }
+
+        if (cert_serial.length == serial->length &&
+            memcmp(cert_serial.content, serial->content, serial->length) == 0 &&
+            cert_issuer.total == issuer->total &&
+            memcmp(cert_issuer.start, issuer->start, issuer->total) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int pe_extract_signer(const uint8_t* cert_table, size_t size, char* subject, size_t subject_size) {
+    static const uint8_t oid_signed_data[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02};
+
+    if (subject_size > 0) {
+        subject[0] = '\0';
+    }
+    if (!cert_table || size < 8 || subject_size == 0) {
+        return 0;
+    }
+
+    // WIN_CERTIFICATE { dwLength, wRevision, wCertificateType, bCertificate[] }
+    uint32_t length = read_le32(cert_table);
+    if (read_le16(cert_table + 6) != WIN_CERT_TYPE_PKCS_SIGNED_DATA || length < 8) {
+        return 0;
+    }
+    if (length > size) {
+        length = (uint32_t)size;
+    }
+    const uint8_t* cursor = cert_table + 8;
+    const uint8_t* end = cert_table + length;
+
+    // ContentInfo { contentType OID, [0] EXPLICIT SignedData }
+    DerElement content_info, oid, explicit0, signed_data;
+    if (!der_expect(&cursor, end, 0x30, &content_info)) return 0;
+    cursor = content_info.content;
+    end = content_info.content + content_info.length;
+    if (!der_expect(&cursor, end, 0x06, &oid) ||
+        oid.length != sizeof(oid_signed_data) || memcmp(oid.content, oid_signed_data, oid.length) != 0) {
+        return 0;
+    }
+    if (!der_expect(&cursor, end, 0xA0, &explicit0)) return 0;
+    cursor = explicit0.content;
+    end = explicit0.content + explicit0.length;
+    if (!der_expect(&cursor, end, 0x30, &signed_data)) return 0;
+
+    // SignedData { version, digestAlgorithms, contentInfo, [0] certificates, [1] crls, signerInfos }
+    cursor = signed_data.content;
+    end = signed_data.content + signed_data.length;
+    DerElement version, digest_algorithms, inner_content, element;
+    DerElement certificates = {0};
+    if (!der_expect(&cursor, end, 0x02, &version) ||
+        !der_expect(&cursor, end, 0x31, &digest_algorithms) ||
+        !der_expect(&cursor, end, 0x30, &inner_content)) {
+        return 0;
+    }
+
+    DerElement signer_infos = {0};
+    while (der_next(&cursor, end, &element)) {
+        if (element.tag == 0xA0) {
+            certificates = element;
+        } else if (element.tag == 0x31) {
+            signer_infos = element;
+        }
+    }
+    if (!certificates.content || !signer_infos.content) {
+        return 0;
+    }
+
+    // First SignerInfo { version, issuerAndSerialNumber { issuer, serial }, ... }
+    cursor = signer_infos.content;
+    end = signer_infos.content + signer_infos.length;
+    DerElement signer_info, signer_version, issuer_and_serial, issuer, serial;
+    if (!der_expect(&cursor, end, 0x30, &signer_info)) return 0;
+    cursor = signer_info.content;
+    end = signer_info.content + signer_info.length;
+    if (!der_expect(&cursor, end, 0x02, &signer_version) ||
+        !der_expect(&cursor, end, 0x30, &issuer_and_serial)) {
+        return 0;  // subjectKeyIdentifier form: leave it to CryptoAPI
+    }
+    cursor = issuer_and_serial.content;
+    end = issuer_and_serial.content + issuer_and_serial.length;
+    if (!der_expect(&cursor, end, 0x30, &issuer) || !der_expect(&cursor, end, 0x02, &serial)) {
+        return 0;
+    }
+
+    DerElement subject_name;
+    if (!find_signer_subject(&certificates, &issuer, &serial, &subject_name)) {
+        return 0;
+    }
+
+    // Same field CertGetNameString(SIMPLE_DISPLAY) prefers: CN, then O
+    return find_name_attribute(&subject_name, 3, subject, subject_size) ||
+           find_name_attribute(&subject_name, 10, subject, subject_size);
+}
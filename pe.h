@@ -0,0 +1,40 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_PE_H
+#define PEEK_PE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Portable PE / Authenticode reader (no Windows dependencies). Only looks at
+// structure - it never validates signatures; that stays with WinVerifyTrust.
+
+#define PE_HEADER_READ_SIZE 4096          // Enough for DOS + NT headers of real binaries
+#define PE_MAX_CERT_TABLE (1024 * 1024)   // Larger certificate tables are left to WinVerifyTrust
+#define PE_MAX_SIGNER 128
+
+typedef enum {
+    PE_SIGNATURE_NOT_PE = 0,    // Not a PE image (or headers beyond the buffer)
+    PE_SIGNATURE_NONE,          // Valid PE with an empty security directory
+    PE_SIGNATURE_EMBEDDED,      // Security directory present (Authenticode blob)
+    PE_SIGNATURE_MALFORMED      // Security directory points outside the file
+} PeSignatureKind;
+
+typedef struct {
+    PeSignatureKind kind;
+    uint16_t machine;
+    int is_64bit;
+    uint32_t cert_offset;       // File offset of the certificate table
+    uint32_t cert_size;
+} PeHeaderInfo;
+
+// Classify from the first bytes of a file. `file_size` is the full size on disk.
+PeSignatureKind pe_parse_headers(const uint8_t* data, size_t size, uint64_t file_size, PeHeaderInfo* info);
+
+// Extract the signer's subject CN (or O) from a certificate table
+// (WIN_CERTIFICATE + PKCS#7 SignedData). Returns 1 on success, 0 otherwise.
+int pe_extract_signer(const uint8_t* cert_table, size_t size, char* subject, size_t subject_size);
+
+#endif
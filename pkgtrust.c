@@ -0,0 +1,880 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "pkgtrust.h"
+
+#ifdef _WIN32
+
+// Authenticode covers Windows (network_verify_signature); nothing to index here
+
+int pkgtrust_init(const char* index_path) {
+    (void)index_path;
+    return -1;
+}
+
+void pkgtrust_cleanup(void) {
+}
+
+int pkgtrust_refresh(void) {
+    return 0;
+}
+
+TrustStatus pkgtrust_verify(const char* file_path) {
+    (void)file_path;
+    return TRUST_UNKNOWN;
+}
+
+int pkgtrust_lookup(const char* file_path, char* digest_hex, size_t digest_hex_size) {
+    (void)file_path;
+    (void)digest_hex;
+    (void)digest_hex_size;
+    return 0;
+}
+
+size_t pkgtrust_get_entry_count(void) {
+    return 0;
+}
+
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PKGTRUST_MAGIC "PPKG"
+#define PKGTRUST_VERSION 1
+#define PKGTRUST_DIGEST_SIZE 16     // dpkg records MD5
+#define PKGTRUST_READ_CHUNK (1024 * 1024)
+
+// ============================================================================
+// On-disk index layout: header | sources[] | entries[] | slots[] | strings
+// ============================================================================
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t source_count;
+    uint32_t entry_count;
+    uint32_t slot_count;            // Power of two, open addressing
+    uint32_t string_size;
+    int64_t db_mtime_ns;            // mtime of the dpkg info directory at build time
+    uint64_t reserved[2];
+} PkgIndexHeader;
+
+// One *.md5sums file; sources are sorted by name, their entries are contiguous
+typedef struct {
+    int64_t mtime_ns;
+    uint64_t size;
+    uint32_t name_offset;
+    uint32_t first_entry;
+    uint32_t entry_count;
+    uint32_t reserved;
+} PkgIndexSource;
+
+typedef struct {
+    uint64_t path_hash;
+    uint32_t path_offset;
+    uint32_t path_len;
+    uint8_t digest[PKGTRUST_DIGEST_SIZE];
+} PkgIndexEntry;
+
+typedef struct {
+    void* base;
+    size_t size;
+    const PkgIndexHeader* header;
+    const PkgIndexSource* sources;
+    const PkgIndexEntry* entries;
+    const uint32_t* slots;          // Entry index + 1, 0 = empty
+    const char* strings;
+} PkgIndexView;
+
+// Index being assembled in memory before it is written out
+typedef struct {
+    PkgIndexSource* sources;
+    uint32_t source_count;
+    uint32_t source_capacity;
+    PkgIndexEntry* entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    char* strings;
+    uint32_t string_size;
+    uint32_t string_capacity;
+} IndexBuilder;
+
+static PkgIndexView current_index;
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t build_lock = PTHREAD_MUTEX_INITIALIZER;
+static char index_file[PATH_MAX];
+static int initialized = 0;
+
+// ============================================================================
+// MD5 (RFC 1321) - only needed to match dpkg's recorded digests
+// ============================================================================
+
+typedef struct {
+    uint32_t state[4];
+    uint64_t total_len;
+    uint8_t buffer[64];
+    size_t buffer_len;
+} Md5Context;
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t md5_shift[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static void md5_block(uint32_t state[4], const uint8_t* block) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) |
+               ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        uint32_t t = a + f + md5_k[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += (t << md5_shift[i]) | (t >> (32 - md5_shift[i]));
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+static void md5_init(Md5Context* ctx) {
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->total_len = 0;
+    ctx->buffer_len = 0;
+}
+
+static void md5_update(Md5Context* ctx, const uint8_t* data, size_t len) {
+    ctx->total_len += len;
+
+    if (ctx->buffer_len > 0) {
+        size_t take = 64 - ctx->buffer_len;
+        if (take > len) take = len;
+        memcpy(ctx->buffer + ctx->buffer_len, data, take);
+        ctx->buffer_len += take;
+        data += take;
+        len -= take;
+        if (ctx->buffer_len < 64) return;
+        md5_block(ctx->state, ctx->buffer);
+        ctx->buffer_len = 0;
+    }
+
+    while (len >= 64) {
+        md5_block(ctx->state, data);
+        data += 64;
+        len -= 64;
+    }
+
+    memcpy(ctx->buffer, data, len);
+    ctx->buffer_len = len;
+}
+
+static void md5_final(Md5Context* ctx, uint8_t digest[PKGTRUST_DIGEST_SIZE]) {
+    uint64_t bit_len = ctx->total_len * 8;
+    uint8_t pad = 0x80;
+    md5_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->buffer_len != 56) {
+        md5_update(ctx, &pad, 1);
+    }
+    for (int i = 0; i < 8; i++) {
+        ctx->buffer[56 + i] = (uint8_t)(bit_len >> (8 * i));
+    }
+    md5_block(ctx->state, ctx->buffer);
+
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            digest[i * 4 + j] = (uint8_t)(ctx->state[i] >> (8 * j));
+        }
+    }
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static uint64_t hash_path(const char* path, size_t len) {
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)path[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int parse_hex_digest(const char* hex, uint8_t digest[PKGTRUST_DIGEST_SIZE]) {
+    for (int i = 0; i < PKGTRUST_DIGEST_SIZE * 2; i++) {
+        char c = hex[i];
+        int v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return 0;
+        if (i & 1) digest[i / 2] |= (uint8_t)v;
+        else digest[i / 2] = (uint8_t)(v << 4);
+    }
+    return 1;
+}
+
+static int64_t stat_mtime_ns(const struct stat* st) {
+    return (int64_t)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static int has_suffix(const char* name, const char* suffix) {
+    size_t n = strlen(name), s = strlen(suffix);
+    return n > s && strcmp(name + n - s, suffix) == 0;
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// ============================================================================
+// Index builder
+// ============================================================================
+
+static int builder_reserve(void** array, uint32_t* capacity, uint32_t needed, size_t item_size) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    uint32_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < needed) {
+        if (new_capacity > UINT32_MAX / 2) return -1;
+        new_capacity *= 2;
+    }
+    void* grown = realloc(*array, (size_t)new_capacity * item_size);
+    if (!grown) {
+        return -1;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int builder_add_string(IndexBuilder* b, const char* text, size_t len, uint32_t* offset) {
+    if (len >= UINT32_MAX - b->string_size ||
+        builder_reserve((void**)&b->strings, &b->string_capacity, b->string_size + (uint32_t)len + 1, 1) != 0) {
+        return -1;
+    }
+    *offset = b->string_size;
+    memcpy(b->strings + b->string_size, text, len);
+    b->strings[b->string_size + len] = '\0';
+    b->string_size += (uint32_t)len + 1;
+    return 0;
+}
+
+static int builder_add_entry(IndexBuilder* b, const char* path, size_t len, const uint8_t* digest) {
+    if (builder_reserve((void**)&b->entries, &b->entry_capacity, b->entry_count + 1, sizeof(PkgIndexEntry)) != 0) {
+        return -1;
+    }
+    PkgIndexEntry* entry = &b->entries[b->entry_count];
+    if (builder_add_string(b, path, len, &entry->path_offset) != 0) {
+        return -1;
+    }
+    entry->path_hash = hash_path(path, len);
+    entry->path_len = (uint32_t)len;
+    memcpy(entry->digest, digest, PKGTRUST_DIGEST_SIZE);
+    b->entry_count++;
+    return 0;
+}
+
+static void builder_free(IndexBuilder* b) {
+    free(b->sources);
+    free(b->entries);
+    free(b->strings);
+    memset(b, 0, sizeof(IndexBuilder));
+}
+
+// "<32 hex>  relative/path" per line; paths are stored absolute.
+// Returns 0, -1 if the file cannot be opened, -2 when out of memory
+static int parse_md5sums(IndexBuilder* b, int dir_fd, const char* name) {
+    int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    FILE* file = fdopen(fd, "r");
+    if (!file) {
+        close(fd);
+        return -1;
+    }
+
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_len;
+    char path[PATH_MAX];
+    int result = 0;
+
+    while ((line_len = getline(&line, &line_capacity, file)) > 0) {
+        while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r')) {
+            line[--line_len] = '\0';
+        }
+
+        uint8_t digest[PKGTRUST_DIGEST_SIZE];
+        if (line_len < PKGTRUST_DIGEST_SIZE * 2 + 3 || !parse_hex_digest(line, digest) ||
+            line[PKGTRUST_DIGEST_SIZE * 2] != ' ') {
+            continue;
+        }
+
+        const char* relative = line + PKGTRUST_DIGEST_SIZE * 2;
+        while (*relative == ' ' || *relative == '*') relative++;
+        if (*relative == '/') relative++;
+
+        int path_len = snprintf(path, sizeof(path), "/%s", relative);
+        if (path_len <= 1 || path_len >= (int)sizeof(path)) {
+            continue;
+        }
+        if (builder_add_entry(b, path, (size_t)path_len, digest) != 0) {
+            result = -2;
+            break;
+        }
+    }
+
+    free(line);
+    fclose(file);
+    return result;
+}
+
+// Source from the previous index with the same file name (sources are sorted)
+static const PkgIndexSource* find_old_source(const PkgIndexView* old, const char* name) {
+    if (!old || !old->header) {
+        return NULL;
+    }
+    uint32_t low = 0, high = old->header->source_count;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int cmp = strcmp(old->strings + old->sources[mid].name_offset, name);
+        if (cmp == 0) return &old->sources[mid];
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return NULL;
+}
+
+static int copy_old_entries(IndexBuilder* b, const PkgIndexView* old, const PkgIndexSource* source) {
+    for (uint32_t i = 0; i < source->entry_count; i++) {
+        const PkgIndexEntry* entry = &old->entries[source->first_entry + i];
+        if (builder_add_entry(b, old->strings + entry->path_offset, entry->path_len, entry->digest) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int write_index(const IndexBuilder* b, int64_t db_mtime_ns) {
+    uint32_t slot_count = 16;
+    while (slot_count < b->entry_count * 2) {
+        slot_count *= 2;
+    }
+    uint32_t* slots = (uint32_t*)calloc(slot_count, sizeof(uint32_t));
+    if (!slots) {
+        return -1;
+    }
+
+    // Later sources win for paths listed twice (diversions, file moves)
+    uint32_t mask = slot_count - 1;
+    for (uint32_t i = 0; i < b->entry_count; i++) {
+        const PkgIndexEntry* entry = &b->entries[i];
+        uint32_t slot = (uint32_t)entry->path_hash & mask;
+        while (slots[slot] != 0) {
+            const PkgIndexEntry* other = &b->entries[slots[slot] - 1];
+            if (other->path_hash == entry->path_hash && other->path_len == entry->path_len &&
+                memcmp(b->strings + other->path_offset, b->strings + entry->path_offset, entry->path_len) == 0) {
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i + 1;
+    }
+
+    PkgIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PKGTRUST_MAGIC, 4);
+    header.version = PKGTRUST_VERSION;
+    header.source_count = b->source_count;
+    header.entry_count = b->entry_count;
+    header.slot_count = slot_count;
+    header.string_size = b->string_size;
+    header.db_mtime_ns = db_mtime_ns;
+
+    // Write beside the live file and rename, so a mapped index is never torn
+    char temp_file[PATH_MAX + 8];
+    snprintf(temp_file, sizeof(temp_file), "%s.tmp", index_file);
+    FILE* file = fopen(temp_file, "wb");
+    if (!file) {
+        free(slots);
+        return -1;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(b->sources, sizeof(PkgIndexSource), b->source_count, file) == b->source_count &&
+             fwrite(b->entries, sizeof(PkgIndexEntry), b->entry_count, file) == b->entry_count &&
+             fwrite(slots, sizeof(uint32_t), slot_count, file) == slot_count &&
+             fwrite(b->strings, 1, b->string_size, file) == b->string_size;
+    ok = (fclose(file) == 0) && ok;
+    free(slots);
+
+    if (!ok || rename(temp_file, index_file) != 0) {
+        unlink(temp_file);
+        return -1;
+    }
+    return 0;
+}
+
+// Sources that could not be read last time (mtime_ns -1, no entries)
+static int has_unreadable_source(const PkgIndexView* old) {
+    for (uint32_t i = 0; i < old->header->source_count; i++) {
+        if (old->sources[i].mtime_ns == -1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Rebuild from the dpkg database, reusing entries of unchanged sources.
+// Returns 1 if a new index was written, 0 if `old` is current, -1 on error
+static int rebuild_index(const PkgIndexView* old) {
+    struct stat dir_stat;
+    if (stat(PKGTRUST_DPKG_INFO_DIR, &dir_stat) != 0) {
+        return -1;
+    }
+    // dpkg replaces list files by rename, which always touches the directory.
+    // Unreadable lists are retried even so; only their success is a change
+    int changed = 1;
+    if (old && old->header && old->header->db_mtime_ns == stat_mtime_ns(&dir_stat)) {
+        if (!has_unreadable_source(old)) {
+            return 0;
+        }
+        changed = 0;
+    }
+
+    DIR* dir = opendir(PKGTRUST_DPKG_INFO_DIR);
+    if (!dir) {
+        return -1;
+    }
+
+    char** names = NULL;
+    size_t name_count = 0, name_capacity = 0;
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (!has_suffix(item->d_name, ".md5sums")) {
+            continue;
+        }
+        if (name_count == name_capacity) {
+            size_t grown_capacity = name_capacity ? name_capacity * 2 : 256;
+            char** grown = (char**)realloc(names, grown_capacity * sizeof(char*));
+            if (!grown) break;
+            names = grown;
+            name_capacity = grown_capacity;
+        }
+        names[name_count] = strdup(item->d_name);
+        if (names[name_count]) name_count++;
+    }
+    qsort(names, name_count, sizeof(char*), compare_names);
+
+    IndexBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    int dir_fd = dirfd(dir);
+    int result = 0;
+
+    for (size_t i = 0; i < name_count && result == 0; i++) {
+        struct stat file_stat;
+        if (fstatat(dir_fd, names[i], &file_stat, 0) != 0) {
+            continue;
+        }
+        if (builder_reserve((void**)&builder.sources, &builder.source_capacity,
+                            builder.source_count + 1, sizeof(PkgIndexSource)) != 0) {
+            result = -1;
+            break;
+        }
+
+        PkgIndexSource* source = &builder.sources[builder.source_count];
+        memset(source, 0, sizeof(PkgIndexSource));
+        source->mtime_ns = stat_mtime_ns(&file_stat);
+        source->size = (uint64_t)file_stat.st_size;
+        source->first_entry = builder.entry_count;
+        if (builder_add_string(&builder, names[i], strlen(names[i]), &source->name_offset) != 0) {
+            result = -1;
+            break;
+        }
+
+        const PkgIndexSource* previous = find_old_source(old, names[i]);
+        if (previous && previous->mtime_ns == source->mtime_ns && previous->size == source->size) {
+            result = copy_old_entries(&builder, old, previous);
+        } else {
+            int parsed = parse_md5sums(&builder, dir_fd, names[i]);
+            if (parsed == -2) {
+                result = -1;
+                break;
+            }
+            if (parsed == -1) {
+                source->mtime_ns = -1;  // Unreadable: no entries, re-read next refresh
+            } else {
+                changed = 1;
+            }
+        }
+
+        source->entry_count = builder.entry_count - source->first_entry;
+        builder.source_count++;
+    }
+
+    if (result == 0 && changed) {
+        result = write_index(&builder, stat_mtime_ns(&dir_stat)) == 0 ? 1 : -1;
+    }
+
+    builder_free(&builder);
+    for (size_t i = 0; i < name_count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    closedir(dir);
+    return result;
+}
+
+// ============================================================================
+// Mapping
+// ============================================================================
+
+static int map_index(PkgIndexView* view) {
+    memset(view, 0, sizeof(PkgIndexView));
+
+    int fd = open(index_file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PkgIndexHeader)) {
+        close(fd);
+        return -1;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    const PkgIndexHeader* header = (const PkgIndexHeader*)base;
+    uint64_t expected = sizeof(PkgIndexHeader) +
+                        (uint64_t)header->source_count * sizeof(PkgIndexSource) +
+                        (uint64_t)header->entry_count * sizeof(PkgIndexEntry) +
+                        (uint64_t)header->slot_count * sizeof(uint32_t) +
+                        header->string_size;
+    if (memcmp(header->magic, PKGTRUST_MAGIC, 4) != 0 || header->version != PKGTRUST_VERSION ||
+        header->slot_count == 0 || (header->slot_count & (header->slot_count - 1)) != 0 ||
+        header->slot_count < header->entry_count || expected != (uint64_t)st.st_size) {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+
+    const uint8_t* cursor = (const uint8_t*)base + sizeof(PkgIndexHeader);
+    view->base = base;
+    view->size = (size_t)st.st_size;
+    view->header = header;
+    view->sources = (const PkgIndexSource*)cursor;
+    cursor += (size_t)header->source_count * sizeof(PkgIndexSource);
+    view->entries = (const PkgIndexEntry*)cursor;
+    cursor += (size_t)header->entry_count * sizeof(PkgIndexEntry);
+    view->slots = (const uint32_t*)cursor;
+    cursor += (size_t)header->slot_count * sizeof(uint32_t);
+    view->strings = (const char*)cursor;
+    return 0;
+}
+
+static void unmap_index(PkgIndexView* view) {
+    if (view->base) {
+        munmap(view->base, view->size);
+    }
+    memset(view, 0, sizeof(PkgIndexView));
+}
+
+// Caller holds index_lock (shared)
+static const PkgIndexEntry* find_entry(const char* path) {
+    const PkgIndexView* view = &current_index;
+    if (!view->header || view->header->entry_count == 0) {
+        return NULL;
+    }
+
+    size_t len = strlen(path);
+    uint64_t hash = hash_path(path, len);
+    uint32_t mask = view->header->slot_count - 1;
+    uint32_t slot = (uint32_t)hash & mask;
+
+    for (uint32_t probes = 0; probes <= mask; probes++) {
+        uint32_t index = view->slots[slot];
+        if (index == 0 || index > view->header->entry_count) {
+            return NULL;
+        }
+        const PkgIndexEntry* entry = &view->entries[index - 1];
+        if (entry->path_hash == hash && entry->path_len == len &&
+            entry->path_offset + (uint64_t)len < view->header->string_size &&
+            memcmp(view->strings + entry->path_offset, path, len) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+// Exact path first, then its merged-/usr alias: such systems run /usr/bin/x
+// for packages listing /bin/x, and the other way round
+static int lookup_recorded(const char* path, uint8_t digest[PKGTRUST_DIGEST_SIZE]) {
+    char alias[PATH_MAX];
+    const char* other = NULL;
+    if (strncmp(path, "/usr/", 5) == 0) {
+        other = path + 4;
+    } else if (snprintf(alias, sizeof(alias), "/usr%s", path) < (int)sizeof(alias)) {
+        other = alias;
+    }
+
+    pthread_rwlock_rdlock(&index_lock);
+    const PkgIndexEntry* entry = find_entry(path);
+    if (!entry && other) {
+        entry = find_entry(other);
+    }
+    if (entry) {
+        memcpy(digest, entry->digest, PKGTRUST_DIGEST_SIZE);
+    }
+    pthread_rwlock_unlock(&index_lock);
+    return entry != NULL;
+}
+
+// The path as given, then with its symlinks resolved: packages list the
+// target of alternatives and compiler links (/usr/bin/gcc -> gcc-12)
+static int lookup_digest(const char* path, uint8_t digest[PKGTRUST_DIGEST_SIZE]) {
+    if (lookup_recorded(path, digest)) {
+        return 1;
+    }
+
+    char resolved[PATH_MAX];
+    if (!realpath(path, resolved) || strcmp(resolved, path) == 0) {
+        return 0;
+    }
+    return lookup_recorded(resolved, digest);
+}
+
+static int hash_file(const char* path, uint8_t digest[PKGTRUST_DIGEST_SIZE]) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    Md5Context ctx;
+    md5_init(&ctx);
+    int result = 0;
+
+    void* mapped = st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (mapped != MAP_FAILED) {
+        madvise(mapped, (size_t)st.st_size, MADV_SEQUENTIAL);
+        md5_update(&ctx, (const uint8_t*)mapped, (size_t)st.st_size);
+        munmap(mapped, (size_t)st.st_size);
+    } else {
+        // Empty files, or files mmap refuses (procfs, pipes)
+        uint8_t* buffer = (uint8_t*)malloc(PKGTRUST_READ_CHUNK);
+        ssize_t n;
+        if (!buffer) {
+            result = -1;
+        } else {
+            while ((n = read(fd, buffer, PKGTRUST_READ_CHUNK)) > 0) {
+                md5_update(&ctx, buffer, (size_t)n);
+            }
+            if (n < 0) result = -1;
+            free(buffer);
+        }
+    }
+
+    close(fd);
+    if (result == 0) {
+        md5_final(&ctx, digest);
+    }
+    return result;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+static int default_index_path(char* out, size_t out_size) {
+    char dir[PATH_MAX];
+    const char* cache = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    if (cache && cache[0] == '/') {
+        snprintf(dir, sizeof(dir), "%s/peek", cache);
+    } else if (home && home[0] == '/') {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+        mkdir(dir, 0700);
+        snprintf(dir, sizeof(dir), "%s/.cache/peek", home);
+    } else {
+        return -1;
+    }
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    int written = snprintf(out, out_size, "%s/%s", dir, PKGTRUST_INDEX_NAME);
+    return (written > 0 && (size_t)written < out_size) ? 0 : -1;
+}
+
+int pkgtrust_init(const char* index_path) {
+    if (initialized) {
+        return 0;
+    }
+
+    if (index_path) {
+        if (strlen(index_path) >= sizeof(index_file)) return -1;
+        strcpy(index_file, index_path);
+    } else if (default_index_path(index_file, sizeof(index_file)) != 0) {
+        return -1;
+    }
+
+    // Existing index is used as the base of an incremental refresh
+    map_index(&current_index);
+    initialized = 1;
+
+    if (pkgtrust_refresh() < 0 && !current_index.header) {
+        initialized = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void pkgtrust_cleanup(void) {
+    pthread_mutex_lock(&build_lock);
+    pthread_rwlock_wrlock(&index_lock);
+    unmap_index(&current_index);
+    initialized = 0;
+    pthread_rwlock_unlock(&index_lock);
+    pthread_mutex_unlock(&build_lock);
+}
+
+int pkgtrust_refresh(void) {
+    if (!initialized) {
+        return -1;
+    }
+
+    // Only the builder swaps the mapping, so it can read current_index unlocked
+    pthread_mutex_lock(&build_lock);
+    int result = rebuild_index(&current_index);
+    if (result == 1) {
+        PkgIndexView fresh;
+        if (map_index(&fresh) == 0) {
+            PkgIndexView stale;
+            pthread_rwlock_wrlock(&index_lock);
+            stale = current_index;
+            current_index = fresh;
+            pthread_rwlock_unlock(&index_lock);
+            unmap_index(&stale);
+        } else {
+            result = -1;
+        }
+    }
+    pthread_mutex_unlock(&build_lock);
+    return result;
+}
+
+TrustStatus pkgtrust_verify(const char* file_path) {
+    if (!file_path || file_path[0] != '/') {
+        return TRUST_ERROR;
+    }
+
+    uint8_t expected[PKGTRUST_DIGEST_SIZE];
+    if (!lookup_digest(file_path, expected)) {
+        return TRUST_UNSIGNED;
+    }
+
+    uint8_t actual[PKGTRUST_DIGEST_SIZE];
+    if (hash_file(file_path, actual) != 0) {
+        return TRUST_ERROR;
+    }
+    return memcmp(expected, actual, PKGTRUST_DIGEST_SIZE) == 0 ? TRUST_VERIFIED_SIGNED : TRUST_INVALID;
+}
+
+int pkgtrust_lookup(const char* file_path, char* digest_hex, size_t digest_hex_size) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t digest[PKGTRUST_DIGEST_SIZE];
+
+    if (!file_path || !lookup_digest(file_path, digest)) {
+        return 0;
+    }
+    if (digest_hex && digest_hex_size > PKGTRUST_DIGEST_SIZE * 2) {
+        for (int i = 0; i < PKGTRUST_DIGEST_SIZE; i++) {
+            digest_hex[i * 2] = hex[digest[i] >> 4];
+            digest_hex[i * 2 + 1] = hex[digest[i] & 0x0F];
+        }
+        digest_hex[PKGTRUST_DIGEST_SIZE * 2] = '\0';
+    }
+    return 1;
+}
+
+size_t pkgtrust_get_entry_count(void) {
+    pthread_rwlock_rdlock(&index_lock);
+    size_t count = current_index.header ? current_index.header->entry_count : 0;
+    pthread_rwlock_unlock(&index_lock);
+    return count;
+}
+
+#endif
@@ -0,0 +1,49 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_PKGTRUST_H
+#define PEEK_PKGTRUST_H
+
+#include <stddef.h>
+#include "trust.h"
+
+// Linux trust verification: "does this binary match the file its distro
+// package installed?". The dpkg file-checksum database
+// (/var/lib/dpkg/info/*.md5sums) is compiled into one mmap-able index
+// (path -> expected digest) that is refreshed incrementally: only package
+// lists whose mtime/size changed are re-read. On Windows every call is a
+// no-op returning TRUST_UNKNOWN.
+//
+// Result mapping:
+//   TRUST_VERIFIED_SIGNED  path is owned by a package and the digest matches
+//   TRUST_INVALID          path is owned by a package but the file was modified
+//   TRUST_UNSIGNED         path is not owned by any package
+//   TRUST_ERROR            file could not be read
+
+#ifndef PKGTRUST_DPKG_INFO_DIR
+#define PKGTRUST_DPKG_INFO_DIR "/var/lib/dpkg/info"
+#endif
+#define PKGTRUST_INDEX_NAME "pkgtrust.idx"
+
+// Load the index (building or refreshing it as needed).
+// `index_path` NULL -> $XDG_CACHE_HOME/peek/pkgtrust.idx (or ~/.cache/peek/...)
+// Returns 0 on success, -1 on error
+int pkgtrust_init(const char* index_path);
+
+void pkgtrust_cleanup(void);
+
+// Re-read package lists that changed since the index was built.
+// Returns 1 if the index was rebuilt, 0 if it was current, -1 on error
+int pkgtrust_refresh(void);
+
+// One index lookup plus one file hash. A path no package lists is looked up
+// again with its symlinks resolved (and its merged-/usr alias)
+TrustStatus pkgtrust_verify(const char* file_path);
+
+// Expected digest (lowercase hex) recorded for `file_path`; returns 1 if owned by a package
+int pkgtrust_lookup(const char* file_path, char* digest_hex, size_t digest_hex_size);
+
+size_t pkgtrust_get_entry_count(void);
+
+#endif
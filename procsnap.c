@@ -0,0 +1,378 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "procsnap.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// PID Tables
+// ============================================================================
+
+typedef struct {
+    ProcessInfo* entries;
+    int count;
+    int capacity;
+    int* slots;                     // Open addressing over entry indices, -1 = empty
+    int slot_count;                 // Power of two, at most half full
+} ProcessTable;
+
+// tables[current_table] is the snapshot; the other one is rebuilt by the next refresh
+static ProcessTable tables[2];
+static int current_table = 0;
+
+static uint32_t hash_pid(uint32_t pid) {
+    return pid * 2654435761u;
+}
+
+// New zeroed entry at the end of the table, NULL when out of memory
+static ProcessInfo* table_append(ProcessTable* table) {
+    if (table->count == table->capacity) {
+        int capacity = table->capacity ? table->capacity * 2 : 512;
+        ProcessInfo* entries = (ProcessInfo*)realloc(table->entries, (size_t)capacity * sizeof(ProcessInfo));
+        if (!entries) {
+            return NULL;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    ProcessInfo* info = &table->entries[table->count++];
+    memset(info, 0, sizeof(*info));
+    return info;
+}
+
+static int table_index(ProcessTable* table) {
+    int slot_count = 1024;
+    while (slot_count < table->count * 2) {
+        slot_count *= 2;
+    }
+    if (slot_count != table->slot_count) {
+        int* slots = (int*)realloc(table->slots, (size_t)slot_count * sizeof(int));
+        if (!slots) {
+            return -1;
+        }
+        table->slots = slots;
+        table->slot_count = slot_count;
+    }
+
+    memset(table->slots, 0xff, (size_t)table->slot_count * sizeof(int));
+    uint32_t mask = (uint32_t)table->slot_count - 1;
+    for (int i = 0; i < table->count; i++) {
+        uint32_t slot = hash_pid(table->entries[i].pid) & mask;
+        while (table->slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        table->slots[slot] = i;
+    }
+    return 0;
+}
+
+static const ProcessInfo* table_find(const ProcessTable* table, uint32_t pid) {
+    if (table->slot_count == 0) {
+        return NULL;
+    }
+
+    uint32_t mask = (uint32_t)table->slot_count - 1;
+    for (uint32_t slot = hash_pid(pid) & mask; table->slots[slot] >= 0; slot = (slot + 1) & mask) {
+        const ProcessInfo* info = &table->entries[table->slots[slot]];
+        if (info->pid == pid) {
+            return info;
+        }
+    }
+    return NULL;
+}
+
+static void table_free(ProcessTable* table) {
+    free(table->entries);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+#ifdef _WIN32
+
+// ============================================================================
+// Windows: SystemProcessInformation
+// ============================================================================
+
+#include <windows.h>
+#include <winternl.h>
+
+#define PROCSNAP_STATUS_INFO_LENGTH_MISMATCH ((NTSTATUS)0xC0000004L)
+
+// Leading fields of SYSTEM_PROCESS_INFORMATION. winternl.h declares the
+// creation time and the parent PID as reserved members
+typedef struct {
+    ULONG NextEntryOffset;
+    ULONG NumberOfThreads;
+    LARGE_INTEGER WorkingSetPrivateSize;
+    ULONG HardFaultCount;
+    ULONG NumberOfThreadsHighWatermark;
+    ULONGLONG CycleTime;
+    LARGE_INTEGER CreateTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER KernelTime;
+    UNICODE_STRING ImageName;
+    LONG BasePriority;
+    HANDLE UniqueProcessId;
+    HANDLE InheritedFromUniqueProcessId;
+    ULONG HandleCount;
+    ULONG SessionId;
+} ProcessRecord;
+
+// Reused across refreshes, grown when the process list outgrows it
+static BYTE* query_buffer = NULL;
+static ULONG query_buffer_size = 0;
+
+static int query_process_records(void) {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        ULONG needed = 0;
+        NTSTATUS status = NtQuerySystemInformation(SystemProcessInformation, query_buffer, query_buffer_size, &needed);
+        if (status >= 0) {
+            return 0;
+        }
+        if (status != PROCSNAP_STATUS_INFO_LENGTH_MISMATCH) {
+            return -1;
+        }
+
+        // Processes can start before the next call: leave some headroom
+        ULONG size = needed + needed / 4 + 16384;
+        BYTE* buffer = (BYTE*)malloc(size);
+        if (!buffer) {
+            return -1;
+        }
+        free(query_buffer);
+        query_buffer = buffer;
+        query_buffer_size = size;
+    }
+    return -1;
+}
+
+static void read_image_path(uint32_t pid, char* path, size_t size) {
+    path[0] = '\0';
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) {
+        return;
+    }
+
+    DWORD length = (DWORD)size;
+    if (!QueryFullProcessImageNameA(process, 0, path, &length)) {
+        path[0] = '\0';
+    }
+    CloseHandle(process);
+}
+
+static int scan_processes(ProcessTable* next, const ProcessTable* previous) {
+    if (query_process_records() != 0) {
+        return -1;
+    }
+
+    const BYTE* cursor = query_buffer;
+    for (;;) {
+        const ProcessRecord* record = (const ProcessRecord*)cursor;
+        ProcessInfo* info = table_append(next);
+        if (!info) {
+            return -1;
+        }
+
+        info->pid = (uint32_t)(ULONG_PTR)record->UniqueProcessId;
+        info->parent_pid = (uint32_t)(ULONG_PTR)record->InheritedFromUniqueProcessId;
+        info->session_id = record->SessionId;
+        info->start_time = (uint64_t)record->CreateTime.QuadPart;
+
+        if (record->ImageName.Buffer && record->ImageName.Length > 0) {
+            int length = WideCharToMultiByte(CP_ACP, 0, record->ImageName.Buffer, record->ImageName.Length / sizeof(WCHAR),
+                                             info->name, PROCSNAP_NAME_MAX - 1, NULL, NULL);
+            info->name[length > 0 ? length : 0] = '\0';
+        } else if (info->pid == 0) {
+            strcpy(info->name, "System Idle Process");
+        }
+
+        // Paths cost an OpenProcess each: only for processes new since the
+        // last refresh (denied ones are not retried while they live)
+        const ProcessInfo* known = table_find(previous, info->pid);
+        if (known && known->start_time == info->start_time) {
+            memcpy(info->path, known->path, sizeof(info->path));
+        } else if (info->pid != 0 && info->pid != 4) {
+            read_image_path(info->pid, info->path, sizeof(info->path));
+        }
+
+        if (record->NextEntryOffset == 0) {
+            break;
+        }
+        cursor += record->NextEntryOffset;
+    }
+    return 0;
+}
+
+int procsnap_init(void) {
+    return 0;
+}
+
+static void release_platform(void) {
+    free(query_buffer);
+    query_buffer = NULL;
+    query_buffer_size = 0;
+}
+
+#else
+
+// ============================================================================
+// Linux: /proc scan
+// ============================================================================
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+// pid, comm, parent, session and start time from /proc/<pid>/stat.
+// Returns -1 when the process exited during the scan
+static int read_stat(uint32_t pid, ProcessInfo* info) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    char buffer[1024];
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (size <= 0) {
+        return -1;
+    }
+    buffer[size] = '\0';
+
+    // comm may itself contain ')' and spaces: it runs to the last ')'
+    char* open_paren = strchr(buffer, '(');
+    char* close_paren = strrchr(buffer, ')');
+    if (!open_paren || !close_paren || close_paren < open_paren) {
+        return -1;
+    }
+
+    size_t length = (size_t)(close_paren - open_paren - 1);
+    if (length >= PROCSNAP_NAME_MAX) {
+        length = PROCSNAP_NAME_MAX - 1;
+    }
+    memcpy(info->name, open_paren + 1, length);
+    info->name[length] = '\0';
+
+    // Fields 3 (state) to 22 (starttime), see proc(5)
+    unsigned int parent = 0;
+    int session = 0;
+    unsigned long long start = 0;
+    if (sscanf(close_paren + 1, " %*c %u %*d %d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+               &parent, &session, &start) != 3) {
+        return -1;
+    }
+
+    info->pid = pid;
+    info->parent_pid = parent;
+    info->session_id = (uint32_t)session;
+    info->start_time = start;
+    return 0;
+}
+
+static int scan_processes(ProcessTable* next, const ProcessTable* previous) {
+    DIR* dir = opendir("/proc");
+    if (!dir) {
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        char* end = NULL;
+        unsigned long pid = strtoul(entry->d_name, &end, 10);
+        if (*end != '\0') {
+            continue;
+        }
+
+        ProcessInfo* info = table_append(next);
+        if (!info) {
+            closedir(dir);
+            return -1;
+        }
+        if (read_stat((uint32_t)pid, info) != 0) {
+            next->count--;
+            continue;
+        }
+
+        // comm is truncated to 15 characters; the exe link has the real
+        // name. Read once per process (same pid and start time)
+        const ProcessInfo* known = table_find(previous, info->pid);
+        if (known && known->start_time == info->start_time) {
+            memcpy(info->name, known->name, sizeof(info->name));
+            memcpy(info->path, known->path, sizeof(info->path));
+            continue;
+        }
+
+        char link[64];
+        snprintf(link, sizeof(link), "/proc/%lu/exe", pid);
+        ssize_t length = readlink(link, info->path, sizeof(info->path) - 1);
+        if (length <= 0) {
+            info->path[0] = '\0';
+            continue;
+        }
+        info->path[length] = '\0';
+
+        const char* base = strrchr(info->path, '/');
+        base = base ? base + 1 : info->path;
+        if (base[0]) {
+            snprintf(info->name, sizeof(info->name), "%s", base);
+        }
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+int procsnap_init(void) {
+    return (access("/proc/self/stat", R_OK) == 0) ? 0 : -1;
+}
+
+static void release_platform(void) {
+}
+
+#endif
+
+// ============================================================================
+// Snapshot
+// ============================================================================
+
+void procsnap_cleanup(void) {
+    table_free(&tables[0]);
+    table_free(&tables[1]);
+    current_table = 0;
+    release_platform();
+}
+
+int procsnap_refresh(void) {
+    ProcessTable* next = &tables[current_table ^ 1];
+    next->count = 0;
+
+    if (scan_processes(next, &tables[current_table]) != 0 || table_index(next) != 0) {
+        next->count = 0;
+        return -1;
+    }
+
+    current_table ^= 1;
+    return next->count;
+}
+
+const ProcessInfo* procsnap_find(uint32_t pid) {
+    return table_find(&tables[current_table], pid);
+}
+
+int procsnap_get_count(void) {
+    return tables[current_table].count;
+}
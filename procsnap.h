@@ -0,0 +1,52 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_PROCSNAP_H
+#define PEEK_PROCSNAP_H
+
+#include <stdint.h>
+
+// Process table snapshot, taken once per poll and joined against the
+// connection tables by PID instead of opening every owning process.
+//
+// Windows: one NtQuerySystemInformation(SystemProcessInformation) call gives
+// name, parent PID, session and creation time of every process. The full
+// image path is not part of that answer, so it is queried
+// (QueryFullProcessImageName) only for processes that were not in the
+// previous snapshot under the same PID and start time, and copied over
+// otherwise. Linux: one pass over /proc/[pid]/stat, with the same carry-over
+// for the /proc/[pid]/exe link.
+//
+// Two PID-indexed tables (current and previous) swap on each refresh. Not
+// thread-safe: refresh and lookups belong to the polling thread.
+
+#define PROCSNAP_NAME_MAX 260
+#define PROCSNAP_PATH_MAX 260
+
+typedef struct {
+    uint32_t pid;
+    uint32_t parent_pid;
+    uint32_t session_id;
+    uint64_t start_time;            // Windows: creation FILETIME; Linux: clock ticks after boot
+    char name[PROCSNAP_NAME_MAX];   // Image file name ("chrome.exe")
+    char path[PROCSNAP_PATH_MAX];   // Full image path, empty when access was denied
+} ProcessInfo;
+
+// Returns 0 or -1 (the process query is unavailable)
+int procsnap_init(void);
+
+void procsnap_cleanup(void);
+
+// Replace the snapshot. Returns the number of processes, or -1 on error (the
+// previous snapshot is kept)
+int procsnap_refresh(void);
+
+// Entry of `pid` in the current snapshot, NULL when the process was not
+// running at the last refresh. Valid until the next refresh
+const ProcessInfo* procsnap_find(uint32_t pid);
+
+// Processes in the current snapshot
+int procsnap_get_count(void);
+
+#endif
@@ -0,0 +1,384 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "resolver.h"
+#include "logger.h"
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RESOLVER_BUCKETS 8192      // Power of two, 2x cache size
+#define RESOLVER_MAX_WORKERS 16
+
+typedef enum {
+    RESOLVE_EMPTY = 0,
+    RESOLVE_PENDING,     // Queued or being resolved by a worker
+    RESOLVE_POSITIVE,    // Hostname known
+    RESOLVE_NEGATIVE     // Lookup failed (NXDOMAIN, timeout...)
+} ResolveState;
+
+typedef struct {
+    BYTE key[17];                        // [0] = IP version (4 or 6), [1..16] = address bytes
+    ResolveState state;
+    char hostname[RESOLVER_MAX_HOSTNAME];
+    ULONGLONG expires;                   // GetTickCount64() deadline for POSITIVE/NEGATIVE
+    int hash_next;
+} ResolveEntry;
+
+static ResolveEntry entries[RESOLVER_CACHE_SIZE];
+static int buckets[RESOLVER_BUCKETS];
+static int entries_used = 0;
+static int victim_cursor = 0;
+
+// Work queue of entry indices (an entry is queued at most once while PENDING)
+static int queue[RESOLVER_CACHE_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+
+static CRITICAL_SECTION resolver_cs;
+static CONDITION_VARIABLE queue_cv;
+static HANDLE workers[RESOLVER_MAX_WORKERS];
+static int worker_count = 0;
+static volatile BOOL stopping = FALSE;
+static BOOL resolver_initialized = FALSE;
+
+// Optional explicit DNS server (PEEK_DNS_SERVER)
+static IP4_ARRAY dns_servers;
+static BOOL use_custom_server = FALSE;
+
+static HWND notify_hwnd = NULL;
+static UINT notify_message = 0;
+static volatile LONG notify_pending = 0;
+
+static DWORD hash_key(const BYTE* key) {
+    // FNV-1a
+    DWORD hash = 2166136261u;
+    for (int i = 0; i < 17; i++) {
+        hash ^= key[i];
+        hash *= 16777619u;
+    }
+    return hash & (RESOLVER_BUCKETS - 1);
+}
+
+// Must be called with resolver_cs held
+static int find_entry(const BYTE* key) {
+    for (int i = buckets[hash_key(key)]; i >= 0; i = entries[i].hash_next) {
+        if (memcmp(entries[i].key, key, sizeof(entries[i].key)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Must be called with resolver_cs held
+static void unlink_entry(int idx) {
+    int* link = &buckets[hash_key(entries[idx].key)];
+    while (*link >= 0) {
+        if (*link == idx) {
+            *link = entries[idx].hash_next;
+            return;
+        }
+        link = &entries[*link].hash_next;
+    }
+}
+
+// Must be called with resolver_cs held. Returns -1 when every slot is in flight.
+static int allocate_entry(const BYTE* key) {
+    int idx = -1;
+
+    if (entries_used < RESOLVER_CACHE_SIZE) {
+        idx = entries_used++;
+    } else {
+        // Clock-style reuse: skip entries that still have a query in flight
+        for (int scanned = 0; scanned < RESOLVER_CACHE_SIZE; scanned++) {
+            int candidate = victim_cursor;
+            victim_cursor = (victim_cursor + 1) % RESOLVER_CACHE_SIZE;
+            if (entries[candidate].state != RESOLVE_PENDING) {
+                unlink_entry(candidate);
+                idx = candidate;
+                break;
+            }
+        }
+        if (idx < 0) {
+            return -1;
+        }
+    }
+
+    ResolveEntry* e = &entries[idx];
+    memcpy(e->key, key, sizeof(e->key));
+    e->state = RESOLVE_EMPTY;
+    e->hostname[0] = '\0';
+    e->expires = 0;
+
+    DWORD bucket = hash_key(key);
+    e->hash_next = buckets[bucket];
+    buckets[bucket] = idx;
+    return idx;
+}
+
+// Must be called with resolver_cs held
+static void enqueue_entry(int idx) {
+    entries[idx].state = RESOLVE_PENDING;
+    queue[(queue_head + queue_count) % RESOLVER_CACHE_SIZE] = idx;
+    queue_count++;
+    WakeConditionVariable(&queue_cv);
+}
+
+static void build_ptr_name(const BYTE* key, char* name, size_t size) {
+    if (key[0] == 4) {
+        snprintf(name, size, "%u.%u.%u.%u.in-addr.arpa", key[4], key[3], key[2], key[1]);
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    size_t pos = 0;
+    for (int i = 16; i >= 1 && pos + 4 < size; i--) {
+        name[pos++] = hex[key[i] & 0x0F];
+        name[pos++] = '.';
+        name[pos++] = hex[key[i] >> 4];
+        name[pos++] = '.';
+    }
+    name[pos] = '\0';
+    strncat(name, "ip6.arpa", size - pos - 1);
+}
+
+static void notify_window(void) {
+    if (notify_hwnd && InterlockedExchange(&notify_pending, 1) == 0) {
+        PostMessage(notify_hwnd, notify_message, 0, 0);
+    }
+}
+
+static DWORD WINAPI ResolverWorkerThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    for (;;) {
+        EnterCriticalSection(&resolver_cs);
+        while (queue_count == 0 && !stopping) {
+            SleepConditionVariableCS(&queue_cv, &resolver_cs, INFINITE);
+        }
+        if (stopping) {
+            LeaveCriticalSection(&resolver_cs);
+            break;
+        }
+
+        int idx = queue[queue_head];
+        queue_head = (queue_head + 1) % RESOLVER_CACHE_SIZE;
+        queue_count--;
+
+        BYTE key[17];
+        memcpy(key, entries[idx].key, sizeof(key));
+        LeaveCriticalSection(&resolver_cs);
+
+        // Blocking query runs outside the lock on this worker only
+        char ptr_name[80];
+        build_ptr_name(key, ptr_name, sizeof(ptr_name));
+
+        char hostname[RESOLVER_MAX_HOSTNAME] = {0};
+        DWORD ttl_ms = RESOLVER_NEGATIVE_TTL_MS;
+        PDNS_RECORDA records = NULL;
+
+        DNS_STATUS status = DnsQuery_A(ptr_name, DNS_TYPE_PTR,
+                                       use_custom_server ? DNS_QUERY_BYPASS_CACHE : DNS_QUERY_STANDARD,
+                                       use_custom_server ? &dns_servers : NULL,
+                                       &records, NULL);
+        if (status == ERROR_SUCCESS) {
+            for (PDNS_RECORDA rec = records; rec; rec = rec->pNext) {
+                if (rec->wType == DNS_TYPE_PTR && rec->Data.PTR.pNameHost) {
+                    strncpy(hostname, rec->Data.PTR.pNameHost, RESOLVER_MAX_HOSTNAME - 1);
+                    ULONGLONG ttl = (ULONGLONG)rec->dwTtl * 1000;
+                    if (ttl < RESOLVER_MIN_TTL_MS) ttl = RESOLVER_MIN_TTL_MS;
+                    if (ttl > RESOLVER_MAX_TTL_MS) ttl = RESOLVER_MAX_TTL_MS;
+                    ttl_ms = (DWORD)ttl;
+                    break;
+                }
+            }
+        }
+        if (records) {
+            DnsRecordListFree(records, DnsFreeRecordList);
+        }
+
+        EnterCriticalSection(&resolver_cs);
+        // Pending entries are never recycled, so idx still holds this key
+        ResolveEntry* e = &entries[idx];
+        if (hostname[0] != '\0') {
+            strcpy(e->hostname, hostname);
+            e->state = RESOLVE_POSITIVE;
+        } else {
+            e->state = RESOLVE_NEGATIVE;
+        }
+        e->expires = GetTickCount64() + ttl_ms;
+        BOOL resolved = (e->state == RESOLVE_POSITIVE);
+        LeaveCriticalSection(&resolver_cs);
+
+        if (resolved) {
+            notify_window();
+        }
+    }
+
+    return 0;
+}
+
+// `counted`: first lookup for a row; re-checks of the same row stay out of the hit rate
+static BOOL resolver_lookup(const BYTE* key, char* hostname, size_t size, BOOL counted) {
+    if (hostname && size > 0) {
+        hostname[0] = '\0';
+    }
+    if (!resolver_initialized) {
+        return FALSE;
+    }
+
+    BOOL found = FALSE;
+    ULONGLONG now = GetTickCount64();
+
+    EnterCriticalSection(&resolver_cs);
+
+    int idx = find_entry(key);
+    if (idx < 0) {
+        idx = allocate_entry(key);
+        if (idx >= 0) {
+            enqueue_entry(idx);
+        }
+    } else {
+        ResolveEntry* e = &entries[idx];
+        if (e->state == RESOLVE_POSITIVE) {
+            if (hostname && size > 0) {
+                strncpy(hostname, e->hostname, size - 1);
+                hostname[size - 1] = '\0';
+            }
+            found = TRUE;
+        }
+        // Expired answers are refreshed in the background; stale names stay visible meanwhile
+        if (e->state != RESOLVE_PENDING && now >= e->expires) {
+            enqueue_entry(idx);
+        }
+    }
+
+    LeaveCriticalSection(&resolver_cs);
+
+    if (counted) {
+        metrics_counter_add(found ? METRIC_COUNTER_RESOLVER_HIT : METRIC_COUNTER_RESOLVER_MISS, 1);
+    }
+    return found;
+}
+
+static void make_key_ipv4(DWORD addr, BYTE key[17]) {
+    memset(key, 0, 17);
+    key[0] = 4;
+    memcpy(&key[1], &addr, 4);  // Network byte order
+}
+
+static void make_key_ipv6(const BYTE* addr, BYTE key[17]) {
+    key[0] = 6;
+    memcpy(&key[1], addr, 16);
+}
+
+BOOL resolver_lookup_ipv4(DWORD addr, char* hostname, size_t size) {
+    BYTE key[17];
+    make_key_ipv4(addr, key);
+    return resolver_lookup(key, hostname, size, TRUE);
+}
+
+BOOL resolver_lookup_ipv6(const BYTE* addr, char* hostname, size_t size) {
+    BYTE key[17];
+    make_key_ipv6(addr, key);
+    return resolver_lookup(key, hostname, size, TRUE);
+}
+
+BOOL resolver_recheck_ipv4(DWORD addr, char* hostname, size_t size) {
+    BYTE key[17];
+    make_key_ipv4(addr, key);
+    return resolver_lookup(key, hostname, size, FALSE);
+}
+
+BOOL resolver_recheck_ipv6(const BYTE* addr, char* hostname, size_t size) {
+    BYTE key[17];
+    make_key_ipv6(addr, key);
+    return resolver_lookup(key, hostname, size, FALSE);
+}
+
+void resolver_set_notify_window(HWND hwnd, UINT message) {
+    notify_message = message;
+    notify_hwnd = hwnd;
+}
+
+void resolver_ack_notify(void) {
+    InterlockedExchange(&notify_pending, 0);
+}
+
+int resolver_init(int max_concurrent) {
+    if (resolver_initialized) {
+        return 0;
+    }
+
+    if (max_concurrent <= 0) max_concurrent = RESOLVER_DEFAULT_WORKERS;
+    if (max_concurrent > RESOLVER_MAX_WORKERS) max_concurrent = RESOLVER_MAX_WORKERS;
+
+    InitializeCriticalSection(&resolver_cs);
+    InitializeConditionVariable(&queue_cv);
+    for (int i = 0; i < RESOLVER_BUCKETS; i++) {
+        buckets[i] = -1;
+    }
+    entries_used = 0;
+    victim_cursor = 0;
+    queue_head = queue_count = 0;
+    stopping = FALSE;
+
+    // Explicit server (e.g. a local stub DNS server for testing)
+    char server[64];
+    DWORD len = GetEnvironmentVariableA("PEEK_DNS_SERVER", server, sizeof(server));
+    if (len > 0 && len < sizeof(server)) {
+        unsigned int a, b, c, d;
+        if (sscanf(server, "%u.%u.%u.%u", &a, &b, &c, &d) == 4 && a < 256 && b < 256 && c < 256 && d < 256) {
+            BYTE octets[4] = {(BYTE)a, (BYTE)b, (BYTE)c, (BYTE)d};
+            dns_servers.AddrCount = 1;
+            memcpy(&dns_servers.AddrArray[0], octets, 4);  // IP4_ADDRESS is network byte order
+            use_custom_server = TRUE;
+            LOG_INFO("Reverse DNS using server %s", server);
+        } else {
+            LOG_WARNING("Ignoring invalid PEEK_DNS_SERVER value: %s", server);
+        }
+    }
+
+    resolver_initialized = TRUE;
+
+    worker_count = 0;
+    for (int i = 0; i < max_concurrent; i++) {
+        workers[worker_count] = CreateThread(NULL, 0, ResolverWorkerThread, NULL, 0, NULL);
+        if (workers[worker_count] != NULL) {
+            worker_count++;
+        }
+    }
+
+    LOG_SUCCESS("Reverse DNS resolver started (%d worker(s))", worker_count);
+    return 0;
+}
+
+void resolver_cleanup(void) {
+    if (!resolver_initialized) {
+        return;
+    }
+
+    notify_hwnd = NULL;
+
+    EnterCriticalSection(&resolver_cs);
+    stopping = TRUE;
+    WakeAllConditionVariable(&queue_cv);
+    LeaveCriticalSection(&resolver_cs);
+
+    // Workers blocked inside DnsQuery can't be interrupted - don't hold up exit for them
+    BOOL all_exited = TRUE;
+    if (worker_count > 0) {
+        DWORD wait = WaitForMultipleObjects(worker_count, workers, TRUE, 2000);
+        all_exited = (wait != WAIT_TIMEOUT && wait != WAIT_FAILED);
+    }
+    for (int i = 0; i < worker_count; i++) {
+        CloseHandle(workers[i]);
+    }
+    worker_count = 0;
+
+    resolver_initialized = FALSE;
+    if (all_exited) {
+        DeleteCriticalSection(&resolver_cs);
+    }
+}
@@ -0,0 +1,44 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_RESOLVER_H
+#define PEEK_RESOLVER_H
+
+#include <windows.h>
+#include <windns.h>
+
+#pragma comment(lib, "dnsapi.lib")
+
+#define RESOLVER_MAX_HOSTNAME 256
+#define RESOLVER_CACHE_SIZE 4096          // Max cached addresses (positive + negative + pending)
+#define RESOLVER_DEFAULT_WORKERS 4        // Max concurrent PTR queries
+#define RESOLVER_MIN_TTL_MS (60 * 1000)           // Floor for positive answers
+#define RESOLVER_MAX_TTL_MS (60 * 60 * 1000)      // Ceiling for positive answers
+#define RESOLVER_NEGATIVE_TTL_MS (5 * 60 * 1000)  // Failures are retried after this
+
+// Start the resolver pool. max_concurrent bounds the number of in-flight queries.
+// Set PEEK_DNS_SERVER=a.b.c.d to send queries to a specific server (e.g. a local stub).
+int resolver_init(int max_concurrent);
+
+void resolver_cleanup(void);
+
+// Post `message` to `hwnd` when answers arrive (coalesced: at most one pending post)
+void resolver_set_notify_window(HWND hwnd, UINT message);
+
+// Re-arm notifications - call from the message handler before scanning rows
+void resolver_ack_notify(void);
+
+// Non-blocking lookups. Return TRUE with the cached hostname when known;
+// otherwise queue a single deduplicated PTR query and return FALSE.
+BOOL resolver_lookup_ipv4(DWORD addr, char* hostname, size_t size);
+
+BOOL resolver_lookup_ipv6(const BYTE* addr, char* hostname, size_t size);
+
+// Same, but not counted in the hit rate: for a row whose first lookup was
+// already counted (hostname re-scans, list rebuilds)
+BOOL resolver_recheck_ipv4(DWORD addr, char* hostname, size_t size);
+
+BOOL resolver_recheck_ipv6(const BYTE* addr, char* hostname, size_t size);
+
+#endif
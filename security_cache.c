@@ -0,0 +1,747 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "security_cache.h"
+#include "logger.h"
+#include "metrics.h"
+#include "sha256.h"
+#include "trust_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <shlobj.h>
+#include <wincrypt.h>
+
+// Fixed pool of entries, chained hash buckets (indices) and an intrusive LRU list
+typedef struct {
+    char process_path[MAX_PATH];
+    char sha256_hash[SHA256_HASH_LENGTH];
+    TrustStatus trust_status;
+    FileIdentity identity;
+    DWORD validated_tick;    // Last time identity was checked against the disk
+    DWORD path_hash;
+    int bucket_next;         // Next entry in bucket chain, or in the free list
+    int lru_prev;
+    int lru_next;
+    BOOL used;
+} SecurityCacheEntry;
+
+static SecurityCacheEntry* entries = NULL;
+static int* buckets = NULL;
+static int capacity = 0;
+static int bucket_mask = 0;
+static int entry_count = 0;
+static int free_head = -1;
+static int lru_head = -1;   // Most recently used
+static int lru_tail = -1;   // Eviction candidate
+
+static CRITICAL_SECTION cache_cs;
+static BOOL cache_initialized = FALSE;
+
+// ============================================================================
+// On-disk format (security_cache.dat, little-endian)
+// ============================================================================
+//
+// [SecurityCacheFileHeader][SecurityCacheRecord]...
+//
+// Records are fixed-size and only ever appended; a later record for the same
+// path supersedes earlier ones. Each record carries an HMAC-SHA256 keyed by
+// a random per-user key, so a torn append (crash mid-write) and a record
+// written by anything but Peek are both dropped on load. The file is
+// compacted at startup when superseded or rejected records dominate.
+//
+// The key lives DPAPI-protected in security_cache.key; both files get a
+// user-only DACL. A lost or undecryptable key is replaced, which simply
+// invalidates the cache.
+
+#define SECURITY_CACHE_FILE_MAGIC 0x48435350  // "PSCH"
+#define SECURITY_CACHE_FILE_VERSION 2         // Version 2 = HMAC-SHA256 records
+#define SECURITY_CACHE_KEY_SIZE 32
+#define SECURITY_CACHE_KEY_MAX_BLOB 4096      // DPAPI output for the key is well below this
+#define MAX_PENDING_RECORDS 4096
+
+typedef struct {
+    DWORD magic;
+    DWORD version;
+    DWORD record_size;
+    DWORD reserved;
+} SecurityCacheFileHeader;
+
+typedef struct {
+    char process_path[MAX_PATH];
+    char sha256_hash[SHA256_HASH_LENGTH];
+    BYTE reserved[3];
+    DWORD trust_status;
+    DWORD volume_serial;
+    ULONGLONG file_size;
+    ULONGLONG file_index;
+    FILETIME last_write;
+    BYTE mac[SHA256_DIGEST_SIZE];   // HMAC-SHA256 of every byte above
+} SecurityCacheRecord;
+
+static char cache_file_path[MAX_PATH] = {0};
+static char key_file_path[MAX_PATH] = {0};
+static BYTE record_key[SECURITY_CACHE_KEY_SIZE];
+
+// Records waiting for the background writer (guarded by cache_cs)
+static SecurityCacheRecord* pending_records = NULL;
+static int pending_count = 0;
+static HANDLE writer_thread = NULL;
+static HANDLE writer_wake_event = NULL;
+static HANDLE writer_stop_event = NULL;
+
+static DWORD hash_path(const char* path) {
+    DWORD h = 2166136261u;
+    while (*path) {
+        h ^= (BYTE)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ============================================================================
+// LRU & bucket helpers (cache_cs held)
+// ============================================================================
+
+static void lru_unlink(int idx) {
+    SecurityCacheEntry* e = &entries[idx];
+    if (e->lru_prev >= 0) entries[e->lru_prev].lru_next = e->lru_next; else lru_head = e->lru_next;
+    if (e->lru_next >= 0) entries[e->lru_next].lru_prev = e->lru_prev; else lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = -1;
+}
+
+static void lru_push_front(int idx) {
+    SecurityCacheEntry* e = &entries[idx];
+    e->lru_prev = -1;
+    e->lru_next = lru_head;
+    if (lru_head >= 0) entries[lru_head].lru_prev = idx;
+    lru_head = idx;
+    if (lru_tail < 0) lru_tail = idx;
+}
+
+static int find_entry(const char* path, DWORD h) {
+    for (int idx = buckets[h & bucket_mask]; idx >= 0; idx = entries[idx].bucket_next) {
+        if (entries[idx].path_hash == h && strcmp(entries[idx].process_path, path) == 0) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void remove_entry(int idx) {
+    SecurityCacheEntry* e = &entries[idx];
+    int* link = &buckets[e->path_hash & bucket_mask];
+    while (*link != idx) {
+        link = &entries[*link].bucket_next;
+    }
+    *link = e->bucket_next;
+
+    lru_unlink(idx);
+    e->used = FALSE;
+    e->bucket_next = free_head;
+    free_head = idx;
+    entry_count--;
+}
+
+static int allocate_entry(void) {
+    if (free_head < 0) {
+        // Full: recycle the least recently used entry
+        remove_entry(lru_tail);
+    }
+    int idx = free_head;
+    free_head = entries[idx].bucket_next;
+    entry_count++;
+    return idx;
+}
+
+static BOOL identity_equal(const FileIdentity* a, const FileIdentity* b) {
+    return a->file_size == b->file_size &&
+           a->last_write.dwLowDateTime == b->last_write.dwLowDateTime &&
+           a->last_write.dwHighDateTime == b->last_write.dwHighDateTime &&
+           a->volume_serial == b->volume_serial &&
+           a->file_index == b->file_index;
+}
+
+static void store_locked(const char* process_path, const FileIdentity* identity,
+                         const char* hash, TrustStatus status, DWORD validated_tick) {
+    DWORD h = hash_path(process_path);
+    int idx = find_entry(process_path, h);
+    if (idx < 0) {
+        idx = allocate_entry();
+        SecurityCacheEntry* e = &entries[idx];
+        strncpy(e->process_path, process_path, MAX_PATH - 1);
+        e->process_path[MAX_PATH - 1] = '\0';
+        e->path_hash = h;
+        e->used = TRUE;
+        e->bucket_next = buckets[h & bucket_mask];
+        buckets[h & bucket_mask] = idx;
+    } else {
+        lru_unlink(idx);
+    }
+
+    SecurityCacheEntry* e = &entries[idx];
+    strncpy(e->sha256_hash, hash, SHA256_HASH_LENGTH - 1);
+    e->sha256_hash[SHA256_HASH_LENGTH - 1] = '\0';
+    e->trust_status = status;
+    if (identity) {
+        e->identity = *identity;
+    } else {
+        memset(&e->identity, 0, sizeof(FileIdentity));
+    }
+    e->validated_tick = validated_tick;
+    lru_push_front(idx);
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+static void record_mac(const SecurityCacheRecord* record, BYTE mac[SHA256_DIGEST_SIZE]) {
+    BYTE pad[SHA256_BLOCK_SIZE];
+    BYTE inner[SHA256_DIGEST_SIZE];
+    Sha256Context ctx;
+
+    memset(pad, 0x36, sizeof(pad));
+    for (int i = 0; i < SECURITY_CACHE_KEY_SIZE; i++) {
+        pad[i] ^= record_key[i];
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, sizeof(pad));
+    sha256_update(&ctx, record, offsetof(SecurityCacheRecord, mac));
+    sha256_final(&ctx, inner);
+
+    memset(pad, 0x5C, sizeof(pad));
+    for (int i = 0; i < SECURITY_CACHE_KEY_SIZE; i++) {
+        pad[i] ^= record_key[i];
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, sizeof(pad));
+    sha256_update(&ctx, inner, sizeof(inner));
+    sha256_final(&ctx, mac);
+}
+
+static BOOL record_authentic(const SecurityCacheRecord* record) {
+    BYTE expected[SHA256_DIGEST_SIZE];
+    record_mac(record, expected);
+
+    // Compare every byte: no early exit on the first mismatch
+    BYTE diff = 0;
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        diff |= (BYTE)(expected[i] ^ record->mac[i]);
+    }
+    return diff == 0;
+}
+
+// Read the DPAPI-protected record key, or create one. FALSE disables persistence
+static BOOL load_record_key(void) {
+    HANDLE hFile = CreateFileA(key_file_path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile != INVALID_HANDLE_VALUE) {
+        BYTE blob[SECURITY_CACHE_KEY_MAX_BLOB];
+        DWORD blob_size = 0;
+        BOOL read_ok = ReadFile(hFile, blob, sizeof(blob), &blob_size, NULL);
+        CloseHandle(hFile);
+
+        DATA_BLOB input;
+        DATA_BLOB output;
+        input.pbData = blob;
+        input.cbData = blob_size;
+        if (read_ok && blob_size > 0 &&
+            CryptUnprotectData(&input, NULL, NULL, NULL, NULL, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+            BOOL valid = output.cbData == SECURITY_CACHE_KEY_SIZE;
+            if (valid) {
+                memcpy(record_key, output.pbData, SECURITY_CACHE_KEY_SIZE);
+            }
+            SecureZeroMemory(output.pbData, output.cbData);
+            LocalFree(output.pbData);
+            if (valid) {
+                return TRUE;
+            }
+        }
+        LOG_WARNING("Security cache key unreadable - starting a new cache");
+    }
+
+    HCRYPTPROV hProv = 0;
+    BOOL ok = CryptAcquireContext(&hProv, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
+    if (ok) {
+        ok = CryptGenRandom(hProv, SECURITY_CACHE_KEY_SIZE, record_key);
+        CryptReleaseContext(hProv, 0);
+    }
+    if (!ok) {
+        LOG_ERROR("Failed to generate the security cache key: %lu", GetLastError());
+        return FALSE;
+    }
+
+    DATA_BLOB input;
+    DATA_BLOB output;
+    input.pbData = record_key;
+    input.cbData = SECURITY_CACHE_KEY_SIZE;
+    if (!CryptProtectData(&input, L"PEEK Security Cache Key", NULL, NULL, NULL,
+                          CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        LOG_ERROR("DPAPI encryption failed: %lu", GetLastError());
+        return FALSE;
+    }
+
+    hFile = CreateFileA(key_file_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+    DWORD written = 0;
+    ok = hFile != INVALID_HANDLE_VALUE &&
+         WriteFile(hFile, output.pbData, output.cbData, &written, NULL) && written == output.cbData;
+    if (hFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile);
+    }
+    LocalFree(output.pbData);
+
+    if (!ok) {
+        LOG_ERROR("Failed to save the security cache key: %lu", GetLastError());
+        DeleteFileA(key_file_path);
+        return FALSE;
+    }
+    trust_store_protect_file(key_file_path);
+    return TRUE;
+}
+
+static void fill_record(SecurityCacheRecord* record, const char* process_path,
+                        const FileIdentity* identity, const char* hash, TrustStatus status) {
+    memset(record, 0, sizeof(SecurityCacheRecord));
+    strncpy(record->process_path, process_path, MAX_PATH - 1);
+    strncpy(record->sha256_hash, hash, SHA256_HASH_LENGTH - 1);
+    record->trust_status = (DWORD)status;
+    if (identity) {
+        record->volume_serial = identity->volume_serial;
+        record->file_size = identity->file_size;
+        record->file_index = identity->file_index;
+        record->last_write = identity->last_write;
+    }
+    record_mac(record, record->mac);
+}
+
+static BOOL write_records(HANDLE hFile, const SecurityCacheRecord* records, int count) {
+    DWORD size = (DWORD)(count * sizeof(SecurityCacheRecord));
+    DWORD written = 0;
+    return count == 0 || (WriteFile(hFile, records, size, &written, NULL) && written == size);
+}
+
+// Rewrite the file with one record per live entry (startup only, cache_cs not needed)
+static void compact_cache_file(void) {
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, MAX_PATH, "%s.tmp", cache_file_path);
+
+    HANDLE hFile = CreateFileA(temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    SecurityCacheFileHeader header = {SECURITY_CACHE_FILE_MAGIC, SECURITY_CACHE_FILE_VERSION,
+                                      sizeof(SecurityCacheRecord), 0};
+    DWORD written = 0;
+    BOOL ok = WriteFile(hFile, &header, sizeof(header), &written, NULL) && written == sizeof(header);
+
+    // Oldest first so LRU order survives the next load
+    SecurityCacheRecord record;
+    for (int idx = lru_tail; ok && idx >= 0; idx = entries[idx].lru_prev) {
+        const SecurityCacheEntry* e = &entries[idx];
+        fill_record(&record, e->process_path, &e->identity, e->sha256_hash, e->trust_status);
+        ok = write_records(hFile, &record, 1);
+    }
+    CloseHandle(hFile);
+
+    // The DACL moves with the file
+    if (ok) {
+        trust_store_protect_file(temp_path);
+    }
+    if (!ok || !MoveFileExA(temp_path, cache_file_path, MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(temp_path);
+        return;
+    }
+    LOG_INFO("Security cache file compacted (%d records)", entry_count);
+}
+
+static void load_cache_file(void) {
+    HANDLE hFile = CreateFileA(cache_file_path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size;
+    HANDLE hMapping = NULL;
+    const BYTE* view = NULL;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart >= (LONGLONG)sizeof(SecurityCacheFileHeader)) {
+        hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        view = hMapping ? (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    }
+
+    int total_records = 0;
+    int loaded = 0;
+    int rejected = 0;
+    BOOL needs_compaction = FALSE;
+
+    if (view) {
+        const SecurityCacheFileHeader* header = (const SecurityCacheFileHeader*)view;
+        if (header->magic == SECURITY_CACHE_FILE_MAGIC &&
+            header->version == SECURITY_CACHE_FILE_VERSION &&
+            header->record_size == sizeof(SecurityCacheRecord)) {
+            const SecurityCacheRecord* records = (const SecurityCacheRecord*)(view + sizeof(SecurityCacheFileHeader));
+            total_records = (int)((size.QuadPart - sizeof(SecurityCacheFileHeader)) / sizeof(SecurityCacheRecord));
+
+            // Force an identity check on first lookup: cheap stat, no hashing if unchanged
+            DWORD validated_tick = GetTickCount() - SECURITY_CACHE_REVALIDATE_MS;
+
+            for (int i = 0; i < total_records; i++) {
+                const SecurityCacheRecord* record = &records[i];
+                if (!record_authentic(record)) {
+                    rejected++;
+                    needs_compaction = TRUE;
+                    continue;
+                }
+                if (record->process_path[MAX_PATH - 1] != '\0' ||
+                    record->sha256_hash[SHA256_HASH_LENGTH - 1] != '\0' ||
+                    record->trust_status > TRUST_BLOCKLISTED) {
+                    needs_compaction = TRUE;
+                    continue;
+                }
+
+                FileIdentity identity;
+                identity.file_size = record->file_size;
+                identity.last_write = record->last_write;
+                identity.volume_serial = record->volume_serial;
+                identity.file_index = record->file_index;
+                store_locked(record->process_path, &identity, record->sha256_hash,
+                             (TrustStatus)record->trust_status, validated_tick);
+                loaded++;
+            }
+
+            if ((size.QuadPart - sizeof(SecurityCacheFileHeader)) % sizeof(SecurityCacheRecord) != 0) {
+                needs_compaction = TRUE;  // Torn tail from an interrupted append
+            }
+        } else {
+            LOG_WARNING("Security cache file has an unknown format - rebuilding");
+            needs_compaction = TRUE;
+        }
+    }
+
+    if (view) UnmapViewOfFile(view);
+    if (hMapping) CloseHandle(hMapping);
+    CloseHandle(hFile);
+
+    if (rejected > 0) {
+        LOG_WARNING("Security cache: %d records failed authentication - dropped", rejected);
+    }
+
+    // Superseded / evicted records dominate: rewrite with live entries only
+    if (needs_compaction || total_records > entry_count * 2 + 64) {
+        compact_cache_file();
+    }
+
+    if (loaded > 0) {
+        LOG_SUCCESS("Loaded %d cached hash/trust results from disk", entry_count);
+    }
+}
+
+static DWORD WINAPI SecurityCacheWriterThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    SecurityCacheRecord* batch = (SecurityCacheRecord*)malloc(MAX_PENDING_RECORDS * sizeof(SecurityCacheRecord));
+    if (!batch) {
+        return 0;
+    }
+
+    HANDLE events[2] = {writer_stop_event, writer_wake_event};
+    BOOL stopping = FALSE;
+
+    while (!stopping) {
+        DWORD wait = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+        stopping = (wait == WAIT_OBJECT_0);
+        if (!stopping) {
+            // Let a burst of results (cold start) accumulate into one write
+            stopping = (WaitForSingleObject(writer_stop_event, SECURITY_CACHE_FLUSH_MS) == WAIT_OBJECT_0);
+        }
+
+        EnterCriticalSection(&cache_cs);
+        int count = pending_count;
+        memcpy(batch, pending_records, (size_t)count * sizeof(SecurityCacheRecord));
+        pending_count = 0;
+        LeaveCriticalSection(&cache_cs);
+
+        if (count == 0) {
+            continue;
+        }
+
+        HANDLE hFile = CreateFileA(cache_file_path, FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+                                   OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            LOG_WARNING("Unable to open security cache file: %lu", GetLastError());
+            continue;
+        }
+
+        LARGE_INTEGER size;
+        BOOL created = GetFileSizeEx(hFile, &size) && size.QuadPart == 0;
+        if (created) {
+            SecurityCacheFileHeader header = {SECURITY_CACHE_FILE_MAGIC, SECURITY_CACHE_FILE_VERSION,
+                                              sizeof(SecurityCacheRecord), 0};
+            DWORD written = 0;
+            WriteFile(hFile, &header, sizeof(header), &written, NULL);
+        }
+
+        if (!write_records(hFile, batch, count)) {
+            LOG_WARNING("Failed to append to security cache file: %lu", GetLastError());
+        }
+        CloseHandle(hFile);
+
+        if (created) {
+            trust_store_protect_file(cache_file_path);
+        }
+    }
+
+    free(batch);
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int security_cache_init(int max_entries) {
+    if (cache_initialized) {
+        return 0;
+    }
+
+    if (max_entries <= 0) {
+        char value[32];
+        DWORD len = GetEnvironmentVariableA("PEEK_SECURITY_CACHE_ENTRIES", value, sizeof(value));
+        max_entries = (len > 0 && len < sizeof(value)) ? atoi(value) : 0;
+        if (max_entries <= 0) {
+            max_entries = SECURITY_CACHE_DEFAULT_ENTRIES;
+        }
+    }
+
+    int bucket_count = 1;
+    while (bucket_count < max_entries * 2) {
+        bucket_count <<= 1;
+    }
+
+    entries = (SecurityCacheEntry*)calloc((size_t)max_entries, sizeof(SecurityCacheEntry));
+    buckets = (int*)malloc((size_t)bucket_count * sizeof(int));
+    if (!entries || !buckets) {
+        LOG_ERROR("Failed to allocate security cache (%d entries)", max_entries);
+        free(entries);
+        free(buckets);
+        entries = NULL;
+        buckets = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < bucket_count; i++) {
+        buckets[i] = -1;
+    }
+    for (int i = 0; i < max_entries; i++) {
+        entries[i].bucket_next = (i + 1 < max_entries) ? i + 1 : -1;
+        entries[i].lru_prev = entries[i].lru_next = -1;
+    }
+
+    capacity = max_entries;
+    bucket_mask = bucket_count - 1;
+    entry_count = 0;
+    free_head = 0;
+    lru_head = lru_tail = -1;
+
+    InitializeCriticalSection(&cache_cs);
+    cache_initialized = TRUE;
+    LOG_INFO("Security cache ready (%d entries)", capacity);
+
+    char appdata[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(cache_file_path, MAX_PATH, "%s\\Peek", appdata);
+        CreateDirectoryA(cache_file_path, NULL);
+        snprintf(cache_file_path, MAX_PATH, "%s\\Peek\\security_cache.dat", appdata);
+        snprintf(key_file_path, MAX_PATH, "%s\\Peek\\security_cache.key", appdata);
+    } else {
+        strcpy(cache_file_path, "security_cache.dat");
+        strcpy(key_file_path, "security_cache.key");
+    }
+
+    // Without the record key nothing is loaded or written
+    BOOL key_ready = load_record_key();
+
+    // Warm start: previous results, validated lazily by file identity
+    if (key_ready) {
+        load_cache_file();
+    }
+
+    pending_records = (SecurityCacheRecord*)malloc(MAX_PENDING_RECORDS * sizeof(SecurityCacheRecord));
+    writer_wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    writer_stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (key_ready && pending_records && writer_wake_event && writer_stop_event) {
+        writer_thread = CreateThread(NULL, 0, SecurityCacheWriterThread, NULL, 0, NULL);
+    }
+    if (!writer_thread) {
+        LOG_WARNING("Security cache persistence disabled");
+        pending_count = MAX_PENDING_RECORDS;  // Never queue
+    }
+
+    return 0;
+}
+
+void security_cache_cleanup(void) {
+    if (!cache_initialized) {
+        return;
+    }
+
+    // Writer drains the pending batch before exiting
+    if (writer_thread) {
+        SetEvent(writer_stop_event);
+        WaitForSingleObject(writer_thread, INFINITE);
+        CloseHandle(writer_thread);
+        writer_thread = NULL;
+    }
+    if (writer_wake_event) CloseHandle(writer_wake_event);
+    if (writer_stop_event) CloseHandle(writer_stop_event);
+    writer_wake_event = NULL;
+    writer_stop_event = NULL;
+    free(pending_records);
+    pending_records = NULL;
+    pending_count = 0;
+
+    SecureZeroMemory(record_key, sizeof(record_key));
+    DeleteCriticalSection(&cache_cs);
+    free(entries);
+    free(buckets);
+    entries = NULL;
+    buckets = NULL;
+    capacity = 0;
+    entry_count = 0;
+    cache_initialized = FALSE;
+}
+
+BOOL security_cache_get_file_identity(const char* process_path, FileIdentity* identity) {
+    memset(identity, 0, sizeof(FileIdentity));
+
+    // Attribute-only open: works on running executables and does not touch file data
+    HANDLE hFile = CreateFileA(process_path, FILE_READ_ATTRIBUTES,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return FALSE;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(hFile, &info);
+    CloseHandle(hFile);
+    if (!ok) {
+        return FALSE;
+    }
+
+    identity->file_size = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    identity->last_write = info.ftLastWriteTime;
+    identity->volume_serial = info.dwVolumeSerialNumber;
+    identity->file_index = ((ULONGLONG)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return TRUE;
+}
+
+BOOL security_cache_lookup(const char* process_path, char* hash_out, size_t hash_size,
+                           TrustStatus* trust_out) {
+    if (!cache_initialized || !process_path) {
+        return FALSE;
+    }
+
+    DWORD h = hash_path(process_path);
+    DWORD now = GetTickCount();
+
+    EnterCriticalSection(&cache_cs);
+    int idx = find_entry(process_path, h);
+    if (idx < 0) {
+        LeaveCriticalSection(&cache_cs);
+        metrics_counter_add(METRIC_COUNTER_SECURITY_CACHE_MISS, 1);
+        return FALSE;
+    }
+
+    BOOL needs_validation = (now - entries[idx].validated_tick) >= SECURITY_CACHE_REVALIDATE_MS;
+    FileIdentity stored = entries[idx].identity;
+    LeaveCriticalSection(&cache_cs);
+
+    // Stat the file outside the lock, then re-find (the entry may have moved)
+    FileIdentity current;
+    BOOL stale = FALSE;
+    if (needs_validation && security_cache_get_file_identity(process_path, &current)) {
+        stale = !identity_equal(&stored, &current);
+    }
+
+    BOOL found = FALSE;
+    EnterCriticalSection(&cache_cs);
+    idx = find_entry(process_path, h);
+    if (idx >= 0) {
+        if (stale && identity_equal(&entries[idx].identity, &stored)) {
+            LOG_INFO("Binary changed on disk, re-hashing: %s", process_path);
+            remove_entry(idx);
+        } else {
+            if (needs_validation && !stale) {
+                entries[idx].validated_tick = now;
+            }
+            if (hash_out && hash_size > 0) {
+                strncpy(hash_out, entries[idx].sha256_hash, hash_size - 1);
+                hash_out[hash_size - 1] = '\0';
+            }
+            if (trust_out) {
+                *trust_out = entries[idx].trust_status;
+            }
+            lru_unlink(idx);
+            lru_push_front(idx);
+            found = TRUE;
+        }
+    }
+    LeaveCriticalSection(&cache_cs);
+
+    metrics_counter_add(found ? METRIC_COUNTER_SECURITY_CACHE_HIT : METRIC_COUNTER_SECURITY_CACHE_MISS, 1);
+    return found;
+}
+
+void security_cache_store(const char* process_path, const FileIdentity* identity,
+                          const char* hash, TrustStatus status) {
+    if (!cache_initialized || !process_path) {
+        return;
+    }
+
+    EnterCriticalSection(&cache_cs);
+    store_locked(process_path, identity, hash, status, GetTickCount());
+
+    // Errors are not persisted so the next launch retries them
+    if (status != TRUST_ERROR && strcmp(hash, "Error") != 0 && pending_count < MAX_PENDING_RECORDS) {
+        fill_record(&pending_records[pending_count++], process_path, identity, hash, status);
+        SetEvent(writer_wake_event);
+    }
+    LeaveCriticalSection(&cache_cs);
+}
+
+void security_cache_set_trust(const char* process_path, TrustStatus status) {
+    if (!cache_initialized || !process_path) {
+        return;
+    }
+
+    EnterCriticalSection(&cache_cs);
+    int idx = find_entry(process_path, hash_path(process_path));
+    if (idx >= 0) {
+        entries[idx].trust_status = status;
+    }
+    LeaveCriticalSection(&cache_cs);
+}
+
+void security_cache_remove(const char* process_path) {
+    if (!cache_initialized || !process_path) {
+        return;
+    }
+
+    EnterCriticalSection(&cache_cs);
+    int idx = find_entry(process_path, hash_path(process_path));
+    if (idx >= 0) {
+        remove_entry(idx);
+    }
+    LeaveCriticalSection(&cache_cs);
+}
+
+int security_cache_get_count(void) {
+    return entry_count;
+}
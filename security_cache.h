@@ -0,0 +1,51 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_SECURITY_CACHE_H
+#define PEEK_SECURITY_CACHE_H
+
+#include <windows.h>
+#include "network.h"
+
+#define SECURITY_CACHE_DEFAULT_ENTRIES 4096   // Override with PEEK_SECURITY_CACHE_ENTRIES
+#define SECURITY_CACHE_REVALIDATE_MS 5000     // Min delay between file identity re-checks
+#define SECURITY_CACHE_FLUSH_MS 2000          // Background writer batching interval
+
+// Identity of a binary on disk: any change means the cached hash is stale
+typedef struct {
+    ULONGLONG file_size;
+    FILETIME last_write;
+    DWORD volume_serial;
+    ULONGLONG file_index;
+} FileIdentity;
+
+// Create the cache and load %APPDATA%\Peek\security_cache.dat (memory-mapped).
+// Loaded entries are re-validated by file identity on first use, never re-hashed
+// if unchanged. max_entries <= 0 uses the default (or the env override).
+int security_cache_init(int max_entries);
+
+// Flush pending records to disk and release the cache
+void security_cache_cleanup(void);
+
+// Capture identity before hashing so an update during hashing is detected later
+BOOL security_cache_get_file_identity(const char* process_path, FileIdentity* identity);
+
+// O(1) lookup, result copied out. Returns FALSE on miss, or when the file on
+// disk no longer matches the stored identity (the entry is dropped).
+BOOL security_cache_lookup(const char* process_path, char* hash_out, size_t hash_size,
+                           TrustStatus* trust_out);
+
+// Insert or replace; evicts the least recently used entry when full.
+// The record is appended to the cache file in the background.
+void security_cache_store(const char* process_path, const FileIdentity* identity,
+                          const char* hash, TrustStatus status);
+
+// Update the trust of a cached binary (manual override); no-op if absent
+void security_cache_set_trust(const char* process_path, TrustStatus status);
+
+void security_cache_remove(const char* process_path);
+
+int security_cache_get_count(void);
+
+#endif
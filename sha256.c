@@ -0,0 +1,308 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "sha256.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHA256_HAVE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC/Clang compile the SHA-NI kernel for its own target only, so the rest of
+// the binary keeps running on CPUs without the extension
+#if defined(SHA256_HAVE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#else
+#define SHA256_TARGET_SHANI
+#endif
+
+typedef void (*Sha256BlocksFn)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// ============================================================================
+// Scalar kernel
+// ============================================================================
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define BSIG0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BSIG1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SSIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static uint32_t load_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void sha256_blocks_scalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+
+    while (blocks--) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = load_be32(data + i * 4);
+        }
+        for (int i = 16; i < 64; i++) {
+            w[i] = SSIG1(w[i - 2]) + w[i - 7] + SSIG0(w[i - 15]) + w[i - 16];
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + BSIG1(e) + CH(e, f, g) + K[i] + w[i];
+            uint32_t t2 = BSIG0(a) + MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += SHA256_BLOCK_SIZE;
+    }
+}
+
+// ============================================================================
+// SHA-NI kernel (Intel SHA extensions: sha256rnds2 / sha256msg1 / sha256msg2)
+// ============================================================================
+
+#ifdef SHA256_HAVE_X86
+
+// Four rounds on message words `msg`, then advance the schedule
+#define SHANI_ROUNDS(msg, k_index)                                              \
+    do {                                                                        \
+        __m128i wk = _mm_add_epi32(msg, _mm_loadu_si128((const __m128i*)&K[k_index])); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, wk);                     \
+        wk = _mm_shuffle_epi32(wk, 0x0E);                                       \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, wk);                     \
+    } while (0)
+
+SHA256_TARGET_SHANI
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Repack ABCD/EFGH into the ABEF/CDGH layout sha256rnds2 expects
+    __m128i tmp = _mm_loadu_si128((const __m128i*)&state[0]);      // DCBA
+    __m128i state1 = _mm_loadu_si128((const __m128i*)&state[4]);   // HGFE
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                            // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);                      // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);              // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);                   // CDGH
+
+    while (blocks--) {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+
+        __m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), byteswap);
+        __m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), byteswap);
+        __m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), byteswap);
+        __m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), byteswap);
+
+        // Rounds 0-15: the raw message words
+        SHANI_ROUNDS(msg0, 0);
+        SHANI_ROUNDS(msg1, 4);
+        msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+        SHANI_ROUNDS(msg2, 8);
+        msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+        SHANI_ROUNDS(msg3, 12);
+
+        // Rounds 16-63: each step derives the next 4 schedule words
+        for (int k = 16; k < 64; k += 16) {
+            msg0 = _mm_add_epi32(msg0, _mm_alignr_epi8(msg3, msg2, 4));
+            msg0 = _mm_sha256msg2_epu32(msg0, msg3);
+            SHANI_ROUNDS(msg0, k);
+            msg2 = _mm_sha256msg1_epu32(msg2, msg3);
+
+            msg1 = _mm_add_epi32(msg1, _mm_alignr_epi8(msg0, msg3, 4));
+            msg1 = _mm_sha256msg2_epu32(msg1, msg0);
+            SHANI_ROUNDS(msg1, k + 4);
+            msg3 = _mm_sha256msg1_epu32(msg3, msg0);
+
+            msg2 = _mm_add_epi32(msg2, _mm_alignr_epi8(msg1, msg0, 4));
+            msg2 = _mm_sha256msg2_epu32(msg2, msg1);
+            SHANI_ROUNDS(msg2, k + 8);
+            msg0 = _mm_sha256msg1_epu32(msg0, msg1);
+
+            msg3 = _mm_add_epi32(msg3, _mm_alignr_epi8(msg2, msg1, 4));
+            msg3 = _mm_sha256msg2_epu32(msg3, msg2);
+            SHANI_ROUNDS(msg3, k + 12);
+            msg1 = _mm_sha256msg1_epu32(msg1, msg2);
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        data += SHA256_BLOCK_SIZE;
+    }
+
+    // Back to ABCD/EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                         // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);                      // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);                   // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);                      // HGFE
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+static int cpu_has_shani(void) {
+    unsigned int leaf1[4] = {0};
+    unsigned int leaf7[4] = {0};
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return 0;
+    __cpuid(regs, 1);
+    memcpy(leaf1, regs, sizeof(leaf1));
+    __cpuidex(regs, 7, 0);
+    memcpy(leaf7, regs, sizeof(leaf7));
+#else
+    if (__get_cpuid_max(0, NULL) < 7) return 0;
+    __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+    __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+    int ssse3 = (leaf1[2] >> 9) & 1;
+    int sse41 = (leaf1[2] >> 19) & 1;
+    int sha = (leaf7[1] >> 29) & 1;
+    return ssse3 && sse41 && sha;
+}
+
+#endif // SHA256_HAVE_X86
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+// Written by sha256_select_implementation only, before hashing threads start
+static Sha256BlocksFn blocks_fn = sha256_blocks_scalar;
+static const char* blocks_name = "scalar";
+
+const char* sha256_select_implementation(int allow_accelerated) {
+    Sha256BlocksFn fn = sha256_blocks_scalar;
+    const char* name = "scalar";
+#ifdef SHA256_HAVE_X86
+    if (allow_accelerated && cpu_has_shani()) {
+        fn = sha256_blocks_shani;
+        name = "sha-ni";
+    }
+#else
+    (void)allow_accelerated;
+#endif
+    blocks_name = name;
+    blocks_fn = fn;
+    return name;
+}
+
+const char* sha256_get_implementation(void) {
+    return blocks_name;
+}
+
+// ============================================================================
+// Streaming API
+// ============================================================================
+
+void sha256_init(Sha256Context* ctx) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->total_len = 0;
+    ctx->buffer_len = 0;
+}
+
+void sha256_update(Sha256Context* ctx, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    Sha256BlocksFn blocks = blocks_fn;
+
+    ctx->total_len += len;
+
+    if (ctx->buffer_len > 0) {
+        size_t take = SHA256_BLOCK_SIZE - ctx->buffer_len;
+        if (take > len) take = len;
+        memcpy(ctx->buffer + ctx->buffer_len, p, take);
+        ctx->buffer_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buffer_len < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        blocks(ctx->state, ctx->buffer, 1);
+        ctx->buffer_len = 0;
+    }
+
+    // Bulk of the input is hashed in place, no copy
+    size_t full = len / SHA256_BLOCK_SIZE;
+    if (full > 0) {
+        blocks(ctx->state, p, full);
+        p += full * SHA256_BLOCK_SIZE;
+        len -= full * SHA256_BLOCK_SIZE;
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buffer, p, len);
+        ctx->buffer_len = len;
+    }
+}
+
+void sha256_final(Sha256Context* ctx, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256BlocksFn blocks = blocks_fn;
+    uint64_t bit_len = ctx->total_len * 8;
+
+    ctx->buffer[ctx->buffer_len++] = 0x80;
+    if (ctx->buffer_len > SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->buffer + ctx->buffer_len, 0, SHA256_BLOCK_SIZE - ctx->buffer_len);
+        blocks(ctx->state, ctx->buffer, 1);
+        ctx->buffer_len = 0;
+    }
+    memset(ctx->buffer + ctx->buffer_len, 0, SHA256_BLOCK_SIZE - 8 - ctx->buffer_len);
+    for (int i = 0; i < 8; i++) {
+        ctx->buffer[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bit_len >> (i * 8));
+    }
+    blocks(ctx->state, ctx->buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4 + 0] = (uint8_t)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)(ctx->state[i]);
+    }
+    memset(ctx, 0, sizeof(Sha256Context));
+}
+
+void sha256_digest(const void* data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256Context ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+}
+
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char* hex) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0x0F];
+    }
+    hex[SHA256_DIGEST_SIZE * 2] = '\0';
+}
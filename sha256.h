@@ -0,0 +1,45 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_SHA256_H
+#define PEEK_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Portable SHA-256 (no Windows dependencies) with runtime CPU dispatch:
+// SHA-NI when the CPU has it, scalar otherwise. Builds and runs on Linux too.
+// The kernel is chosen once by sha256_select_implementation at startup.
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t total_len;
+    uint8_t buffer[SHA256_BLOCK_SIZE];
+    size_t buffer_len;
+} Sha256Context;
+
+void sha256_init(Sha256Context* ctx);
+
+void sha256_update(Sha256Context* ctx, const void* data, size_t len);
+
+void sha256_final(Sha256Context* ctx, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// One-shot helper
+void sha256_digest(const void* data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// Lowercase hex, `hex` must hold 65 bytes
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char* hex);
+
+// Pick the kernel: SHA-NI when allowed and the CPU has it, scalar otherwise.
+// Call before any thread hashes (the scalar kernel runs until then); tests
+// call it again to compare the kernels. Returns the kernel name
+const char* sha256_select_implementation(int allow_accelerated);
+
+// Name of the selected kernel ("sha-ni" or "scalar")
+const char* sha256_get_implementation(void);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+* PEEK - Network Monitor
+*/
+
+// connstore.c: every filter kernel this CPU has against connstore_matches on
+// random columns and filters, for row counts on and off the 64-row blocks.
+
+#include "connstore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define ROWS 1000                       // Not a multiple of 64
+
+static const char* const KERNELS[] = {"scalar", "sse2", "avx2"};
+
+static uint32_t seed = 1;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// Few distinct values per field, so filters match a fair share of the rows
+static uint16_t random_port(void) {
+    static const uint16_t common[] = {0, 53, 80, 443, 8080, 49152, 65535};
+    return (next_random() % 2) ? common[next_random() % 7] : (uint16_t)next_random();
+}
+
+static void random_row(ConnectionRow* row) {
+    memset(row, 0, sizeof(ConnectionRow));
+    row->protocol = (next_random() % 2) ? 6 : 17;
+    row->direction = (uint8_t)(next_random() % 3);
+    row->trust = (uint8_t)(next_random() % 7);
+    row->flags = (uint8_t)(next_random() & 0x1F);
+    row->local_port = random_port();
+    row->remote_port = random_port();
+    row->local_addr = next_random();
+    row->remote_addr = (next_random() % 2) ? (0x0A000000u | (next_random() & 0xFFFF)) : next_random();
+    for (int i = 0; i < 16; i++) {
+        row->remote_addr_v6[i] = (uint8_t)next_random();
+    }
+}
+
+static void random_filter(ConnectionFilter* filter) {
+    connstore_filter_reset(filter);
+    if (next_random() % 2) filter->protocol = (next_random() % 2) ? 6 : 17;
+    if (next_random() % 3 == 0) filter->direction = (int)(next_random() % 3);
+    if (next_random() % 3 == 0) filter->trust = (int)(next_random() % 7);
+    if (next_random() % 2) {
+        filter->flags_mask = (uint8_t)(next_random() & 0x1F);
+        filter->flags_value = (uint8_t)(next_random() & 0x1F);
+    }
+    if (next_random() % 2) {
+        filter->local_port_min = random_port();
+        filter->local_port_max = random_port();   // Inverted about half the time
+    }
+    if (next_random() % 2) {
+        filter->remote_port_min = random_port();
+        filter->remote_port_max = random_port();
+    }
+    if (next_random() % 3 == 0) {
+        int prefix = (int)(next_random() % 33);
+        filter->remote_netmask = prefix ? 0xFFFFFFFFu << (32 - prefix) : 0;
+        filter->remote_net = (next_random() % 2) ? 0x0A000000u : next_random();
+    }
+}
+
+// Compare the selected kernel with connstore_matches over rows [0, count)
+static void check_filter(const ConnectionColumns* cols, const ConnectionRow* rows, int count,
+                         const ConnectionFilter* filter) {
+    uint64_t mask[CONNSTORE_MASK_WORDS(ROWS)];
+    memset(mask, 0xA5, sizeof(mask));
+    int matches = connstore_filter(cols, count, filter, mask);
+
+    int expected = 0;
+    int wrong = 0;
+    for (int i = 0; i < count; i++) {
+        int want = connstore_matches(filter, &rows[i]);
+        int got = (int)((mask[i / 64] >> (i % 64)) & 1);
+        expected += want;
+        wrong += (want != got);
+    }
+    CHECK(wrong == 0);
+    CHECK(matches == expected);
+
+    // Rows past `count` in the last word are cleared
+    if (count % 64) {
+        CHECK((mask[count / 64] >> (count % 64)) == 0);
+    }
+}
+
+static void test_kernel(const char* kernel, ConnectionColumns* cols, const ConnectionRow* rows) {
+    static const int counts[] = {1, 63, 64, 65, 127, 200, 513, ROWS};
+    uint32_t kernel_seed = seed;
+
+    for (int round = 0; round < 500; round++) {
+        ConnectionFilter filter;
+        random_filter(&filter);
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            check_filter(cols, rows, counts[c], &filter);
+        }
+    }
+
+    // Fixed cases: everything, an inverted port range, an IPv4 prefix
+    ConnectionFilter filter;
+    uint64_t mask[CONNSTORE_MASK_WORDS(ROWS)];
+    connstore_filter_reset(&filter);
+    CHECK(connstore_filter(cols, ROWS, &filter, mask) == ROWS);
+
+    filter.remote_port_min = 443;
+    filter.remote_port_max = 80;
+    CHECK(connstore_filter(cols, ROWS, &filter, mask) == 0);
+    check_filter(cols, rows, ROWS, &filter);
+
+    connstore_filter_reset(&filter);
+    filter.local_port_min = 65535;
+    filter.local_port_max = 0;
+    CHECK(connstore_filter(cols, ROWS, &filter, mask) == 0);
+
+    connstore_filter_reset(&filter);
+    filter.remote_net = 0x0A000000u;
+    filter.remote_netmask = 0xFFFF0000u;
+    check_filter(cols, rows, ROWS, &filter);
+
+    // Every kernel sees the same filters
+    seed = kernel_seed;
+    printf("connstore: %s kernel checked\n", kernel);
+}
+
+int main(void) {
+    ConnectionColumns cols;
+    ConnectionRow* rows = (ConnectionRow*)malloc(ROWS * sizeof(ConnectionRow));
+    if (!rows || connstore_init(&cols, ROWS) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    CHECK(cols.capacity % 64 == 0 && cols.capacity >= ROWS);
+
+    for (int i = 0; i < ROWS; i++) {
+        random_row(&rows[i]);
+        CHECK(connstore_append(&cols, &rows[i]) == i);
+    }
+
+    // Later edits go through the same columns
+    rows[5].trust = 3;
+    connstore_set_trust(&cols, 5, 3);
+    rows[700].flags = CONNSTORE_FLAG_FREE;
+    connstore_set_flags(&cols, 700, CONNSTORE_FLAG_FREE);
+
+    CHECK(strcmp(connstore_get_implementation(), "scalar") == 0);
+    for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+        if (!connstore_select_implementation(KERNELS[k])) {
+            printf("connstore: no %s on this CPU, skipped\n", KERNELS[k]);
+            continue;
+        }
+        CHECK(strcmp(connstore_get_implementation(), KERNELS[k]) == 0);
+        test_kernel(KERNELS[k], &cols, rows);
+    }
+    CHECK(connstore_select_implementation(NULL) != NULL);
+
+    connstore_free(&cols);
+    free(rows);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    puts("connstore: all checks passed");
+    return 0;
+}
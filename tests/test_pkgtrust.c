@@ -0,0 +1,226 @@
+/*
+* PEEK - Network Monitor
+*/
+
+// pkgtrust.c against a fake dpkg database. The build points
+// PKGTRUST_DPKG_INFO_DIR at PKGTRUST_TEST_ROOT/info; the packaged files live
+// under PKGTRUST_TEST_ROOT/usr/bin and are listed by their absolute paths.
+
+#define _DEFAULT_SOURCE
+
+#include "pkgtrust.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define MD5_TOOL "b71eb7c0309f1936cb1e28649549f44b"       // "tool v1\n"
+#define MD5_ORIGINAL "88fa9f694690e11239096536ccf2702b"   // "original\n"
+#define MD5_BETA "f0cf2a92516045024a0c99147b28f05b"       // "beta\n"
+#define MD5_GAMMA "303febb9068384eca46b5b6516843b35"      // "gamma\n"
+#define MD5_MISSING "676513fde5797c3785164942c97dfec1"    // "missing\n"
+
+static char bin_dir[1024];
+static char index_path[1024];
+
+static void path_of(char* out, size_t size, const char* name) {
+    snprintf(out, size, "%s/%s", bin_dir, name);
+}
+
+static void write_file(const char* path, const char* text) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "cannot write %s\n", path);
+        exit(2);
+    }
+    fputs(text, file);
+    fclose(file);
+}
+
+// "<digest>  <path relative to />" lines, one per name under bin_dir
+static void write_md5sums(const char* package, const char* const* names, const char* const* digests, int count) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.md5sums", PKGTRUST_DPKG_INFO_DIR, package);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "cannot write %s\n", path);
+        exit(2);
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s  %s/%s\n", digests[i], bin_dir + 1, names[i]);
+    }
+    fclose(file);
+}
+
+static void remove_package(const char* package) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.md5sums", PKGTRUST_DPKG_INFO_DIR, package);
+    unlink(path);
+}
+
+// The index notices changes through mtimes: make sure the next one differs
+static void tick(void) {
+    struct timespec pause = {0, 20 * 1000 * 1000};
+    nanosleep(&pause, NULL);
+}
+
+static TrustStatus verify(const char* name) {
+    char path[1024];
+    path_of(path, sizeof(path), name);
+    return pkgtrust_verify(path);
+}
+
+static void setup(void) {
+    char path[1024];
+    char root[512];
+    mkdir(PKGTRUST_TEST_ROOT, 0755);
+    mkdir(PKGTRUST_DPKG_INFO_DIR, 0755);
+
+    // Listed without symlinks, as dpkg does (the link check relies on it)
+    if (!realpath(PKGTRUST_TEST_ROOT, root)) {
+        fprintf(stderr, "cannot resolve %s\n", PKGTRUST_TEST_ROOT);
+        exit(2);
+    }
+    snprintf(bin_dir, sizeof(bin_dir), "%s/usr", root);
+    mkdir(bin_dir, 0755);
+    snprintf(bin_dir, sizeof(bin_dir), "%s/usr/bin", root);
+    mkdir(bin_dir, 0755);
+    snprintf(index_path, sizeof(index_path), "%s/pkgtrust.idx", root);
+
+    // Leftovers of a previous run
+    unlink(index_path);
+    remove_package("alpha");
+    remove_package("beta");
+    remove_package("gamma");
+    const char* stale[] = {"tool", "edited", "missing", "link", "stray", "beta", "gamma"};
+    for (size_t i = 0; i < sizeof(stale) / sizeof(stale[0]); i++) {
+        path_of(path, sizeof(path), stale[i]);
+        unlink(path);
+    }
+
+    path_of(path, sizeof(path), "tool");
+    write_file(path, "tool v1\n");
+    path_of(path, sizeof(path), "edited");
+    write_file(path, "tampered\n");
+    path_of(path, sizeof(path), "stray");
+    write_file(path, "not packaged\n");
+
+    char target[1024];
+    path_of(target, sizeof(target), "tool");
+    path_of(path, sizeof(path), "link");
+    if (symlink(target, path) != 0) {
+        fprintf(stderr, "cannot create %s\n", path);
+        exit(2);
+    }
+
+    const char* names[] = {"tool", "edited", "missing"};
+    const char* digests[] = {MD5_TOOL, MD5_ORIGINAL, MD5_MISSING};
+    write_md5sums("alpha", names, digests, 3);
+}
+
+static void test_verify(void) {
+    CHECK(pkgtrust_init(index_path) == 0);
+    CHECK(pkgtrust_get_entry_count() == 3);
+
+    CHECK(verify("tool") == TRUST_VERIFIED_SIGNED);
+    CHECK(verify("edited") == TRUST_INVALID);
+    CHECK(verify("missing") == TRUST_ERROR);
+    CHECK(verify("stray") == TRUST_UNSIGNED);
+    CHECK(verify("link") == TRUST_VERIFIED_SIGNED);     // Listed under its target
+    CHECK(pkgtrust_verify("relative/path") == TRUST_ERROR);
+
+    char path[1024];
+    char digest[64];
+    path_of(path, sizeof(path), "tool");
+    CHECK(pkgtrust_lookup(path, digest, sizeof(digest)) == 1);
+    CHECK(strcmp(digest, MD5_TOOL) == 0);
+    path_of(path, sizeof(path), "stray");
+    CHECK(pkgtrust_lookup(path, digest, sizeof(digest)) == 0);
+}
+
+static void test_incremental(void) {
+    // Nothing changed: no rebuild
+    CHECK(pkgtrust_refresh() == 0);
+
+    // A new package list is picked up, the others are carried over
+    tick();
+    char path[1024];
+    path_of(path, sizeof(path), "beta");
+    write_file(path, "beta\n");
+    const char* beta_names[] = {"beta"};
+    const char* beta_digests[] = {MD5_BETA};
+    write_md5sums("beta", beta_names, beta_digests, 1);
+
+    CHECK(pkgtrust_refresh() == 1);
+    CHECK(pkgtrust_get_entry_count() == 4);
+    CHECK(verify("beta") == TRUST_VERIFIED_SIGNED);
+    CHECK(verify("tool") == TRUST_VERIFIED_SIGNED);
+    CHECK(pkgtrust_refresh() == 0);
+
+    // A removed package disappears
+    tick();
+    remove_package("beta");
+    CHECK(pkgtrust_refresh() == 1);
+    CHECK(pkgtrust_get_entry_count() == 3);
+    CHECK(verify("beta") == TRUST_UNSIGNED);
+
+    // A reopened index starts from the file on disk
+    pkgtrust_cleanup();
+    CHECK(pkgtrust_init(index_path) == 0);
+    CHECK(pkgtrust_get_entry_count() == 3);
+    CHECK(pkgtrust_refresh() == 0);
+}
+
+// Permission bits do not stop root: only checked as a regular user
+static void test_unreadable_list(void) {
+    if (geteuid() == 0) {
+        puts("pkgtrust: running as root, unreadable list check skipped");
+        return;
+    }
+
+    tick();
+    char path[1024];
+    path_of(path, sizeof(path), "gamma");
+    write_file(path, "gamma\n");
+    const char* names[] = {"gamma"};
+    const char* digests[] = {MD5_GAMMA};
+    write_md5sums("gamma", names, digests, 1);
+
+    char list[1024];
+    snprintf(list, sizeof(list), "%s/gamma.md5sums", PKGTRUST_DPKG_INFO_DIR);
+    chmod(list, 0);
+    CHECK(pkgtrust_refresh() == 1);
+    CHECK(verify("gamma") == TRUST_UNSIGNED);
+
+    // Readable again without any directory change: retried, then current
+    chmod(list, 0644);
+    CHECK(pkgtrust_refresh() == 1);
+    CHECK(verify("gamma") == TRUST_VERIFIED_SIGNED);
+    CHECK(pkgtrust_refresh() == 0);
+}
+
+int main(void) {
+    setup();
+    test_verify();
+    test_incremental();
+    test_unreadable_list();
+    pkgtrust_cleanup();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    puts("pkgtrust: all checks passed");
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+* PEEK - Network Monitor
+*/
+
+// sha256.c against the FIPS 180-2 vectors, whole and streamed in odd-sized
+// pieces, with every kernel this CPU has; then scalar vs SHA-NI on random
+// inputs of every length around the block boundaries.
+
+#include "sha256.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define MILLION 1000000
+
+static const char* const FIPS_MESSAGES[] = {
+    "abc",
+    "",
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+};
+
+static const char* const FIPS_DIGESTS[] = {
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+};
+
+#define MILLION_A_DIGEST "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"
+
+// Piece sizes for the streaming path: partial, exact and multi-block updates
+static const size_t PIECES[] = {1, 3, 7, 13, 64, 63, 65, 127, 200, 1000};
+
+static void hex_digest(const void* data, size_t len, char* hex) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    sha256_digest(data, len, digest);
+    sha256_to_hex(digest, hex);
+}
+
+static void hex_streamed(const uint8_t* data, size_t len, size_t first_piece, char* hex) {
+    Sha256Context ctx;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    size_t piece = first_piece;
+
+    sha256_init(&ctx);
+    for (size_t offset = 0; offset < len; ) {
+        size_t take = PIECES[piece++ % (sizeof(PIECES) / sizeof(PIECES[0]))];
+        if (take > len - offset) {
+            take = len - offset;
+        }
+        sha256_update(&ctx, data + offset, take);
+        offset += take;
+    }
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, hex);
+}
+
+static void test_vectors(const uint8_t* million_a) {
+    char hex[SHA256_DIGEST_SIZE * 2 + 1];
+
+    for (size_t i = 0; i < sizeof(FIPS_MESSAGES) / sizeof(FIPS_MESSAGES[0]); i++) {
+        const uint8_t* message = (const uint8_t*)FIPS_MESSAGES[i];
+        size_t len = strlen(FIPS_MESSAGES[i]);
+
+        hex_digest(message, len, hex);
+        CHECK(strcmp(hex, FIPS_DIGESTS[i]) == 0);
+        for (size_t first = 0; first < sizeof(PIECES) / sizeof(PIECES[0]); first++) {
+            hex_streamed(message, len, first, hex);
+            CHECK(strcmp(hex, FIPS_DIGESTS[i]) == 0);
+        }
+    }
+
+    hex_digest(million_a, MILLION, hex);
+    CHECK(strcmp(hex, MILLION_A_DIGEST) == 0);
+    hex_streamed(million_a, MILLION, 0, hex);
+    CHECK(strcmp(hex, MILLION_A_DIGEST) == 0);
+    hex_streamed(million_a, MILLION, 5, hex);
+    CHECK(strcmp(hex, MILLION_A_DIGEST) == 0);
+}
+
+// Same digests from both kernels, for every length up to a few blocks
+static void test_kernels_agree(void) {
+    if (strcmp(sha256_select_implementation(1), "sha-ni") != 0) {
+        puts("sha256: no SHA-NI on this CPU, kernel comparison skipped");
+        return;
+    }
+
+    enum { MAX_LEN = 4 * SHA256_BLOCK_SIZE + 1 };
+    uint8_t data[MAX_LEN];
+    uint32_t seed = 1;
+    char scalar_hex[SHA256_DIGEST_SIZE * 2 + 1];
+    char shani_hex[SHA256_DIGEST_SIZE * 2 + 1];
+
+    for (int round = 0; round < 8; round++) {
+        for (size_t i = 0; i < sizeof(data); i++) {
+            seed = seed * 1103515245u + 12345u;
+            data[i] = (uint8_t)(seed >> 16);
+        }
+        for (size_t len = 0; len <= sizeof(data); len++) {
+            sha256_select_implementation(0);
+            hex_digest(data, len, scalar_hex);
+            sha256_select_implementation(1);
+            hex_digest(data, len, shani_hex);
+            CHECK(strcmp(scalar_hex, shani_hex) == 0);
+
+            hex_streamed(data, len, (size_t)round, shani_hex);
+            CHECK(strcmp(scalar_hex, shani_hex) == 0);
+        }
+    }
+}
+
+int main(void) {
+    uint8_t* million_a = (uint8_t*)malloc(MILLION);
+    if (!million_a) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    memset(million_a, 'a', MILLION);
+
+    CHECK(strcmp(sha256_get_implementation(), "scalar") == 0);
+    test_vectors(million_a);
+
+    const char* accelerated = sha256_select_implementation(1);
+    CHECK(strcmp(sha256_get_implementation(), accelerated) == 0);
+    if (strcmp(accelerated, "scalar") != 0) {
+        test_vectors(million_a);
+    }
+
+    test_kernels_agree();
+    free(million_a);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("sha256: all checks passed (%s)\n", accelerated);
+    return 0;
+}
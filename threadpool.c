@@ -0,0 +1,209 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "threadpool.h"
+#include "logger.h"
+#include "trace.h"
+#include <stdlib.h>
+
+typedef struct ThreadPoolJob {
+    ThreadPoolWorkFn work;
+    void* arg;
+    ThreadPoolCompletionFn completion;
+    void* context;
+    struct ThreadPoolJob* next;
+} ThreadPoolJob;
+
+// FIFO work queue (unbounded, jobs are small heap nodes)
+static ThreadPoolJob* queue_head = NULL;
+static ThreadPoolJob* queue_tail = NULL;
+static int queue_length = 0;
+
+static CRITICAL_SECTION pool_cs;
+static CONDITION_VARIABLE pool_cv;
+static HANDLE pool_threads[THREADPOOL_MAX_THREADS];
+static int pool_thread_count = 0;
+static BOOL pool_shutdown = FALSE;
+static BOOL pool_initialized = FALSE;
+
+static DWORD WINAPI PoolWorkerThread(LPVOID lpParam) {
+    (void)lpParam;
+    trace_name_thread("pool worker");
+
+    for (;;) {
+        EnterCriticalSection(&pool_cs);
+        while (!queue_head && !pool_shutdown) {
+            SleepConditionVariableCS(&pool_cv, &pool_cs, INFINITE);
+        }
+        if (pool_shutdown) {
+            LeaveCriticalSection(&pool_cs);
+            break;
+        }
+
+        ThreadPoolJob* job = queue_head;
+        queue_head = job->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        }
+        queue_length--;
+        LeaveCriticalSection(&pool_cs);
+
+        job->work(job->arg);
+        if (job->completion) {
+            job->completion(job->arg, job->context);
+        }
+        free(job);
+    }
+
+    return 0;
+}
+
+int threadpool_init(int num_threads) {
+    if (pool_initialized) {
+        return 0;
+    }
+
+    if (num_threads <= 0) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        num_threads = (int)si.dwNumberOfProcessors;
+    }
+    if (num_threads < 2) num_threads = 2;
+    if (num_threads > THREADPOOL_MAX_THREADS) num_threads = THREADPOOL_MAX_THREADS;
+
+    InitializeCriticalSection(&pool_cs);
+    InitializeConditionVariable(&pool_cv);
+    pool_shutdown = FALSE;
+    pool_thread_count = 0;
+
+    for (int i = 0; i < num_threads; i++) {
+        HANDLE thread = CreateThread(NULL, 0, PoolWorkerThread, NULL, 0, NULL);
+        if (thread) {
+            pool_threads[pool_thread_count++] = thread;
+        }
+    }
+
+    if (pool_thread_count == 0) {
+        LOG_ERROR("Failed to start worker pool");
+        DeleteCriticalSection(&pool_cs);
+        return -1;
+    }
+
+    pool_initialized = TRUE;
+    LOG_INFO("Worker pool started (%d threads)", pool_thread_count);
+    return 0;
+}
+
+void threadpool_cleanup(void) {
+    if (!pool_initialized) {
+        return;
+    }
+
+    EnterCriticalSection(&pool_cs);
+    pool_shutdown = TRUE;
+    ThreadPoolJob* discarded = queue_head;
+    queue_head = NULL;
+    queue_tail = NULL;
+    queue_length = 0;
+    LeaveCriticalSection(&pool_cs);
+    WakeAllConditionVariable(&pool_cv);
+
+    // Discarded jobs still complete so batch waiters are released
+    while (discarded) {
+        ThreadPoolJob* next = discarded->next;
+        if (discarded->completion) {
+            discarded->completion(discarded->arg, discarded->context);
+        }
+        free(discarded);
+        discarded = next;
+    }
+
+    WaitForMultipleObjects(pool_thread_count, pool_threads, TRUE, INFINITE);
+    for (int i = 0; i < pool_thread_count; i++) {
+        CloseHandle(pool_threads[i]);
+    }
+    pool_thread_count = 0;
+
+    DeleteCriticalSection(&pool_cs);
+    pool_initialized = FALSE;
+}
+
+int threadpool_get_thread_count(void) {
+    return pool_thread_count;
+}
+
+int threadpool_get_queue_length(void) {
+    return queue_length;
+}
+
+BOOL threadpool_submit(ThreadPoolWorkFn work, void* arg,
+                       ThreadPoolCompletionFn completion, void* context) {
+    if (!pool_initialized || !work) {
+        return FALSE;
+    }
+
+    ThreadPoolJob* job = (ThreadPoolJob*)malloc(sizeof(ThreadPoolJob));
+    if (!job) {
+        return FALSE;
+    }
+    job->work = work;
+    job->arg = arg;
+    job->completion = completion;
+    job->context = context;
+    job->next = NULL;
+
+    EnterCriticalSection(&pool_cs);
+    if (pool_shutdown) {
+        LeaveCriticalSection(&pool_cs);
+        free(job);
+        return FALSE;
+    }
+    if (queue_tail) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    queue_length++;
+    LeaveCriticalSection(&pool_cs);
+
+    WakeConditionVariable(&pool_cv);
+    return TRUE;
+}
+
+// ============================================================================
+// Batches
+// ============================================================================
+
+static void batch_job_done(void* arg, void* context) {
+    (void)arg;
+    ThreadPoolBatch* batch = (ThreadPoolBatch*)context;
+    if (InterlockedDecrement(&batch->pending) == 0) {
+        SetEvent(batch->done_event);
+    }
+}
+
+BOOL threadpool_batch_init(ThreadPoolBatch* batch) {
+    // The extra count is held by the submitter until threadpool_batch_wait
+    batch->pending = 1;
+    batch->done_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    return batch->done_event != NULL;
+}
+
+BOOL threadpool_batch_submit(ThreadPoolBatch* batch, ThreadPoolWorkFn work, void* arg) {
+    InterlockedIncrement(&batch->pending);
+    if (!threadpool_submit(work, arg, batch_job_done, batch)) {
+        InterlockedDecrement(&batch->pending);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void threadpool_batch_wait(ThreadPoolBatch* batch) {
+    if (InterlockedDecrement(&batch->pending) != 0) {
+        WaitForSingleObject(batch->done_event, INFINITE);
+    }
+    CloseHandle(batch->done_event);
+    batch->done_event = NULL;
+}
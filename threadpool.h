@@ -0,0 +1,46 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_THREADPOOL_H
+#define PEEK_THREADPOOL_H
+
+#include <windows.h>
+
+#define THREADPOOL_MAX_THREADS 64
+
+// Work runs on a pool thread. Completion (optional) runs right after it on the
+// same thread - or from threadpool_cleanup if the job was discarded at shutdown,
+// in which case the work function was never called.
+typedef void (*ThreadPoolWorkFn)(void* arg);
+typedef void (*ThreadPoolCompletionFn)(void* arg, void* context);
+
+// Group of jobs that can be waited on as a whole, without per-slot barriers:
+// every job starts as soon as a thread is free, regardless of its siblings.
+typedef struct {
+    volatile LONG pending;
+    HANDLE done_event;
+} ThreadPoolBatch;
+
+// Start the shared pool. num_threads <= 0 uses the number of logical cores.
+int threadpool_init(int num_threads);
+
+// Stop the pool: running jobs finish, queued jobs are discarded (completion still fires)
+void threadpool_cleanup(void);
+
+int threadpool_get_thread_count(void);
+
+int threadpool_get_queue_length(void);
+
+// Queue a job without blocking. Returns FALSE if the pool is not running.
+BOOL threadpool_submit(ThreadPoolWorkFn work, void* arg,
+                       ThreadPoolCompletionFn completion, void* context);
+
+BOOL threadpool_batch_init(ThreadPoolBatch* batch);
+
+BOOL threadpool_batch_submit(ThreadPoolBatch* batch, ThreadPoolWorkFn work, void* arg);
+
+// Wait for every job submitted to the batch, then release it
+void threadpool_batch_wait(ThreadPoolBatch* batch);
+
+#endif
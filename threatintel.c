@@ -0,0 +1,679 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "threatintel.h"
+#include "logger.h"
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shlobj.h>
+
+// ============================================================================
+// Compiled feed image (feeds-<stamp>.bin, little-endian)
+// ============================================================================
+//
+// [ThreatFeedHeader (64 bytes)][Bloom blocks][IPv4 DWORDs][IPv6 16B][SHA-256 32B]
+//
+// The Bloom filter is "blocked": every key maps to one 64-byte block and all
+// of its probe bits live inside that block, so a negative answer costs a single
+// cache miss. The sorted arrays give exact answers for the rare "maybe".
+
+#define THREATINTEL_MAGIC 0x46495450  // "PTIF"
+#define THREATINTEL_VERSION 1
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_PROBES 7
+
+#define KEY_IPV4 4
+#define KEY_IPV6 6
+#define KEY_SHA256 32
+
+typedef struct {
+    DWORD magic;
+    DWORD version;
+    ULONGLONG source_stamp;   // Fingerprint of the feed files this image was built from
+    DWORD bloom_blocks;
+    DWORD v4_count;
+    DWORD v6_count;
+    DWORD hash_count;
+    ULONGLONG bloom_offset;
+    ULONGLONG v4_offset;
+    ULONGLONG v6_offset;
+    ULONGLONG hash_offset;
+} ThreatFeedHeader;
+
+typedef struct {
+    HANDLE file;
+    HANDLE mapping;
+    const BYTE* view;
+    char path[MAX_PATH];
+    ULONGLONG stamp;
+    const ULONGLONG* bloom;   // bloom_blocks * 8 words
+    DWORD bloom_blocks;
+    const DWORD* v4;
+    DWORD v4_count;
+    const BYTE* v6;
+    DWORD v6_count;
+    const BYTE* hashes;
+    DWORD hash_count;
+} ThreatFeed;
+
+// Active feed, swapped atomically under an exclusive lock
+static ThreatFeed* active_feed = NULL;
+static SRWLOCK feed_lock = SRWLOCK_INIT;
+
+static char feeds_dir[MAX_PATH] = {0};
+static char image_dir[MAX_PATH] = {0};
+static HANDLE refresh_thread = NULL;
+static HANDLE stop_event = NULL;
+static BOOL threatintel_initialized = FALSE;
+
+// ============================================================================
+// Hashing & Bloom filter
+// ============================================================================
+
+static ULONGLONG hash_key(BYTE type, const BYTE* data, size_t len) {
+    // FNV-1a 64 followed by a splitmix finalizer for well-spread bits
+    ULONGLONG h = 14695981039346656037ULL;
+    h ^= type;
+    h *= 1099511628211ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static DWORD bloom_block_index(ULONGLONG h, DWORD blocks) {
+    // Multiply-shift range reduction (avoids a 64-bit modulo)
+    return (DWORD)(((h >> 32) * (ULONGLONG)blocks) >> 32);
+}
+
+static void bloom_add(ULONGLONG* bloom, DWORD blocks, ULONGLONG h) {
+    ULONGLONG* block = &bloom[(size_t)bloom_block_index(h, blocks) * 8];
+    DWORD h1 = (DWORD)h;
+    DWORD h2 = (DWORD)(h >> 23) | 1;
+    for (DWORD i = 0; i < BLOOM_PROBES; i++) {
+        DWORD bit = (h1 + i * h2) & (BLOOM_BLOCK_BITS - 1);
+        block[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static BOOL bloom_test(const ULONGLONG* bloom, DWORD blocks, ULONGLONG h) {
+    const ULONGLONG* block = &bloom[(size_t)bloom_block_index(h, blocks) * 8];
+    DWORD h1 = (DWORD)h;
+    DWORD h2 = (DWORD)(h >> 23) | 1;
+    for (DWORD i = 0; i < BLOOM_PROBES; i++) {
+        DWORD bit = (h1 + i * h2) & (BLOOM_BLOCK_BITS - 1);
+        if ((block[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// ============================================================================
+// Exact lookups on the sorted arrays
+// ============================================================================
+
+static BOOL search_v4(const DWORD* values, DWORD count, DWORD value) {
+    DWORD lo = 0, hi = count;
+    while (lo < hi) {
+        DWORD mid = lo + (hi - lo) / 2;
+        if (values[mid] == value) return TRUE;
+        if (values[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return FALSE;
+}
+
+static BOOL search_bytes(const BYTE* values, DWORD count, size_t width, const BYTE* value) {
+    DWORD lo = 0, hi = count;
+    while (lo < hi) {
+        DWORD mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(values + (size_t)mid * width, value, width);
+        if (cmp == 0) return TRUE;
+        if (cmp < 0) lo = mid + 1; else hi = mid;
+    }
+    return FALSE;
+}
+
+static BOOL feed_contains(BYTE type, const BYTE* data, size_t len) {
+    BOOL hit = FALSE;
+    ULONGLONG h = hash_key(type, data, len);
+
+    AcquireSRWLockShared(&feed_lock);
+    const ThreatFeed* feed = active_feed;
+    if (feed && feed->bloom_blocks > 0 && bloom_test(feed->bloom, feed->bloom_blocks, h)) {
+        if (type == KEY_IPV4) {
+            DWORD value;
+            memcpy(&value, data, 4);
+            hit = search_v4(feed->v4, feed->v4_count, value);
+        } else if (type == KEY_IPV6) {
+            hit = search_bytes(feed->v6, feed->v6_count, 16, data);
+        } else {
+            hit = search_bytes(feed->hashes, feed->hash_count, 32, data);
+        }
+    }
+    ReleaseSRWLockShared(&feed_lock);
+
+    return hit;
+}
+
+BOOL threatintel_check_ipv4(DWORD addr) {
+    // Feeds store IPv4 in host order so the array sorts numerically
+    const BYTE* b = (const BYTE*)&addr;
+    DWORD value = ((DWORD)b[0] << 24) | ((DWORD)b[1] << 16) | ((DWORD)b[2] << 8) | b[3];
+    return feed_contains(KEY_IPV4, (const BYTE*)&value, 4);
+}
+
+BOOL threatintel_check_ipv6(const BYTE* addr) {
+    return feed_contains(KEY_IPV6, addr, 16);
+}
+
+static BOOL parse_sha256_hex(const char* hex, BYTE* out) {
+    for (int i = 0; i < 32; i++) {
+        int value = 0;
+        for (int j = 0; j < 2; j++) {
+            char c = hex[i * 2 + j];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return FALSE;
+        }
+        out[i] = (BYTE)value;
+    }
+    return TRUE;
+}
+
+BOOL threatintel_check_sha256(const char* hash_hex) {
+    BYTE digest[32];
+    if (!hash_hex || strlen(hash_hex) != 64 || !parse_sha256_hex(hash_hex, digest)) {
+        return FALSE;
+    }
+    return feed_contains(KEY_SHA256, digest, 32);
+}
+
+// ============================================================================
+// Feed compilation
+// ============================================================================
+
+typedef struct {
+    BYTE* data;
+    size_t width;
+    size_t count;
+    size_t capacity;
+} EntryArray;
+
+static BOOL entry_array_push(EntryArray* arr, const void* value) {
+    if (arr->count == arr->capacity) {
+        size_t new_capacity = arr->capacity ? arr->capacity * 2 : 4096;
+        BYTE* grown = (BYTE*)realloc(arr->data, new_capacity * arr->width);
+        if (!grown) {
+            return FALSE;
+        }
+        arr->data = grown;
+        arr->capacity = new_capacity;
+    }
+    memcpy(arr->data + arr->count * arr->width, value, arr->width);
+    arr->count++;
+    return TRUE;
+}
+
+static int compare_dword(const void* a, const void* b) {
+    DWORD x = *(const DWORD*)a, y = *(const DWORD*)b;
+    return (x > y) - (x < y);
+}
+
+static int compare_16(const void* a, const void* b) {
+    return memcmp(a, b, 16);
+}
+
+static int compare_32(const void* a, const void* b) {
+    return memcmp(a, b, 32);
+}
+
+static void entry_array_sort_unique(EntryArray* arr, int (*compare)(const void*, const void*)) {
+    if (arr->count < 2) {
+        return;
+    }
+    qsort(arr->data, arr->count, arr->width, compare);
+
+    size_t write = 1;
+    for (size_t read = 1; read < arr->count; read++) {
+        if (memcmp(arr->data + read * arr->width, arr->data + (write - 1) * arr->width, arr->width) != 0) {
+            if (write != read) {
+                memcpy(arr->data + write * arr->width, arr->data + read * arr->width, arr->width);
+            }
+            write++;
+        }
+    }
+    arr->count = write;
+}
+
+static void parse_feed_line(char* line, EntryArray* v4, EntryArray* v6, EntryArray* hashes) {
+    // Trim leading whitespace and cut at comment / whitespace / separator
+    while (*line == ' ' || *line == '\t') line++;
+    char* end = line;
+    while (*end && *end != '#' && *end != ' ' && *end != '\t' &&
+           *end != '\r' && *end != '\n' && *end != ',' && *end != ';') {
+        end++;
+    }
+    *end = '\0';
+    if (*line == '\0') {
+        return;
+    }
+
+    size_t len = strlen(line);
+    if (len == 64) {
+        BYTE digest[32];
+        if (parse_sha256_hex(line, digest)) {
+            entry_array_push(hashes, digest);
+        }
+        return;
+    }
+
+    BYTE addr[16];
+    if (strchr(line, ':')) {
+        if (inet_pton(AF_INET6, line, addr) == 1) {
+            entry_array_push(v6, addr);
+        }
+    } else if (inet_pton(AF_INET, line, addr) == 1) {
+        DWORD value = ((DWORD)addr[0] << 24) | ((DWORD)addr[1] << 16) | ((DWORD)addr[2] << 8) | addr[3];
+        entry_array_push(v4, &value);
+    }
+}
+
+static void stamp_mix(ULONGLONG* stamp, const void* data, size_t len) {
+    const BYTE* bytes = (const BYTE*)data;
+    for (size_t i = 0; i < len; i++) {
+        *stamp ^= bytes[i];
+        *stamp *= 1099511628211ULL;
+    }
+}
+
+// Fingerprint of the feed directory (names, sizes, mtimes). 0 = no feeds.
+static ULONGLONG compute_source_stamp(void) {
+    char pattern[MAX_PATH];
+    snprintf(pattern, MAX_PATH, "%s\\*.txt", feeds_dir);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind = FindFirstFileA(pattern, &fd);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+
+    // FindFirstFile order is stable on NTFS (sorted by name)
+    ULONGLONG stamp = 14695981039346656037ULL;
+    int files = 0;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        stamp_mix(&stamp, fd.cFileName, strlen(fd.cFileName));
+        stamp_mix(&stamp, &fd.nFileSizeLow, sizeof(fd.nFileSizeLow));
+        stamp_mix(&stamp, &fd.nFileSizeHigh, sizeof(fd.nFileSizeHigh));
+        stamp_mix(&stamp, &fd.ftLastWriteTime, sizeof(fd.ftLastWriteTime));
+        files++;
+    } while (FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+
+    return (files > 0) ? (stamp | 1) : 0;
+}
+
+static BOOL write_section(HANDLE hFile, const void* data, size_t size) {
+    const BYTE* bytes = (const BYTE*)data;
+    while (size > 0) {
+        DWORD chunk = (size > (1u << 30)) ? (1u << 30) : (DWORD)size;
+        DWORD written = 0;
+        if (!WriteFile(hFile, bytes, chunk, &written, NULL) || written != chunk) {
+            return FALSE;
+        }
+        bytes += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+// Parse every feed file and write a compiled image to `image_path`
+static BOOL compile_feeds(ULONGLONG stamp, const char* image_path) {
+    EntryArray v4 = {NULL, 4, 0, 0};
+    EntryArray v6 = {NULL, 16, 0, 0};
+    EntryArray hashes = {NULL, 32, 0, 0};
+    BOOL success = FALSE;
+    ULONGLONG* bloom = NULL;
+
+    char pattern[MAX_PATH];
+    snprintf(pattern, MAX_PATH, "%s\\*.txt", feeds_dir);
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind = FindFirstFileA(pattern, &fd);
+    if (hFind != INVALID_HANDLE_VALUE) {
+        do {
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                continue;
+            }
+            char feed_path[MAX_PATH];
+            snprintf(feed_path, MAX_PATH, "%s\\%s", feeds_dir, fd.cFileName);
+            FILE* f = fopen(feed_path, "rb");
+            if (!f) {
+                LOG_WARNING("Unable to open threat feed: %s", feed_path);
+                continue;
+            }
+            char line[512];
+            while (fgets(line, sizeof(line), f)) {
+                parse_feed_line(line, &v4, &v6, &hashes);
+            }
+            fclose(f);
+        } while (FindNextFileA(hFind, &fd));
+        FindClose(hFind);
+    }
+
+    entry_array_sort_unique(&v4, compare_dword);
+    entry_array_sort_unique(&v6, compare_16);
+    entry_array_sort_unique(&hashes, compare_32);
+
+    size_t total = v4.count + v6.count + hashes.count;
+    DWORD blocks = (DWORD)((total * THREATINTEL_BLOOM_BITS_PER_ENTRY + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS);
+    if (blocks == 0) blocks = 1;
+
+    bloom = (ULONGLONG*)calloc((size_t)blocks * 8, sizeof(ULONGLONG));
+    if (!bloom) {
+        LOG_ERROR("Out of memory building threat feed Bloom filter");
+        goto cleanup;
+    }
+    for (size_t i = 0; i < v4.count; i++) {
+        bloom_add(bloom, blocks, hash_key(KEY_IPV4, v4.data + i * 4, 4));
+    }
+    for (size_t i = 0; i < v6.count; i++) {
+        bloom_add(bloom, blocks, hash_key(KEY_IPV6, v6.data + i * 16, 16));
+    }
+    for (size_t i = 0; i < hashes.count; i++) {
+        bloom_add(bloom, blocks, hash_key(KEY_SHA256, hashes.data + i * 32, 32));
+    }
+
+    ThreatFeedHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = THREATINTEL_MAGIC;
+    header.version = THREATINTEL_VERSION;
+    header.source_stamp = stamp;
+    header.bloom_blocks = blocks;
+    header.v4_count = (DWORD)v4.count;
+    header.v6_count = (DWORD)v6.count;
+    header.hash_count = (DWORD)hashes.count;
+    header.bloom_offset = sizeof(ThreatFeedHeader);
+    header.v4_offset = header.bloom_offset + (ULONGLONG)blocks * 64;
+    header.v6_offset = header.v4_offset + (ULONGLONG)v4.count * 4;
+    header.hash_offset = header.v6_offset + (ULONGLONG)v6.count * 16;
+
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, MAX_PATH, "%s.tmp", image_path);
+    HANDLE hFile = CreateFileA(temp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Failed to create threat feed image: %lu", GetLastError());
+        goto cleanup;
+    }
+
+    BOOL written = write_section(hFile, &header, sizeof(header)) &&
+                   write_section(hFile, bloom, (size_t)blocks * 64) &&
+                   write_section(hFile, v4.data, v4.count * 4) &&
+                   write_section(hFile, v6.data, v6.count * 16) &&
+                   write_section(hFile, hashes.data, hashes.count * 32);
+    CloseHandle(hFile);
+
+    if (!written || !MoveFileExA(temp_path, image_path, MOVEFILE_REPLACE_EXISTING)) {
+        LOG_ERROR("Failed to write threat feed image: %lu", GetLastError());
+        DeleteFileA(temp_path);
+        goto cleanup;
+    }
+
+    LOG_SUCCESS("Compiled threat feeds: %zu IPv4, %zu IPv6, %zu SHA-256 (%lu KB Bloom)",
+                v4.count, v6.count, hashes.count, (unsigned long)(blocks * 64 / 1024));
+    success = TRUE;
+
+cleanup:
+    free(bloom);
+    free(v4.data);
+    free(v6.data);
+    free(hashes.data);
+    return success;
+}
+
+// ============================================================================
+// Feed image mapping & hot swap
+// ============================================================================
+
+static void unmap_feed(ThreatFeed* feed) {
+    if (!feed) {
+        return;
+    }
+    if (feed->view) UnmapViewOfFile(feed->view);
+    if (feed->mapping) CloseHandle(feed->mapping);
+    if (feed->file != INVALID_HANDLE_VALUE) CloseHandle(feed->file);
+    free(feed);
+}
+
+static ThreatFeed* map_feed(const char* path, ULONGLONG expected_stamp) {
+    ThreatFeed* feed = (ThreatFeed*)calloc(1, sizeof(ThreatFeed));
+    if (!feed) {
+        return NULL;
+    }
+    feed->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (feed->file == INVALID_HANDLE_VALUE) {
+        free(feed);
+        return NULL;
+    }
+    strncpy(feed->path, path, MAX_PATH - 1);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(feed->file, &size) || size.QuadPart < (LONGLONG)sizeof(ThreatFeedHeader)) {
+        unmap_feed(feed);
+        return NULL;
+    }
+
+    feed->mapping = CreateFileMappingA(feed->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    feed->view = feed->mapping ? (const BYTE*)MapViewOfFile(feed->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!feed->view) {
+        unmap_feed(feed);
+        return NULL;
+    }
+
+    const ThreatFeedHeader* header = (const ThreatFeedHeader*)feed->view;
+    ULONGLONG file_size = (ULONGLONG)size.QuadPart;
+    if (header->magic != THREATINTEL_MAGIC || header->version != THREATINTEL_VERSION ||
+        header->source_stamp != expected_stamp ||
+        header->bloom_offset + (ULONGLONG)header->bloom_blocks * 64 > file_size ||
+        header->v4_offset + (ULONGLONG)header->v4_count * 4 > file_size ||
+        header->v6_offset + (ULONGLONG)header->v6_count * 16 > file_size ||
+        header->hash_offset + (ULONGLONG)header->hash_count * 32 > file_size) {
+        unmap_feed(feed);
+        return NULL;
+    }
+
+    feed->stamp = header->source_stamp;
+    feed->bloom = (const ULONGLONG*)(feed->view + header->bloom_offset);
+    feed->bloom_blocks = header->bloom_blocks;
+    feed->v4 = (const DWORD*)(feed->view + header->v4_offset);
+    feed->v4_count = header->v4_count;
+    feed->v6 = feed->view + header->v6_offset;
+    feed->v6_count = header->v6_count;
+    feed->hashes = feed->view + header->hash_offset;
+    feed->hash_count = header->hash_count;
+    return feed;
+}
+
+static void swap_feed(ThreatFeed* feed) {
+    AcquireSRWLockExclusive(&feed_lock);
+    ThreatFeed* old = active_feed;
+    active_feed = feed;
+    ReleaseSRWLockExclusive(&feed_lock);
+
+    // No reader can still hold the old image once the exclusive lock was granted
+    if (old) {
+        char old_path[MAX_PATH];
+        strcpy(old_path, old->path);
+        unmap_feed(old);
+        if (!feed || strcmp(old_path, feed->path) != 0) {
+            DeleteFileA(old_path);
+        }
+    }
+}
+
+// Delete every compiled image but `keep` (NULL: all of them), including
+// images left by earlier runs under other stamps and interrupted compiles.
+// Only the refresh thread compiles or maps images, so none is in use here
+static void prune_feed_images(const char* keep) {
+    char pattern[MAX_PATH];
+    snprintf(pattern, MAX_PATH, "%s\\feeds-*", image_dir);
+
+    WIN32_FIND_DATAA fd;
+    HANDLE find = FindFirstFileA(pattern, &fd);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    const char* keep_name = NULL;
+    if (keep) {
+        keep_name = strrchr(keep, '\\');
+        keep_name = keep_name ? keep_name + 1 : keep;
+    }
+
+    int removed = 0;
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        // The wildcard also matches short names: check the suffix ourselves
+        size_t len = strlen(fd.cFileName);
+        BOOL image = (len > 4 && lstrcmpiA(fd.cFileName + len - 4, ".bin") == 0) ||
+                     (len > 8 && lstrcmpiA(fd.cFileName + len - 8, ".bin.tmp") == 0);
+        if (!image || (keep_name && lstrcmpiA(fd.cFileName, keep_name) == 0)) {
+            continue;
+        }
+
+        char path[MAX_PATH];
+        snprintf(path, MAX_PATH, "%s\\%s", image_dir, fd.cFileName);
+        if (DeleteFileA(path)) {
+            removed++;
+        }
+    } while (FindNextFileA(find, &fd));
+    FindClose(find);
+
+    if (removed > 0) {
+        LOG_INFO("Removed %d stale threat feed image(s)", removed);
+    }
+}
+
+// Load the image matching the current feed files, compiling it first if needed
+static void refresh_feeds(void) {
+    ULONGLONG stamp = compute_source_stamp();
+
+    AcquireSRWLockShared(&feed_lock);
+    ULONGLONG active_stamp = active_feed ? active_feed->stamp : 0;
+    ReleaseSRWLockShared(&feed_lock);
+
+    if (stamp == active_stamp) {
+        return;
+    }
+    if (stamp == 0) {
+        if (active_stamp != 0) {
+            LOG_INFO("Threat feeds removed - blocklist matching disabled");
+            swap_feed(NULL);
+            prune_feed_images(NULL);
+        }
+        return;
+    }
+
+    // Images are versioned by stamp so a mapped image is never overwritten
+    char image_path[MAX_PATH];
+    snprintf(image_path, MAX_PATH, "%s\\feeds-%016llx.bin", image_dir, stamp);
+
+    ThreatFeed* feed = map_feed(image_path, stamp);
+    if (!feed) {
+        if (!compile_feeds(stamp, image_path)) {
+            return;
+        }
+        feed = map_feed(image_path, stamp);
+        if (!feed) {
+            LOG_ERROR("Failed to map compiled threat feed image");
+            return;
+        }
+    }
+
+    swap_feed(feed);
+    LOG_SUCCESS("Threat feeds active (%lu IPv4, %lu IPv6, %lu SHA-256)",
+                feed->v4_count, feed->v6_count, feed->hash_count);
+
+    // Feeds changed while Peek was not running leave one image per stamp
+    prune_feed_images(image_path);
+}
+
+static DWORD WINAPI ThreatFeedRefreshThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    do {
+        refresh_feeds();
+    } while (WaitForSingleObject(stop_event, THREATINTEL_REFRESH_MS) == WAIT_TIMEOUT);
+
+    return 0;
+}
+
+int threatintel_init(void) {
+    if (threatintel_initialized) {
+        return 0;
+    }
+
+    char appdata[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(image_dir, MAX_PATH, "%s\\Peek", appdata);
+    } else {
+        strcpy(image_dir, ".");
+    }
+    CreateDirectoryA(image_dir, NULL);
+    snprintf(feeds_dir, MAX_PATH, "%s\\feeds", image_dir);
+
+    stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!stop_event) {
+        return -1;
+    }
+
+    // First load happens on the thread too: compiling 10M entries must not delay startup
+    refresh_thread = CreateThread(NULL, 0, ThreatFeedRefreshThread, NULL, 0, NULL);
+    if (!refresh_thread) {
+        CloseHandle(stop_event);
+        stop_event = NULL;
+        return -1;
+    }
+
+    threatintel_initialized = TRUE;
+    return 0;
+}
+
+void threatintel_cleanup(void) {
+    if (!threatintel_initialized) {
+        return;
+    }
+
+    SetEvent(stop_event);
+    WaitForSingleObject(refresh_thread, INFINITE);
+    CloseHandle(refresh_thread);
+    CloseHandle(stop_event);
+    refresh_thread = NULL;
+    stop_event = NULL;
+
+    AcquireSRWLockExclusive(&feed_lock);
+    ThreatFeed* feed = active_feed;
+    active_feed = NULL;
+    ReleaseSRWLockExclusive(&feed_lock);
+    unmap_feed(feed);
+
+    threatintel_initialized = FALSE;
+}
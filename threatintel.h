@@ -0,0 +1,29 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_THREATINTEL_H
+#define PEEK_THREATINTEL_H
+
+#include <windows.h>
+
+#define THREATINTEL_REFRESH_MS (60 * 1000)  // How often feed files are checked for changes
+#define THREATINTEL_BLOOM_BITS_PER_ENTRY 10  // ~1% false positive rate before the exact check
+
+// Load local threat feeds from %APPDATA%\Peek\feeds\*.txt (one IPv4, IPv6 or
+// SHA-256 hex entry per line, '#' comments). Feeds are compiled into a
+// memory-mapped image (Bloom filter + sorted arrays) and hot-swapped when the
+// source files change. Compilation runs on a background thread.
+int threatintel_init(void);
+
+void threatintel_cleanup(void);
+
+// Membership checks: one Bloom probe (single cache line), plus a binary
+// search only when the filter says "maybe". Safe from any thread.
+BOOL threatintel_check_ipv4(DWORD addr);
+
+BOOL threatintel_check_ipv6(const BYTE* addr);
+
+BOOL threatintel_check_sha256(const char* hash_hex);
+
+#endif
@@ -0,0 +1,365 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "trace.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shlobj.h>
+
+#define TRACE_RING_MASK (TRACE_EVENTS_PER_THREAD - 1)
+#define TRACE_MAX_DEPTH 64
+
+typedef struct {
+    LONG64 timestamp;                   // QueryPerformanceCounter ticks
+    const char* name;
+    char phase;                         // 'B' or 'E'
+    char detail[TRACE_DETAIL_SIZE];
+} TraceEvent;
+
+// Written only by its own thread; the dump reads `count` first, then events.
+// A slot outlives its thread: the events stay in the dump until another
+// thread reuses the slot
+typedef struct {
+    DWORD thread_id;
+    const char* name;
+    TraceEvent* events;                 // Allocated on the first event, kept on reuse
+    volatile LONG64 count;              // Events ever written (ring index = count & mask)
+    volatile LONG in_use;               // Cleared when the owning thread exits (1 until first used)
+} ThreadTrace;
+
+volatile LONG trace_enabled = 0;
+
+static ThreadTrace threads[TRACE_MAX_THREADS];
+static volatile LONG thread_count = 0;
+static ThreadTrace overflow_thread;     // Threads finding no free slot land here and record nothing
+static DWORD fls_index = FLS_OUT_OF_INDEXES;
+
+static LONG64 trace_origin = 0;
+static double us_per_tick = 0.0;
+
+// Serializes start / stop / dump
+static CRITICAL_SECTION control_cs;
+static BOOL trace_initialized = FALSE;
+
+// Fiber-local destructor: runs when a thread that traced exits
+static void WINAPI release_thread_trace(PVOID data) {
+    ThreadTrace* t = (ThreadTrace*)data;
+    if (t) {
+        InterlockedExchange(&t->in_use, 0);
+    }
+}
+
+// Slot of an exited thread (short-lived export threads, restarted pool
+// workers). Its events are dropped, so unused slots are taken first
+static ThreadTrace* reuse_thread_trace(void) {
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        ThreadTrace* t = &threads[i];
+        if (t->in_use == 0 && InterlockedCompareExchange(&t->in_use, 1, 0) == 0) {
+            // Not while a dump or a restart reads the slot
+            EnterCriticalSection(&control_cs);
+            t->thread_id = GetCurrentThreadId();
+            t->name = NULL;
+            t->count = 0;
+            LeaveCriticalSection(&control_cs);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static ThreadTrace* current_thread_trace(void) {
+    if (fls_index == FLS_OUT_OF_INDEXES) {
+        return NULL;
+    }
+
+    ThreadTrace* t = (ThreadTrace*)FlsGetValue(fls_index);
+    if (t) {
+        return t;
+    }
+
+    LONG slot = (thread_count < TRACE_MAX_THREADS) ? InterlockedIncrement(&thread_count) - 1 : TRACE_MAX_THREADS;
+    if (slot < TRACE_MAX_THREADS) {
+        t = &threads[slot];
+        t->thread_id = GetCurrentThreadId();
+    } else {
+        t = reuse_thread_trace();
+        if (!t) {
+            // Not remembered: the next event looks for a freed slot again
+            return &overflow_thread;
+        }
+    }
+    FlsSetValue(fls_index, t);
+    return t;
+}
+
+void trace_event(char phase, const char* name, const char* detail) {
+    ThreadTrace* t = current_thread_trace();
+    if (!t || t == &overflow_thread) {
+        return;
+    }
+
+    if (!t->events) {
+        t->events = (TraceEvent*)VirtualAlloc(NULL, TRACE_EVENTS_PER_THREAD * sizeof(TraceEvent),
+                                              MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!t->events) {
+            return;
+        }
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    TraceEvent* e = &t->events[t->count & TRACE_RING_MASK];
+    e->timestamp = now.QuadPart;
+    e->name = name;
+    e->phase = phase;
+    e->detail[0] = '\0';
+    if (detail) {
+        // Paths are shortened to their file name
+        const char* base = strrchr(detail, '\\');
+        base = base ? base + 1 : detail;
+        strncpy(e->detail, base, TRACE_DETAIL_SIZE - 1);
+        e->detail[TRACE_DETAIL_SIZE - 1] = '\0';
+    }
+
+    t->count++;
+}
+
+void trace_name_thread(const char* name) {
+    ThreadTrace* t = current_thread_trace();
+    if (t && t != &overflow_thread) {
+        t->name = name;
+    }
+}
+
+// ============================================================================
+// Chrome trace-event JSON
+// ============================================================================
+
+static void write_json_string(FILE* f, const char* text) {
+    fputc('"', f);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', f);
+            fputc(*p, f);
+        } else if (*p < 0x20) {
+            fprintf(f, "\\u%04x", *p);
+        } else {
+            fputc(*p, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void write_event(FILE* f, BOOL* first, DWORD pid, DWORD tid, char phase,
+                        const char* name, double ts, const char* detail) {
+    fputs(*first ? "\n" : ",\n", f);
+    *first = FALSE;
+
+    fprintf(f, "{\"ph\":\"%c\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f", phase,
+            (unsigned long)pid, (unsigned long)tid, ts);
+    if (name) {
+        fputs(",\"name\":", f);
+        write_json_string(f, name);
+    }
+    if (detail && detail[0]) {
+        fputs(",\"args\":{\"detail\":", f);
+        write_json_string(f, detail);
+        fputc('}', f);
+    }
+    fputc('}', f);
+}
+
+static void write_thread(FILE* f, BOOL* first, DWORD pid, const ThreadTrace* t) {
+    LONG64 count = t->count;
+    if (count == 0 || !t->events) {
+        return;
+    }
+
+    if (t->name) {
+        fputs(*first ? "\n" : ",\n", f);
+        *first = FALSE;
+        fprintf(f, "{\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"name\":\"thread_name\",\"args\":{\"name\":",
+                (unsigned long)pid, (unsigned long)t->thread_id);
+        write_json_string(f, t->name);
+        fputs("}}", f);
+    }
+
+    // After a wrap the oldest surviving events may end spans whose begin was
+    // overwritten: skip those, and close spans still open at the end
+    LONG64 start = (count > TRACE_EVENTS_PER_THREAD) ? count - TRACE_EVENTS_PER_THREAD : 0;
+    int depth = 0;
+    double last_ts = 0.0;
+    for (LONG64 i = start; i < count; i++) {
+        const TraceEvent* e = &t->events[i & TRACE_RING_MASK];
+        if (e->phase == 'E') {
+            if (depth == 0) {
+                continue;
+            }
+            depth--;
+        } else {
+            depth++;
+        }
+        last_ts = (double)(e->timestamp - trace_origin) * us_per_tick;
+        write_event(f, first, pid, t->thread_id, e->phase, e->name, last_ts, e->detail);
+    }
+    for (; depth > 0; depth--) {
+        write_event(f, first, pid, t->thread_id, 'E', NULL, last_ts, NULL);
+    }
+}
+
+int trace_dump(const char* path) {
+    if (!trace_initialized) {
+        return -1;
+    }
+
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    setvbuf(f, NULL, _IOFBF, 256 * 1024);
+
+    EnterCriticalSection(&control_cs);
+
+    DWORD pid = GetCurrentProcessId();
+    BOOL first = TRUE;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+
+    LONG registered = thread_count;
+    if (registered > TRACE_MAX_THREADS) {
+        registered = TRACE_MAX_THREADS;
+    }
+    for (LONG i = 0; i < registered; i++) {
+        write_thread(f, &first, pid, &threads[i]);
+    }
+
+    fputs("\n]}\n", f);
+    LeaveCriticalSection(&control_cs);
+
+    BOOL ok = !ferror(f);
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+// ============================================================================
+// Control
+// ============================================================================
+
+void trace_start(void) {
+    if (!trace_initialized) {
+        return;
+    }
+
+    EnterCriticalSection(&control_cs);
+    InterlockedExchange(&trace_enabled, 0);
+
+    LONG registered = thread_count;
+    if (registered > TRACE_MAX_THREADS) {
+        registered = TRACE_MAX_THREADS;
+    }
+    for (LONG i = 0; i < registered; i++) {
+        threads[i].count = 0;
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    trace_origin = now.QuadPart;
+
+    InterlockedExchange(&trace_enabled, 1);
+    LeaveCriticalSection(&control_cs);
+}
+
+int trace_stop(char* path_out, size_t path_size) {
+    if (!trace_initialized) {
+        return -1;
+    }
+
+    InterlockedExchange(&trace_enabled, 0);
+    Sleep(1);  // Let an event that passed the check before the switch land
+
+    char dir[MAX_PATH];
+    char appdata[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(dir, MAX_PATH, "%s\\Peek", appdata);
+        CreateDirectoryA(dir, NULL);
+        snprintf(dir, MAX_PATH, "%s\\Peek\\traces", appdata);
+    } else {
+        // Fallback to current directory
+        strcpy(dir, "traces");
+    }
+    CreateDirectoryA(dir, NULL);
+
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    snprintf(path_out, path_size, "%s\\peek-trace-%04u%02u%02u-%02u%02u%02u.json",
+             dir, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+
+    return trace_dump(path_out);
+}
+
+void trace_init(void) {
+    if (trace_initialized) {
+        return;
+    }
+
+    InitializeCriticalSection(&control_cs);
+    fls_index = FlsAlloc(release_thread_trace);
+
+    // Slots not handed out yet are not reusable
+    for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+        threads[i].in_use = 1;
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    us_per_tick = 1e6 / (double)frequency.QuadPart;
+
+    trace_initialized = (fls_index != FLS_OUT_OF_INDEXES);
+    if (!trace_initialized) {
+        LOG_WARNING("Tracing unavailable (no FLS slot)");
+        return;
+    }
+
+    trace_name_thread("UI");
+
+    char value[8];
+    DWORD len = GetEnvironmentVariableA("PEEK_TRACE", value, sizeof(value));
+    if (len > 0 && len < sizeof(value) && strcmp(value, "0") != 0) {
+        trace_start();
+        LOG_INFO("Tracing enabled (F12 writes the trace)");
+    }
+}
+
+void trace_cleanup(void) {
+    if (!trace_initialized) {
+        return;
+    }
+
+    if (trace_enabled) {
+        char path[MAX_PATH];
+        if (trace_stop(path, sizeof(path)) == 0) {
+            LOG_SUCCESS("Trace written to %s", path);
+        } else {
+            LOG_ERROR("Unable to write the trace");
+        }
+    }
+
+    // Worker threads are gone by now
+    LONG registered = thread_count;
+    if (registered > TRACE_MAX_THREADS) {
+        registered = TRACE_MAX_THREADS;
+    }
+    for (LONG i = 0; i < registered; i++) {
+        if (threads[i].events) {
+            VirtualFree(threads[i].events, 0, MEM_RELEASE);
+            threads[i].events = NULL;
+        }
+    }
+
+    FlsFree(fls_index);
+    fls_index = FLS_OUT_OF_INDEXES;
+    DeleteCriticalSection(&control_cs);
+    trace_initialized = FALSE;
+}
@@ -0,0 +1,50 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_TRACE_H
+#define PEEK_TRACE_H
+
+#include <windows.h>
+
+#define TRACE_MAX_THREADS 64            // Threads tracing at once; an exited thread's slot is reused
+#define TRACE_EVENTS_PER_THREAD 32768   // Ring per thread: the newest events are kept
+#define TRACE_DETAIL_SIZE 40            // Inline copy of the optional detail (file name...)
+
+// Opt-in span tracer. Each thread appends begin/end events to its own ring
+// (no locks, no shared cache lines); a dump writes Chrome trace-event JSON
+// that loads in chrome://tracing or ui.perfetto.dev.
+//
+// Start with PEEK_TRACE=1, or toggle with F12 in the main window (stopping
+// writes %APPDATA%\Peek\traces\peek-trace-YYYYMMDD-HHMMSS.json).
+//
+// Span names must be string literals. When tracing is off every macro is a
+// single test of trace_enabled.
+
+extern volatile LONG trace_enabled;
+
+void trace_event(char phase, const char* name, const char* detail);
+
+#define TRACE_BEGIN(name) do { if (trace_enabled) trace_event('B', (name), NULL); } while (0)
+#define TRACE_BEGIN_DETAIL(name, detail) do { if (trace_enabled) trace_event('B', (name), (detail)); } while (0)
+#define TRACE_END(name) do { if (trace_enabled) trace_event('E', (name), NULL); } while (0)
+
+// Reads PEEK_TRACE; call once before other threads start tracing
+void trace_init(void);
+
+// Writes a final trace if one is running
+void trace_cleanup(void);
+
+// Clear every ring and start recording
+void trace_start(void);
+
+// Stop recording and write the trace. Returns 0 and the file path on success
+int trace_stop(char* path_out, size_t path_size);
+
+// Write what has been recorded so far to `path`. Returns 0 on success
+int trace_dump(const char* path);
+
+// Label the calling thread in the trace viewer (name must outlive the trace)
+void trace_name_thread(const char* name);
+
+#endif
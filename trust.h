@@ -0,0 +1,23 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_TRUST_H
+#define PEEK_TRUST_H
+
+// Trust levels shared by the Windows (Authenticode) and Linux (package
+// database) verifiers. Kept free of platform headers.
+
+typedef enum {
+    TRUST_UNKNOWN = 0,            // Not yet verified (gray)
+    TRUST_MICROSOFT_SIGNED,       // Signed by Microsoft/Windows (dark green)
+    TRUST_VERIFIED_SIGNED,        // Signed by verified publisher (green)
+    TRUST_MANUAL_TRUSTED,         // Manually marked as trusted (yellow-green)
+    TRUST_UNSIGNED,               // Not signed (orange)
+    TRUST_INVALID,                // Invalid/expired signature (red)
+    TRUST_MANUAL_THREAT,          // Manually marked as threat (dark red)
+    TRUST_ERROR,                  // Error during verification (gray-red)
+    TRUST_BLOCKLISTED             // Remote address or binary hash on a threat feed (purple)
+} TrustStatus;
+
+#endif
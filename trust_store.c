@@ -0,0 +1,749 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#include "trust_store.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wincrypt.h>
+#include <shlobj.h>
+#include <aclapi.h>
+
+// Fixed pool of entries with chained hash buckets (indices), like security_cache.c
+typedef struct {
+    char process_path[MAX_PATH];
+    TrustStatus status;
+    DWORD path_hash;
+    int bucket_next;         // Next entry in bucket chain, or in the free list
+    BOOL used;
+} TrustStoreEntry;
+
+static TrustStoreEntry* entries = NULL;
+static int* buckets = NULL;
+static int bucket_mask = 0;
+static int entry_count = 0;
+static int free_head = -1;
+
+static SRWLOCK store_lock = SRWLOCK_INIT;
+static BOOL store_initialized = FALSE;
+
+// ============================================================================
+// On-disk formats
+// ============================================================================
+//
+// Snapshot (trust_overrides.dat, same layout as before journaling):
+//   [MAGIC:4][VERSION:4][COUNT:4][DPAPI(TrustOverrideRecord[COUNT])]
+//
+// Journal (trust_overrides.journal):
+//   [TrustJournalHeader] then per change [SIZE:4][DPAPI(TrustJournalPayload)]
+//
+// Replaying the journal over the snapshot is idempotent (last write wins), so
+// a crash between writing a new snapshot and trimming the journal is harmless.
+
+#define TRUST_SNAPSHOT_MAGIC 0x4B454550   // "PEEK"
+#define TRUST_SNAPSHOT_VERSION 2          // Version 2 = DPAPI
+#define TRUST_JOURNAL_MAGIC 0x4A4F5450    // "PTOJ"
+#define TRUST_JOURNAL_VERSION 1
+#define TRUST_JOURNAL_MAX_BLOB 4096       // DPAPI output for one payload is well below this
+
+typedef struct {
+    char process_path[MAX_PATH];
+    TrustStatus override_status;
+    BOOL valid;
+} TrustOverrideRecord;
+
+typedef struct {
+    DWORD magic;
+    DWORD version;
+} TrustJournalHeader;
+
+// Only the used part of `process_path` is encrypted
+typedef struct {
+    DWORD status;
+    DWORD path_len;
+    char process_path[MAX_PATH];
+} TrustJournalPayload;
+
+#define TRUST_JOURNAL_PAYLOAD_HEADER (2 * sizeof(DWORD))
+
+static char snapshot_path[MAX_PATH] = {0};
+static char journal_path[MAX_PATH] = {0};
+
+// Journal handle and record count (journal_cs held)
+static HANDLE journal_file = INVALID_HANDLE_VALUE;
+static int journal_records = 0;
+static CRITICAL_SECTION journal_cs;
+
+static HANDLE compactor_thread = NULL;
+static HANDLE compactor_wake_event = NULL;
+static HANDLE compactor_stop_event = NULL;
+
+static DWORD hash_path(const char* path) {
+    DWORD h = 2166136261u;
+    while (*path) {
+        h ^= (BYTE)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ============================================================================
+// Index helpers (store_lock held)
+// ============================================================================
+
+static int find_entry(const char* path, DWORD h) {
+    for (int idx = buckets[h & bucket_mask]; idx >= 0; idx = entries[idx].bucket_next) {
+        if (entries[idx].path_hash == h && strcmp(entries[idx].process_path, path) == 0) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+static void remove_entry(int idx) {
+    int* link = &buckets[entries[idx].path_hash & bucket_mask];
+    while (*link != idx) {
+        link = &entries[*link].bucket_next;
+    }
+    *link = entries[idx].bucket_next;
+
+    entries[idx].used = FALSE;
+    entries[idx].bucket_next = free_head;
+    free_head = idx;
+    entry_count--;
+}
+
+// Returns FALSE only when a new entry is needed and the pool is full
+static BOOL set_locked(const char* process_path, TrustStatus status) {
+    DWORD h = hash_path(process_path);
+    int idx = find_entry(process_path, h);
+
+    if (status == TRUST_UNKNOWN) {
+        if (idx >= 0) {
+            remove_entry(idx);
+        }
+        return TRUE;
+    }
+
+    if (idx < 0) {
+        if (free_head < 0) {
+            return FALSE;
+        }
+        idx = free_head;
+        free_head = entries[idx].bucket_next;
+
+        TrustStoreEntry* e = &entries[idx];
+        strncpy(e->process_path, process_path, MAX_PATH - 1);
+        e->process_path[MAX_PATH - 1] = '\0';
+        e->path_hash = h;
+        e->used = TRUE;
+        e->bucket_next = buckets[h & bucket_mask];
+        buckets[h & bucket_mask] = idx;
+        entry_count++;
+    }
+
+    entries[idx].status = status;
+    return TRUE;
+}
+
+// ============================================================================
+// DPAPI & file protection
+// ============================================================================
+
+// Encrypt data using DPAPI (user-scoped, tied to Windows account)
+static BOOL dpapi_encrypt(const BYTE* plaintext, DWORD plaintext_len, BYTE** ciphertext, DWORD* ciphertext_len) {
+    DATA_BLOB input;
+    DATA_BLOB output;
+
+    input.pbData = (BYTE*)plaintext;
+    input.cbData = plaintext_len;
+
+    // Encrypt with DPAPI (CRYPTPROTECT_LOCAL_MACHINE for machine scope, 0 for user scope)
+    // Using user scope for better security isolation
+    if (!CryptProtectData(&input, L"PEEK Trust Overrides", NULL, NULL, NULL,
+                          CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        LOG_ERROR("DPAPI encryption failed: %lu", GetLastError());
+        return FALSE;
+    }
+
+    *ciphertext = output.pbData;
+    *ciphertext_len = output.cbData;
+    return TRUE;
+}
+
+// Decrypt data using DPAPI
+static BOOL dpapi_decrypt(const BYTE* ciphertext, DWORD ciphertext_len, BYTE** plaintext, DWORD* plaintext_len) {
+    DATA_BLOB input;
+    DATA_BLOB output;
+    LPWSTR description = NULL;
+
+    input.pbData = (BYTE*)ciphertext;
+    input.cbData = ciphertext_len;
+
+    if (!CryptUnprotectData(&input, &description, NULL, NULL, NULL,
+                            CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+        LOG_ERROR("DPAPI decryption failed: %lu", GetLastError());
+        return FALSE;
+    }
+
+    if (description) {
+        LocalFree(description);
+    }
+
+    *plaintext = output.pbData;
+    *plaintext_len = output.cbData;
+    return TRUE;
+}
+
+// Set restrictive ACLs on a file (user only)
+void trust_store_protect_file(const char* file_path) {
+    // Get current user SID
+    HANDLE hToken = NULL;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &hToken)) {
+        LOG_WARNING("Failed to open process token for ACL: %lu", GetLastError());
+        return;
+    }
+
+    DWORD dwSize = 0;
+    GetTokenInformation(hToken, TokenUser, NULL, 0, &dwSize);
+    PTOKEN_USER pTokenUser = (PTOKEN_USER)malloc(dwSize);
+
+    if (!GetTokenInformation(hToken, TokenUser, pTokenUser, dwSize, &dwSize)) {
+        LOG_WARNING("Failed to get token information: %lu", GetLastError());
+        free(pTokenUser);
+        CloseHandle(hToken);
+        return;
+    }
+
+    PSID pSID = pTokenUser->User.Sid;
+    CloseHandle(hToken);
+
+    // Create ACL with only user access
+    EXPLICIT_ACCESSA ea[1];
+    ZeroMemory(&ea, sizeof(EXPLICIT_ACCESSA));
+    ea[0].grfAccessPermissions = GENERIC_READ | GENERIC_WRITE;
+    ea[0].grfAccessMode = SET_ACCESS;
+    ea[0].grfInheritance = NO_INHERITANCE;
+    ea[0].Trustee.TrusteeForm = TRUSTEE_IS_SID;
+    ea[0].Trustee.TrusteeType = TRUSTEE_IS_USER;
+    ea[0].Trustee.ptstrName = (LPSTR)pSID;
+
+    PACL pACL = NULL;
+    DWORD dwRes = SetEntriesInAclA(1, ea, NULL, &pACL);
+
+    if (dwRes != ERROR_SUCCESS) {
+        LOG_WARNING("SetEntriesInAcl failed: %lu", dwRes);
+        free(pTokenUser);
+        return;
+    }
+
+    // Apply ACL to file
+    dwRes = SetNamedSecurityInfoA(
+        (LPSTR)file_path,
+        SE_FILE_OBJECT,
+        DACL_SECURITY_INFORMATION | PROTECTED_DACL_SECURITY_INFORMATION,
+        NULL,
+        NULL,
+        pACL,
+        NULL
+    );
+
+    if (dwRes != ERROR_SUCCESS) {
+        LOG_WARNING("SetNamedSecurityInfo failed: %lu", dwRes);
+    }
+
+    LocalFree(pACL);
+    free(pTokenUser);
+}
+
+static void quarantine_file(const char* path) {
+    char corrupt_path[MAX_PATH];
+    snprintf(corrupt_path, MAX_PATH, "%s.corrupt.%lu", path, (unsigned long)GetTickCount());
+    MoveFileA(path, corrupt_path);
+}
+
+// ============================================================================
+// Snapshot
+// ============================================================================
+
+static void load_snapshot(void) {
+    FILE* f = fopen(snapshot_path, "rb");
+    if (!f) {
+        LOG_INFO("No trust overrides file found (first run)");
+        return;
+    }
+
+    // Read entire file
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (file_size < 12) {
+        LOG_ERROR("Trust overrides file too small (corrupted)");
+        fclose(f);
+        return;
+    }
+
+    BYTE* file_data = (BYTE*)malloc(file_size);
+    if (!file_data || fread(file_data, 1, file_size, f) != (size_t)file_size) {
+        LOG_ERROR("Failed to read trust overrides file");
+        free(file_data);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+
+    // Check magic + count
+    DWORD magic = *(DWORD*)&file_data[0];
+    DWORD count = *(DWORD*)&file_data[8];
+
+    if (magic != TRUST_SNAPSHOT_MAGIC) {
+        LOG_ERROR("Invalid trust overrides file (bad magic) - renaming to .corrupt");
+        quarantine_file(snapshot_path);
+        free(file_data);
+        return;
+    }
+
+    if (count > TRUST_STORE_MAX_ENTRIES) {
+        LOG_ERROR("Invalid count in trust overrides file");
+        free(file_data);
+        return;
+    }
+
+    // DPAPI encrypted data starts at offset 12
+    BYTE* decrypted_data = NULL;
+    DWORD decrypted_size = 0;
+
+    if (!dpapi_decrypt(&file_data[12], (DWORD)(file_size - 12), &decrypted_data, &decrypted_size)) {
+        LOG_ERROR("DPAPI decryption failed - file may be corrupted or tampered");
+        quarantine_file(snapshot_path);
+        free(file_data);
+        return;
+    }
+    free(file_data);
+
+    // Verify size matches
+    size_t expected_size = count * sizeof(TrustOverrideRecord);
+    if (decrypted_size != expected_size) {
+        LOG_ERROR("Decrypted data size mismatch (expected %zu, got %lu)", expected_size, (unsigned long)decrypted_size);
+        LocalFree(decrypted_data);
+        return;
+    }
+
+    const TrustOverrideRecord* records = (const TrustOverrideRecord*)decrypted_data;
+    for (DWORD i = 0; i < count; i++) {
+        if (records[i].valid && records[i].process_path[MAX_PATH - 1] == '\0') {
+            set_locked(records[i].process_path, records[i].override_status);
+        }
+    }
+    LocalFree(decrypted_data);
+}
+
+// Atomically replace the snapshot with `count` records
+static BOOL write_snapshot(const TrustOverrideRecord* records, DWORD count) {
+    BYTE* encrypted_blob = NULL;
+    DWORD encrypted_size = 0;
+
+    if (!dpapi_encrypt((const BYTE*)records, count * sizeof(TrustOverrideRecord), &encrypted_blob, &encrypted_size)) {
+        return FALSE;
+    }
+
+    // Atomic write: write to temp file first
+    char temp_path[MAX_PATH];
+    snprintf(temp_path, MAX_PATH, "%s.tmp", snapshot_path);
+
+    FILE* f = fopen(temp_path, "wb");
+    if (!f) {
+        LOG_ERROR("Failed to create temp file for trust overrides");
+        LocalFree(encrypted_blob);
+        return FALSE;
+    }
+
+    DWORD header[3] = {TRUST_SNAPSHOT_MAGIC, TRUST_SNAPSHOT_VERSION, count};
+    BOOL ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+              fwrite(encrypted_blob, 1, encrypted_size, f) == encrypted_size;
+    ok = (fclose(f) == 0) && ok;
+    LocalFree(encrypted_blob);
+
+    if (!ok) {
+        DeleteFileA(temp_path);
+        return FALSE;
+    }
+
+    // Atomic replace using Windows ReplaceFile
+    if (!ReplaceFileA(snapshot_path, temp_path, NULL, REPLACEFILE_WRITE_THROUGH, NULL, NULL)) {
+        // If target doesn't exist, just rename
+        if (GetLastError() != ERROR_FILE_NOT_FOUND || !MoveFileA(temp_path, snapshot_path)) {
+            LOG_ERROR("Failed to replace trust overrides file: %lu", GetLastError());
+            DeleteFileA(temp_path);
+            return FALSE;
+        }
+    }
+
+    trust_store_protect_file(snapshot_path);
+    return TRUE;
+}
+
+// ============================================================================
+// Journal
+// ============================================================================
+
+// Replay records onto the index and leave `journal_file` open at the end of
+// the last valid record (a torn or tampered tail is cut off)
+static void open_journal(void) {
+    BOOL created = (GetFileAttributesA(journal_path) == INVALID_FILE_ATTRIBUTES);
+    journal_file = CreateFileA(journal_path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+    if (journal_file == INVALID_HANDLE_VALUE) {
+        LOG_WARNING("Unable to open trust overrides journal: %lu", GetLastError());
+        return;
+    }
+
+    LARGE_INTEGER size;
+    BYTE* data = NULL;
+    DWORD bytes_read = 0;
+    if (GetFileSizeEx(journal_file, &size) && size.QuadPart > 0 && size.QuadPart < 64 * 1024 * 1024) {
+        data = (BYTE*)malloc((size_t)size.QuadPart);
+        if (data && !ReadFile(journal_file, data, (DWORD)size.QuadPart, &bytes_read, NULL)) {
+            bytes_read = 0;
+        }
+    }
+
+    DWORD valid_end = sizeof(TrustJournalHeader);
+    const TrustJournalHeader* header = (const TrustJournalHeader*)data;
+    if (bytes_read >= sizeof(TrustJournalHeader) &&
+        header->magic == TRUST_JOURNAL_MAGIC && header->version == TRUST_JOURNAL_VERSION) {
+        DWORD offset = sizeof(TrustJournalHeader);
+        while (offset + sizeof(DWORD) <= bytes_read) {
+            DWORD blob_size = *(const DWORD*)(data + offset);
+            if (blob_size == 0 || blob_size > TRUST_JOURNAL_MAX_BLOB ||
+                offset + sizeof(DWORD) + blob_size > bytes_read) {
+                break;  // Torn append
+            }
+
+            BYTE* plain = NULL;
+            DWORD plain_size = 0;
+            if (!dpapi_decrypt(data + offset + sizeof(DWORD), blob_size, &plain, &plain_size)) {
+                LOG_ERROR("Trust overrides journal record rejected (tampered?) - ignoring the rest");
+                break;
+            }
+
+            const TrustJournalPayload* payload = (const TrustJournalPayload*)plain;
+            BOOL valid = plain_size >= TRUST_JOURNAL_PAYLOAD_HEADER &&
+                         payload->path_len > 0 && payload->path_len < MAX_PATH &&
+                         plain_size == TRUST_JOURNAL_PAYLOAD_HEADER + payload->path_len &&
+                         payload->status <= TRUST_BLOCKLISTED;
+            if (valid) {
+                char path[MAX_PATH];
+                memcpy(path, payload->process_path, payload->path_len);
+                path[payload->path_len] = '\0';
+                set_locked(path, (TrustStatus)payload->status);
+                journal_records++;
+            }
+            LocalFree(plain);
+            if (!valid) {
+                break;
+            }
+
+            offset += sizeof(DWORD) + blob_size;
+            valid_end = offset;
+        }
+    } else if (bytes_read > 0) {
+        LOG_ERROR("Invalid trust overrides journal - starting a new one");
+    }
+    free(data);
+
+    // Rewrite the header if needed and drop anything past the last good record
+    TrustJournalHeader fresh = {TRUST_JOURNAL_MAGIC, TRUST_JOURNAL_VERSION};
+    DWORD written = 0;
+    LARGE_INTEGER position;
+    position.QuadPart = 0;
+    SetFilePointerEx(journal_file, position, NULL, FILE_BEGIN);
+    WriteFile(journal_file, &fresh, sizeof(fresh), &written, NULL);
+    position.QuadPart = valid_end;
+    SetFilePointerEx(journal_file, position, NULL, FILE_BEGIN);
+    SetEndOfFile(journal_file);
+
+    if (created) {
+        trust_store_protect_file(journal_path);
+    }
+}
+
+static BOOL append_journal(const char* process_path, TrustStatus status) {
+    TrustJournalPayload payload;
+    payload.status = (DWORD)status;
+    payload.path_len = (DWORD)strlen(process_path);
+    if (payload.path_len == 0 || payload.path_len >= MAX_PATH) {
+        return FALSE;
+    }
+    memcpy(payload.process_path, process_path, payload.path_len);
+
+    BYTE* encrypted_blob = NULL;
+    DWORD encrypted_size = 0;
+    if (!dpapi_encrypt((const BYTE*)&payload, TRUST_JOURNAL_PAYLOAD_HEADER + payload.path_len,
+                       &encrypted_blob, &encrypted_size)) {
+        return FALSE;
+    }
+
+    // Size prefix and blob in one write so a crash leaves at most one torn record
+    BYTE record[sizeof(DWORD) + TRUST_JOURNAL_MAX_BLOB];
+    BOOL ok = encrypted_size <= TRUST_JOURNAL_MAX_BLOB;
+    if (ok) {
+        memcpy(record, &encrypted_size, sizeof(DWORD));
+        memcpy(record + sizeof(DWORD), encrypted_blob, encrypted_size);
+    }
+    LocalFree(encrypted_blob);
+
+    int records = 0;
+    EnterCriticalSection(&journal_cs);
+    if (ok && journal_file != INVALID_HANDLE_VALUE) {
+        DWORD to_write = sizeof(DWORD) + encrypted_size;
+        DWORD written = 0;
+        LARGE_INTEGER zero;
+        zero.QuadPart = 0;
+        ok = SetFilePointerEx(journal_file, zero, NULL, FILE_END) &&
+             WriteFile(journal_file, record, to_write, &written, NULL) && written == to_write;
+        if (ok) {
+            records = ++journal_records;
+        }
+    } else {
+        ok = FALSE;
+    }
+    LeaveCriticalSection(&journal_cs);
+
+    if (records >= TRUST_STORE_COMPACT_RECORDS && compactor_wake_event) {
+        SetEvent(compactor_wake_event);
+    }
+    return ok;
+}
+
+// Fold the journal into a fresh snapshot. Appends made while the snapshot is
+// written are kept: only the journal prefix the snapshot covers is dropped.
+static void compact_journal(void) {
+    EnterCriticalSection(&journal_cs);
+    if (journal_file == INVALID_HANDLE_VALUE || journal_records == 0) {
+        LeaveCriticalSection(&journal_cs);
+        return;
+    }
+
+    LARGE_INTEGER cut;
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    SetFilePointerEx(journal_file, zero, &cut, FILE_END);
+    int covered_records = journal_records;
+
+    AcquireSRWLockShared(&store_lock);
+    DWORD count = (DWORD)entry_count;
+    TrustOverrideRecord* records = (TrustOverrideRecord*)calloc(count ? count : 1, sizeof(TrustOverrideRecord));
+    if (records) {
+        DWORD n = 0;
+        for (int idx = 0; idx < TRUST_STORE_MAX_ENTRIES && n < count; idx++) {
+            if (entries[idx].used) {
+                memcpy(records[n].process_path, entries[idx].process_path, MAX_PATH);
+                records[n].override_status = entries[idx].status;
+                records[n].valid = TRUE;
+                n++;
+            }
+        }
+    }
+    ReleaseSRWLockShared(&store_lock);
+    LeaveCriticalSection(&journal_cs);
+
+    if (!records) {
+        return;
+    }
+    BOOL written = write_snapshot(records, count);
+    free(records);
+    if (!written) {
+        return;
+    }
+
+    // Keep only the records appended after `cut`
+    EnterCriticalSection(&journal_cs);
+    LARGE_INTEGER end;
+    SetFilePointerEx(journal_file, zero, &end, FILE_END);
+    DWORD tail_size = (DWORD)(end.QuadPart - cut.QuadPart);
+    BYTE* tail = tail_size ? (BYTE*)malloc(tail_size) : NULL;
+    DWORD bytes = 0;
+
+    if (tail_size == 0 || (tail && SetFilePointerEx(journal_file, cut, NULL, FILE_BEGIN) &&
+                           ReadFile(journal_file, tail, tail_size, &bytes, NULL) && bytes == tail_size)) {
+        LARGE_INTEGER body;
+        body.QuadPart = sizeof(TrustJournalHeader);
+        SetFilePointerEx(journal_file, body, NULL, FILE_BEGIN);
+        if (tail_size > 0) {
+            WriteFile(journal_file, tail, tail_size, &bytes, NULL);
+        }
+        SetEndOfFile(journal_file);
+        journal_records -= covered_records;
+    }
+    free(tail);
+    LeaveCriticalSection(&journal_cs);
+
+    LOG_INFO("Trust overrides journal compacted (%lu override(s))", (unsigned long)count);
+}
+
+static DWORD WINAPI TrustStoreCompactorThread(LPVOID lpParam) {
+    (void)lpParam;
+
+    HANDLE events[2] = {compactor_stop_event, compactor_wake_event};
+    while (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        compact_journal();
+    }
+    return 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int trust_store_init(void) {
+    if (store_initialized) {
+        return 0;
+    }
+
+    int bucket_count = 1;
+    while (bucket_count < TRUST_STORE_MAX_ENTRIES * 2) {
+        bucket_count <<= 1;
+    }
+
+    entries = (TrustStoreEntry*)calloc(TRUST_STORE_MAX_ENTRIES, sizeof(TrustStoreEntry));
+    buckets = (int*)malloc((size_t)bucket_count * sizeof(int));
+    if (!entries || !buckets) {
+        LOG_ERROR("Failed to allocate trust override store");
+        free(entries);
+        free(buckets);
+        entries = NULL;
+        buckets = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < bucket_count; i++) {
+        buckets[i] = -1;
+    }
+    for (int i = 0; i < TRUST_STORE_MAX_ENTRIES; i++) {
+        entries[i].bucket_next = (i + 1 < TRUST_STORE_MAX_ENTRIES) ? i + 1 : -1;
+    }
+    bucket_mask = bucket_count - 1;
+    entry_count = 0;
+    free_head = 0;
+
+    char appdata[MAX_PATH];
+    if (SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appdata) == S_OK) {
+        snprintf(snapshot_path, MAX_PATH, "%s\\Peek", appdata);
+        CreateDirectoryA(snapshot_path, NULL);
+        snprintf(snapshot_path, MAX_PATH, "%s\\Peek\\trust_overrides.dat", appdata);
+        snprintf(journal_path, MAX_PATH, "%s\\Peek\\trust_overrides.journal", appdata);
+        LOG_INFO("Secure file path: %s", snapshot_path);
+    } else {
+        // Fallback to current directory
+        strcpy(snapshot_path, "trust_overrides.dat");
+        strcpy(journal_path, "trust_overrides.journal");
+        LOG_WARNING("Using fallback file path");
+    }
+
+    InitializeCriticalSection(&journal_cs);
+
+    // Single-threaded until the compactor starts: no locking needed here
+    load_snapshot();
+    open_journal();
+    store_initialized = TRUE;
+
+    compactor_wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    compactor_stop_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (compactor_wake_event && compactor_stop_event) {
+        compactor_thread = CreateThread(NULL, 0, TrustStoreCompactorThread, NULL, 0, NULL);
+    }
+    if (compactor_thread && journal_records >= TRUST_STORE_COMPACT_RECORDS) {
+        SetEvent(compactor_wake_event);
+    }
+
+    LOG_SUCCESS("Loaded %d trust override(s) (DPAPI verified, %d journal record(s))",
+                entry_count, journal_records);
+    return 0;
+}
+
+void trust_store_cleanup(void) {
+    if (!store_initialized) {
+        return;
+    }
+
+    // A compaction in progress finishes first; the journal stays for next launch
+    if (compactor_thread) {
+        SetEvent(compactor_stop_event);
+        WaitForSingleObject(compactor_thread, INFINITE);
+        CloseHandle(compactor_thread);
+        compactor_thread = NULL;
+    }
+    if (compactor_wake_event) CloseHandle(compactor_wake_event);
+    if (compactor_stop_event) CloseHandle(compactor_stop_event);
+    compactor_wake_event = NULL;
+    compactor_stop_event = NULL;
+
+    if (journal_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(journal_file);
+        journal_file = INVALID_HANDLE_VALUE;
+    }
+    journal_records = 0;
+    DeleteCriticalSection(&journal_cs);
+
+    AcquireSRWLockExclusive(&store_lock);
+    free(entries);
+    free(buckets);
+    entries = NULL;
+    buckets = NULL;
+    entry_count = 0;
+    store_initialized = FALSE;
+    ReleaseSRWLockExclusive(&store_lock);
+}
+
+TrustStatus trust_store_get(const char* process_path) {
+    if (!process_path || process_path[0] == '\0') {
+        return TRUST_UNKNOWN;
+    }
+
+    TrustStatus status = TRUST_UNKNOWN;
+    DWORD h = hash_path(process_path);
+
+    AcquireSRWLockShared(&store_lock);
+    if (store_initialized) {
+        int idx = find_entry(process_path, h);
+        if (idx >= 0) {
+            status = entries[idx].status;
+        }
+    }
+    ReleaseSRWLockShared(&store_lock);
+    return status;
+}
+
+BOOL trust_store_set(const char* process_path, TrustStatus status) {
+    if (!process_path || process_path[0] == '\0' || !store_initialized) {
+        return FALSE;
+    }
+
+    AcquireSRWLockExclusive(&store_lock);
+    BOOL stored = set_locked(process_path, status);
+    ReleaseSRWLockExclusive(&store_lock);
+
+    if (!stored) {
+        LOG_ERROR("Trust override store full (%d entries)", TRUST_STORE_MAX_ENTRIES);
+        return FALSE;
+    }
+
+    // The in-memory override stands even if persisting it fails
+    if (append_journal(process_path, status)) {
+        LOG_SUCCESS("Saved trust override for: %s (DPAPI journal)", process_path);
+    } else {
+        LOG_ERROR("Failed to journal trust override for: %s", process_path);
+    }
+    return TRUE;
+}
+
+int trust_store_get_count(void) {
+    AcquireSRWLockShared(&store_lock);
+    int count = entry_count;
+    ReleaseSRWLockShared(&store_lock);
+    return count;
+}
@@ -0,0 +1,37 @@
+/*
+* PEEK - Network Monitor
+*/
+
+#ifndef PEEK_TRUST_STORE_H
+#define PEEK_TRUST_STORE_H
+
+#include <windows.h>
+#include "trust.h"
+
+#define TRUST_STORE_MAX_ENTRIES 8192
+#define TRUST_STORE_COMPACT_RECORDS 256   // Journal length that triggers a background compaction
+
+// Manual trust overrides: hash-indexed in memory, persisted as a DPAPI
+// snapshot (%APPDATA%\Peek\trust_overrides.dat) plus an append-only DPAPI
+// journal (trust_overrides.journal). A change is one small encrypted append;
+// the journal is folded into the snapshot by a background thread.
+
+// Load snapshot + replay journal, start the compactor. Returns 0 on success
+int trust_store_init(void);
+
+void trust_store_cleanup(void);
+
+// O(1); TRUST_UNKNOWN when the path has no override
+TrustStatus trust_store_get(const char* process_path);
+
+// Set (or clear with TRUST_UNKNOWN) an override and journal it.
+// FALSE only when the store is full
+BOOL trust_store_set(const char* process_path, TrustStatus status);
+
+int trust_store_get_count(void);
+
+// Replace the DACL of a file with a protected one granting the current user
+// only. Also used for the other persisted verdicts (security cache)
+void trust_store_protect_file(const char* file_path);
+
+#endif